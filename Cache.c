@@ -0,0 +1,247 @@
+//----------------------------------------------------------------------------
+//  Description:  Flash program cache (RECEIVING VERSION), see Cache.h
+//----------------------------------------------------------------------------
+
+
+#include "TI_CC/include.h"
+#include "Clock.h"
+#include "Crc16.h"
+#include "Motion.h"
+#include "Cache.h"
+
+typedef struct
+{
+  unsigned int marker;                      // CACHE_VALID, written last
+  unsigned int hash;                        // CRC-16 of the program
+  unsigned int length;
+  unsigned int stamp;                       // Store order
+  char program[MOTION_MAX_INSTR];
+} Cache_Entry;
+
+typedef union
+{
+  Cache_Entry entry;
+  char erase[CACHE_SEGMENT_SIZE];           // Whole flash segment
+} Cache_Segment;
+
+// The cache itself, in main flash.  Volatile: the code below changes it.
+// The device header may place it (the host simulator write-protects it).
+#ifndef CACHE_FLASH_PLACEMENT
+#define CACHE_FLASH_PLACEMENT
+#endif
+#pragma data_alignment=CACHE_SEGMENT_SIZE
+static const volatile Cache_Segment flash[CACHE_SEGMENTS]
+  CACHE_FLASH_PLACEMENT = { 0 };
+
+static char valid[CACHE_SEGMENTS];
+static unsigned int lastUse[CACHE_SEGMENTS];
+static unsigned int useCount;               // Next store stamp or use
+static char *offered;                       // Program to store, from the ISR
+static unsigned int offeredLen;
+static unsigned int offeredHash;
+static volatile char pending = 0;
+
+
+// Erase one segment.  Interrupts must be off.
+static void flashErase(const volatile Cache_Segment *seg)
+{
+  FCTL2 = FWKEY + FSSEL_1 + CLOCK_FLASH_FN; // MCLK / (FN+1)
+  FCTL3 = FWKEY;                            // Unlock
+  FCTL1 = FWKEY + ERASE;
+  *(volatile char *)seg->erase = 0;         // Dummy write starts the erase
+  FCTL1 = FWKEY;
+  FCTL3 = FWKEY + LOCK;
+}
+
+// Write "count" bytes to erased flash.  Interrupts must be off.
+static void flashWrite(const volatile void *dst, const char *src,
+                       unsigned int count)
+{
+  volatile char *d = (volatile char *)dst;
+  unsigned int i;
+
+  FCTL2 = FWKEY + FSSEL_1 + CLOCK_FLASH_FN;
+  FCTL3 = FWKEY;
+  FCTL1 = FWKEY + WRT;
+  for (i = 0; i < count; i++)
+    d[i] = src[i];
+  FCTL1 = FWKEY;
+  FCTL3 = FWKEY + LOCK;
+}
+
+
+// Non-zero if segment "s" holds a whole program
+static char check(char s)
+{
+  const volatile Cache_Entry *e = &flash[s].entry;
+  unsigned int crc = CRC16_INIT;
+  unsigned int i;
+
+  if (e->marker != CACHE_VALID || e->length > MOTION_MAX_INSTR)
+    return 0;
+  for (i = 0; i < e->length; i++)
+    crc = Crc16_Update(crc, e->program[i]);
+  return crc == e->hash;
+}
+
+
+// Segment holding the program, or CACHE_SEGMENTS
+static char find(unsigned int hash, unsigned int length)
+{
+  char s;
+
+  for (s = 0; s < CACHE_SEGMENTS; s++)
+    if (valid[s] && flash[s].entry.hash == hash
+        && flash[s].entry.length == length)
+      break;
+  return s;
+}
+
+
+//-----------------------------------------------------------------------------
+//  void Cache_Init(void)
+//
+//  DESCRIPTION:
+//  Finds the segments holding whole programs and orders them by when they
+//  were stored.  Clock_Init() must have been called.
+//-----------------------------------------------------------------------------
+void Cache_Init(void)
+{
+  char s;
+
+  useCount = 0;
+  for (s = 0; s < CACHE_SEGMENTS; s++)
+  {
+    valid[s] = check(s);
+    if (!valid[s])
+      continue;
+    lastUse[s] = flash[s].entry.stamp;
+    if ((int)(lastUse[s] - useCount) >= 0)
+      useCount = lastUse[s] + 1;
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+//  char Cache_Copy(unsigned int hash, unsigned int length, char *program)
+//
+//  DESCRIPTION:
+//  Looks a program up by hash and length, and copies it out on a hit.
+//  Called from the PORT2 interrupt.
+//
+//  ARGUMENTS:
+//      char *program
+//          MOTION_MAX_INSTR bytes, e.g. a slot from Motion_Claim()
+//
+//  RETURN VALUE:
+//      char
+//          1:  Hit, the program is in "program"
+//          0:  Miss
+//-----------------------------------------------------------------------------
+char Cache_Copy(unsigned int hash, unsigned int length, char *program)
+{
+  char s = find(hash, length);
+  unsigned int i;
+
+  if (s == CACHE_SEGMENTS)
+    return 0;
+  for (i = 0; i < length; i++)
+    program[i] = flash[s].entry.program[i];
+  lastUse[s] = useCount++;
+  return 1;
+}
+
+
+//-----------------------------------------------------------------------------
+//  void Cache_Offer(char *program, unsigned int length)
+//
+//  DESCRIPTION:
+//  A program just received in full, from the PORT2 interrupt.  It is hashed
+//  here, while the slot still holds it.  A program already cached counts
+//  as a use of its segment; any other is stored by Cache_Poll(), and only
+//  the last one offered is kept.
+//-----------------------------------------------------------------------------
+void Cache_Offer(char *program, unsigned int length)
+{
+  unsigned int hash = Crc16(program, length);
+  char s = find(hash, length);
+
+  pending = 0;
+  if (s < CACHE_SEGMENTS)
+  {
+    lastUse[s] = useCount++;
+    return;
+  }
+  offered = program;
+  offeredLen = length;
+  offeredHash = hash;
+  pending = 1;
+}
+
+// The slot "program" is taken for a new program, from the PORT2 interrupt.
+// A program offered from it and not stored yet is gone: the offer is dropped.
+void Cache_Claimed(char *program)
+{
+  if (offered == program)
+    pending = 0;
+}
+
+// Non-zero if Cache_Poll() has a program to store now
+char Cache_Pending(void)
+{
+  return pending && !TI_CC_SPIBusy();
+}
+
+
+//-----------------------------------------------------------------------------
+//  void Cache_Poll(void)
+//
+//  DESCRIPTION:
+//  Stores the program from Cache_Offer() in a free segment, or in the least
+//  recently used one.  The program is written with interrupts off, so a
+//  fragment can't change it half way.  Call it from main().
+//
+//  The erase holds interrupts off for tens of ms, which would stall an SPI
+//  transaction running from the USCI interrupt (a TXFIFO load: the ack of
+//  the last fragment).  The program waits for it; the end of the
+//  transaction wakes main().
+//-----------------------------------------------------------------------------
+void Cache_Poll(void)
+{
+  unsigned int hdr[3];                      // hash, length, stamp
+  unsigned int marker = CACHE_VALID;
+  char s, victim;
+
+  _DINT();
+  if (!pending || TI_CC_SPIBusy())
+  {
+    _EINT();
+    return;
+  }
+  pending = 0;
+  hdr[0] = offeredHash;
+  hdr[1] = offeredLen;
+  hdr[2] = useCount;
+
+  victim = 0;
+  for (s = 0; s < CACHE_SEGMENTS; s++)
+  {
+    if (!valid[s])
+    {
+      victim = s;
+      break;
+    }
+    if ((int)(lastUse[s] - lastUse[victim]) < 0)
+      victim = s;
+  }
+
+  valid[victim] = 0;
+  flashErase(&flash[victim]);
+  flashWrite(&flash[victim].entry.hash, (char *)hdr, sizeof(hdr));
+  flashWrite(flash[victim].entry.program, offered, offeredLen);
+  flashWrite(&flash[victim].entry.marker, (char *)&marker,
+             sizeof(marker));               // Last: the entry is whole
+  valid[victim] = check(victim);
+  lastUse[victim] = useCount++;
+  _EINT();
+}
@@ -0,0 +1,38 @@
+//----------------------------------------------------------------------------
+//  Description:  Flash program cache (RECEIVING VERSION)
+//
+//  Programs the car has received are kept in CACHE_SEGMENTS main-flash
+//  segments, one per 512-byte segment, keyed by their CRC-16 (Crc16.h) and
+//  length.  The GUI computes the same hash and first asks for a program
+//  with HOST_RUN / PKT_RUN; only on a miss does it upload the program.
+//
+//  A new program is hashed when it is offered, from the interrupt that
+//  completed it, and written from main() by Cache_Poll() into a free
+//  segment, or else into the least recently used one.  If its slot is
+//  claimed for the next program first, the offer is dropped.  Use (a run
+//  from the cache, or the same program uploaded again) is tracked in RAM;
+//  after a reset the store order in flash stands in for it.  Each
+//  store is one segment erase, so with the flash rated for 10^5 erase cycles
+//  the cache outlives any realistic number of new routes.
+//
+//  Power-loss safety: a segment only counts once its marker word, written
+//  last, reads CACHE_VALID and its program matches its hash.  A store cut
+//  short by a reset leaves a free segment and never a wrong program.
+//
+//  Interrupts stay off for a store, about 35 ms for a full program.  A
+//  packet arriving meanwhile can be lost; the transfer and report retries
+//  cover it.
+//----------------------------------------------------------------------------
+
+
+#define CACHE_SEGMENTS         4           // 2 KB of main flash
+#define CACHE_SEGMENT_SIZE     512
+#define CACHE_VALID            0xCA5E
+
+
+void Cache_Init(void);
+char Cache_Copy(unsigned int, unsigned int, char *);
+void Cache_Offer(char *, unsigned int);
+void Cache_Claimed(char *);
+char Cache_Pending(void);
+void Cache_Poll(void);
@@ -0,0 +1,179 @@
+//----------------------------------------------------------------------------
+//  Description:  Clock profiles
+//----------------------------------------------------------------------------
+
+
+#include "TI_CC/include.h"
+#include "Clock.h"
+#include "Trace.h"
+
+// Fail the build if the UART divisor is more than 2 % off
+#define CLOCK_ERR_OK(f,b)      (CLOCK_BAUD_ERR(f,b) <= 20 && \
+                                CLOCK_BAUD_ERR(f,b) >= -20)
+typedef char clock_baud_check[CLOCK_ERR_OK(CLOCK_HZ, CLOCK_BAUD) ? 1 : -1];
+
+unsigned int Clock_AclkHz = CLOCK_ACLK_HZ;
+
+static Clock_AlarmFn alarmFn[CLOCK_ALARM_FRAME+1];
+static unsigned int alarmWhen[CLOCK_ALARM_FRAME+1]; // TACCR2 alarms' times
+static char alarmArmed = 0;                 // ...and which are armed, by bit
+
+
+//-----------------------------------------------------------------------------
+//  void Clock_Init(void)
+//
+//  DESCRIPTION:
+//  Sets the DCO to the calibrated TI_CC_MCLK_MHZ frequency (MCLK = SMCLK =
+//  DCO) and ACLK to the VLO, measures the VLO into Clock_AclkHz, and starts
+//  Timer_A in continuous mode from ACLK.  Stops if the calibration constants
+//  in information memory have been erased.
+//-----------------------------------------------------------------------------
+void Clock_Init(void)
+{
+  unsigned int start, cycles;
+  char n;
+
+  if (CLOCK_CALBC1 == 0xFF || CLOCK_CALDCO == 0xFF)
+    while (1);                              // Calibration data erased
+
+  DCOCTL = 0;                               // Lowest DCOx/MODx while changing
+  BCSCTL1 = CLOCK_CALBC1;                   // Set range
+  DCOCTL = CLOCK_CALDCO;                    // Set DCO step + modulation
+  BCSCTL3 |= LFXT1S_2;                      // ACLK = VLO
+
+  // Time CLOCK_VLO_PERIODS ACLK periods in SMCLK cycles: TACCR2 captures
+  // Timer_A, counting SMCLK, on each rising edge of CCI2B (ACLK).  At most
+  // 40000 cycles at 16 MHz and the 4 kHz VLO minimum, so TAR cannot wrap.
+  TACTL = TASSEL_2 + MC_2 + TACLR;          // SMCLK, continuous mode
+  TACCTL2 = CM_1 + CCIS_1 + SCS + CAP;
+  start = 0;
+  for (n = 0; n <= CLOCK_VLO_PERIODS; n++)
+  {
+    while (!(TACCTL2 & CCIFG));
+    TACCTL2 &= ~CCIFG;
+    if (!n)
+      start = TACCR2;
+  }
+  cycles = TACCR2 - start;
+  Clock_AclkHz = (CLOCK_HZ * CLOCK_VLO_PERIODS + cycles / 2) / cycles;
+
+  TACCTL0 = TACCTL1 = TACCTL2 = 0;
+  TACTL = TASSEL_1 + MC_2 + TACLR;          // ACLK, continuous mode
+}
+
+
+// Timer_A count.  TAR is clocked from ACLK, asynchronous to MCLK, so read it
+// until two reads agree.
+unsigned int Clock_Now(void)
+{
+  unsigned int t;
+
+  do
+    t = TAR;
+  while (t != TAR);
+  return t;
+}
+
+
+// Point TACCR2 at the earliest armed alarm sharing it.  Interrupts must be
+// off.  An alarm already due is flagged at once, so none is missed.
+static void armShared(void)
+{
+  char a, next = 0;
+
+  for (a = CLOCK_ALARM_LINK; a <= CLOCK_ALARM_FRAME; a++)
+    if ((alarmArmed & (1 << a))
+        && (!next || (int)(alarmWhen[a] - alarmWhen[next]) < 0))
+      next = a;
+  if (!next)
+  {
+    TACCTL2 = 0;
+    return;
+  }
+  TACCR2 = alarmWhen[next];
+  TACCTL2 = CCIE;
+  if ((int)(alarmWhen[next] - Clock_Now()) <= 0)
+    TACCTL2 = CCIE + CCIFG;
+}
+
+
+//-----------------------------------------------------------------------------
+//  void Clock_Alarm(char alarm, unsigned int ticks, Clock_AlarmFn fn)
+//
+//  DESCRIPTION:
+//  Calls "fn" from the Timer_A1 interrupt "ticks" ACLK periods from now.
+//  Re-arming a running alarm replaces it.
+//
+//  ARGUMENTS:
+//      char alarm
+//          CLOCK_ALARM_RADIO, CLOCK_ALARM_LINK or CLOCK_ALARM_FRAME
+//-----------------------------------------------------------------------------
+void Clock_Alarm(char alarm, unsigned int ticks, Clock_AlarmFn fn)
+{
+  __istate_t s = __get_interrupt_state();
+  unsigned int when;
+
+  __disable_interrupt();
+  when = Clock_Now() + ticks;
+  alarmFn[alarm] = fn;
+  if (alarm == CLOCK_ALARM_RADIO)
+  {
+    TACCR1 = when;
+    TACCTL1 = CCIE;
+  }
+  else
+  {
+    alarmWhen[alarm] = when;
+    alarmArmed |= 1 << alarm;
+    armShared();
+  }
+  __set_interrupt_state(s);
+}
+
+void Clock_Cancel(char alarm)
+{
+  __istate_t s = __get_interrupt_state();
+
+  __disable_interrupt();
+  if (alarm == CLOCK_ALARM_RADIO)
+    TACCTL1 = 0;
+  else
+  {
+    alarmArmed &= ~(1 << alarm);
+    armShared();
+  }
+  __set_interrupt_state(s);
+}
+
+
+// Timer_A CCR1/CCR2: alarms
+#pragma vector=TIMERA1_VECTOR
+__interrupt void clock_ISR(void)
+{
+  char alarm, wake = 0;
+  unsigned int now;
+
+  switch (TAIV)
+  {
+    case 2:                                 // TACCR1
+      TRACE(TRACE_ALARM, TRACE_LATE(TACCR1));
+      TACCTL1 = 0;
+      wake = alarmFn[CLOCK_ALARM_RADIO] && alarmFn[CLOCK_ALARM_RADIO]();
+      break;
+    case 4:                                 // TACCR2: every alarm now due
+      TRACE(TRACE_ALARM, TRACE_LATE(TACCR2));
+      now = Clock_Now();
+      for (alarm = CLOCK_ALARM_LINK; alarm <= CLOCK_ALARM_FRAME; alarm++)
+        if ((alarmArmed & (1 << alarm))
+            && (int)(alarmWhen[alarm] - now) <= 0)
+        {
+          alarmArmed &= ~(1 << alarm);
+          if (alarmFn[alarm] && alarmFn[alarm]())
+            wake = 1;
+        }
+      armShared();
+      break;
+  }
+  if (wake)
+    _BIC_SR_IRQ(LPM3_bits);
+}
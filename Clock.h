@@ -0,0 +1,97 @@
+//----------------------------------------------------------------------------
+//  Description:  Clock profiles
+//
+//  TI_CC_MCLK_MHZ (TI_CC_hardware_board.h) selects the DCO frequency.  The
+//  UART divisor and modulation, the SPI divider, the flash timing divider
+//  and the TI_CC_Wait() delays are derived from it.  ACLK comes from the VLO
+//  in every profile, so timers clocked from ACLK keep running in LPM3.
+//
+//  The VLO is only specified to 4-20 kHz and drifts with temperature and
+//  supply, so Clock_Init() measures it against the calibrated DCO and every
+//  ACLK duration (CLOCK_ACLK_TICKS()) uses the measured Clock_AclkHz rather
+//  than the nominal CLOCK_ACLK_HZ.
+//
+//  Timer_A runs continuously from ACLK as the system timebase:
+//      TACCR0   motion steps and dead-man (Motion.c, RECEIVING VERSION),
+//               PKT_DRIVE ticks (Stream.c, SENDING VERSION)
+//      TACCR1   CLOCK_ALARM_RADIO, radio TX timeout, WOR idle and hop scan
+//               (CC2500.c)
+//      TACCR2   CLOCK_ALARM_LINK, link-layer timing, and CLOCK_ALARM_FRAME,
+//               TDMA frame timing (Tdma.h)
+//  The alarms are one-shot and call back from the Timer_A1 interrupt; a
+//  callback returning non-zero wakes main() from LPM.  CLOCK_ALARM_LINK and
+//  CLOCK_ALARM_FRAME share TACCR2, which is set to the earlier of the two.
+//
+//      profile   DCO cal        profile baud   UCBRx  UCBRSx  mean error
+//       1 MHz    CALxx_1MHZ       9600          104      1     +0.040 %
+//       8 MHz    CALxx_8MHZ     115200           69      4     -0.080 %
+//      16 MHz    CALxx_16MHZ    230400           69      4     -0.080 %
+//       8 MHz    CALxx_8MHZ       9600          833      3     -0.005 %
+//      16 MHz    CALxx_16MHZ      9600         1666      5     +0.003 %
+//
+//  host/TestClock.c checks these, the SPI divider and the flash divider of
+//  every profile.
+//
+//  CLOCK_BAUD defaults to 9600 because the eZ430-RF2500 USB backchannel
+//  only runs at 9600.  Define CLOCK_BAUD as CLOCK_PROFILE_BAUD when the
+//  UART is wired to an external USB-serial adapter.
+//----------------------------------------------------------------------------
+
+
+#define CLOCK_MHZ              TI_CC_MCLK_MHZ
+#define CLOCK_HZ               ((unsigned long)CLOCK_MHZ*1000000)
+#define CLOCK_ACLK_HZ          12000       // VLO nominal frequency
+#define CLOCK_VLO_PERIODS      8           // VLO periods Clock_Init() times
+
+#if CLOCK_MHZ == 1
+#define CLOCK_CALBC1           CALBC1_1MHZ
+#define CLOCK_CALDCO           CALDCO_1MHZ
+#define CLOCK_PROFILE_BAUD     9600
+#elif CLOCK_MHZ == 8
+#define CLOCK_CALBC1           CALBC1_8MHZ
+#define CLOCK_CALDCO           CALDCO_8MHZ
+#define CLOCK_PROFILE_BAUD     115200
+#elif CLOCK_MHZ == 16
+#define CLOCK_CALBC1           CALBC1_16MHZ
+#define CLOCK_CALDCO           CALDCO_16MHZ
+#define CLOCK_PROFILE_BAUD     230400
+#endif
+
+#ifndef CLOCK_BAUD
+#define CLOCK_BAUD             9600
+#endif
+
+// USCI_A0 low-frequency baud generation (UCOS16 = 0):
+//   UCBRx  = floor(f / baud)
+//   UCBRSx = round(8 * (f / baud - UCBRx))
+#define CLOCK_UCBR(f,b)        ((f)/(b))
+#define CLOCK_UCBRS(f,b)       ((((f)*16/(b))+1)/2 - 8*CLOCK_UCBR(f,b))
+#define CLOCK_UART_BR          CLOCK_UCBR(CLOCK_HZ, CLOCK_BAUD)
+#define CLOCK_UART_BRS         CLOCK_UCBRS(CLOCK_HZ, CLOCK_BAUD)
+
+// Baud rate actually generated and its error in tenths of a percent
+#define CLOCK_BAUD_ACTUAL(f,b) (((f)*8)/(8*CLOCK_UCBR(f,b) + CLOCK_UCBRS(f,b)))
+#define CLOCK_BAUD_ERR(f,b)    (((long)CLOCK_BAUD_ACTUAL(f,b) - (long)(b))*1000 \
+                                / (long)(b))
+
+// Flash timing generator divider: MCLK / (CLOCK_FLASH_FN + 1) within the
+// 257-476 kHz the flash controller needs (Cache.c)
+#define CLOCK_FLASH_FN         ((CLOCK_HZ + 475999) / 476000 - 1)
+
+// ACLK ticks for a duration in milliseconds, at the measured VLO frequency
+#define CLOCK_ACLK_TICKS(ms)   (((unsigned long)(ms)*Clock_AclkHz)/1000)
+
+
+// Alarm channels (Timer_A capture/compare registers)
+#define CLOCK_ALARM_RADIO      1
+#define CLOCK_ALARM_LINK       2
+#define CLOCK_ALARM_FRAME      3           // Shares TACCR2 with the above
+
+typedef char (*Clock_AlarmFn)(void);
+
+extern unsigned int Clock_AclkHz;          // Set by Clock_Init()
+
+void Clock_Init(void);
+unsigned int Clock_Now(void);
+void Clock_Alarm(char, unsigned int, Clock_AlarmFn);
+void Clock_Cancel(char);
@@ -0,0 +1,31 @@
+//----------------------------------------------------------------------------
+//  Description:  CRC-16/CCITT, four bits at a time from a 16-entry table
+//----------------------------------------------------------------------------
+
+
+#include "Crc16.h"
+
+static const unsigned int crcNibble[16] = {
+  0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+  0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+
+// Add one byte to a running CRC
+unsigned int Crc16_Update(unsigned int crc, char c)
+{
+  crc = (crc << 4) ^ crcNibble[((crc >> 12) ^ ((unsigned char)c >> 4)) & 0x0F];
+  crc = (crc << 4) ^ crcNibble[((crc >> 12) ^ c) & 0x0F];
+  return crc & 0xFFFF;
+}
+
+// CRC of a whole buffer, starting from CRC16_INIT
+unsigned int Crc16(char *buffer, unsigned int count)
+{
+  unsigned int crc = CRC16_INIT;
+  unsigned int i;
+
+  for (i = 0; i < count; i++)
+    crc = Crc16_Update(crc, buffer[i]);
+  return crc;
+}
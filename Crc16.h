@@ -0,0 +1,13 @@
+//----------------------------------------------------------------------------
+//  Description:  CRC-16/CCITT (polynomial 0x1021, initial value 0xFFFF)
+//
+//  Used for the serial frames between the GUI and the SENDING VERSION.  The
+//  MATLAB side computes the same CRC in CarGui.m (crc16).
+//----------------------------------------------------------------------------
+
+
+#define CRC16_INIT             0xFFFF
+
+
+unsigned int Crc16_Update(unsigned int, char);
+unsigned int Crc16(char *, unsigned int);
@@ -0,0 +1,187 @@
+//----------------------------------------------------------------------------
+//  Description:  Instruction encoder and decoder, see Encoding.h
+//
+//  Plain C with no MSP430 dependencies, so the same file can be built for a
+//  host-side tool.
+//----------------------------------------------------------------------------
+
+
+#include "Encoding.h"
+
+// Original one-byte instructions
+#define LEGACY_OP(b)           ((b) & 0x60)
+#define LEGACY_ARG(b)          ((b) & 0x1F)
+#define LEGACY_MAX_ARG         31
+#define LEGACY_TURN_DEG        90
+
+
+// Read a varint at buf[*pos]; returns 0 if it runs past "len" or past 16 bits
+static char getVarint(const char *buf, char len, char *pos, unsigned int *value)
+{
+  unsigned long v = 0;
+  char shift = 0;
+  unsigned char b;
+
+  do
+  {
+    if (*pos >= len || shift > 14)
+      return 0;
+    b = (unsigned char)buf[(*pos)++];
+    v |= (unsigned long)(b & 0x7F) << shift;
+    shift += 7;
+  } while (b & 0x80);
+
+  if (v > 0xFFFF)
+    return 0;
+  *value = (unsigned int)v;
+  return 1;
+}
+
+// Write a varint at buf[*pos]; returns 0 if it doesn't fit in "room"
+static char putVarint(char *buf, char room, char *pos, unsigned int value)
+{
+  do
+  {
+    if (*pos >= room)
+      return 0;
+    buf[(*pos)++] = (value > 0x7F) ? (char)((value & 0x7F) | 0x80)
+                                   : (char)value;
+    value >>= 7;
+  } while (value);
+  return 1;
+}
+
+
+// Decode an original one-byte instruction
+static void decodeLegacy(char b, Encoding_Instr *in)
+{
+  char arg = LEGACY_ARG(b);
+
+  in->repeat = 1;
+  switch (LEGACY_OP(b))
+  {
+    case 0x00:
+      in->op = arg ? ENC_DETONATE : ENC_STOP;
+      in->arg = 0;
+      break;
+    case 0x20:
+      in->op = ENC_FORWARD;
+      in->arg = arg;
+      break;
+    case 0x40:
+      in->op = ENC_BACKWARD;
+      in->arg = arg;
+      break;
+    default:
+      in->op = arg ? ENC_RIGHT : ENC_LEFT;
+      in->arg = LEGACY_TURN_DEG;
+      break;
+  }
+}
+
+// The one-byte form of "in", or -1 if it has none
+static int encodeLegacy(const Encoding_Instr *in)
+{
+  if (in->repeat > 1)
+    return -1;
+  switch (in->op)
+  {
+    case ENC_STOP:
+      return in->arg ? -1 : 0x00;
+    case ENC_DETONATE:
+      return 0x1F;
+    case ENC_FORWARD:
+      return (in->arg <= LEGACY_MAX_ARG) ? 0x20 | in->arg : -1;
+    case ENC_BACKWARD:
+      return (in->arg <= LEGACY_MAX_ARG) ? 0x40 | in->arg : -1;
+    case ENC_LEFT:
+      return (in->arg == LEGACY_TURN_DEG) ? 0x60 : -1;
+    case ENC_RIGHT:
+      return (in->arg == LEGACY_TURN_DEG) ? 0x7F : -1;
+    default:
+      return -1;
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+//  char Encoding_Decode(const char *buf, char len, Encoding_Instr *in)
+//
+//  DESCRIPTION:
+//  Decodes the instruction at the start of "buf", which holds "len" bytes.
+//
+//  RETURN VALUE:
+//      char
+//          Bytes used by the instruction
+//          0:  Instruction truncated or malformed, or repeated though it
+//              takes no time
+//-----------------------------------------------------------------------------
+char Encoding_Decode(const char *buf, char len, Encoding_Instr *in)
+{
+  char pos = 1;
+  char b;
+
+  if (len < 1)
+    return 0;
+  b = buf[0];
+  if (!(b & ENC_EXTENDED))
+  {
+    decodeLegacy(b, in);
+    return 1;
+  }
+
+  in->op = (b >> 4) & 0x07;
+  in->arg = b & 0x07;
+  in->repeat = 1;
+  if (in->arg == ENC_ARG_VARINT && !getVarint(buf, len, &pos, &in->arg))
+    return 0;
+  if (b & ENC_REPEAT)
+  {
+    if (!getVarint(buf, len, &pos, &in->repeat) || !in->repeat
+        || (in->repeat > 1 && !ENC_TIMED(in)))
+      return 0;
+  }
+  return pos;
+}
+
+
+//-----------------------------------------------------------------------------
+//  char Encoding_Encode(char *buf, char room, const Encoding_Instr *in)
+//
+//  DESCRIPTION:
+//  Encodes one instruction into "buf", using the original one-byte form
+//  whenever it can express the instruction so that older receivers still
+//  understand the program.  At most ENC_MAX_BYTES bytes are written.
+//
+//  RETURN VALUE:
+//      char
+//          Bytes written
+//          0:  Not enough room, or a repeat count on an instruction that
+//              takes no time
+//-----------------------------------------------------------------------------
+char Encoding_Encode(char *buf, char room, const Encoding_Instr *in)
+{
+  int legacy = encodeLegacy(in);
+  char pos = 1;
+  char b;
+
+  if (room < 1 || (in->repeat > 1 && !ENC_TIMED(in)))
+    return 0;
+  if (legacy >= 0)
+  {
+    buf[0] = (char)legacy;
+    return 1;
+  }
+
+  b = ENC_EXTENDED | ((in->op & 0x07) << 4);
+  if (in->repeat > 1)
+    b |= ENC_REPEAT;
+  b |= (in->arg < ENC_ARG_VARINT) ? (char)in->arg : ENC_ARG_VARINT;
+  buf[0] = b;
+
+  if (in->arg >= ENC_ARG_VARINT && !putVarint(buf, room, &pos, in->arg))
+    return 0;
+  if (in->repeat > 1 && !putVarint(buf, room, &pos, in->repeat))
+    return 0;
+  return pos;
+}
@@ -0,0 +1,86 @@
+//----------------------------------------------------------------------------
+//  Description:  Instruction encoding shared by the GUI and the RECEIVING
+//  VERSION
+//
+//  A program is a string of instructions of one or more bytes.  Bytes with
+//  bit 7 clear are the original one-byte instructions and mean what they
+//  always did:
+//
+//      0 oo aaaaa     oo = 00 stop (a = 0) / detonate (a != 0)
+//                          01 forward a units
+//                          10 backward a units
+//                          11 turn left (a = 0) / right (a != 0), 90 deg
+//
+//  Bytes with bit 7 set start an extended instruction:
+//
+//      1 ooo r aaa    [argument varint]  [repeat varint]
+//
+//  ooo is one of the ENC_ ops below.  aaa holds an argument of 0-6; 7 means
+//  the argument follows as a varint (7 bits per byte, least significant
+//  first, bit 7 set on every byte but the last).  If r is set a repeat
+//  count follows as a varint and the instruction runs that many times.
+//  Only an instruction that takes time (ENC_TIMED) may repeat more than
+//  once: the car runs zero-length steps back to back in its timer
+//  interrupt, so a large count on one would keep it there.
+//  An ENC_VERSION instruction, if present, must come first and gives the
+//  encoding version the program needs.
+//
+//  ENC_CONTROL instructions (version 2) steer the program instead of the
+//  car.  Their argument is ENC_CTL(kind, operand), and they take no repeat
+//  count:
+//
+//      ENC_CTL_REPEAT n    run the instructions up to the matching
+//                          ENC_CTL_LOOP n times (n >= 1)
+//      ENC_CTL_LOOP        end of the innermost REPEAT body
+//      ENC_CTL_CALL a      run the subroutine at byte offset a of the
+//                          program, then go on after the CALL
+//      ENC_CTL_RETURN      end of a subroutine; in the main program, the
+//                          end of the program (subroutines may follow it)
+//
+//  Loops and calls nest up to MOTION_STACK_DEPTH (Motion.h) in all.
+//
+//  Units are MOTION_UNIT_MS (0.1 ft); turns take an angle in degrees.  The
+//  GUI's encoder (encodeprog in CarGui.m) follows the same rules.
+//----------------------------------------------------------------------------
+
+
+#define ENC_VERSION_CURRENT    2           // 2: ENC_CONTROL
+
+// Ops
+#define ENC_STOP               0           // Pins off, pause for arg units
+#define ENC_FORWARD            1           // arg units
+#define ENC_BACKWARD           2           // arg units
+#define ENC_LEFT               3           // arg degrees
+#define ENC_RIGHT              4           // arg degrees
+#define ENC_DETONATE           5
+#define ENC_CONTROL            6           // arg = ENC_CTL(kind, operand)
+#define ENC_VERSION            7           // arg = encoding version
+
+#define ENC_EXTENDED           0x80
+#define ENC_REPEAT             0x08
+#define ENC_ARG_VARINT         7           // aaa value: varint follows
+#define ENC_MAX_BYTES          7           // Header + two 3-byte varints
+
+// ENC_CONTROL kinds, in the low two bits of the argument
+#define ENC_CTL_REPEAT         0           // operand = count
+#define ENC_CTL_LOOP           1
+#define ENC_CTL_CALL           2           // operand = byte offset
+#define ENC_CTL_RETURN         3
+#define ENC_CTL(kind, operand) (((operand) << 2) | (kind))
+#define ENC_CTL_KIND(arg)      ((arg) & 3)
+#define ENC_CTL_OPERAND(arg)   ((arg) >> 2)
+
+// Non-zero if instruction "in" takes time: a move, turn or pause of a
+// non-zero argument
+#define ENC_TIMED(in)          ((in)->op <= ENC_RIGHT && (in)->arg)
+
+typedef struct
+{
+  char op;
+  unsigned int arg;
+  unsigned int repeat;                      // Runs, at least 1
+} Encoding_Instr;
+
+
+char Encoding_Decode(const char *, char, Encoding_Instr *);
+char Encoding_Encode(char *, char, const Encoding_Instr *);
@@ -37,6 +37,28 @@ function CarGui()
 %
 %   Delete Previous Commands
 %       Delete
+%
+%   Drives the Car Live with the Arrow Keys until ESCAPE is Pressed
+%       Drive
+%
+%   Switches the Radio Link to Another Modem Profile
+%       Radio Plain     250 kbps (the default)
+%       Radio FEC       250 kbps with error correction, for noisy rooms
+%       Radio Fast      500 kbps, shorter range
+%       Radio Short     250 kbps with a short preamble
+%       Radio Long      10 kbps, longest range
+%
+%   Dumps the Trace Ring of the Board on the Serial Port (firmware built
+%   with TRACE_ENABLE) and Plots its Latency Histograms
+%       Trace
+%
+%   Picks the Car(s) the Following Runs, Radio Changes and Driving Go To
+%       Car <Address>       one car, 1 to 253 (1 at power up)
+%       Group <Number>      live driving of every car in group 1 to 8
+%       All                 live driving of every car
+%
+%   Gives the Picked Car a New Address, and Optionally its Groups
+%       Address <Address> [<Group> ...]
 
 % -----------------------------------------------------------------
 % |                                 --------------------------    |
@@ -69,7 +91,8 @@ function CarGui()
 %
 %   Start Bit:
 %       Bit 7 is the start bit to signal a new character
-%       This should always be 0.
+%       0 - one byte instruction as below
+%       1 - extended instruction (see Encoding.h and encodeinstr)
 %
 %   Opcode:
 %       Bits 6 and 5 determine the Type of Command
@@ -94,6 +117,12 @@ function CarGui()
 %
 %
 %       00011111 - Detonate
+%
+%   Extended:
+%       1 ooo r aaa [argument] [repeat count]
+%       Longer distances, turn angles and repeated instructions; the
+%       one byte form is still used whenever it fits
+%       Op 6 (control) loops over a repeated block of instructions
 
 
 %By Ben Duong & Eugene Kolodenker ENG EC450 Spring 2011
@@ -123,6 +152,23 @@ position(50).limits = zeros(1,4);
 count = 1;
 cmdcount = 1;
 
+%sequence number of the last frame sent to the EZ430-RF2500
+hostseq = 0;
+
+%live driving: serial port, H-bridge bits and keepalive timer
+driveport = [];
+drivestate = 0;
+drivetimer = [];
+
+%link reports from HOST_DONE frames, one row per finished program:
+%[car: rssi lqi packets crc overflows backoffs ccafails, sender: the
+%same, car address]
+linklog = zeros(0,15);
+
+%where the sender sends (HOST_TARGET frame): [address groups], address 0
+%with a group bitmap for a group, 255 for every car (Protocol.h)
+target = [1 0];
+
 
 %initalize variables used for display
 cmdstr = cell(1,1);
@@ -363,10 +409,6 @@ uicontrol(cmdedit)
         
         
         % serial sending here
-        for i = 1:count-1
-           % disp(movements{i})
-            movements{i} = char(bin2dec(movements{i}));
-        end
         
         
         
@@ -375,9 +417,25 @@ uicontrol(cmdedit)
         %-----------------------------------------------------------------
         %   The Instructions are sent serially to an MSP430F2274 through
         %   the USCI UART at 9600 baud through the USB port
+        %
+        %   The whole program goes out in one frame:
+        %       [126 type seq len payload crchi crclo]
+        %   and the sender answers with one ACK frame carrying the same seq
+        %   once the car has received every radio fragment of it
         %-----------------------------------------------------------------
-        if(count-1 >= 50)
-            count = 50;
+        %a program goes to one car at a time
+        if(target(1) == 0 || target(1) == 255)
+            errordlg('Programs go to one car: pick it with Car <Address>')
+            return
+        end
+        
+        %encode the instructions (Encoding.h), merging repeated ones;
+        %a program must fit in 240 bytes (5 radio fragments)
+        last = count-1;
+        program = encodeprog(movements(1:last));
+        while(length(program) > 240)
+            last = last - 1;
+            program = encodeprog(movements(1:last));
         end
         
         %find the available serial ports
@@ -388,56 +446,48 @@ uicontrol(cmdedit)
         if(length(avail) > 1)
             %create a waitbar object for the sending process
             set([run cmdedit],'Visible','off')
-            wait = waitbar(0,'Sending Instruction Count');
+            wait = waitbar(0,'Sending Instructions');
             %create a serial object pointed at the second serial port
-            rf2500 = serial(avail{end});
+            %the baud rate must match CLOCK_BAUD in the sender firmware
+            rf2500 = serial(avail{end},'BaudRate',9600,'Timeout',2);
             %connect the serial object to the serial port
             fopen(rf2500);
-            %send the number of instructions first
-            fprintf(rf2500,sprintf('%c',char(count-1)));
-          
-            fscanf(rf2500);
-            for i = 1:count-1
-                %Send each instruction
-                fprintf(rf2500,sprintf('%c',movements{i}));
-                %disp(int32(movements{i}))
-               %Update the waitbar
-                waitbar(i/(count-1),wait,sprintf('Sending Instruction %s',commands{waitpointer(i)}));
-                %Read for confirmation
-                fscanf(rf2500);
-                
+            %a route the car has run before is kept in its flash (Cache.h):
+            %ask for it by CRC first, and send all of the instructions in
+            %one frame only if the car or the sender doesn't know it
+            hash = crc16(program);
+            sent = sendframe(rf2500,7,target);
+            if(sent)
+                [sent reason] = sendframe(rf2500,5,[mod(hash,256) floor(hash/256) length(program)]);
+                if(~sent && (reason == 5 || reason == 3))
+                    sent = sendframe(rf2500,1,program);
+                end
             end
             
             %delete the sending waitbar
             delete(wait)
             
-            %create a waitbar for the actual running
-            running = waitbar(0,'RUNNING');
-            
-            %if the number of instructions is 10 clear the two bytes in the
-            %input buffer
-            if(count-1 == 10)
-                fscanf(rf2500,'%c',2);
-            end
-            
-            %wait until the byte signalling done is ready
-            cc = 0;
-            while((get(rf2500,'BytesAvailable') <= 0))
-                %disp(rf2500.BytesAvailable);
-                %fprintf('%d %d\n',cc,get(rf2500,'BytesAvailable'))
-                waitbar(cc/(sum(time(1:count-1))),running);
-                cc = cc +1;
+            if(sent)
+                %create a waitbar for the actual running
+                running = waitbar(0,'RUNNING');
+                
+                %wait until the frame signalling done is ready
+                cc = 0;
+                while((get(rf2500,'BytesAvailable') < 6))
+                    waitbar(cc/(sum(time(1:last))),running);
+                    cc = cc +1;
+                end
+                
+                %read it in, with how well each board hears the other
+                [dtype dseq link] = readframe(rf2500);
+                if(dtype == 17 && length(link) >= 14)
+                    linkstats(link);
+                end
+                
+                %delete the running waitbar
+                delete(running)
             end
             
-            %read it in
-            %x=fscanf(rf2500,'%c',1);
-            
-            
-            %disp(int32(x))
-            %delete the running waitbar
-            delete(running)
-            
-            
             %disconnect the serial object from the port
             fclose(rf2500);
             %delete the serial object
@@ -517,7 +567,7 @@ uicontrol(cmdedit)
         %Check the command against acceptable commands
         if( strcmpi(command,'turn left') || strcmpi(command,'l') || strcmpi(command,'left'))
             %Check for a left turn command
-            movements{count} = '01100000';
+            movements{count} = [3 90];
             %"pointer" for waitbar
             waitpointer(count) = cmdcount;
             time(count) = 50;
@@ -528,7 +578,7 @@ uicontrol(cmdedit)
             
         elseif( strcmpi(command,'turn right') || strcmpi(command,'r') || strcmpi(command,'right'))
             %Check f  or a Right turn command
-            movements{count} = '01111111';
+            movements{count} = [4 90];
             waitpointer(count) = cmdcount;
             time(count) = 50;
             cmdpointer(cmdcount) = count;
@@ -538,7 +588,7 @@ uicontrol(cmdedit)
             
         elseif( strcmpi(command,'detonate'))
             %Check for a detonation command
-            movements{count} = '00011111';
+            movements{count} = [5 0];
             %"pointer" for waitbar
             waitpointer(count) = cmdcount;
             time(count) = 25;
@@ -582,6 +632,33 @@ uicontrol(cmdedit)
            
             %automatically run the command list
             cmdrun(-10);
+        elseif(strcmpi(command,'drive'))
+            %live driving takes over the arrow keys until ESCAPE
+            drivestart();
+            delete = 1;
+        elseif(strncmpi(command,'radio ',6))
+            %switch both boards to another modem profile
+            if(~radioprofile(strtrim(command(7:end))))
+                set(valid,'Visible','On')
+            end
+            delete = 1;
+        elseif(strcmpi(command,'trace'))
+            %latency histograms from the board's trace ring
+            tracedump();
+            delete = 1;
+        elseif(strncmpi(command,'car ',4) || strncmpi(command,'group ',6) ...
+                || strcmpi(command,'all'))
+            %pick the car, or the group of cars, to command
+            if(~picktarget(command))
+                set(valid,'Visible','On')
+            end
+            delete = 1;
+        elseif(strncmpi(command,'address ',8))
+            %give the picked car a new address and groups
+            if(~readdress(str2num(command(9:end))))
+                set(valid,'Visible','On')
+            end
+            delete = 1;
         elseif(strcmpi(command,'delete'))
             if(cmdcount > 1)
                 instrnum = round(totalscroll+1-get(scroll,'Value'));
@@ -620,9 +697,6 @@ uicontrol(cmdedit)
         else
             %Otherwise it must be a forward or backward command
             
-            %initalize the instruction to "STOP"
-            instruction = '00000000';
-            
             %seperate the direction and distance
             [direction distance]= strtok(command);
             
@@ -637,25 +711,10 @@ uicontrol(cmdedit)
                 %update simulation
                 modplot('u',distance/10);
                 
-                %set opcode for forward
-                instruction(3) = '1';
-                
                 
                 cmdpointer(cmdcount) = count;
-                %if the distance is over 6.3 feet it must be broken up
-                %into sections of less than 6.3 feet
-                while(distance >= 32)
-                    movements{count} = binconvert(distance,instruction);
-                    %"pointer" for waitbar
-                    waitpointer(count) = cmdcount;
-                    time(count) = 3.1*250;
-                    count = count + 1;
-                    distance = distance - 31;
-                    
-                end
-                
-                %encode the distance into the instruction
-                movements{count} = binconvert(distance,instruction);
+                %any distance fits in one extended instruction
+                movements{count} = [1 distance];
                 %"pointer" for waitbar
                 waitpointer(count) = cmdcount;
                 time(count) = distance/10*250;
@@ -673,25 +732,10 @@ uicontrol(cmdedit)
                 %update simulation
                 modplot('d',distance/10);
                 
-                %set opcode for backward
-                instruction(2) = '1';
-                
                 
                 cmdpointer(cmdcount) = count;
-                %if the distance is over 6.3 feet it must be broken up
-                %into sections of less than 6.3 feet
-                while(distance >= 32)
-                    movements{count} = binconvert(distance,instruction);
-                    %"pointer" for waitbar
-                    waitpointer(count) = cmdcount;
-                    time(count) = 3.1*250;
-                    count = count + 1;
-                    distance = distance - 31;
-                   
-                end
-                
-                %encode the distance into the instruction
-                movements{count} = binconvert(distance,instruction);
+                %any distance fits in one extended instruction
+                movements{count} = [2 distance];
                 %"pointer" for waitbar
                 waitpointer(count) = cmdcount;
                 time(count) = distance/10*250;
@@ -753,31 +797,459 @@ uicontrol(cmdedit)
 
 %--------------------------------------------------------------------------
 %% Instruction Encode
-%Subfunction to do binary encoding of the instruction
+%Subfunctions to encode the instructions as in Encoding.h
+%Each movement is [op arg]: 1 forward/2 backward in tenths of a foot,
+%3 left/4 right in degrees, 5 detonate
 
-    function instrout = binconvert(distance, instruction)
+%Encode a whole program, merging runs of the same instruction and turning
+%blocks repeated back to back (a patrol route, a figure eight) into REPEAT
+%loops; loops need encoding version 2 on the car
+    function bytes = encodeprog(moves)
         
-        %If the distance is still over 12.7 feet set this instruction to
-        %12.7 feet
-        if(distance >= 32)
-            instruction(4:8) = '11111';
-        else
-            %otherwise convert the distance to binary
-            distance = dec2bin(distance);
-            
-            %replace the bits in the input instruction with the distance
-            for i = 1:length(distance)
-                instruction(9-i) = distance(end+1-i);
+        [bytes looped] = encodeloops(moves);
+        if(looped)
+            bytes = [encodeinstr(7,2,1) bytes];
+        end
+        
+    end
+
+%Encode moves, starting a loop wherever a repeated block saves bytes
+    function [bytes looped] = encodeloops(moves)
+        
+        bytes = [];
+        looped = false;
+        n = length(moves);
+        i = 1;
+        while(i <= n)
+            %best block starting here: [copies length bytes saved]; blocks
+            %of one move are left to the repeat count
+            best = [0 0 0];
+            for len = 2:floor((n-i+1)/2)
+                copies = 1;
+                while(i+(copies+1)*len-1 <= n && ...
+                        isequal(moves(i+copies*len:i+(copies+1)*len-1),moves(i:i+len-1)))
+                    copies = copies + 1;
+                end
+                if(copies > 1)
+                    saved = (copies-1)*length(encoderuns(moves(i:i+len-1))) ...
+                        - length([encodeinstr(6,4*copies,1) encodeinstr(6,1,1)]);
+                    if(saved > best(3))
+                        best = [copies len saved];
+                    end
+                end
             end
             
+            if(best(1))
+                %REPEAT copies (ENC_CTL(0,copies)), the block, LOOP
+                body = encodeloops(moves(i:i+best(2)-1));
+                bytes = [bytes encodeinstr(6,4*best(1),1) body encodeinstr(6,1,1)];
+                looped = true;
+                i = i + best(1)*best(2);
+            else
+                runs = 1;
+                while(i+runs <= n && timed(moves{i}) && ...
+                        isequal(moves{i+runs},moves{i}))
+                    runs = runs + 1;
+                end
+                bytes = [bytes encodeinstr(moves{i}(1),moves{i}(2),runs)];
+                i = i + runs;
+            end
+        end
+        
+    end
+
+%Encode moves merging runs of the same instruction only
+    function bytes = encoderuns(moves)
+        
+        bytes = [];
+        i = 1;
+        while(i <= length(moves))
+            runs = 1;
+            while(i+runs <= length(moves) && timed(moves{i}) && ...
+                    isequal(moves{i+runs},moves{i}))
+                runs = runs + 1;
+            end
+            bytes = [bytes encodeinstr(moves{i}(1),moves{i}(2),runs)];
+            i = i + runs;
+        end
+        
+    end
+
+%Only a move, turn or pause of a non-zero argument may take a repeat
+%count (ENC_TIMED): the car runs zero-length steps back to back in its
+%timer interrupt
+    function t = timed(move)
+        
+        t = move(1) <= 4 && move(2) > 0;
+        
+    end
+
+%Encode one instruction, in the original one-byte form when it fits so
+%older cars still understand it
+    function bytes = encodeinstr(op, arg, runs)
+        
+        if(runs == 1)
+            if(op == 5)
+                bytes = 31;
+                return
+            elseif((op == 1 || op == 2) && arg <= 31)
+                bytes = op*32 + arg;
+                return
+            elseif((op == 3 || op == 4) && arg == 90)
+                bytes = 96 + (op == 4)*31;
+                return
+            end
+        end
+        
+        %extended form: 1 ooo r aaa [arg varint] [repeat varint]
+        bytes = 128 + op*16 + (runs > 1)*8 + min(arg,7);
+        if(arg >= 7)
+            bytes = [bytes varint(arg)];
+        end
+        if(runs > 1)
+            bytes = [bytes varint(runs)];
+        end
+        
+    end
+
+%7 bits per byte, least significant first, top bit set if more follow
+    function bytes = varint(value)
+        
+        bytes = mod(value,128);
+        value = floor(value/128);
+        while(value > 0)
+            bytes(end) = bytes(end) + 128;
+            bytes = [bytes mod(value,128)];
+            value = floor(value/128);
         end
         
-        %output the encoded instruction
-        instrout = instruction;
+    end
+
+%END OF INSTRUCTION ENCODING SUBFUNCTIONS
+
+%--------------------------------------------------------------------------
+%% Serial Frames
+%Subfunctions to send and receive frames to and from the EZ430-RF2500
+
+%Send one frame and wait for the ACK carrying its sequence number,
+%repeating the frame (with the same sequence number) up to 3 times;
+%reason is the last NACK reason, and a cache miss (5), an unknown frame
+%type (3) or a frame the target can't take (6) is not repeated
+    function [ok reason] = sendframe(port, type, payload)
+        
+        hostseq = mod(hostseq+1,256);
+        data = [type hostseq length(payload) payload];
+        crc = crc16(data);
+        frame = [126 data floor(crc/256) mod(crc,256)];
+        
+        ok = false;
+        reason = 0;
+        for attempt = 1:3
+            fwrite(port,frame,'uint8');
+            [rtype rseq reply good] = readframe(port);
+            if(good && rtype == 6 && rseq == hostseq)
+                ok = true;
+                return
+            end
+            if(good && rtype == 21 && rseq == hostseq && ~isempty(reply))
+                reason = reply(1);
+                if(reason == 5 || reason == 3 || reason == 6)
+                    return
+                end
+            end
+        end
+        
+    end
+
+%Read one frame; good is false on a timeout or a CRC error
+    function [type seq payload good] = readframe(port)
+        
+        type = 0;
+        seq = 0;
+        payload = [];
+        good = false;
+        
+        %hunt for the start of frame
+        sof = 0;
+        while(sof ~= 126)
+            [sof n] = fread(port,1,'uint8');
+            if(n == 0)
+                return
+            end
+        end
+        
+        [hdr n] = fread(port,3,'uint8');
+        if(n < 3)
+            return
+        end
+        hdr = hdr';
+        if(hdr(3) > 0)
+            payload = fread(port,hdr(3),'uint8')';
+        end
+        [crc n] = fread(port,2,'uint8');
+        if(n < 2)
+            return
+        end
+        
+        type = hdr(1);
+        seq = hdr(2);
+        good = (crc16([hdr payload]) == crc(1)*256 + crc(2));
+        
+    end
+
+%CRC-16/CCITT (polynomial 0x1021, start 0xFFFF), same as Crc16.c
+    function crc = crc16(bytes)
+        
+        crc = 65535;
+        for b = bytes(:)'
+            crc = bitxor(crc, b*256);
+            for k = 1:8
+                if(bitand(crc,32768))
+                    crc = bitxor(mod(crc*2,65536),4129);
+                else
+                    crc = mod(crc*2,65536);
+                end
+            end
+        end
+        
+    end
+
+%Ask the sender to move both boards to a modem profile (HOST_PROFILE
+%frame); the ACK comes once the car has switched too
+    function known = radioprofile(name)
+        
+        %in the order of RF_PROFILE_PLAIN, _FEC, _FAST, _SHORT, _LONG
+        names = {'plain','fec','fast','short','long'};
+        profile = find(strcmpi(name,names)) - 1;
+        known = ~isempty(profile);
+        if(~known)
+            return
+        end
+        
+        ports = instrhwinfo('serial');
+        avail = ports.SerialPorts;
+        if(length(avail) > 1)
+            port = serial(avail{end},'BaudRate',9600,'Timeout',2);
+            fopen(port);
+            if(target(1) == 0 || target(1) == 255)
+                errordlg('Radio changes go to one car: pick it with Car <Address>')
+            elseif(~sendframe(port,7,target) || ~sendframe(port,3,profile))
+                errordlg('The car did not switch radio profile')
+            end
+            fclose(port);
+            delete(port)
+        end
+        
+    end
+
+%Log and print the link reports of a HOST_DONE frame (RFLinkReport in
+%CC2500.c): RSSI in signed half dB, LQI lower is better, and counters of
+%good packets, CRC failures, overflows, sends put off by a busy channel
+%and sends dropped that wrap at 256.  The car's address comes last, if
+%the sender sends it.
+    function linkstats(link)
+        
+        if(length(link) < 15)
+            link(15) = 1;
+        end
+        linklog(end+1,:) = link(1:15);
+        names = {sprintf('Car %d',link(15)),'Sender'};
+        for k = 1:2
+            r = link(7*k-6:7*k);
+            rssi = (r(1) - 256*(r(1) > 127))/2 - 72;
+            fprintf('%s: %.1f dBm, LQI %d, %d packets, %d CRC failures, %d overflows, %d backoffs, %d CCA drops\n',...
+                names{k},rssi,r(2),r(3),r(4),r(5),r(6),r(7));
+        end
+        
+    end
+
+%Pick where runs, radio changes and live driving go: Car <n>, Group <n>
+%or All.  The sender is told before each of them (HOST_TARGET frame).
+    function known = picktarget(command)
+        
+        words = strsplit(strtrim(command));
+        known = true;
+        if(strcmpi(words{1},'all'))
+            target = [255 0];
+            return
+        end
+        n = str2double(words{end});
+        if(strcmpi(words{1},'car') && n >= 1 && n <= 253 && n == round(n))
+            target = [n 0];
+        elseif(strcmpi(words{1},'group') && n >= 1 && n <= 8 && n == round(n))
+            target = [0 2^(n-1)];
+        else
+            known = false;
+        end
+        
+    end
+
+%Give the picked car a new address and groups (HOST_ADDRESS frame); the
+%ACK comes once the car has taken them, and the car stays picked
+    function known = readdress(args)
+        
+        known = ~isempty(args) && all(args == round(args)) && args(1) >= 1 ...
+            && args(1) <= 253 && all(args(2:end) >= 1 & args(2:end) <= 8);
+        if(~known)
+            return
+        end
+        groups = sum(unique(2.^(args(2:end)-1)));
+        
+        ports = instrhwinfo('serial');
+        avail = ports.SerialPorts;
+        if(target(1) == 0 || target(1) == 255)
+            errordlg('Pick the car to readdress with Car <Address>')
+        elseif(length(avail) > 1)
+            port = serial(avail{end},'BaudRate',9600,'Timeout',2);
+            fopen(port);
+            if(sendframe(port,7,target) && sendframe(port,8,[args(1) groups]))
+                target = [args(1) 0];
+            else
+                errordlg('The car did not take the new address')
+            end
+            fclose(port);
+            delete(port)
+        end
+        
+    end
+
+%Ask the board for its trace ring (HOST_TRACE frame, Trace.h) and plot
+%the time spent in each traced interval, from a begin event to its _END
+%event, and how late the Timer_A interrupts ran.  The board answers with
+%the dump before its ACK.
+    function tracedump()
+        
+        ports = instrhwinfo('serial');
+        avail = ports.SerialPorts;
+        if(length(avail) <= 1)
+            return
+        end
+        port = serial(avail{end},'BaudRate',9600,'Timeout',2);
+        fopen(port);
+        hostseq = mod(hostseq+1,256);
+        data = [4 hostseq 0];
+        crc = crc16(data);
+        fwrite(port,[126 data floor(crc/256) mod(crc,256)],'uint8');
+        dump = [];
+        [rtype rseq payload good] = readframe(port);
+        while(good && rtype ~= 6)
+            if(rtype == 4)
+                dump = payload;
+            end
+            [rtype rseq payload good] = readframe(port);
+        end
+        fclose(port);
+        delete(port)
+        if(isempty(dump))
+            errordlg('The board sent no trace (is TRACE_ENABLE set?)')
+            return
+        end
+        
+        %[MHz] then [event arg time lo time hi] per entry, oldest first;
+        %times count MCLK cycles and wrap at 65536
+        mhz = dump(1);
+        rec = reshape(dump(2:end),4,[])';
+        ev = rec(:,1);
+        arg = rec(:,2);
+        t = rec(:,3) + 256*rec(:,4);
+        
+        %begin events as in Trace.h; each is closed by the next event up
+        begins = [2 4 6 8];
+        names = {'Timer\_A0 ISR (motion step / stream tick)','PORT2 ISR',...
+            'SPI transaction','RFSendPacket wait on GDO0'};
+        figure('Name','Trace');
+        for k = 1:4
+            d = [];
+            start = [];
+            for n = 1:length(ev)
+                if(ev(n) == begins(k))
+                    start = t(n);
+                elseif(ev(n) == begins(k)+1 && ~isempty(start))
+                    d(end+1) = mod(t(n)-start,65536)/mhz;
+                    start = [];
+                end
+            end
+            subplot(3,2,k)
+            if(~isempty(d))
+                hist(d)
+            end
+            title(names{k})
+            xlabel('us')
+        end
+        
+        %TRACE_ALARM and TRACE_TIMER0 carry how many ACLK ticks late the
+        %interrupt ran
+        subplot(3,2,5)
+        late = arg(ev == 1 | ev == 2)*1000/12;
+        if(~isempty(late))
+            hist(late)
+        end
+        title('Timer\_A interrupt lateness')
+        xlabel('us')
+        
+    end
+
+%END OF SERIAL FRAME SUBFUNCTIONS
+
+%--------------------------------------------------------------------------
+%% Live Driving
+%Subfunctions to drive the car live with the arrow keys (HOST_DRIVE frames)
+
+%Open the serial port and take over the arrow keys
+    function drivestart()
+        
+        ports = instrhwinfo('serial');
+        avail = ports.SerialPorts;
+        if(length(avail) > 1)
+            driveport = serial(avail{end},'BaudRate',9600,'Timeout',2);
+            fopen(driveport);
+            drivestate = 0;
+            %the picked car, group or all cars
+            sendframe(driveport,7,target);
+            set([run cmdedit],'Visible','off')
+            set(o,'WindowKeyPressFcn',@(src,event) drivekey(event.Key,1),...
+                'WindowKeyReleaseFcn',@(src,event) drivekey(event.Key,0))
+            %the sender stops the car if it hears nothing for 0.5 s
+            drivetimer = timer('Period',0.2,'ExecutionMode','fixedRate',...
+                'TimerFcn',@(src,event) sendframe(driveport,2,drivestate));
+            start(drivetimer)
+        end
+        
+    end
+
+%Arrow keys set and clear the H-bridge bits, ESCAPE stops driving
+    function drivekey(key, down)
+        
+        %1 forward, 2 left, 4 backward, 8 right (Motion.h)
+        keys = {'uparrow','leftarrow','downarrow','rightarrow'};
+        bit = find(strcmp(key,keys));
+        
+        if(strcmp(key,'escape') && down)
+            stop(drivetimer)
+            delete(drivetimer)
+            %an empty frame stops the car
+            sendframe(driveport,2,[]);
+            set(o,'WindowKeyPressFcn','','WindowKeyReleaseFcn','')
+            fclose(driveport);
+            delete(driveport)
+            set([run cmdedit],'Visible','On')
+            uicontrol(cmdedit)
+        elseif(~isempty(bit))
+            if(down)
+                newstate = bitor(drivestate,2^(bit-1));
+            else
+                newstate = bitand(drivestate,15-2^(bit-1));
+            end
+            %key repeat sends nothing new
+            if(newstate ~= drivestate)
+                drivestate = newstate;
+                sendframe(driveport,2,drivestate);
+            end
+        end
         
     end
 
-%END OF BINARY ENCODING SUBFUNCTION
+%END OF LIVE DRIVING SUBFUNCTIONS
 
 %--------------------------------------------------------------------------
 %% Mod Plot
@@ -0,0 +1,196 @@
+//----------------------------------------------------------------------------
+//  Description:  Framed serial protocol between the MATLAB GUI and the
+//  SENDING VERSION
+//----------------------------------------------------------------------------
+
+
+#include "TI_CC/include.h"
+#include "Uart.h"
+#include "Crc16.h"
+#include "HostLink.h"
+
+// Framing state machine
+#define HL_SOF                 0
+#define HL_TYPE                1
+#define HL_SEQ                 2
+#define HL_LEN                 3
+#define HL_DATA                4
+#define HL_CRC1                5
+#define HL_CRC2                6
+
+static char state = HL_SOF;
+static char type, seq;
+static unsigned char len, pos;
+static char frame[HOST_MAX_PAYLOAD];
+static unsigned int crc, rxCrc;
+static char ready = 0;                      // frame[] holds a finished frame
+static char lastSeq;                        // seq of the last accepted frame
+static char haveLast = 0;
+static char txSeq = 0;                      // seq of our own frames
+
+
+// Queue one byte, waiting for the TX ISR to make room
+static void put(char c)
+{
+  while (!Uart_Write(c));
+}
+
+// Send one frame: SOF, header, payload and CRC
+static void sendFrame(char t, char s, char *payload, char length)
+{
+  unsigned int c = CRC16_INIT;
+  char i;
+
+  put(HOST_SOF);
+  put(t);
+  put(s);
+  put(length);
+  c = Crc16_Update(c, t);
+  c = Crc16_Update(c, s);
+  c = Crc16_Update(c, length);
+  for (i = 0; i < length; i++)
+  {
+    put(payload[i]);
+    c = Crc16_Update(c, payload[i]);
+  }
+  put(c >> 8);
+  put(c);
+}
+
+
+// Feed one byte to the framing state machine; returns 1 at end of frame
+static char feed(char c)
+{
+  if (state != HL_SOF && state < HL_CRC1)
+    crc = Crc16_Update(crc, c);
+
+  switch (state)
+  {
+    case HL_SOF:
+      if (c == HOST_SOF)
+      {
+        crc = CRC16_INIT;
+        state = HL_TYPE;
+      }
+      break;
+    case HL_TYPE:
+      type = c;
+      state = HL_SEQ;
+      break;
+    case HL_SEQ:
+      seq = c;
+      state = HL_LEN;
+      break;
+    case HL_LEN:
+      len = c;
+      pos = 0;
+      if (len > HOST_MAX_PAYLOAD)
+      {
+        HostLink_Nack(HOST_ERR_LENGTH);
+        state = HL_SOF;
+      }
+      else
+        state = len ? HL_DATA : HL_CRC1;
+      break;
+    case HL_DATA:
+      frame[pos++] = c;
+      if (pos == len)
+        state = HL_CRC1;
+      break;
+    case HL_CRC1:
+      rxCrc = (unsigned int)(unsigned char)c << 8;
+      state = HL_CRC2;
+      break;
+    case HL_CRC2:
+      rxCrc |= (unsigned char)c;
+      state = HL_SOF;
+      if (rxCrc != crc)
+        HostLink_Nack(HOST_ERR_CRC);
+      else if (haveLast && seq == lastSeq)
+        HostLink_Ack();                     // Repeat of a frame already
+      else                                  // handled: its ack was lost
+        return 1;
+      break;
+  }
+  return 0;
+}
+
+
+//-----------------------------------------------------------------------------
+//  char HostLink_Poll(void)
+//
+//  DESCRIPTION:
+//  Drains the UART RX ring through the framing state machine.  Bad frames
+//  are answered with HOST_NACK here.  Stops at the end of a good frame so
+//  the next frame can keep arriving in the ring while this one is handled;
+//  the caller must answer it with HostLink_Ack() or HostLink_Nack().
+//
+//  RETURN VALUE:
+//      char
+//          Type of the frame that is ready, fetch it with HostLink_Frame()
+//          0:  No complete frame yet
+//-----------------------------------------------------------------------------
+char HostLink_Poll(void)
+{
+  char c;
+
+  if (ready)
+    return type;
+  while (Uart_Read(&c))
+  {
+    if (feed(c))
+    {
+      ready = 1;
+      return type;
+    }
+  }
+  return 0;
+}
+
+
+//-----------------------------------------------------------------------------
+//  char *HostLink_Frame(char *length)
+//
+//  DESCRIPTION:
+//  Returns the payload of the frame found by HostLink_Poll().  The buffer
+//  stays valid until the frame is answered.
+//
+//  ARGUMENTS:
+//      char *length
+//          Set to the payload length
+//-----------------------------------------------------------------------------
+char *HostLink_Frame(char *length)
+{
+  *length = len;
+  return frame;
+}
+
+
+// Accept the current frame
+void HostLink_Ack(void)
+{
+  lastSeq = seq;
+  haveLast = 1;
+  ready = 0;
+  sendFrame(HOST_ACK, seq, 0, 0);           // Acks carry the frame's seq
+}
+
+// Reject the current frame; the GUI may send it again with the same seq
+void HostLink_Nack(char reason)
+{
+  ready = 0;
+  sendFrame(HOST_NACK, seq, &reason, 1);
+}
+
+
+//-----------------------------------------------------------------------------
+//  void HostLink_Send(char type, char *payload, char length)
+//
+//  DESCRIPTION:
+//  Sends one unsolicited frame (e.g. HOST_DONE) to the GUI.  Must be called
+//  from main().
+//-----------------------------------------------------------------------------
+void HostLink_Send(char t, char *payload, char length)
+{
+  sendFrame(t, txSeq++, payload, length);
+}
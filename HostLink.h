@@ -0,0 +1,66 @@
+//----------------------------------------------------------------------------
+//  Description:  Framed serial protocol between the MATLAB GUI and the
+//  SENDING VERSION
+//
+//  Both directions use the same frame:
+//
+//      [0x7E] [type] [seq] [len] [payload: len bytes] [CRC hi] [CRC lo]
+//
+//  The CRC-16/CCITT covers type, seq, len and the payload.  The GUI sends a
+//  whole program in one frame and the sender answers with one HOST_ACK (or
+//  HOST_NACK) frame carrying the same seq once the car has acknowledged
+//  every fragment of the program.  A frame whose seq matches the
+//  last one accepted is acknowledged again but not re-sent over the radio,
+//  so the GUI can safely repeat a frame whose ack was lost.
+//  HostLink_Poll() runs from main(), outside any ISR.
+//
+//  A 49-instruction program at 9600 baud, in the host simulator
+//  (host/TestHostLink.c): the old per-byte echo took 158 ms and 50 round
+//  trips; the frame is 57 ms on the line and acked at 68 ms, the car's
+//  fragment ack included, in one round trip.  The host's serial latency
+//  comes on top of each round trip.
+//----------------------------------------------------------------------------
+
+
+#define HOST_SOF               0x7E
+#define HOST_MAX_PAYLOAD       240         // PKT_PROG_MAX
+#define HOST_OVERHEAD          6           // SOF, type, seq, len, CRC
+
+// GUI -> sender
+#define HOST_PROGRAM           0x01        // payload: instructions
+#define HOST_DRIVE             0x02        // payload: [H-bridge bits], or
+                                            // empty to stop driving
+#define HOST_PROFILE           0x03        // payload: [RF_PROFILE_...]
+#define HOST_TRACE             0x04        // empty; answered with a HOST_TRACE
+                                            // frame (Trace_Dump()), then ACK
+#define HOST_RUN               0x05        // payload: [hash lo] [hash hi]
+                                            // [length], CRC-16 of a program
+                                            // to run from the car's cache
+#define HOST_TARGET            0x07        // payload: [address] [groups],
+                                            // where packets go (Protocol.h)
+#define HOST_ADDRESS           0x08        // payload: [address] [groups],
+                                            // new ones for the target car
+
+// Sender -> GUI
+#define HOST_ACK               0x06        // seq of the accepted frame
+#define HOST_NACK              0x15        // seq, payload: [reason]
+#define HOST_DONE              0x11        // Car finished a program; payload:
+                                            // the car's and the sender's
+                                            // RFLinkReport(), then the car's
+                                            // address
+
+// HOST_NACK reasons
+#define HOST_ERR_CRC           0x01
+#define HOST_ERR_LENGTH        0x02
+#define HOST_ERR_TYPE          0x03
+#define HOST_ERR_RADIO         0x04        // Car did not take the program
+#define HOST_ERR_MISS          0x05        // HOST_RUN: not cached, upload it
+#define HOST_ERR_TARGET        0x06        // Needs a single car as target, or
+                                            // no such address
+
+
+char HostLink_Poll(void);
+char *HostLink_Frame(char *);
+void HostLink_Ack(void);
+void HostLink_Nack(char);
+void HostLink_Send(char, char *, char);
@@ -0,0 +1,461 @@
+//----------------------------------------------------------------------------
+//  Description:  Timer_A driven motion executor (RECEIVING VERSION)
+//
+//  Each instruction (see Encoding.h) becomes one step, or one step per run
+//  if it carries a repeat count: the H-bridge pins are set when the step
+//  starts and TACCR0 is armed for the step duration.  The
+//  CCR0 interrupt ends the step and starts the next one.  Durations longer
+//  than MOTION_MAX_CHUNK ticks are split over several compare periods.
+//  The pins of each op come from pinTable[]; a step costs about 120 MCLK
+//  cycles with it, as with the switch it replaced, in the host
+//  simulator's estimate (host/TestMotion.c).  ENC_CONTROL instructions
+//  (loops and subroutine calls) move the program position between steps,
+//  using a stack of MOTION_STACK_DEPTH frames.
+//
+//  Two program slots are kept.  One is running; the other is filled in place
+//  through Motion_Claim() and handed over by Motion_Commit(), after which the
+//  CCR0 ISR swaps it in with no gap when the running one ends.
+//----------------------------------------------------------------------------
+
+
+#include "TI_CC/include.h"
+#include "Clock.h"
+#include "Encoding.h"
+#include "Motion.h"
+#include "Trace.h"
+
+#define MOTION_MAX_CHUNK       0x8000      // Longest single CCR0 period
+
+// How a step's argument gives its duration
+#define TIME_NONE              0
+#define TIME_UNITS             1           // MOTION_UNIT_MS each
+#define TIME_DEGREES           2
+
+// P2 bits of one op: "clear" then "set" when its step starts, "end"
+// cleared again when the step ends
+typedef struct
+{
+  char clear;
+  char set;
+  char end;
+  char timing;
+} Motion_Pins;
+
+#if MOTION_PIN_TABLE
+// Indexed by ENC_ op
+static const Motion_Pins pinTable[8] =
+{
+  { MOTION_PINS, 0x00, 0x00, TIME_UNITS },        // ENC_STOP
+  { 0x17,        0x01, 0x01, TIME_UNITS },        // ENC_FORWARD
+  { 0x1B,        0x04, 0x04, TIME_UNITS },        // ENC_BACKWARD
+  { 0x0E,        0x03, 0x19, TIME_DEGREES },      // ENC_LEFT: LEFT + FORWARD
+  { 0x06,        0x09, 0x19, TIME_DEGREES },      // ENC_RIGHT: RIGHT + FORWARD
+  { 0x0F,        0x10, 0x00, TIME_NONE },         // ENC_DETONATE
+  { 0x00,        0x00, 0x00, TIME_NONE },         // ENC_CONTROL: see control()
+  { 0x00,        0x00, 0x00, TIME_NONE }          // ENC_VERSION
+};
+#endif
+
+// A REPEAT body (count runs left, at least 1) or a CALL (count 0)
+typedef struct
+{
+  unsigned int addr;                        // Start of the body, or return
+  unsigned int count;                       // address
+} Motion_Frame;
+
+static char slot[2][MOTION_MAX_INSTR];
+static char active;                         // Slot being run
+static char staged;                         // Other slot holds a program
+static char policy = MOTION_QUEUE_POLICY;
+static char *program;                       // slot[active]
+static unsigned int number;                 // Bytes in program
+static unsigned int slotLen;                // Bytes in the staged program
+static unsigned int step;                   // Byte of the next instruction
+static Encoding_Instr instr;                // Instruction being run
+static unsigned int runs;                   // Runs of it still to start
+static Motion_Frame stack[MOTION_STACK_DEPTH];
+static char depth;                          // Frames in use
+static char endMask;                        // P2 bits cleared at end of step
+static unsigned long remaining;             // ACLK ticks left in this step
+static volatile char busy;
+static char driving;                        // Pins set by Motion_Drive()
+static unsigned int deadman;
+static volatile char done;                  // Programs finished, not yet reported
+
+
+//-----------------------------------------------------------------------------
+//  void Motion_Init(void)
+//
+//  DESCRIPTION:
+//  Takes TACCR0 of the Timer_A timebase started by Clock_Init(), and sets
+//  the dead-man window from the VLO frequency it measured.  The H-bridge
+//  pins on P2 must already be configured as outputs.
+//-----------------------------------------------------------------------------
+void Motion_Init(void)
+{
+  TACCTL0 = 0;
+  deadman = CLOCK_ACLK_TICKS(MOTION_DEADMAN_MS);
+}
+
+
+// Arm CCR0 for the next part of the current step
+static void armChunk(void)
+{
+  unsigned int chunk;
+
+  if (remaining > MOTION_MAX_CHUNK)
+    chunk = MOTION_MAX_CHUNK;
+  else
+    chunk = (unsigned int)remaining;
+  remaining -= chunk;
+  TACCR0 = Clock_Now() + chunk;
+  TACCTL0 = CCIE;
+}
+
+
+#if !MOTION_PIN_TABLE
+// Set the pins for one instruction and return its duration in ACLK ticks:
+// the switch pinTable[] replaced, kept to compare (host/TestMotion.c)
+static unsigned long startInstr(const Encoding_Instr *in)
+{
+  switch(in->op){
+    case ENC_STOP:	// Stop, and pause if there is an argument
+      P2OUT &= ~MOTION_PINS;
+      endMask = 0;
+      return CLOCK_ACLK_TICKS((unsigned long)in->arg*MOTION_UNIT_MS);
+    case ENC_DETONATE:
+      P2OUT &= ~(0x0F);
+      P2OUT |= MOTION_DETONATE;
+      endMask = 0;
+      return 0;
+    case ENC_FORWARD:
+      P2OUT &= ~(0x17);
+      P2OUT |= MOTION_FORWARD;
+      endMask = MOTION_FORWARD;
+      return CLOCK_ACLK_TICKS((unsigned long)in->arg*MOTION_UNIT_MS);
+    case ENC_BACKWARD:
+      P2OUT &= ~(0x1B);
+      P2OUT |= MOTION_BACKWARD;
+      endMask = MOTION_BACKWARD;
+      return CLOCK_ACLK_TICKS((unsigned long)in->arg*MOTION_UNIT_MS);
+    case ENC_LEFT:
+    case ENC_RIGHT:
+      P2OUT &= ~(0x06);
+      if(in->op == ENC_RIGHT){
+        P2OUT |= MOTION_RIGHT + MOTION_FORWARD;
+      }else{
+        P2OUT &= ~(MOTION_RIGHT);
+        P2OUT |= MOTION_LEFT + MOTION_FORWARD;
+      }
+      endMask = 0x19;
+      return CLOCK_ACLK_TICKS((unsigned long)in->arg*MOTION_TURN_MS
+                              / MOTION_TURN_DEG);
+    default:
+      P2OUT &= ~MOTION_PINS;
+      endMask = 0;
+      return 0;
+  }
+}
+#else
+// Set the pins for one instruction and return its duration in ACLK ticks
+static unsigned long startInstr(const Encoding_Instr *in)
+{
+  const Motion_Pins *p = &pinTable[in->op & 0x07];
+
+  P2OUT = (P2OUT & ~p->clear) | p->set;
+  endMask = p->end;
+  if (p->timing == TIME_UNITS)
+    return CLOCK_ACLK_TICKS((unsigned long)in->arg*MOTION_UNIT_MS);
+  if (p->timing == TIME_DEGREES)
+    return CLOCK_ACLK_TICKS((unsigned long)in->arg*MOTION_TURN_MS
+                            / MOTION_TURN_DEG);
+  return 0;
+}
+#endif
+
+
+// Run an ENC_CONTROL instruction: move "step" to where the program goes on.
+// Returns 0 if the program is malformed here.
+static char control(unsigned int arg)
+{
+  unsigned int operand = ENC_CTL_OPERAND(arg);
+
+  switch (ENC_CTL_KIND(arg))
+  {
+    case ENC_CTL_REPEAT:
+      if (!operand || depth == MOTION_STACK_DEPTH)
+        return 0;
+      stack[depth].addr = step;
+      stack[depth++].count = operand;
+      return 1;
+    case ENC_CTL_LOOP:
+      if (!depth || !stack[depth-1].count)  // Not in a REPEAT body
+        return 0;
+      if (--stack[depth-1].count)
+        step = stack[depth-1].addr;
+      else
+        depth--;
+      return 1;
+    case ENC_CTL_CALL:
+      if (operand >= number || depth == MOTION_STACK_DEPTH)
+        return 0;
+      stack[depth].addr = step;
+      stack[depth++].count = 0;
+      step = operand;
+      return 1;
+    default:                                // ENC_CTL_RETURN
+      while (depth && stack[depth-1].count) // Leave unfinished loops
+        depth--;
+      if (!depth)
+        step = number;                      // End of the main program
+      else
+        step = stack[--depth].addr;
+      return 1;
+  }
+}
+
+
+// Make slot "s" the running program
+static void load(char s)
+{
+  active = s;
+  program = slot[s];
+  number = slotLen;
+  step = 0;
+  runs = 0;
+  depth = 0;
+}
+
+
+// Start instructions until one needs timing, moving on to the staged program
+// when the running one ends; returns 0 when there is nothing left to run.  A
+// malformed instruction, a program needing a newer encoding, or a loop
+// running more than MOTION_MAX_UNTIMED control instructions without a timed
+// step, stops the car and ends the program there.
+static char nextStep(void)
+{
+  unsigned long ticks;
+  unsigned int left;
+  char n;
+  char untimed = 0;
+
+  for (;;)
+  {
+    while (runs || step < number)
+    {
+      if (!runs)
+      {
+        left = number - step;
+        n = Encoding_Decode(&program[step],
+                            left > ENC_MAX_BYTES ? ENC_MAX_BYTES : left,
+                            &instr);
+        if (n)
+          step += n;
+        if (!n || (instr.op == ENC_VERSION
+                   && instr.arg > ENC_VERSION_CURRENT)
+            || (instr.op == ENC_CONTROL
+                && (instr.repeat != 1 || ++untimed > MOTION_MAX_UNTIMED
+                    || !control(instr.arg))))
+        {
+          P2OUT &= ~MOTION_PINS;
+          step = number;
+          break;
+        }
+        if (instr.op == ENC_CONTROL)
+          continue;
+        runs = instr.repeat;
+      }
+      runs--;
+      ticks = startInstr(&instr);
+      if (ticks)
+      {
+        remaining = ticks;
+        armChunk();
+        return 1;
+      }
+      P1OUT ^= MOTION_LED;                  // Zero-length step done
+    }
+    done++;
+    if (!staged)
+      return 0;
+    staged = 0;
+    load(active ^ 1);
+  }
+}
+
+
+void Motion_SetPolicy(char p)
+{
+  policy = p;
+}
+
+
+//-----------------------------------------------------------------------------
+//  char *Motion_Claim(void)
+//
+//  DESCRIPTION:
+//  Returns the idle slot, MOTION_MAX_INSTR bytes, for the next program to be
+//  written into.  It stays untouched by the executor until Motion_Commit().
+//  With MOTION_POLICY_APPEND there is no idle slot while a program is
+//  already staged behind the running one.  Must be called with interrupts
+//  off (i.e. from an ISR).
+//
+//  RETURN VALUE:
+//      char *
+//          The slot
+//          0:  No slot free, try again once a program finishes
+//-----------------------------------------------------------------------------
+char *Motion_Claim(void)
+{
+  if (staged)
+    return 0;
+  return slot[active ^ 1];
+}
+
+
+//-----------------------------------------------------------------------------
+//  void Motion_Commit(unsigned int length)
+//
+//  DESCRIPTION:
+//  Hands over the program written into the slot from Motion_Claim().  If
+//  the executor is idle it starts right away.  Otherwise, with
+//  MOTION_POLICY_APPEND the program is staged and starts as soon as the
+//  running one ends; with MOTION_POLICY_REPLACE the running program is cut
+//  short and the new one starts now.  Live driving stops with its pins and
+//  dead-man timer.  Must be called with interrupts off.
+//
+//  ARGUMENTS:
+//      unsigned int length
+//          Bytes of instructions, at most MOTION_MAX_INSTR
+//-----------------------------------------------------------------------------
+void Motion_Commit(unsigned int length)
+{
+  if (length > MOTION_MAX_INSTR)
+    length = MOTION_MAX_INSTR;
+  slotLen = length;
+  if (driving)                              // A program ends live driving:
+  {                                         // pins and dead-man timer off
+    P2OUT &= ~MOTION_PINS;
+    TACCTL0 = 0;
+    driving = 0;
+  }
+
+  if (busy && policy == MOTION_POLICY_APPEND)
+  {
+    staged = 1;
+    return;
+  }
+
+  if (busy)                                 // MOTION_POLICY_REPLACE
+  {
+    TACCTL0 = 0;
+    P2OUT &= ~endMask;
+    done++;                                 // Report the dropped program
+  }
+  staged = 0;
+  load(active ^ 1);
+  busy = nextStep();
+}
+
+char Motion_Busy(void)
+{
+  return busy;
+}
+
+// Returns 1 once for each program that has finished (or was replaced)
+char Motion_Done(void)
+{
+  char d;
+
+  _DINT();
+  d = done;
+  if (d)
+    done--;
+  _EINT();
+  return d != 0;
+}
+
+
+// Non-zero if Motion_Done() has a finished program to return
+char Motion_Finished(void)
+{
+  return done != 0;
+}
+
+
+//-----------------------------------------------------------------------------
+//  void Motion_Drive(char pins)
+//
+//  DESCRIPTION:
+//  Live driving: sets the H-bridge pins now and (re)starts the dead-man
+//  timer.  A running program is cut short and a staged one dropped, each
+//  reported as done.  Must be called with interrupts off.
+//
+//  ARGUMENTS:
+//      char pins
+//          MOTION_FORWARD/BACKWARD/LEFT/RIGHT bits; opposing bits set
+//          together cancel out
+//-----------------------------------------------------------------------------
+void Motion_Drive(char pins)
+{
+  if (busy)
+  {
+    P2OUT &= ~endMask;
+    done++;
+    busy = 0;
+  }
+  if (staged)                               // Report the dropped one too
+    done++;
+  staged = 0;
+
+  pins &= MOTION_FORWARD + MOTION_BACKWARD + MOTION_LEFT + MOTION_RIGHT;
+  if ((pins & (MOTION_FORWARD + MOTION_BACKWARD))
+      == MOTION_FORWARD + MOTION_BACKWARD)
+    pins &= ~(MOTION_FORWARD + MOTION_BACKWARD);
+  if ((pins & (MOTION_LEFT + MOTION_RIGHT)) == MOTION_LEFT + MOTION_RIGHT)
+    pins &= ~(MOTION_LEFT + MOTION_RIGHT);
+  P2OUT = (P2OUT & ~MOTION_PINS) | pins;
+
+  driving = 1;
+  TACCR0 = Clock_Now() + deadman;
+  TACCTL0 = CCIE;
+}
+
+// Dead-man window for Motion_Drive(), in ms
+void Motion_SetDeadman(unsigned int ms)
+{
+  deadman = CLOCK_ACLK_TICKS(ms);
+}
+
+
+// Timer_A CCR0: end of a step (or of one chunk of a long step), or the
+// dead-man timer running out while driving
+#pragma vector=TIMERA0_VECTOR
+__interrupt void motion_ISR(void)
+{
+  TRACE(TRACE_TIMER0, TRACE_LATE(TACCR0));
+  if (driving)                              // No PKT_DRIVE in time: stop
+  {
+    P2OUT &= ~MOTION_PINS;
+    TACCTL0 = 0;
+    driving = 0;
+    TRACE(TRACE_TIMER0_END, 0);
+    return;
+  }
+  if (remaining)
+  {
+    armChunk();
+    TRACE(TRACE_TIMER0_END, 0);
+    return;
+  }
+  P2OUT &= ~endMask;
+  P1OUT ^= MOTION_LED;
+  if (!nextStep())
+  {
+    TACCTL0 = 0;
+    busy = 0;
+  }
+  if (done)
+    _BIC_SR_IRQ(LPM3_bits);                 // Wake main to send confirmation
+  TRACE(TRACE_TIMER0_END, 0);
+}
@@ -0,0 +1,64 @@
+//----------------------------------------------------------------------------
+//  Description:  Motion executor for the car (RECEIVING VERSION)
+//
+//  Runs the instruction list one step at a time from the Timer_A CCR0
+//  interrupt.  The radio ISR only hands the list over and returns, and the
+//  CPU sits in LPM3 between steps.  Timer_A runs from ACLK (VLO, ~12 kHz,
+//  see Clock.h) so it keeps counting in LPM3.
+//
+//  Programs are double buffered: while one runs, the next one can be
+//  received straight into the other slot and staged, and it starts as soon
+//  as the current one ends.
+//
+//  Motion_Drive() sets the pins straight from a PKT_DRIVE packet, cutting
+//  any program short.  TACCR0 then serves as the dead-man timer: the car
+//  stops unless the next PKT_DRIVE comes within the dead-man window.
+//----------------------------------------------------------------------------
+
+
+#define MOTION_MAX_INSTR       240         // Bytes of instructions per slot
+#define MOTION_STACK_DEPTH     8           // Nested loops and calls
+#define MOTION_MAX_UNTIMED     64          // Control instructions in a row
+                                            // with no timed step between;
+                                            // more is a runaway loop
+
+// What to do with a program that arrives while another one is running
+#define MOTION_POLICY_APPEND   0           // Run it after the current one
+#define MOTION_POLICY_REPLACE  1           // Drop the current one, run it now
+
+#ifndef MOTION_QUEUE_POLICY
+#define MOTION_QUEUE_POLICY    MOTION_POLICY_APPEND
+#endif
+
+#ifndef MOTION_PIN_TABLE                    // 0: start each step with the
+#define MOTION_PIN_TABLE       1           // switch pinTable[] replaced
+#endif
+
+#define MOTION_UNIT_MS         25          // 0.1 ft of travel (GUI: 250/ft)
+#define MOTION_TURN_MS         (31*MOTION_UNIT_MS) // Time for MOTION_TURN_DEG
+#define MOTION_TURN_DEG        90
+
+#ifndef MOTION_DEADMAN_MS
+#define MOTION_DEADMAN_MS      100         // 5 PKT_DRIVE periods at 50 Hz
+#endif
+
+// P2 outputs driving the H-bridge
+#define MOTION_FORWARD         0x01        // PIN 1 (2.0)
+#define MOTION_LEFT            0x02        // PIN 2 (2.1)
+#define MOTION_BACKWARD        0x04        // PIN 3 (2.2)
+#define MOTION_RIGHT           0x08        // PIN 4 (2.3)
+#define MOTION_DETONATE        0x10        // PIN 5 (2.4)
+#define MOTION_PINS            0x1F
+
+#define MOTION_LED             0x02        // LED2, toggled after every step
+
+
+void Motion_Init(void);
+void Motion_SetPolicy(char);
+char *Motion_Claim(void);
+void Motion_Commit(unsigned int);
+char Motion_Busy(void);
+char Motion_Done(void);
+char Motion_Finished(void);
+void Motion_Drive(char);
+void Motion_SetDeadman(unsigned int);
@@ -0,0 +1,128 @@
+//----------------------------------------------------------------------------
+//  Description:  Radio packet layout shared by the SENDING and RECEIVING
+//  versions.
+//
+//  The CC2500 runs in variable-length mode, so every packet starts with a
+//  length byte counting the bytes that follow it:
+//
+//      [length] [address] [type] [payload ...]
+//
+//  Programs (instructions encoded as in Encoding.h) are cut into fragments
+//  of up to PKT_FRAG_DATA bytes, all sent in one burst:
+//
+//      PKT_FRAG       [id] [index | PKT_ACK_REQ] [total lo] [total hi] [data]
+//      PKT_FRAG_ACK   [id] [bitmap of fragments held]
+//      PKT_DONE       [seq] [link report] [car]   car finished a program;
+//                     the report is the car's RFLinkReport(), then comes
+//                     the car's address
+//      PKT_DONE_ACK   [seq]
+//      PKT_DRIVE      [H-bridge bits]   live driving, see Stream.c
+//      PKT_PROFILE    [profile]         switch modem profile, see RFSetProfile()
+//      PKT_PROFILE_ACK [profile]
+//      PKT_RUN        [id] [hash lo] [hash hi] [length]   run a program from
+//                     the car's flash cache, see Cache.h
+//      PKT_RUN_ACK    [id] [1 ran / 0 not cached]
+//      PKT_ADDRESS    [address] [groups]   give the car a new address and
+//                     group bitmap
+//      PKT_ADDRESS_ACK [address] [groups]
+//      PKT_BEACON     [seq] [frame lo] [frame hi] [slot lo] [slot hi] [n]
+//                     [car ...]   TDMA frame start, to PKT_ADDR_ALL: the
+//                     last frame and the slot in the sender's ACLK ticks,
+//                     then the n cars holding a slot, see Tdma.h
+//      PKT_JOIN       [car]       ask for a slot, in the join slot
+//
+//  Each car has its own address, PKT_ADDR_CAR at reset, and the sender has
+//  PKT_ADDR_SENDER.  The radio drops packets for other addresses before the
+//  MCU sees them (RFSetAddress()), but lets through the two broadcast
+//  addresses:
+//
+//      PKT_ADDR_GROUP [length] [0x00] [type] [groups] [payload ...]
+//                     for every car in one of the groups of the bitmap
+//      PKT_ADDR_ALL   [length] [0xFF] [type] [payload ...]
+//                     for every car
+//
+//  Only PKT_DRIVE and PKT_BEACON are taken from a broadcast, so a platoon
+//  can be driven live as one; everything that is acknowledged goes to a
+//  single car.
+//  Cars answer PKT_ADDR_SENDER.
+//
+//  Every fragment carries the program id and total length, so any of them
+//  can open the transfer on the car.  The last fragment of a burst asks for
+//  a PKT_FRAG_ACK; the sender then resends only the fragments missing from
+//  its bitmap.  See TransferTx.c and TransferRx.c.
+//
+//  PKT_DONE is sent stop-and-wait: the car repeats it until the sender
+//  answers with a PKT_DONE_ACK carrying the same seq, and the sender
+//  forwards a given seq to the GUI only once.
+//
+//  PKT_PROFILE is also repeated until acknowledged.  The car answers in the
+//  profile it is in and switches once the answer is on the air; the sender
+//  switches on the answer.  Since a lost answer leaves the car already
+//  switched, the sender asks in the old and the new profile by turns.
+//
+//  PKT_RUN takes its id from the same sequence as the programs, and the car
+//  runs a given id only once, like the fragments.
+//
+//  PKT_ADDRESS takes effect on the car at once, so the sender asks at the
+//  old and the new address by turns, like a profile change.  The address
+//  is kept in RAM: a car reset goes back to PKT_ADDR_CAR.
+//----------------------------------------------------------------------------
+
+
+// Addresses
+#ifndef PKT_ADDR_CAR                        // This car's at reset, build with
+#define PKT_ADDR_CAR           0x01        // one per car
+#endif
+#ifndef PKT_GROUPS_CAR                      // ...and its group bitmap
+#define PKT_GROUPS_CAR         0x00
+#endif
+#define PKT_ADDR_SENDER        0xFE
+#define PKT_ADDR_GROUP         RF_ADDR_BROADCAST0
+#define PKT_ADDR_ALL           RF_ADDR_BROADCAST1
+#define PKT_ADDR_UNIT(a)       ((unsigned char)(a) != PKT_ADDR_GROUP          \
+                                && (unsigned char)(a) != PKT_ADDR_ALL         \
+                                && (unsigned char)(a) != PKT_ADDR_SENDER)
+                                            // A single car
+
+// Packet types
+#define PKT_FRAG               0x02
+#define PKT_FRAG_ACK           0x03
+#define PKT_DONE               0x11        // Was the bare confirmation byte
+#define PKT_DONE_ACK           0x12
+#define PKT_DRIVE              0x20
+#define PKT_PROFILE            0x30
+#define PKT_PROFILE_ACK        0x31
+#define PKT_RUN                0x40
+#define PKT_RUN_ACK            0x41
+#define PKT_ADDRESS            0x50
+#define PKT_ADDRESS_ACK        0x51
+#define PKT_BEACON             0x60
+#define PKT_JOIN               0x61
+
+#define PKT_HDR_LEN            2           // Address + type
+
+// Value of the length byte, and whole packet size, for "n" payload bytes
+#define PKT_LEN(n)             ((n) + PKT_HDR_LEN)
+#define PKT_SIZE(n)            (PKT_LEN(n) + 1)
+
+// PKT_FRAG
+#define PKT_FRAG_HDR           4           // id, index, total length
+#define PKT_FRAG_DATA          48          // Largest fragment: fits the FIFO
+#define PKT_ACK_REQ            0x80        // In the index byte
+#define PKT_MAX_FRAGS          5           // MOTION_MAX_INSTR of car RAM
+#define PKT_PROG_MAX           (PKT_MAX_FRAGS*PKT_FRAG_DATA)
+
+// PKT_RUN
+#define PKT_RUN_LEN            4
+
+// PKT_BEACON
+#define PKT_BEACON_HDR         6           // Before the slot table
+
+// PKT_DONE
+#define PKT_DONE_LEN           (2 + RF_LINK_REPORT_LEN)
+
+#define PKT_MAX_LEN            PKT_LEN(PKT_FRAG_HDR + PKT_FRAG_DATA)
+
+#if PKT_MAX_LEN + 1 > RF_FEC_PKTLEN
+#error "The largest packet must fit RF_PROFILE_FEC's fixed length"
+#endif
@@ -4,6 +4,17 @@
 
 
 #include "TI_CC/include.h"
+#include "Clock.h"
+#include "Motion.h"
+#include "Protocol.h"
+#include "Transfer.h"
+#include "Cache.h"
+#include "Tdma.h"
+#include "Trace.h"
+#if TRACE_ENABLE
+#include "Uart.h"
+#include "HostLink.h"
+#endif
 
 
 // bit masks for P1 on the RF2500 target board
@@ -12,24 +23,24 @@
 #define SW1_MASK               0x04 
 #define flashcount			   5000
 #define delaycount			   1000
-#define disttime			   500
 
-//bit marcos for decoding
-#define OPCODE(instr) 		  	(instr & (0x60))
-#define ARGUMENT(instr)			(instr & (0x1F))
+// Sleep mode between events.  Tracing needs SMCLK for its Timer_B
+// timestamps and for the UART that dumps them.
+#if TRACE_ENABLE
+#define SLEEP_BITS             LPM0_bits
+#else
+#define SLEEP_BITS             LPM3_bits
+#endif
 
 
 extern char paTable[];		// power table for C2500
 extern char paTableLen;
 
-char txBuffer[4];
-char rxBuffer[51];
+char rxBuffer[PKT_MAX_LEN];
+#if TRACE_ENABLE
+char trace[TRACE_DUMP_LEN];                 // HOST_TRACE payload
+#endif
 unsigned int i,j,k;
-unsigned long int time;
-
-char RXchars[50];
-int number = 0;
-char op, arg;
 
 
 
@@ -37,14 +48,20 @@ char op, arg;
 void main (void)
 {
   WDTCTL = WDTPW + WDTHOLD;                 // Stop WDT
+  Clock_Init();                             // DCO and ACLK from the clock profile
+  Trace_Init();                             // Timer_B timestamps, if tracing
+#if TRACE_ENABLE
+  Uart_Init();                              // Trace dumps over the backchannel
+#endif
 
 //CONFIGURE SPI WIRELESS
   P2SEL &= 0x3F;							//clear select bits for XIN,XOUT, which are set by default
 
   TI_CC_SPISetup();                         // Initialize SPI port
-  TI_CC_PowerupResetCCxxxx();               // Reset CCxxxx
-  writeRFSettings();                        // Write RF settings to config reg
-  TI_CC_SPIWriteBurstReg(TI_CCxxx0_PATABLE, paTable, paTableLen);//Write PATABLE
+  while (RFInit());                         // Reset CCxxxx, write RF settings
+                                            // and PATABLE until they verify
+  RFSetAddress(PKT_ADDR_CAR);               // Packets for other cars stay in
+                                            // the radio
 
   // Configure ports -- switch inputs, LEDs, GDO0 to RX packet info from CCxxxx
  
@@ -65,6 +82,9 @@ void main (void)
   //Configure OutPut Pins on Port 2
   P2DIR |= 0x1F; //Outputs
   P2OUT &= ~0x1F; //All pins to 0
+
+  Motion_Init();                            // Timer_A from ACLK for move timing
+  Cache_Init();                             // Programs kept in flash
   
   // setup for interrupts related to receipt of a message from the CC2500
   
@@ -72,109 +92,134 @@ void main (void)
   TI_CC_GDO0_PxIFG &= ~TI_CC_GDO0_PIN;      // Clear Interrupt flag for GDO0 pin
   TI_CC_GDO0_PxIE |= TI_CC_GDO0_PIN;        // Enable interrupt on end of packet
 
-  // turn on the CC2500 in receive mode
-  TI_CC_SPIStrobe(TI_CCxxx0_SRX);           // Initialize CCxxxx in RX mode.
+  // turn on the CC2500 in receive mode, continuous or Wake-on-Radio
+  RFWorListen(RF_WOR_SETTING);              // Initialize CCxxxx in RX mode.
                                             // When a pkt is received, it will
                                             // signal on GDO0 and wake CPU
-  _BIS_SR(LPM3_bits + GIE);                 // Enter LPM3, enable interrupts
+  RFHopStart(RF_HOP_SEED, RF_HOP_FOLLOW);   // Follow the sender, if hopping
+  for (;;)
+  {
+    _DINT();
+#if TRACE_ENABLE
+    if (!Transfer_Reporting() && !Cache_Pending() && !Uart_Available())
+#else
+    if (!Transfer_Reporting() && !Cache_Pending())
+#endif
+      _BIS_SR((TI_CC_SPIBusy() ? LPM0_bits : SLEEP_BITS) + GIE);
+                                            // Sleep, enable interrupts; SPI
+                                            // transfers need SMCLK
+    _EINT();
+
+    //When all of the instructions are done
+    //send confirmation of completed instructions, one at a time: each is
+    //repeated until the sender acknowledges it
+    Transfer_SendReports();
+    Cache_Poll();                           // Keep a new program in flash
+
+#if TRACE_ENABLE
+    switch (HostLink_Poll())                // The car only answers HOST_TRACE
+    {
+    case 0:
+      break;
+    case HOST_TRACE:
+      HostLink_Send(HOST_TRACE, trace, Trace_Dump(trace));
+      HostLink_Ack();
+      break;
+    default:
+      HostLink_Nack(HOST_ERR_TYPE);
+      break;
+    }
+#endif
+  }
 }
 
 
-// ISR for received packet
+// ISR for GDO0
 // The ISR assumes the int came from the pin attached to GDO0 and therefore
-// does not check the other seven inputs.  Interprets this as a signal from
-// CCxxxx indicating packet received.
+// does not check the other seven inputs.  GDO0 falls at the end of a
+// confirmation sent by RFSendPacketAsync() or of a received packet.
+// Broadcasts are only taken for PKT_DRIVE and PKT_BEACON, and group ones
+// only by members.
 
 //This is triggered when the packets of instructions are sent from the SENDER 
 #pragma vector=PORT2_VECTOR
 __interrupt void port2_ISR (void)
 {
-  char len=50;                               // Len of pkt to be RXed (only addr
+  char len=sizeof(rxBuffer);                 // Len of pkt to be RXed (only addr
                                             // plus data; size byte not incl b/c
                                             // stripped away within RX function)
-  if (RFReceivePacket(rxBuffer,&len)){       // Fetch packet from CCxxxx
-
-  	number = rxBuffer[1];					//the number of instructions is stored in the first element
-  	for (j = 0; j < number;j++){	
-  		RXchars[j] = rxBuffer[j+2];			//store the instructions into an array
-  	}
-  	
- //PIN 1 (2.0) - Forward
- //PIN 2 (2.1) - Left
- //PIN 3 (2.2) - Backward
- //PIN 4 (2.3) - Right
- //PIN 5 (2.4) - Detonate
-  	
-  	//run each instruction one at a time
-  	for (k = 0; k < number; k++){
-		//get the opcode and argument through bit masks
-  		op =OPCODE(RXchars[k]);
-  		arg = ARGUMENT(RXchars[k]);
-  		switch(op){
-  			case 0x00:	// Stop/Detonate
-				if(arg > 0){			//Argument is non-zero if command is detonate
-					P2OUT &= ~(0x0F);	
-					P2OUT |= 0x10;		
-				}else
-				{
-					P2OUT &= ~0x1F;
-				}
-  				time = 0; 											
-  				P1OUT ^= LED2_MASK;			 			 
-  			break; 													
-  			case 0x20: // Forward 									
-  				P2OUT &= ~(0x17); 									
-  				P2OUT |= 0x01; 										
-  				while(time++ < disttime*arg); 						
-  				P1OUT ^= LED2_MASK;			 			
-  				P2OUT &= ~(0x01); 									
-  				time = 0; 											
-  			break; 													
-  			case 0x40: // Backward 									
-  				P2OUT &= ~(0x1B); 									
-  				P2OUT |= 0x04; 										
-  				while(time++ < disttime*arg); 						
-  				P1OUT ^= LED2_MASK;			 			
-  				P2OUT &= ~(0x04); 									
-  				time = 0; 											
-  			break; 													
-  			case 0x60: //Turn 										
-  			P2OUT &= ~(0x06);	
-				if(arg > 0){			//Argument is non-zero if command is RIGHT
-					P2OUT &= ~(0x02);
-					P2OUT |= 0x09;
-				}else{
-					P2OUT &= ~(0x08);
-					P2OUT |= 0x03;
-				}
-				while(time++ < disttime*31);
-				P2OUT &= ~(0x19);
-				time = 0;
-			P1OUT ^= LED2_MASK;			 			
-  			break;
-			default: 
-  				P2OUT &= ~(0x1F);
-  				time = 0;			 			
-  		}
-		
+  char event;
+  char *payload = &rxBuffer[2];
+  char n;
+
+  TRACE(TRACE_GDO0, 0);
+  event = RFGDO0Event();
+  if (event == RF_EVENT_TX_DONE)
+  {
+    Transfer_TxDone();                      // Profile switch, if one waits
+    _BIC_SR_IRQ(LPM3_bits);                 // Send the next confirmation
+    TRACE(TRACE_GDO0_END, event);
+    return;
   }
-
-  	//When all of the instructions are done
-  	//send confirmation of completed instructions
-  	
-  	P2IFG &= ~TI_CC_GDO0_PIN;                 // Clear flag
-  	
-  	txBuffer[0] = 2;
-  	txBuffer[1] = 0x01;
-  	txBuffer[2] = 0x11;						//Confirmation character
-  	
-  	RFSendPacket(txBuffer,3);
- 	P1IFG &= ~SW1_MASK;                        //Clr flag that caused int
-	P2IFG &= ~TI_CC_GDO0_PIN;                  // After pkt TX, this flag is set.
-  	
-
+  if (event != RF_EVENT_RX)
+  {
+    TRACE(TRACE_GDO0_END, event);
+    return;
+  }
+  if (!RFReceivePacket(rxBuffer,&len) || len < PKT_HDR_LEN) // Fetch packet from CCxxxx
+  {
+    TRACE(TRACE_GDO0_END, event);
+    return;
+  }
+  n = len - PKT_HDR_LEN;
+  if (rxBuffer[0] != RFAddress())           // Broadcast
+  {
+    if (rxBuffer[1] != PKT_DRIVE && rxBuffer[1] != PKT_BEACON)
+    {
+      TRACE(TRACE_GDO0_END, event);
+      return;
+    }
+    if (rxBuffer[0] == PKT_ADDR_GROUP)      // Strip the group bitmap
+    {
+      if (!n || !(payload[0] & Transfer_Groups()))
+      {
+        TRACE(TRACE_GDO0_END, event);
+        return;
+      }
+      payload++;
+      n--;
+    }
+  }
+  switch (rxBuffer[1])
+  {
+  case PKT_FRAG:
+    //the packet is CRC checked; its data goes straight into the idle
+    //program slot.  A complete program is staged if one is running and
+    //starts as soon as the current one ends
+    Transfer_Fragment(payload, n);
+    break;
+  case PKT_DONE_ACK:
+    Transfer_ReportAcked(payload, n);
+    break;
+  case PKT_DRIVE:
+    if (n)                                  //live driving: pins now
+      Motion_Drive(payload[0]);
+    break;
+  case PKT_PROFILE:
+    Transfer_Profile(payload, n);
+    break;
+  case PKT_RUN:
+    Transfer_RunCached(payload, n);
+    break;
+  case PKT_ADDRESS:
+    Transfer_Address(payload, n);
+    break;
+  case PKT_BEACON:
+    Tdma_Beacon(payload, n);                //our uplink slot, if any
+    break;
   }
-  P2IFG &= ~TI_CC_GDO0_PIN;                 // Clear flag
+  _BIC_SR_IRQ(LPM3_bits);                   // Let main report finished programs
+  TRACE(TRACE_GDO0_END, event);
 }
 
 
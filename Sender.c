@@ -3,6 +3,14 @@
 //SENDING VERSION
 
 #include "TI_CC/include.h"
+#include "Protocol.h"
+#include "Clock.h"
+#include "Uart.h"
+#include "HostLink.h"
+#include "Transfer.h"
+#include "Stream.h"
+#include "Tdma.h"
+#include "Trace.h"
 
 
 // bit masks for P1 on the RF2500 target board
@@ -15,30 +23,27 @@
 extern char paTable[];		// power table for C2500
 extern char paTableLen;
 
-char txBuffer[51];
-char rxBuffer[4];
+char rxBuffer[PKT_LEN(PKT_DONE_LEN)];
+char link[2*RF_LINK_REPORT_LEN+1];          // HOST_DONE payload
+#if TRACE_ENABLE
+char trace[TRACE_DUMP_LEN];                 // HOST_TRACE payload
+#endif
 unsigned int i,j;
 unsigned int count;
 
-char TXchars[50];
-int countint = 0;
-int number = 0;
+char number = 0;
+char sending = 0;                           // A program (or profile change)
+                                            // frame is being carried out
 
 
 void main (void)
 {
   WDTCTL = WDTPW + WDTHOLD;                 // Stop WDT
 
-//CONFIGURE UART SERIAL
-  BCSCTL1 = CALBC1_1MHZ;                    // Set DCO
-  DCOCTL = CALDCO_1MHZ;
-  P3SEL = 0x30;                             // P3.4,5 = USCI_A0 TXD/RXD
-  UCA0CTL1 |= UCSSEL_2;                     // SMCLK
-  UCA0BR0 = 104;                            // 1MHz 9600
-  UCA0BR1 = 0;                              // 1MHz 9600
-  UCA0MCTL = UCBRS0;                        // Modulation UCBRSx = 1
-  UCA0CTL1 &= ~UCSWRST;                     // **Initialize USCI state machine**
-  IE2 |= UCA0RXIE;                          // Enable USCI_A0 RX interrupt
+//CONFIGURE CLOCKS AND UART SERIAL
+  Clock_Init();                             // DCO and ACLK from the clock profile
+  Uart_Init();                              // CLOCK_BAUD, RX/TX rings, RX interrupt
+  Trace_Init();                             // Timer_B timestamps, if tracing
 
 
   
@@ -46,9 +51,9 @@ void main (void)
   P2SEL &= 0x3F;							//clear select bits for XIN,XOUT, which are set by default
 
   TI_CC_SPISetup();                         // Initialize SPI port
-  TI_CC_PowerupResetCCxxxx();               // Reset CCxxxx
-  writeRFSettings();                        // Write RF settings to config reg
-  TI_CC_SPIWriteBurstReg(TI_CCxxx0_PATABLE, paTable, paTableLen);//Write PATABLE
+  while (RFInit());                         // Reset CCxxxx, write RF settings
+                                            // and PATABLE until they verify
+  RFSetAddress(PKT_ADDR_SENDER);            // Cars answer here
 
   // Configure ports -- switch inputs, LEDs, GDO0 to RX packet info from CCxxxx
  
@@ -76,69 +81,212 @@ void main (void)
   TI_CC_SPIStrobe(TI_CCxxx0_SRX);           // Initialize CCxxxx in RX mode.
                                             // When a pkt is received, it will
                                             // signal on GDO0 and wake CPU
-  _BIS_SR(LPM3_bits + GIE);                 // Enter LPM3, enable interrupts
-}
+  RFWorPeer(RF_WOR_SETTING);                // Wake the car first if it sleeps
+  RFHopStart(RF_HOP_SEED, RF_HOP_LEAD);     // Pick the channel, if hopping
+  Tdma_Start();                             // Beacon the uplink slots, if TDMA
+  for (;;)
+  {
+    _DINT();
+    if ((sending || !Uart_Available()) && !Transfer_Reported()
+        && !Transfer_Ready())
+    {
+      _BIS_SR(LPM0_bits + GIE);             // Sleep until a UART byte, a
+      _DINT();                              // confirmation or radio work;
+    }                                       // SMCLK stays on
 
-//Interrupt handler for serial read
-#pragma vector=USCIAB0RX_VECTOR
-__interrupt void USCI0RX_ISR(void)
-{
-  while (!(IFG2&UCA0TXIFG));				// USCI_A0 TX buffer ready?
-  if(UCA0RXBUF != 10 || !countint){			// skip the stop filler characters unless it is the first one
-  TXchars[countint] = UCA0RXBUF;            // save the character to the array
-  countint++;									
-  }
-  UCA0TXBUF = UCA0RXBUF;                    // TX -> RXed character for confirmation to the GUI
- 
-  																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																																				
-  if((countint-1) >= TXchars[0] && UCA0RXBUF == 10){	//When all of the characters have been read in
-  	number = countint-1;								//Get the number of instructions
-  	TXchars[0] = 90;									//Reset number of instructions
-  	countint = 0;										//Reset counter
-  	
-	// After the serial read is done 
-	// wireless sending							
-  txBuffer[0] = 50;                           // Packet length
-  txBuffer[1] = 0x01;                        // Packet address
-  txBuffer[2] = number;						//number of instructions
-  
-  //store the characters to be sent in the txBuffer
-  for (j = 1; j <= number; j++){
-  	txBuffer[j+2] = TXchars[j];
-  }
-  
+    // Tell the GUI which cars are done and how both ends hear each other,
+    // taking each report off the ISR's queue with interrupts off
+    while (Transfer_CarLink(link))
+    {
+      _EINT();
+      link[2*RF_LINK_REPORT_LEN] = link[RF_LINK_REPORT_LEN];
+      RFLinkReport(&link[RF_LINK_REPORT_LEN]);
+      HostLink_Send(HOST_DONE, link, sizeof(link));
+      _DINT();
+    }
+    _EINT();
 
-  RFSendPacket(txBuffer, 51);                 // Send the packet value over RF
-  P1OUT ^= LED2_MASK;			 			 // toggle LED2 on THIS board
-  
-  P1IFG &= ~SW1_MASK;                        //Clr flag that caused int
-  P2IFG &= ~TI_CC_GDO0_PIN;                  // After pkt TX, this flag is set.
- 
-  }
+    // The program frame is answered only once the car holds all of it
+    switch (Transfer_Poll())
+    {
+    case TRANSFER_DONE:
+      P1OUT ^= LED2_MASK;                   // toggle LED2 on THIS board
+      HostLink_Ack();                       // One ack per program
+      sending = 0;
+      break;
+    case TRANSFER_FAILED:
+      HostLink_Nack(HOST_ERR_RADIO);
+      sending = 0;
+      break;
+    case TRANSFER_MISS:
+      HostLink_Nack(HOST_ERR_MISS);         // The GUI uploads it instead
+      sending = 0;
+      break;
+    }
+    if (sending)
+      continue;
 
-  
+    switch (HostLink_Poll())                //When a whole frame has been read in
+    {
+    case 0:
+      break;
+    case HOST_PROGRAM:
+    {
+      char *instr = HostLink_Frame(&number);
+
+      // Fragments go out straight from the frame buffer, to one car;
+      // not while driving live
+      if (!PKT_ADDR_UNIT(Transfer_Target()))
+        HostLink_Nack(HOST_ERR_TARGET);
+      else if (Stream_Active())
+        HostLink_Nack(HOST_ERR_RADIO);
+      else if (Transfer_Start(instr, (unsigned char)number))
+        sending = 1;
+      else
+        HostLink_Nack(HOST_ERR_LENGTH);
+      break;
+    }
+    case HOST_DRIVE:
+    {
+      char *drive = HostLink_Frame(&number);
+
+      if (number)                           // Live driving: straight out
+        Stream_Set(drive[0]);
+      else
+        Stream_Stop();
+      HostLink_Ack();
+      break;
+    }
+    case HOST_PROFILE:
+    {
+      char *profile = HostLink_Frame(&number);
+
+      // Answered once both ends use it; not while driving live
+      if (number != 1)
+        HostLink_Nack(HOST_ERR_LENGTH);
+      else if (!PKT_ADDR_UNIT(Transfer_Target()))
+        HostLink_Nack(HOST_ERR_TARGET);
+      else if (Stream_Active() || !Transfer_SetProfile(profile[0]))
+        HostLink_Nack(HOST_ERR_RADIO);
+      else
+        sending = 1;
+      break;
+    }
+    case HOST_RUN:
+    {
+      char *run = HostLink_Frame(&number);
+      unsigned int hash = (unsigned char)run[0]
+                        | ((unsigned int)(unsigned char)run[1] << 8);
+
+      // Answered once the car runs it, or says it hasn't got it
+      if (number != 3)
+        HostLink_Nack(HOST_ERR_LENGTH);
+      else if (!PKT_ADDR_UNIT(Transfer_Target()))
+        HostLink_Nack(HOST_ERR_TARGET);
+      else if (Stream_Active() || !Transfer_Run(hash, run[2]))
+        HostLink_Nack(HOST_ERR_RADIO);
+      else
+        sending = 1;
+      break;
+    }
+    case HOST_TARGET:
+    {
+      char *to = HostLink_Frame(&number);
+
+      // A car, a group or all of them; not while driving live
+      if (number != 2)
+        HostLink_Nack(HOST_ERR_LENGTH);
+      else if (Stream_Active())
+        HostLink_Nack(HOST_ERR_RADIO);
+      else if (!Transfer_SetTarget(to[0], to[1]))
+        HostLink_Nack(HOST_ERR_TARGET);
+      else
+        HostLink_Ack();
+      break;
+    }
+    case HOST_ADDRESS:
+    {
+      char *addr = HostLink_Frame(&number);
+
+      // Answered once the car has taken it; the target follows the car
+      if (number != 2)
+        HostLink_Nack(HOST_ERR_LENGTH);
+      else if (!PKT_ADDR_UNIT(Transfer_Target()) || !PKT_ADDR_UNIT(addr[0]))
+        HostLink_Nack(HOST_ERR_TARGET);
+      else if (Stream_Active() || !Transfer_SetAddress(addr[0], addr[1]))
+        HostLink_Nack(HOST_ERR_RADIO);
+      else
+        sending = 1;
+      break;
+    }
+#if TRACE_ENABLE
+    case HOST_TRACE:
+      HostLink_Send(HOST_TRACE, trace, Trace_Dump(trace));
+      HostLink_Ack();
+      break;
+#endif
+    default:
+      HostLink_Nack(HOST_ERR_TYPE);
+      break;
+    }
+  }
 }
 
 
-// ISR for received packet
+// ISR for GDO0
 // The ISR assumes the int came from the pin attached to GDO0 and therefore
-// does not check the other seven inputs.  Interprets this as a signal from
-// CCxxxx indicating packet received.
+// does not check the other seven inputs.  GDO0 falls at the end of a packet
+// sent by RFSendPacketAsync() or at the end of a received one.
 
-// This is triggered when the car is done with its instruction set and sends a confirmation of completion
+// The car sends fragment acks, and a confirmation when its program is done
 #pragma vector=PORT2_VECTOR
 __interrupt void port2_ISR (void)
 {
-  char len=3;                               // Len of pkt to be RXed (only addr
+  char len=sizeof(rxBuffer);                // Len of pkt to be RXed (only addr
                                             // plus data; size byte not incl b/c
                                             // stripped away within RX function)
-  if (RFReceivePacket(rxBuffer,&len)){       // Fetch packet from CCxxxx
-  	while (!(IFG2&UCA0TXIFG));			
-  	UCA0TXBUF = rxBuffer[1];			//Send the character recieved character back up through the UART to unlock the GUI
-  	P1OUT ^= LED1_MASK;					//Toggle RED LED
-  	
+  char event;
+
+  TRACE(TRACE_GDO0, 0);
+  event = RFGDO0Event();
+  if (event == RF_EVENT_TX_DONE)
+  {
+    _BIC_SR_IRQ(LPM3_bits);                 // main() may send the next one
+    TRACE(TRACE_GDO0_END, event);
+    return;
+  }
+  if (event != RF_EVENT_RX)                 // Wake-up burst still going
+  {
+    TRACE(TRACE_GDO0_END, event);
+    return;
+  }
+  if (RFReceivePacket(rxBuffer,&len) && len >= PKT_HDR_LEN){ // Fetch packet from CCxxxx
+    switch (rxBuffer[1])
+    {
+    case PKT_FRAG_ACK:
+      Transfer_Acked(&rxBuffer[2], len - PKT_HDR_LEN);
+      break;
+    case PKT_PROFILE_ACK:
+      Transfer_ProfileAcked(&rxBuffer[2], len - PKT_HDR_LEN);
+      break;
+    case PKT_RUN_ACK:
+      Transfer_RunAcked(&rxBuffer[2], len - PKT_HDR_LEN);
+      break;
+    case PKT_ADDRESS_ACK:
+      Transfer_AddressAcked(&rxBuffer[2], len - PKT_HDR_LEN);
+      break;
+    case PKT_JOIN:
+      Tdma_Join(&rxBuffer[2], len - PKT_HDR_LEN);
+      break;
+    case PKT_DONE:
+      if (Transfer_Report(&rxBuffer[2], len - PKT_HDR_LEN))
+        P1OUT ^= LED1_MASK;                 //Toggle RED LED; main() tells
+                                            //the GUI
+      break;
+    }
+    _BIC_SR_IRQ(LPM3_bits);
   }
-  P2IFG &= ~TI_CC_GDO0_PIN;                 // Clear flag
+  TRACE(TRACE_GDO0_END, event);
 }
 
 
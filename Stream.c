@@ -0,0 +1,97 @@
+//----------------------------------------------------------------------------
+//  Description:  Live driving stream (SENDING VERSION)
+//
+//  Timer_A CCR0 ticks every STREAM_PERIOD_MS while streaming and repeats
+//  the current state.  A tick that finds the radio busy skips its packet;
+//  the dead-man window on the car spans several ticks.  The state goes to
+//  the target of Transfer_SetTarget(), which may be a group of cars.
+//----------------------------------------------------------------------------
+
+
+#include "TI_CC/include.h"
+#include "Clock.h"
+#include "Protocol.h"
+#include "Stream.h"
+#include "Transfer.h"
+#include "Trace.h"
+
+#define STREAM_QUIET           (STREAM_HOST_MS / STREAM_PERIOD_MS)
+
+static volatile char active = 0;
+static char state;                          // H-bridge bits being streamed
+static unsigned int quiet;                  // Ticks since the GUI's last word
+static unsigned int ticks;                  // STREAM_PERIOD_MS in ACLK ticks
+static char pkt[PKT_SIZE(2)];               // Room for a group bitmap
+
+
+// Put the current state on the air, unless the radio is busy
+static void sendState(void)
+{
+  char n = Transfer_Header(pkt, PKT_DRIVE, 1);
+
+  pkt[n] = state;
+  RFSendPacketAsync(pkt, n + 1);
+}
+
+
+//-----------------------------------------------------------------------------
+//  void Stream_Set(char pins)
+//
+//  DESCRIPTION:
+//  Starts streaming, or updates the state being streamed.  A change is sent
+//  at once and restarts the period.
+//
+//  ARGUMENTS:
+//      char pins
+//          MOTION_FORWARD/BACKWARD/LEFT/RIGHT bits, see Motion.h
+//-----------------------------------------------------------------------------
+void Stream_Set(char pins)
+{
+  _DINT();
+  quiet = 0;
+  if (!active || pins != state)
+  {
+    state = pins;
+    sendState();
+    ticks = CLOCK_ACLK_TICKS(STREAM_PERIOD_MS);
+    TACCR0 = Clock_Now() + ticks;
+    TACCTL0 = CCIE;
+    active = 1;
+  }
+  _EINT();
+}
+
+// Stop the car, repeating the stop a few times before the stream ends
+void Stream_Stop(void)
+{
+  _DINT();
+  if (active)
+  {
+    state = 0;
+    quiet = STREAM_QUIET - STREAM_STOP_REPEAT;
+    sendState();
+  }
+  _EINT();
+}
+
+char Stream_Active(void)
+{
+  return active;
+}
+
+
+// Timer_A CCR0: stream tick
+#pragma vector=TIMERA0_VECTOR
+__interrupt void stream_ISR(void)
+{
+  TRACE(TRACE_TIMER0, TRACE_LATE(TACCR0));
+  TACCR0 += ticks;
+  if (++quiet > STREAM_QUIET)               // GUI gone quiet: stop the car
+  {
+    TACCTL0 = 0;
+    active = 0;
+    state = 0;
+  }
+  sendState();
+  TRACE(TRACE_TIMER0_END, 0);
+}
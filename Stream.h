@@ -0,0 +1,25 @@
+//----------------------------------------------------------------------------
+//  Description:  Live driving stream (SENDING VERSION)
+//
+//  The GUI sends HOST_DRIVE frames when the driver's input changes.  Each
+//  change goes on the air at once as a PKT_DRIVE, and the last state is
+//  repeated every STREAM_PERIOD_MS from TACCR0 so the car's dead-man timer
+//  (MOTION_DEADMAN_MS) keeps being fed.  If the GUI goes quiet for
+//  STREAM_HOST_MS the stream sends a stop and ends.
+//
+//  Input-to-pin latency is the HOST_DRIVE frame on the serial line (7
+//  bytes, 7.3 ms at 9600 baud) plus the PKT_DRIVE airtime (15 bytes on the
+//  air, 480 us at 250 kbps) plus a few tens of us of SPI and ISR time.
+//  The periodic repeats don't add to it; only a radio still busy with a
+//  previous packet does, by at most one packet airtime.
+//----------------------------------------------------------------------------
+
+
+#define STREAM_PERIOD_MS       20          // 50 Hz
+#define STREAM_HOST_MS         500         // GUI keepalive timeout
+#define STREAM_STOP_REPEAT     3           // Stop sent this many times
+
+
+void Stream_Set(char);
+void Stream_Stop(void);
+char Stream_Active(void);
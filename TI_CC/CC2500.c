@@ -13,6 +13,8 @@
 
 #include "include.h"
 #include "CC2500.h"
+#include "../Clock.h"
+#include "../Trace.h"
 
 #define TI_CC_RF_FREQ  2400  // 315, 433, 868, 915, 2400
 
@@ -22,10 +24,11 @@
 //  void writeRFSettings(void)
 //
 //  DESCRIPTION:
-//  Used to configure the CCxxxx registers.  There are five instances of this
-//  function, one for each available carrier frequency.  The instance compiled
-//  is chosen according to the system variable TI_CC_RF_FREQ, assigned within
-//  the header file "TI_CC_hardware_board.h".
+//  Used to configure the CCxxxx registers.  The register values come from a
+//  const table in flash, one for each available carrier frequency.  The table
+//  compiled is chosen according to the system variable TI_CC_RF_FREQ,
+//  assigned within the header file "TI_CC_hardware_board.h".  The table is
+//  written with one burst per contiguous register range.
 //
 //  ARGUMENTS:
 //      none
@@ -55,57 +58,1053 @@
 // Packetlength = 255
 // Preamble count = (2)  4 bytes
 // Append status = 1
-// Address check = (0) No address check
+// Address check = (3) Address check and 0 (0x00) and 255 (0xFF) broadcast
 // FIFO autoflush = 0
-// Device address = 0
+// Device address = 1, replaced by RFSetAddress()
 // GDO0 signal selection = ( 6) Asserts when sync word has been sent / received, and de-asserts at the end of the packet
 // GDO2 signal selection = (11) Serial Clock
-void writeRFSettings(void)
-{
-    // Write register settings
-    TI_CC_SPIWriteReg(TI_CCxxx0_IOCFG2,   0x0B);  // GDO2 output pin config.
-    TI_CC_SPIWriteReg(TI_CCxxx0_IOCFG0,   0x06);  // GDO0 output pin config.
-    TI_CC_SPIWriteReg(TI_CCxxx0_PKTLEN,   0xFF);  // Packet length.
-    TI_CC_SPIWriteReg(TI_CCxxx0_PKTCTRL1, 0x05);  // Packet automation control.
-    TI_CC_SPIWriteReg(TI_CCxxx0_PKTCTRL0, 0x05);  // Packet automation control.
-    TI_CC_SPIWriteReg(TI_CCxxx0_ADDR,     0x01);  // Device address.
-    TI_CC_SPIWriteReg(TI_CCxxx0_CHANNR,   0x00); // Channel number.
-    TI_CC_SPIWriteReg(TI_CCxxx0_FSCTRL1,  0x07); // Freq synthesizer control.
-    TI_CC_SPIWriteReg(TI_CCxxx0_FSCTRL0,  0x00); // Freq synthesizer control.
-    TI_CC_SPIWriteReg(TI_CCxxx0_FREQ2,    0x5D); // Freq control word, high byte
-    TI_CC_SPIWriteReg(TI_CCxxx0_FREQ1,    0x93); // Freq control word, mid byte.
-    TI_CC_SPIWriteReg(TI_CCxxx0_FREQ0,    0xB1); // Freq control word, low byte.
-    TI_CC_SPIWriteReg(TI_CCxxx0_MDMCFG4,  0x2D); // Modem configuration.
-    TI_CC_SPIWriteReg(TI_CCxxx0_MDMCFG3,  0x3B); // Modem configuration.
-    TI_CC_SPIWriteReg(TI_CCxxx0_MDMCFG2,  0x73); // Modem configuration.
-    TI_CC_SPIWriteReg(TI_CCxxx0_MDMCFG1,  0x22); // Modem configuration.
-    TI_CC_SPIWriteReg(TI_CCxxx0_MDMCFG0,  0xF8); // Modem configuration.
-    TI_CC_SPIWriteReg(TI_CCxxx0_DEVIATN,  0x00); // Modem dev (when FSK mod en)
-    TI_CC_SPIWriteReg(TI_CCxxx0_MCSM1 ,   0x3F); //MainRadio Cntrl State Machine
-    TI_CC_SPIWriteReg(TI_CCxxx0_MCSM0 ,   0x18); //MainRadio Cntrl State Machine
-    TI_CC_SPIWriteReg(TI_CCxxx0_FOCCFG,   0x1D); // Freq Offset Compens. Config
-    TI_CC_SPIWriteReg(TI_CCxxx0_BSCFG,    0x1C); //  Bit synchronization config.
-    TI_CC_SPIWriteReg(TI_CCxxx0_AGCCTRL2, 0xC7); // AGC control.
-    TI_CC_SPIWriteReg(TI_CCxxx0_AGCCTRL1, 0x00); // AGC control.
-    TI_CC_SPIWriteReg(TI_CCxxx0_AGCCTRL0, 0xB2); // AGC control.
-    TI_CC_SPIWriteReg(TI_CCxxx0_FREND1,   0xB6); // Front end RX configuration.
-    TI_CC_SPIWriteReg(TI_CCxxx0_FREND0,   0x10); // Front end RX configuration.
-    TI_CC_SPIWriteReg(TI_CCxxx0_FSCAL3,   0xEA); // Frequency synthesizer cal.
-    TI_CC_SPIWriteReg(TI_CCxxx0_FSCAL2,   0x0A); // Frequency synthesizer cal.
-    TI_CC_SPIWriteReg(TI_CCxxx0_FSCAL1,   0x00); // Frequency synthesizer cal.
-    TI_CC_SPIWriteReg(TI_CCxxx0_FSCAL0,   0x11); // Frequency synthesizer cal.
-    TI_CC_SPIWriteReg(TI_CCxxx0_FSTEST,   0x59); // Frequency synthesizer cal.
-    TI_CC_SPIWriteReg(TI_CCxxx0_TEST2,    0x88); // Various test settings.
-    TI_CC_SPIWriteReg(TI_CCxxx0_TEST1,    0x31); // Various test settings.
-    TI_CC_SPIWriteReg(TI_CCxxx0_TEST0,    0x0B);  // Various test settings.
-}
+//
+// Registers not listed above keep their reset values, which are included in
+// the image so the writes can be done as a few bursts over contiguous
+// ranges.  The test registers PTEST and AGCTEST are not written.
+#define RF_MCSM1_CCA           0x3F        // CCA mode 3, RX after RX and TX
+#define RF_MCSM1_NO_CCA        0x0F        // CCA mode 0, the same otherwise
+static const char rfConfig[TI_CCxxx0_TEST0+1] = {
+    0x0B,   // IOCFG2    GDO2 output pin config.
+    0x2E,   // IOCFG1    GDO1 output pin config. (reset value)
+    0x06,   // IOCFG0    GDO0 output pin config.
+    0x07,   // FIFOTHR   RX/TX FIFO thresholds. (reset value)
+    0xD3,   // SYNC1     Sync word, high byte. (reset value)
+    0x91,   // SYNC0     Sync word, low byte. (reset value)
+    0xFF,   // PKTLEN    Packet length.
+    0x07,   // PKTCTRL1  Packet automation control.
+    0x05,   // PKTCTRL0  Packet automation control.
+    0x01,   // ADDR      Device address.
+    0x00,   // CHANNR    Channel number.
+    0x07,   // FSCTRL1   Freq synthesizer control.
+    0x00,   // FSCTRL0   Freq synthesizer control.
+    0x5D,   // FREQ2     Freq control word, high byte
+    0x93,   // FREQ1     Freq control word, mid byte.
+    0xB1,   // FREQ0     Freq control word, low byte.
+    0x2D,   // MDMCFG4   Modem configuration.
+    0x3B,   // MDMCFG3   Modem configuration.
+    0x73,   // MDMCFG2   Modem configuration.
+    0x22,   // MDMCFG1   Modem configuration.
+    0xF8,   // MDMCFG0   Modem configuration.
+    0x00,   // DEVIATN   Modem dev (when FSK mod en)
+    0x07,   // MCSM2     MainRadio Cntrl State Machine (reset value)
+    RF_CSMA ? RF_MCSM1_CCA : RF_MCSM1_NO_CCA, // MCSM1 MainRadio Cntrl
+            // State Machine, CCA mode 3 (RSSI low and not receiving) or off
+    0x18,   // MCSM0     MainRadio Cntrl State Machine
+    0x1D,   // FOCCFG    Freq Offset Compens. Config
+    0x1C,   // BSCFG     Bit synchronization config.
+    0xC7,   // AGCCTRL2  AGC control.
+    0x00,   // AGCCTRL1  AGC control.
+    0xB2,   // AGCCTRL0  AGC control.
+    0x87,   // WOREVT1   Event 0 timeout, high byte (reset value)
+    0x6B,   // WOREVT0   Event 0 timeout, low byte (reset value)
+    0xF8,   // WORCTRL   Wake On Radio control (reset value)
+    0xB6,   // FREND1    Front end RX configuration.
+    0x10,   // FREND0    Front end RX configuration.
+    0xEA,   // FSCAL3    Frequency synthesizer cal.
+    0x0A,   // FSCAL2    Frequency synthesizer cal.
+    0x00,   // FSCAL1    Frequency synthesizer cal.
+    0x11,   // FSCAL0    Frequency synthesizer cal.
+    0x41,   // RCCTRL1   RC oscillator config (reset value)
+    0x00,   // RCCTRL0   RC oscillator config (reset value)
+    0x59,   // FSTEST    Frequency synthesizer cal.
+    0x7F,   // PTEST     Production test (not written)
+    0x3F,   // AGCTEST   AGC test (not written)
+    0x88,   // TEST2     Various test settings.
+    0x31,   // TEST1     Various test settings.
+    0x0B    // TEST0     Various test settings.
+};
 
 // PATABLE (0 dBm output power)
 extern char paTable[] = {0xFB};
 extern char paTableLen = 1;
 
+#define TI_CC_RF_CRC           2           // PKTCTRL0 CRC_EN
+
+// Modem profiles, generated from CC2500Profiles.h; see RFSetProfile()
+#include "CC2500Profiles.h"
+
+static const char rfProfileRegs[] = {
+    TI_CCxxx0_FSCTRL1,  TI_CCxxx0_PKTLEN,   TI_CCxxx0_PKTCTRL1,
+    TI_CCxxx0_PKTCTRL0, TI_CCxxx0_MDMCFG4,  TI_CCxxx0_MDMCFG3,
+    TI_CCxxx0_MDMCFG2,  TI_CCxxx0_MDMCFG1,  TI_CCxxx0_DEVIATN,
+    TI_CCxxx0_FOCCFG,   TI_CCxxx0_BSCFG,    TI_CCxxx0_AGCCTRL2,
+    TI_CCxxx0_AGCCTRL1, TI_CCxxx0_AGCCTRL0, TI_CCxxx0_FREND1,
+    TI_CCxxx0_TEST2,    TI_CCxxx0_TEST1
+};
+#define RF_PROFILE_REGS        sizeof(rfProfileRegs)
+static const char rfProfiles[RF_NUM_PROFILES][RF_PROFILE_REGS] = {
+    RF_PROFILE_ROW(RF_PLAIN),
+    RF_PROFILE_ROW(RF_FEC),
+    RF_PROFILE_ROW(RF_FAST),
+    RF_PROFILE_ROW(RF_SHORT),
+    RF_PROFILE_ROW(RF_LONG)
+};
+
+// On-air framing of each profile, used by RFAirtimeUs()
+static const struct
+{
+  unsigned int kbps;
+  char preamble;                            // Bytes
+  char sync;                                // Bytes
+  char fec;                                 // Fixed length, rate 1/2 code
+} rfFraming[RF_NUM_PROFILES] = {
+    RF_FRAMING_ROW(RF_PLAIN),
+    RF_FRAMING_ROW(RF_FEC),
+    RF_FRAMING_ROW(RF_FAST),
+    RF_FRAMING_ROW(RF_SHORT),
+    RF_FRAMING_ROW(RF_LONG)
+};
+
+#endif
+
+
+static char rfProfile = RF_PROFILE_BOOT;
+static char rfAddr = 0x01;                  // ADDR, see RFSetAddress()
+#define RF_FEC_ON              (rfFraming[rfProfile].fec)
+
+// Link statistics kept by RFReceivePacket(), see RFLinkReport()
+static struct
+{
+  char rssi;                                // Last good packet, as appended
+  char lqi;
+  unsigned int packets;                     // Good packets
+  unsigned int crcFails;
+  unsigned int overflows;                   // RXFIFO overflows, packets too
+                                            // long for the buffer
+  unsigned int backoffs;                    // Sends put off, channel busy
+  unsigned int ccaFails;                    // ...and dropped after
+} rfStats;                                  // RF_CSMA_MAX_BACKOFFS
+static const char rfPad[RF_FEC_PKTLEN];     // Fills FEC packets to length
+
+// Write the registers of the current profile over rfConfig[]
+static void profileApply(void)
+{
+  char r;
+
+  for (r = 0; r < RF_PROFILE_REGS; r++)
+    TI_CC_SPIWriteReg(rfProfileRegs[r], rfProfiles[rfProfile][r]);
+}
+
+
+// Contiguous register ranges of rfConfig[] written as bursts
+static const char rfRanges[][2] = {
+  { TI_CCxxx0_IOCFG2, TI_CCxxx0_RCCTRL0 - TI_CCxxx0_IOCFG2 + 1 },
+  { TI_CCxxx0_FSTEST, 1 },
+  { TI_CCxxx0_TEST2,  TI_CCxxx0_TEST0 - TI_CCxxx0_TEST2 + 1 }
+};
+#define RF_NUM_RANGES  (sizeof(rfRanges)/sizeof(rfRanges[0]))
+
+void writeRFSettings(void)
+{
+    char r;
+#if !RF_CONFIG_BURST
+    char a;
+#endif
+
+    // Write register settings: 3 burst transactions (48 SPI bytes) in
+    // place of 45 single writes (90 SPI bytes, 45 /CS cycles).  With the
+    // read back, 468 us in place of 1581 us at boot in the simulator
+    // (host/TestSmoke.c, RF_CONFIG_BURST 0 for single writes).
+    for (r = 0; r < RF_NUM_RANGES; r++)
+#if RF_CONFIG_BURST
+        TI_CC_SPIWriteBurstReg(rfRanges[r][0],
+                               (char *)&rfConfig[rfRanges[r][0]],
+                               rfRanges[r][1]);
+#else
+        for (a = rfRanges[r][0]; a < rfRanges[r][0] + rfRanges[r][1]; a++)
+            TI_CC_SPIWriteReg(a, rfConfig[a]);
+#endif
+}
+
+
+
+//-----------------------------------------------------------------------------
+//  char verifyRFSettings(char *badAddr, char maxBad)
+//
+//  DESCRIPTION:
+//  Reads back the registers written by writeRFSettings() (one burst read
+//  per range) and compares them with the configuration table.  FSCAL3 to
+//  FSCAL1 are skipped, since the chip overwrites them with calibration
+//  results.
+//
+//  ARGUMENTS:
+//      char *badAddr
+//          Receives the addresses of up to "maxBad" registers that differ
+//          (may be null)
+//      char maxBad
+//          Size of badAddr
+//
+//  RETURN VALUE:
+//      char
+//          Number of registers that differ, 0 if the radio is configured
+//-----------------------------------------------------------------------------
+char verifyRFSettings(char *badAddr, char maxBad)
+{
+  char readBack[TI_CCxxx0_TEST0+1];
+  char r, a, last;
+  char bad = 0;
+
+  for (r = 0; r < RF_NUM_RANGES; r++)
+  {
+    a = rfRanges[r][0];
+    last = a + rfRanges[r][1];
+#if RF_CONFIG_BURST
+    TI_CC_SPIReadBurstReg(a, &readBack[a], rfRanges[r][1]);
+#else
+    for (; a < last; a++)
+      readBack[a] = TI_CC_SPIReadReg(a);
+    a = rfRanges[r][0];
+#endif
+    for (; a < last; a++)
+    {
+      if (a >= TI_CCxxx0_FSCAL3 && a <= TI_CCxxx0_FSCAL1)
+        continue;                           // Calibration results
+      if (readBack[a] != rfConfig[a])
+      {
+        if (badAddr && bad < maxBad)
+          badAddr[bad] = a;
+        bad++;
+      }
+    }
+  }
+  return bad;
+}
+
+
+//-----------------------------------------------------------------------------
+//  char RFInit(void)
+//
+//  DESCRIPTION:
+//  Resets the radio and loads the configuration and PATABLE.  Used at boot
+//  and to recover the radio after a fault, in the modem profile in use
+//  (RF_PROFILE_BOOT at boot).  SPI must be set up.
+//
+//  RETURN VALUE:
+//      char
+//          Number of registers that failed to verify, 0 on success
+//-----------------------------------------------------------------------------
+char RFInit(void)
+{
+  char r;
+
+  TI_CC_PowerupResetCCxxxx();               // Reset CCxxxx
+  writeRFSettings();                        // Write RF settings to config reg
+  TI_CC_SPIWriteBurstReg(TI_CCxxx0_PATABLE, paTable, paTableLen);//Write PATABLE
+  r = verifyRFSettings(0, 0);
+  profileApply();                           // The profile in use
+  TI_CC_SPIWriteReg(TI_CCxxx0_ADDR, rfAddr); // Our address
+  return r;
+}
+
+
+//-----------------------------------------------------------------------------
+//  unsigned int RFAirtimeUs(char size)
+//
+//  DESCRIPTION:
+//  Returns the time in microseconds a packet of "size" bytes (length byte
+//  included, as passed to RFSendPacket) spends on the air: preamble, sync
+//  word, the packet itself and the CRC.
+//
+//  At 250 kbps (32 us per byte) a command packet costs:
+//
+//      instructions   fixed 51-byte packet   sized packet (n + 3 bytes)
+//            1              1952 us                  448 us
+//           10              1952 us                  736 us
+//           49              1952 us                 1984 us
+//      confirmation (3 bytes)                        416 us
+//
+//  The figures above are for RF_PROFILE_PLAIN; CC2500Profiles.h has them
+//  for every profile.  In RF_PROFILE_FEC every packet is padded to
+//  RF_FEC_PKTLEN bytes and doubled by the rate 1/2 code, rounded up to
+//  4-byte interleaver blocks: 3968 us whatever its size.
+//
+//  ARGUMENTS:
+//      char size
+//          The size of the txBuffer
+//-----------------------------------------------------------------------------
+unsigned int RFAirtimeUs(char size)
+{
+  unsigned int coded = size + TI_CC_RF_CRC;
+
+  if (RF_FEC_ON)
+    coded = (2 * (RF_FEC_PKTLEN + TI_CC_RF_CRC) + 4) / 4 * 4;
+  return (unsigned int)(((unsigned long)(rfFraming[rfProfile].preamble
+                         + rfFraming[rfProfile].sync + coded) * 8000)
+                        / rfFraming[rfProfile].kbps);
+}
+
+
+// Asynchronous transmit state, see RFSendPacketAsync()
+#define RF_TX_MARGIN_MS        10          // Calibration, CCA and slack
+static volatile char txPending = 0;
+static volatile char txTimeouts = 0;
+static char *txPkt;                         // Kept for wake-up repeats
+static char txSize;
+static volatile char txLoading = 0;         // TXFIFO filling from the SPI ISR
+static char txFill;                         // ...with this many bytes so far
+static char repeating = 0;                  // Wake-up burst in progress
+static unsigned int repeatEnd;              // ...until this Clock_Now()
+static char backoffs;                       // Of the packet being sent
+static char backingOff = 0;                 // Waiting on CLOCK_ALARM_RADIO
+static unsigned int csmaRand;               // Backoff random sequence
+static char noCca = 0;                      // RFSendPacketNoCca() sending
+
+// Wake-on-Radio state, see RFWorListen() and RFWorPeer()
+#define RF_WORCTRL_ON          0x78        // RC osc on, EVENT1 = 7, RC_CAL
+static char worListen = RF_WOR_OFF;         // Our own listen mode
+static char worPeer = RF_WOR_OFF;           // The other end's listen mode
+static volatile char awake = 0;             // In RX, or peer known listening
+
+// Per setting: WOREVT1:0 (28.85 us units), MCSM2 RX_TIME, period in ms.
+// With WOR_RES 0 the sniff lasts 3.6058 % of the period halved RX_TIME
+// times: 5.41 ms in every setting.  That is longer than one copy of a
+// wake-up burst in the slowest profile sniffing supports, RF_PROFILE_FEC
+// (3968 us on the air and about 0.5 ms to reload and turn round), plus its
+// preamble and sync word, so a sniff that opens mid-packet still hears the
+// next copy.  No RX_TIME gives a 100 ms period that long a sniff.
+static const unsigned int worSettings[RF_WOR_SLOW+1][3] = {
+  {0,     0, 0},                            // RF_WOR_OFF
+  {5200,  0, 150},                          // RF_WOR_FAST:   3.6058 %
+  {10400, 1, 300},                          // RF_WOR_MEDIUM: 1.8029 %
+  {41600, 3, 1200}                          // RF_WOR_SLOW:   0.4507 %
+};
+
+// Channel hopping state, see RFHopStart()
+#define RF_HOP_MIN_TRIES       8           // Before a channel can be blacklisted
+#define RF_HOP_AGE             32          // Statistics halved at this many tries
+#define RF_MCSM0_MANUAL_CAL    0x08        // MCSM0 with FS_AUTOCAL off
+static char hopRole = 0;                    // 0, RF_HOP_LEAD or RF_HOP_FOLLOW
+static char hopSeq[RF_HOP_CHANNELS];        // CHANNR values, shared order
+static char hopCal[RF_HOP_CHANNELS][3];     // FSCAL3..FSCAL1 per channel
+static unsigned char hopTries[RF_HOP_CHANNELS]; // Exchanges per channel (lead)
+static unsigned char hopFails[RF_HOP_CHANNELS]; // ...and how many were lost
+static char hopIndex;                       // Current place in hopSeq
+static char hopHome;                        // Where the lead was last heard
+static char hopLosses;                      // Lost exchanges in a row
+static volatile char hopMove = 0;           // Lead: hop before the next send
+static char hopLost = 0;                    // Lead: hopped, not heard since
+
+
+// Retune to channel "c" of the sequence with its stored calibration; the
+// radio is left in IDLE
+static void hopTune(char c)
+{
+  TI_CC_SPIStrobe(TI_CCxxx0_SIDLE);
+  TI_CC_SPIWriteBurstReg(TI_CCxxx0_FSCAL3, hopCal[c], 3);
+  TI_CC_SPIWriteReg(TI_CCxxx0_CHANNR, hopSeq[c]);
+  hopIndex = c;
+}
+
+// Follower scan time per channel: RF_HOP_DWELL_MS, or two of the longest
+// packets in slower profiles
+static unsigned int hopDwell(void)
+{
+  unsigned int ms = RFAirtimeUs(RF_FEC_PKTLEN) / 500 + 1;
+
+  return ms > RF_HOP_DWELL_MS ? ms : RF_HOP_DWELL_MS;
+}
+
+// Follower scan: the next channel every hopDwell(), unless a packet is
+// coming in on this one
+static char hopScan(void)
+{
+  if (!(TI_CC_GDO0_PxIN & TI_CC_GDO0_PIN))
+  {
+    hopTune((hopIndex + 1) % RF_HOP_CHANNELS);
+    TI_CC_SPIStrobe(TI_CCxxx0_SRX);
+  }
+  Clock_Alarm(CLOCK_ALARM_RADIO, CLOCK_ACLK_TICKS(hopDwell()), hopScan);
+  return 0;
+}
+
+// Blacklisted: enough tries, and more than a quarter of them lost
+static char hopBad(char c)
+{
+  return RF_HOP_BLACKLIST && hopTries[c] >= RF_HOP_MIN_TRIES
+      && (unsigned int)hopFails[c] * 4 > hopTries[c];
+}
+
+// Lead: move on to the next channel of the sequence that isn't
+// blacklisted.  Each pass over a blacklisted channel forgets one of its
+// losses, so it gets another chance later.
+static void hopNext(void)
+{
+  char c = hopIndex;
+  char n;
+
+  for (n = 0; n < RF_HOP_CHANNELS; n++)
+  {
+    c = (c + 1) % RF_HOP_CHANNELS;
+    if (!hopBad(c))
+      break;
+    hopFails[c]--;
+  }
+  hopTune(c);
+}
+
+
+// Write the WOR registers for our listen mode and start sniffing
+static void worStart(void)
+{
+  TI_CC_SPIStrobe(TI_CCxxx0_SIDLE);
+  TI_CC_SPIWriteReg(TI_CCxxx0_WOREVT1, worSettings[worListen][0] >> 8);
+  TI_CC_SPIWriteReg(TI_CCxxx0_WOREVT0, worSettings[worListen][0]);
+  TI_CC_SPIWriteReg(TI_CCxxx0_MCSM2, worSettings[worListen][1]);
+  TI_CC_SPIWriteReg(TI_CCxxx0_WORCTRL, RF_WORCTRL_ON);
+  TI_CC_SPIStrobe(TI_CCxxx0_SWOR);
+  awake = 0;
+}
+
+// Back to listening the way RFWorListen() and RFHopStart() left it:
+// sniffing or scanning unless awake, RX otherwise
+static void listen(void)
+{
+  if (worListen && !awake)
+    worStart();
+  else if (hopRole == RF_HOP_FOLLOW && !awake)
+    hopScan();
+  else
+    TI_CC_SPIStrobe(TI_CCxxx0_SRX);
+}
+
+// Nothing on the air for a while: back to sniffing or scanning, or the
+// peer is
+static char worIdle(void)
+{
+  awake = 0;
+  if (worListen || hopRole == RF_HOP_FOLLOW)
+    listen();
+  return 0;
+}
+
+// After every packet, sent or received, stay awake (or count the peer as
+// awake) for a while longer.  Shares CLOCK_ALARM_RADIO with the TX timeout,
+// so only called while no send is pending.
+static void worActivity(void)
+{
+  unsigned int stay = hopRole ? RF_HOP_STAY_MS : RF_WOR_AWAKE_MS;
+
+  if (worListen || hopRole == RF_HOP_FOLLOW)
+  {
+    awake = 1;
+    Clock_Alarm(CLOCK_ALARM_RADIO, CLOCK_ACLK_TICKS(stay), worIdle);
+  }
+  else if (worPeer || hopRole == RF_HOP_LEAD)
+  {
+    awake = 1;
+    Clock_Alarm(CLOCK_ALARM_RADIO, CLOCK_ACLK_TICKS(stay / 2), worIdle);
+  }
+  else
+    Clock_Cancel(CLOCK_ALARM_RADIO);
+}
+
+
+// TX timeout: GDO0 never signalled the end of the packet.  Flush both FIFOs
+// and reset the radio, then go back to RX (or to sniffing or scanning).
+// The stored channel calibrations stay valid across the reset.
+static char txTimeout(void)
+{
+  TI_CC_SPIStrobe(TI_CCxxx0_SIDLE);
+  TI_CC_SPIStrobe(TI_CCxxx0_SFTX);
+  TI_CC_SPIStrobe(TI_CCxxx0_SFRX);
+  RFInit();
+  if (hopRole)
+  {
+    TI_CC_SPIWriteReg(TI_CCxxx0_MCSM0, RF_MCSM0_MANUAL_CAL);
+    hopTune(hopIndex);
+  }
+  awake = 0;
+  listen();
+  TI_CC_GDO0_PxIFG &= ~TI_CC_GDO0_PIN;
+  txTimeouts++;
+  repeating = 0;
+  txPending = 0;
+  return 1;                                 // Wake main: the radio is free
+}
+
+// Strobe STX; returns 0 if CCA found the channel busy and the radio stayed
+// in RX.  The TXFIFO keeps the packet for the next try.  Right after STX the
+// radio still reads as RX while it turns around, so RX only counts as busy
+// once it has lasted RF_CCA_READS reads.  STX is ignored while the radio
+// calibrates or settles on its way to RX (right after RFSetProfile() or a
+// wake from IDLE), so that is waited out first.
+static char ccaStx(void)
+{
+  char state;
+#if RF_CSMA
+  char n;
 #endif
 
+  do
+    state = TI_CC_SPIReadStatus(TI_CCxxx0_MARCSTATE) & TI_CCxxx0_MARC_STATE;
+  while (state >= TI_CCxxx0_MARC_VCOON_MC && state <= TI_CCxxx0_MARC_ENDCAL);
+
+#if RF_CSMA
+  if (noCca)                                // CCA mode "always" for this
+  {                                         // STX only
+    TI_CC_SPIWriteReg(TI_CCxxx0_MCSM1, RF_MCSM1_NO_CCA);
+    TI_CC_SPIStrobe(TI_CCxxx0_STX);
+    TI_CC_SPIWriteReg(TI_CCxxx0_MCSM1, RF_MCSM1_CCA);
+    return 1;
+  }
+#endif
+
+  TI_CC_SPIStrobe(TI_CCxxx0_STX);
+#if RF_CSMA
+  for (n = 0; n < RF_CCA_READS; n++)
+  {
+    state = TI_CC_SPIReadStatus(TI_CCxxx0_MARCSTATE) & TI_CCxxx0_MARC_STATE;
+    if (state < TI_CCxxx0_MARC_RX || state > TI_CCxxx0_MARC_RX_RST)
+      return 1;                             // Left RX: the channel was clear
+  }
+  return 0;
+#else
+  return 1;
+#endif
+}
+
+// Random backoff in ACLK ticks for the "n"th busy channel in a row: 1 to
+// 2^BE units, the exponent BE growing from RF_CSMA_MIN_BE to RF_CSMA_MAX_BE
+static unsigned int backoffTicks(char n)
+{
+  char be = RF_CSMA_MIN_BE + n - 1;
+
+  if (be > RF_CSMA_MAX_BE)
+    be = RF_CSMA_MAX_BE;
+  csmaRand = csmaRand * 25173 + 13849 + Clock_Now() + rfAddr;
+  return ((csmaRand >> 8) & ((1 << be) - 1)) * RF_CSMA_UNIT_TICKS
+         + RF_CSMA_UNIT_TICKS;
+}
+
+static char backoffDone(void);
+
+// Put the loaded packet on the air, or back off if the channel is busy.
+// After RF_CSMA_MAX_BACKOFFS the packet is dropped and the send ends.
+static void tryTx(void)
+{
+  backingOff = 0;
+  if (ccaStx())
+  {
+    Clock_Alarm(CLOCK_ALARM_RADIO,
+                CLOCK_ACLK_TICKS(RFAirtimeUs(txSize) / 1000 + RF_TX_MARGIN_MS + 1),
+                txTimeout);
+    return;
+  }
+  rfStats.backoffs++;
+  if (++backoffs > RF_CSMA_MAX_BACKOFFS)
+  {
+    rfStats.ccaFails++;
+    TI_CC_SPIStrobe(TI_CCxxx0_SIDLE);
+    TI_CC_SPIStrobe(TI_CCxxx0_SFTX);
+    listen();
+    Clock_Cancel(CLOCK_ALARM_RADIO);
+    repeating = 0;
+    txPending = 0;
+    return;
+  }
+  backingOff = 1;
+  Clock_Alarm(CLOCK_ALARM_RADIO, backoffTicks(backoffs), backoffDone);
+}
+
+// CLOCK_ALARM_RADIO at the end of a backoff: try again
+static char backoffDone(void)
+{
+  tryTx();
+  return !txPending;                        // Wake main if it was dropped
+}
+
+// End of a TXFIFO load, from the SPI interrupt: pad the packet to
+// RF_FEC_PKTLEN if FEC is on, then put it on the air, listening first
+static void txLoaded(void)
+{
+  char pad = RF_FEC_PKTLEN - txFill;
+
+  if (RF_FEC_ON && txFill < RF_FEC_PKTLEN)
+  {
+    txFill = RF_FEC_PKTLEN;
+    if (TI_CC_SPIStart(TI_CCxxx0_TXFIFO | TI_CCxxx0_WRITE_BURST,
+                       (char *)rfPad, 0, pad, txLoaded))
+      return;
+    TI_CC_SPIWriteBurstReg(TI_CCxxx0_TXFIFO, (char *)rfPad, pad);
+  }
+  txLoading = 0;
+  backoffs = 0;
+  tryTx();
+}
+
+// Load the TXFIFO from txPkt through the SPI interrupt and return at once;
+// txLoaded() sends it.  If the bus is taken (an ISR cutting into the drain
+// in RFReceivePacket()), the load is written blocking instead.
+static void startTx(void)
+{
+  txLoading = 1;
+  txFill = txSize;
+  if (TI_CC_SPIStart(TI_CCxxx0_TXFIFO | TI_CCxxx0_WRITE_BURST, txPkt, 0,
+                     txSize, txLoaded))
+    return;
+  TI_CC_SPIWriteBurstReg(TI_CCxxx0_TXFIFO, txPkt, txSize);
+  txLoaded();
+}
+
+
+//-----------------------------------------------------------------------------
+//  char RFSendPacketAsync(char *txBuffer, char size)
+//
+//  DESCRIPTION:
+//  Starts sending a packet and returns at once.  The TXFIFO is loaded from
+//  the SPI interrupt (TI_CC_SPIStart()) and STX strobed at the end of the
+//  load; the end of the packet is reported by RFGDO0Event() from the
+//  PORT2 interrupt.  GDO0 must be set up as for RFSendPacket(), with its
+//  interrupt enabled on the falling edge.  If the end of packet is not seen
+//  within the packet airtime plus RF_TX_MARGIN_MS, the CLOCK_ALARM_RADIO
+//  alarm flushes and resets the radio.
+//
+//  With RF_CSMA the radio listens before it talks: STX only takes it to TX
+//  if CCA finds the RSSI below the carrier-sense threshold (the AGC target
+//  plus RF_CCA_ABS_THR dB) and no packet coming in.  Otherwise the send is
+//  put off by a random backoff on CLOCK_ALARM_RADIO, of 1 to 2^BE units of
+//  RF_CSMA_UNIT_TICKS, BE growing by one per busy try from RF_CSMA_MIN_BE
+//  to RF_CSMA_MAX_BE.  After RF_CSMA_MAX_BACKOFFS busy tries the packet is
+//  dropped and the send ends as if done; the layers above resend on their
+//  own timeouts.  Backoffs and drops are counted for RFLinkReport().
+//
+//  Measured in the host simulator (host/TestCsma.c) with each node offering
+//  5 % of the channel in 1 ms packets at random times, and no resends
+//  (latency is to the end of the packet, collisions counted per packet),
+//  as test_csma prints it:
+//
+//      nodes     collisions        dropped    mean latency
+//             RF_CSMA 0     1           1     RF_CSMA 0     1
+//         2      10.4 %    0.5 %      0.0 %      1.34 ms   1.44 ms
+//         4      43.6 %    0.0 %      0.0 %      1.31 ms   1.68 ms
+//         6      47.3 %    0.4 %      0.0 %      1.31 ms   1.93 ms
+//         8      61.1 %    1.3 %      1.0 %      1.31 ms   2.38 ms
+//        10      66.8 %    1.1 %      1.6 %      1.31 ms   2.77 ms
+//
+//  If the other end listens with Wake-on-Radio (RFWorPeer()) and has not
+//  heard from us lately, the packet is sent over and over for one WOR
+//  period so that one copy lands in a sniff window; the send completes at
+//  the end of that burst.  A hopping lead does the same for two follower
+//  scan cycles, plus RF_HOP_STAY_MS after a hop.  The buffer must be kept
+//  until RFTxBusy() clears.
+//
+//  ARGUMENTS:
+//      char *txBuffer
+//          Pointer to a buffer containing the data to be transmitted
+//
+//      char size
+//          The size of the txBuffer
+//
+//  RETURN VALUE:
+//      char
+//          1:  Packet started
+//          0:  A packet is still on the air, nothing was done
+//-----------------------------------------------------------------------------
+char RFSendPacketAsync(char *txBuffer, char size)
+{
+  __istate_t s = __get_interrupt_state();
+
+  __disable_interrupt();
+  if (txPending)
+  {
+    __set_interrupt_state(s);
+    return 0;
+  }
+  txPending = 1;
+  txPkt = txBuffer;
+  txSize = size;
+  if (worListen && !awake)                  // Leave the sniff cycle
+    TI_CC_SPIStrobe(TI_CCxxx0_SIDLE);
+  if (hopRole == RF_HOP_FOLLOW && !awake)   // Leave the scan, answer where
+    hopTune(hopHome);                       // the lead was last heard
+  if (hopMove)
+  {
+    hopMove = 0;
+    hopNext();
+    hopLost = 1;
+    awake = 0;
+  }
+  if (worPeer && !awake)
+  {
+    repeating = 1;
+    repeatEnd = Clock_Now()
+              + CLOCK_ACLK_TICKS(worSettings[worPeer][2] + RF_WOR_MARGIN_MS);
+  }
+  else if (hopRole == RF_HOP_LEAD && !awake)
+  {
+    repeating = 1;                          // The follower may still stay on
+    repeatEnd = Clock_Now()                 // the old channel after a hop
+              + CLOCK_ACLK_TICKS(2 * RF_HOP_CHANNELS * hopDwell()
+                                 + (hopLost ? RF_HOP_STAY_MS : 0));
+  }
+  startTx();
+  __set_interrupt_state(s);
+  return 1;
+}
+
+// As RFSendPacketAsync(), but STX goes straight to TX without listening
+// first, for a packet that must go on the air when it is sent: the TDMA
+// beacon, which carries its own timing
+char RFSendPacketNoCca(char *txBuffer, char size)
+{
+  __istate_t s = __get_interrupt_state();
+  char started;
+
+  __disable_interrupt();
+  noCca = 1;
+  started = RFSendPacketAsync(txBuffer, size);
+  noCca = 0;
+  __set_interrupt_state(s);
+  return started;
+}
+
+// Non-zero while a packet started by RFSendPacketAsync() is on the air
+char RFTxBusy(void)
+{
+  return txPending;
+}
+
+// Number of sends the timeout gave up on
+char RFTxTimeouts(void)
+{
+  return txTimeouts;
+}
+
+
+//-----------------------------------------------------------------------------
+//  char RFGDO0Event(void)
+//
+//  DESCRIPTION:
+//  Tells apart the two reasons GDO0 falls: the end of a packet sent by
+//  RFSendPacketAsync(), or the end of a received packet.  Call it from the
+//  PORT2 interrupt before reading the RXFIFO; it clears the GDO0 flag.
+//
+//  While a send is pending the radio could still have been receiving when
+//  STX was strobed, in which case CCA ignores the strobe.  A non-empty
+//  TXFIFO tells this apart: the packet is an RX, and the send is tried
+//  again unless a backoff is already timing the next try.
+//
+//  GDO0 also falls when the radio drops a packet for another address
+//  (RFSetAddress()).  The RXFIFO is then empty, and RF_EVENT_NONE is
+//  returned without counting the packet as activity, so the caller can go
+//  straight back to sleep.
+//
+//  RETURN VALUE:
+//      char
+//          RF_EVENT_TX_DONE:  The pending send completed
+//          RF_EVENT_RX:       A packet may be waiting in the RXFIFO
+//          RF_EVENT_NONE:     One copy of a wake-up burst went out, the
+//                             TXFIFO is still loading and nothing came
+//                             in, or a packet for someone else was dropped
+//-----------------------------------------------------------------------------
+char RFGDO0Event(void)
+{
+  TI_CC_GDO0_PxIFG &= ~TI_CC_GDO0_PIN;
+  if (txLoading)                            // Not on the air yet: a packet
+    return TI_CC_SPIReadStatus(TI_CCxxx0_RXBYTES)   // came in meanwhile
+           ? RF_EVENT_RX : RF_EVENT_NONE;
+  if (txPending)
+  {
+    if (!(TI_CC_SPIReadStatus(TI_CCxxx0_TXBYTES) & TI_CCxxx0_NUM_TXBYTES))
+    {
+      if (repeating && (int)(repeatEnd - Clock_Now()) > 0)
+      {
+        startTx();                          // Next copy of the burst
+        return RF_EVENT_NONE;
+      }
+      repeating = 0;
+      txPending = 0;
+      worActivity();
+      return RF_EVENT_TX_DONE;
+    }
+    if (!backingOff)                        // Retry once back in RX
+      tryTx();
+    return RF_EVENT_RX;
+  }
+  hopHome = hopIndex;                       // The lead is on this channel
+  if (!TI_CC_SPIReadStatus(TI_CCxxx0_RXBYTES))
+    return RF_EVENT_NONE;                   // Someone else's, dropped
+  worActivity();
+  return RF_EVENT_RX;
+}
+
+
+//-----------------------------------------------------------------------------
+//  void RFWorListen(char setting)
+//
+//  DESCRIPTION:
+//  Puts the radio in RX, continuously (RF_WOR_OFF) or with Wake-on-Radio:
+//  the CC2500 sleeps on its RC oscillator and sniffs for a sync word once
+//  per WOR period.  A packet keeps it in RX until RF_WOR_AWAKE_MS pass with
+//  nothing sent or received, then sniffing resumes.  The sender must be
+//  told the same setting with RFWorPeer().
+//
+//  Expected average radio current (RX 17 mA, XOSC start 1.5 mA for 1.4 ms
+//  and calibration 8 mA for 0.8 ms per wake, sleep 1 uA), worst-case
+//  latency of the first packet after a quiet spell (one period and
+//  RF_WOR_MARGIN_MS), and the mean and longest wake of a fragment-sized
+//  packet in RF_PROFILE_FEC measured in the simulator (host/TestWor.c, 25
+//  wakes at random phases of the sniff cycle, none missed):
+//
+//      setting        period   sniff    current   latency  measured
+//      RF_WOR_OFF        -       -      17 mA      0.5 ms
+//      RF_WOR_FAST     150 ms  5.41 ms  0.67 mA    155 ms    72 /  134 ms
+//      RF_WOR_MEDIUM   300 ms  5.41 ms  0.34 mA    305 ms   138 /  263 ms
+//      RF_WOR_SLOW    1200 ms  5.41 ms  0.085 mA  1205 ms   630 / 1157 ms
+//
+//  The sniff is 3.6058 % of the period halved MCSM2 RX_TIME times, and the
+//  current (1.5 mA * 1.4 ms + 8 mA * 0.8 ms + 17 mA * sniff) / period plus
+//  1 uA asleep.
+//
+//  Packets sent while the radio is awake carry no extra latency.
+//-----------------------------------------------------------------------------
+void RFWorListen(char setting)
+{
+  worListen = setting;
+  awake = 0;
+  listen();
+}
+
+// The other end listens with this RFWorListen() setting
+void RFWorPeer(char setting)
+{
+  worPeer = setting;
+  awake = 0;
+}
+
+
+// Calibrate the synthesizer on channel "c" and keep the result
+static void hopCalibrate(char c)
+{
+  TI_CC_SPIStrobe(TI_CCxxx0_SIDLE);
+  TI_CC_SPIWriteReg(TI_CCxxx0_CHANNR, hopSeq[c]);
+  TI_CC_SPIStrobe(TI_CCxxx0_SCAL);
+  while ((TI_CC_SPIReadStatus(TI_CCxxx0_MARCSTATE) & TI_CCxxx0_MARC_STATE)
+         != TI_CCxxx0_MARC_IDLE);
+  TI_CC_SPIReadBurstReg(TI_CCxxx0_FSCAL3, hopCal[c], 3);
+}
+
+
+//-----------------------------------------------------------------------------
+//  void RFHopStart(unsigned int seed, char role)
+//
+//  DESCRIPTION:
+//  Spreads the link over RF_HOP_CHANNELS channels RF_HOP_SPACING apart
+//  (2433 to 2478 MHz), in a pseudo-random order both ends derive from the
+//  same seed.  The synthesizer is calibrated once per channel and the
+//  FSCAL3..FSCAL1 results are kept, so a hop is a few register writes and
+//  about 100 us of settling instead of an 800 us calibration.
+//
+//  The lead (SENDING VERSION) picks the channel.  It is told of every
+//  exchange with RFHopResult(); after RF_HOP_LOSSES lost in a row it moves
+//  to the next channel of the sequence, skipping channels that lost more
+//  than a quarter of their recent exchanges.  The blacklist only lives on
+//  the lead.
+//
+//  The follower (RECEIVING VERSION) stays on a channel for RF_HOP_STAY_MS
+//  after each packet, then scans the sequence, RF_HOP_DWELL_MS per channel
+//  (longer in slow profiles), starting with the one the lead moves to
+//  next.  A lead that has not been heard from lately repeats its packet
+//  for two scan cycles (more than the ACLK spread between the boards), so
+//  the follower finds it again wherever it is.  Replies from a scanning
+//  follower go out on the channel the lead was last heard on.
+//
+//  Measured in the host simulator (host/TestHop.c), 200 uploads of 240
+//  bytes with Wi-Fi channel 6 (2426 to 2448 MHz, 6 of the 16 channels)
+//  busy 30 % of the time in 1 ms spells, and 15 % of the packets lost on
+//  every channel besides:
+//
+//                                   packet errors  upload   failed
+//      fixed CHANNR 0 (2433 MHz)         45.7 %    128 ms     48
+//      hopping, RF_HOP_BLACKLIST 0        8.1 %    253 ms      1
+//      hopping with blacklist             6.9 %    250 ms      0
+//
+//  Packet errors are packets that reached a radio and were not received.
+//  The blacklist only acts on a later pass over the sequence, so it
+//  matters on long sessions; uploads take longer hopping because the lead
+//  wakes a scanning follower first.
+//
+//  Must be called after RFInit() and RFWorListen() on both ends; cannot be
+//  used with Wake-on-Radio.
+//
+//  ARGUMENTS:
+//      unsigned int seed
+//          Hop sequence seed, the same on both ends; 0 leaves the radio on
+//          the fixed channel
+//      char role
+//          RF_HOP_LEAD or RF_HOP_FOLLOW
+//-----------------------------------------------------------------------------
+void RFHopStart(unsigned int seed, char role)
+{
+  char i, j, t;
+
+  if (!seed)
+    return;
+
+  // Fisher-Yates shuffle driven by a 16-bit Galois LFSR
+  for (i = 0; i < RF_HOP_CHANNELS; i++)
+    hopSeq[i] = i * RF_HOP_SPACING;
+  for (i = RF_HOP_CHANNELS - 1; i > 0; i--)
+  {
+    seed = (seed >> 1) ^ (-(seed & 1) & 0xB400);
+    j = seed % (i + 1);
+    t = hopSeq[i];
+    hopSeq[i] = hopSeq[j];
+    hopSeq[j] = t;
+  }
+
+  for (i = 0; i < RF_HOP_CHANNELS; i++)
+    hopCalibrate(i);
+  TI_CC_SPIWriteReg(TI_CCxxx0_MCSM0, RF_MCSM0_MANUAL_CAL);
+  hopRole = role;
+  hopHome = 0;
+  hopTune(0);
+  awake = 0;
+  listen();
+}
+
+
+//-----------------------------------------------------------------------------
+//  void RFHopResult(char ok)
+//
+//  DESCRIPTION:
+//  Tells the lead how an exchange on the current channel went, typically
+//  from an ack or its timeout.  Any hop is made at the next send.  Does
+//  nothing on the follower or without hopping.
+//
+//  ARGUMENTS:
+//      char ok
+//          Non-zero if the other end answered
+//-----------------------------------------------------------------------------
+void RFHopResult(char ok)
+{
+  char c = hopIndex;
+
+  if (hopRole != RF_HOP_LEAD)
+    return;
+  if (++hopTries[c] >= RF_HOP_AGE)          // Recent history weighs most
+  {
+    hopTries[c] >>= 1;
+    hopFails[c] >>= 1;
+  }
+  if (ok)
+  {
+    hopLosses = 0;
+    hopLost = 0;
+    return;
+  }
+  hopFails[c]++;
+  if (++hopLosses >= RF_HOP_LOSSES)
+  {
+    hopLosses = 0;
+    hopMove = 1;
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+//  char RFSetProfile(char profile)
+//
+//  DESCRIPTION:
+//  Switches the modem to another profile of CC2500Profiles.h, then goes
+//  back to listening.  Both ends must use the same profile; the packet
+//  layer agrees on it first.
+//
+//  RF_PROFILE_FEC turns on the CC2500's rate 1/2 convolutional code with
+//  interleaving, which corrects bursts of bit errors that would otherwise
+//  cost a whole resend.  The CC2500 only codes fixed-length packets, so
+//  every packet is padded to RF_FEC_PKTLEN bytes; the length byte is kept
+//  as the first data byte and RFReceivePacket() strips the padding.  The
+//  address byte is checked in software, since the radio would check the
+//  length byte in its place.
+//
+//  Goodput of a 240-byte program (five full fragments, resent until they
+//  arrive) and its time from the end of the GUI frame to the ack, against
+//  the bit error rate on the air, measured in the host simulator
+//  (host/TestFec.c; independent bit errors, 10 uploads each):
+//
+//      bit error rate      plain                  FEC
+//      1e-5                14 kB/s, 17 ms         7.9 kB/s, 30 ms
+//      1e-4                14 kB/s, 17 ms         7.9 kB/s, 30 ms
+//      3e-4                9.9 kB/s, 24 ms        7.9 kB/s, 30 ms
+//      1e-3                3.0 kB/s, 80 ms        7.9 kB/s, 30 ms
+//      3e-3                1.7 kB/s, 138 ms,      7.9 kB/s, 30 ms
+//                          3 in 10 failed
+//
+//  Plain wins on a clean channel, FEC once errors pass about 3e-4.
+//
+//  ARGUMENTS:
+//      char profile
+//          RF_PROFILE_PLAIN, RF_PROFILE_FEC, RF_PROFILE_FAST,
+//          RF_PROFILE_SHORT or RF_PROFILE_LONG
+//
+//  RETURN VALUE:
+//      char
+//          1:  Profile in use
+//          0:  A packet is still on the air, or no such profile
+//-----------------------------------------------------------------------------
+char RFSetProfile(char profile)
+{
+  __istate_t s = __get_interrupt_state();
+
+  __disable_interrupt();
+  if (txPending || profile >= RF_NUM_PROFILES)
+  {
+    __set_interrupt_state(s);
+    return 0;
+  }
+  rfProfile = profile;
+  TI_CC_SPIStrobe(TI_CCxxx0_SIDLE);
+  TI_CC_SPIStrobe(TI_CCxxx0_SFRX);
+  profileApply();
+  listen();
+  __set_interrupt_state(s);
+  return 1;
+}
+
+// The profile in use
+char RFProfile(void)
+{
+  return rfProfile;
+}
+
+
+//-----------------------------------------------------------------------------
+//  void RFSetAddress(char address)
+//
+//  DESCRIPTION:
+//  Sets the address the radio answers to, besides the broadcast addresses
+//  RF_ADDR_BROADCAST0 and RF_ADDR_BROADCAST1.  The radio drops packets for
+//  other addresses itself, before they reach the RXFIFO, in every profile
+//  but RF_PROFILE_FEC, where RFReceivePacket() drops them instead.  Kept
+//  across RFInit().
+//
+//  ARGUMENTS:
+//      char address
+//          1 to 254
+//-----------------------------------------------------------------------------
+void RFSetAddress(char address)
+{
+  __istate_t s = __get_interrupt_state();
+
+  __disable_interrupt();
+  rfAddr = address;
+  TI_CC_SPIWriteReg(TI_CCxxx0_ADDR, address);
+  __set_interrupt_state(s);
+}
+
+// The address set by RFSetAddress()
+char RFAddress(void)
+{
+  return rfAddr;
+}
+
 
 //-----------------------------------------------------------------------------
 //  void RFSendPacket(char *txBuffer, char size)
@@ -118,6 +1117,10 @@ extern char paTableLen = 1;
 //  packet start and returns low when complete.  The function polls GDO0 to
 //  ensure packet completion before returning.
 //
+//  With RF_CSMA the channel is checked first and a busy channel backs off
+//  as in RFSendPacketAsync(), busy-waiting; the packet is dropped after
+//  RF_CSMA_MAX_BACKOFFS busy tries.
+//
 //  ARGUMENTS:
 //      char *txBuffer
 //          Pointer to a buffer containing the data to be transmitted
@@ -127,14 +1130,61 @@ extern char paTableLen = 1;
 //-----------------------------------------------------------------------------
 void RFSendPacket(char *txBuffer, char size)
 {
+    char n;
+    unsigned int units;
+
     TI_CC_SPIWriteBurstReg(TI_CCxxx0_TXFIFO, txBuffer, size); // Write TX data
-    TI_CC_SPIStrobe(TI_CCxxx0_STX);         // Change state to TX, initiating
-                                            // data transfer
+    if (RF_FEC_ON && size < RF_FEC_PKTLEN)
+        TI_CC_SPIWriteBurstReg(TI_CCxxx0_TXFIFO, (char *)rfPad,
+                               RF_FEC_PKTLEN - size);   // Fixed length
+    for (n = 1; !ccaStx(); n++)             // Change state to TX, initiating
+    {                                       // data transfer, channel clear
+      rfStats.backoffs++;
+      if (n > RF_CSMA_MAX_BACKOFFS)
+      {
+        rfStats.ccaFails++;
+        TI_CC_SPIStrobe(TI_CCxxx0_SIDLE);
+        TI_CC_SPIStrobe(TI_CCxxx0_SFTX);
+        listen();
+        return;
+      }
+      for (units = backoffTicks(n) / RF_CSMA_UNIT_TICKS; units; units--)
+        TI_CC_Wait(TI_CC_US(500));
+    }
 
+    TRACE(TRACE_TX_WAIT, size);
     while (!(TI_CC_GDO0_PxIN&TI_CC_GDO0_PIN));
                                             // Wait GDO0 to go hi -> sync TX'ed
     while (TI_CC_GDO0_PxIN&TI_CC_GDO0_PIN);
                                             // Wait GDO0 to clear -> end of pkt
+    TRACE(TRACE_TX_WAIT_END, 0);
+}
+
+
+// Read "count" bytes of the RXFIFO into "buffer" (dropped if 0) through the
+// SPI interrupt, in LPM0 meanwhile, so that other interrupts are taken
+// while the FIFO drains.  The GDO0 interrupt stays off, so packets are
+// still read one at a time and in order.
+static void drain(char *buffer, char count)
+{
+  __istate_t s = __get_interrupt_state();
+  char ie = TI_CC_GDO0_PxIE & TI_CC_GDO0_PIN;
+
+  __disable_interrupt();
+  TI_CC_GDO0_PxIE &= ~TI_CC_GDO0_PIN;
+  while (!TI_CC_SPIStart(TI_CCxxx0_RXFIFO | TI_CCxxx0_READ_BURST, 0, buffer,
+                         count, 0))
+  {
+    _BIS_SR(LPM0_bits + GIE);               // Bus taken by a TXFIFO load
+    __disable_interrupt();
+  }
+  while (TI_CC_SPIBusy())
+  {
+    _BIS_SR(LPM0_bits + GIE);               // Woken at the last byte
+    __disable_interrupt();
+  }
+  TI_CC_GDO0_PxIE |= ie;
+  __set_interrupt_state(s);
 }
 
 
@@ -154,6 +1204,15 @@ void RFSendPacket(char *txBuffer, char size)
 //  This is done because the GDO signal will go high even if the FIFO is flushed
 //  due to address filtering, CRC filtering, or packet length filtering.
 //
+//  In RF_PROFILE_FEC the padding after the packet is read and dropped, and
+//  a packet for another address is rejected here instead of by the radio.
+//
+//  The packet is read from the SPI interrupt with the CPU in LPM0, so the
+//  other interrupts are taken meanwhile.
+//
+//  The RSSI and LQI of every packet with a good CRC are kept, and packets
+//  with a bad CRC and RXFIFO overflows are counted; see RFLinkReport().
+//
 //  ARGUMENTS:
 //      char *rxBuffer
 //          Pointer to the buffer where the incoming data should be stored
@@ -170,27 +1229,92 @@ void RFSendPacket(char *txBuffer, char size)
 char RFReceivePacket(char *rxBuffer, char *length)
 {
   char status[2];
-  char pktLen;
+  char pktLen, fill;
+  char rxBytes = TI_CC_SPIReadStatus(TI_CCxxx0_RXBYTES);
 
-  if ((TI_CC_SPIReadStatus(TI_CCxxx0_RXBYTES) & TI_CCxxx0_NUM_RXBYTES))
+  if (rxBytes & TI_CCxxx0_RXFIFO_OVERFLOW)
+  {
+    rfStats.overflows++;
+    TI_CC_SPIStrobe(TI_CCxxx0_SIDLE);
+    TI_CC_SPIStrobe(TI_CCxxx0_SFRX);      // Flush RXFIFO
+    listen();
+    return 0;
+  }
+  if (rxBytes & TI_CCxxx0_NUM_RXBYTES)
   {
     pktLen = TI_CC_SPIReadReg(TI_CCxxx0_RXFIFO); // Read length byte
+    fill = RF_FEC_ON ? RF_FEC_PKTLEN - 1 : pktLen;
 
-    if (pktLen <= *length)                  // If pktLen size <= rxBuffer
+    if (pktLen <= *length && pktLen <= fill) // If pktLen size <= rxBuffer
     {
-      TI_CC_SPIReadBurstReg(TI_CCxxx0_RXFIFO, rxBuffer, pktLen); // Pull data
+      drain(rxBuffer, pktLen);              // Pull data
       *length = pktLen;                     // Return the actual size
-      TI_CC_SPIReadBurstReg(TI_CCxxx0_RXFIFO, status, 2);
-                                            // Read appended status bytes
-      return (char)(status[TI_CCxxx0_LQI_RX]&TI_CCxxx0_CRC_OK);
-    }                                       // Return CRC_OK bit
+      if (fill > pktLen)
+        drain(0, fill - pktLen);            // Drop the FEC padding
+      drain(status, 2);                     // Read appended status bytes
+      if (!(status[TI_CCxxx0_LQI_RX] & TI_CCxxx0_CRC_OK))
+      {
+        rfStats.crcFails++;
+        return 0;
+      }
+      if (RF_FEC_ON && (!pktLen || (rxBuffer[0] != rfAddr
+              && (unsigned char)rxBuffer[0] != RF_ADDR_BROADCAST0
+              && (unsigned char)rxBuffer[0] != RF_ADDR_BROADCAST1)))
+        return 0;                           // Someone else's
+      rfStats.packets++;
+      rfStats.rssi = status[TI_CCxxx0_RSSI_RX];
+      rfStats.lqi = status[TI_CCxxx0_LQI_RX] & TI_CCxxx0_LQI_EST;
+      return TI_CCxxx0_CRC_OK;
+    }
     else
     {
       *length = pktLen;                     // Return the large size
+      rfStats.overflows++;
+      TI_CC_SPIStrobe(TI_CCxxx0_SIDLE);
       TI_CC_SPIStrobe(TI_CCxxx0_SFRX);      // Flush RXFIFO
+      listen();
       return 0;                             // Error
     }
   }
   else
       return 0;                             // Error
 }
+
+
+//-----------------------------------------------------------------------------
+//  char RFLinkReport(char *report)
+//
+//  DESCRIPTION:
+//  Writes the link statistics kept by RFReceivePacket() as
+//  RF_LINK_REPORT_LEN bytes:
+//
+//      [RSSI] [LQI] [packets] [CRC fails] [overflows] [backoffs]
+//      [CCA fails]
+//
+//  RSSI and LQI are those of the last good packet.  RSSI is in two's
+//  complement half-dB steps, so dBm = RSSI / 2 - RF_RSSI_OFFSET; LQI runs
+//  from 0 to 127, lower meaning a cleaner signal.  The counts are
+//  the low bytes of counters kept since reset, so two reports tell how many
+//  packets arrived, failed their CRC or overflowed in between.  Backoffs
+//  and CCA fails count the sends put off, and dropped, because CCA found
+//  the channel busy (RF_CSMA).
+//
+//  ARGUMENTS:
+//      char *report
+//          Receives RF_LINK_REPORT_LEN bytes
+//
+//  RETURN VALUE:
+//      char
+//          RF_LINK_REPORT_LEN
+//-----------------------------------------------------------------------------
+char RFLinkReport(char *report)
+{
+  report[0] = rfStats.rssi;
+  report[1] = rfStats.lqi;
+  report[2] = (char)rfStats.packets;
+  report[3] = (char)rfStats.crcFails;
+  report[4] = (char)rfStats.overflows;
+  report[5] = (char)rfStats.backoffs;
+  report[6] = (char)rfStats.ccaFails;
+  return RF_LINK_REPORT_LEN;
+}
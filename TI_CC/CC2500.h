@@ -10,6 +10,103 @@
 //----------------------------------------------------------------------------
 
 
+// RFGDO0Event() results
+#define RF_EVENT_NONE          0
+#define RF_EVENT_RX            1
+#define RF_EVENT_TX_DONE       2
+
+// Wake-on-Radio settings, see RFWorListen()
+#define RF_WOR_OFF             0
+#define RF_WOR_FAST            1           // 150 ms period
+#define RF_WOR_MEDIUM          2           // 300 ms period
+#define RF_WOR_SLOW            3           // 1.2 s period
+#define RF_WOR_AWAKE_MS        2000        // Stay in RX after a packet
+#define RF_WOR_MARGIN_MS       5           // Wake-up burst beyond one period
+
+#ifndef RF_WOR_SETTING                      // Used by both ends
+#define RF_WOR_SETTING         RF_WOR_OFF
+#endif
+
+// Channel hopping, see RFHopStart()
+#define RF_HOP_LEAD            1           // Picks the channel (SENDING VERSION)
+#define RF_HOP_FOLLOW          2           // Scans for it (RECEIVING VERSION)
+#define RF_HOP_CHANNELS        16
+#define RF_HOP_SPACING         15          // CHANNR steps between channels, 3 MHz
+#define RF_HOP_DWELL_MS        4           // Follower scan time per channel
+#define RF_HOP_STAY_MS         100         // Follower stays put after a packet
+#define RF_HOP_LOSSES          2           // Lost exchanges in a row before a hop
+
+#ifndef RF_HOP_SEED                         // Hop sequence seed, used by both
+#define RF_HOP_SEED            0           // ends; 0 keeps the fixed channel
+#endif
+#ifndef RF_HOP_BLACKLIST                    // 0: the lead hops over every
+#define RF_HOP_BLACKLIST       1           // channel alike
+#endif
+
+// Modem profiles, see RFSetProfile() and CC2500Profiles.h
+#define RF_PROFILE_PLAIN       0           // 250 kbps, variable length
+#define RF_PROFILE_FEC         1           // 250 kbps, FEC and interleaving
+#define RF_PROFILE_FAST        2           // 500 kbps
+#define RF_PROFILE_SHORT       3           // 250 kbps, short preamble and sync
+#define RF_PROFILE_LONG        4           // 10 kbps, long range
+#define RF_NUM_PROFILES        5
+#define RF_FEC_PKTLEN          55          // Every FEC packet, length byte incl.
+
+#ifndef RF_PROFILE_BOOT                     // Profile both ends start in
+#define RF_PROFILE_BOOT        RF_PROFILE_PLAIN
+#endif
+
+// Configuration registers written and verified in bursts, see
+// writeRFSettings()
+#ifndef RF_CONFIG_BURST                     // 0: one transaction per register
+#define RF_CONFIG_BURST        1
+#endif
+
+// Broadcast addresses every radio takes besides its own, see RFSetAddress()
+#define RF_ADDR_BROADCAST0     0x00
+#define RF_ADDR_BROADCAST1     0xFF
+
+// Listen before talk, see RFSendPacketAsync()
+#ifndef RF_CSMA                             // 0: STX regardless of the channel
+#define RF_CSMA                1
+#endif
+#ifndef RF_CCA_ABS_THR                      // Busy above the AGC target plus
+#define RF_CCA_ABS_THR         0           // this many dB, -7 to 7
+#endif
+#define RF_CSMA_UNIT_TICKS     6           // Backoff unit, 500 us of ACLK
+#define RF_CSMA_MIN_BE         2           // Backoff exponent, first and
+#define RF_CSMA_MAX_BE         4           // largest
+#define RF_CSMA_MAX_BACKOFFS   4           // Before the packet is dropped
+// MARCSTATE reads after STX covering the ~10 us RX to TX turnaround, at 16
+// SPI clocks of TI_CC_SPI_DIV MCLK cycles each, plus two for margin
+#define RF_CCA_READS           (10*TI_CC_MCLK_MHZ / (16*TI_CC_SPI_DIV) + 2)
+
+// Link statistics, see RFLinkReport()
+#define RF_LINK_REPORT_LEN     7
+#define RF_RSSI_OFFSET         72          // 69 in RF_PROFILE_LONG
+
+#if RF_HOP_SEED && RF_WOR_SETTING != RF_WOR_OFF
+#error "Channel hopping and Wake-on-Radio can't be used together"
+#endif
+
+
 void writeRFSettings(void);
+char verifyRFSettings(char *, char);
+char RFInit(void);
 void RFSendPacket(char *, char);
 char RFReceivePacket(char *, char *);
+unsigned int RFAirtimeUs(char);
+char RFSendPacketAsync(char *, char);
+char RFSendPacketNoCca(char *, char);
+char RFTxBusy(void);
+char RFTxTimeouts(void);
+char RFGDO0Event(void);
+void RFWorListen(char);
+void RFWorPeer(char);
+void RFHopStart(unsigned int, char);
+void RFHopResult(char);
+char RFSetProfile(char);
+char RFProfile(void);
+void RFSetAddress(char);
+char RFAddress(void);
+char RFLinkReport(char *);
@@ -0,0 +1,211 @@
+//----------------------------------------------------------------------------
+//  Description:  CC2500 modem profiles
+//
+//  Each profile is described by its data rate, modulation, preamble, sync
+//  mode and FEC, plus the analog settings SmartRF Studio recommends for
+//  that rate.  The register values in the rfProfiles[] table (CC2500.c)
+//  are computed from these at compile time, and the checks at the end of
+//  this file stop the build if a profile is inconsistent.  All profiles
+//  keep the 199.95 kHz channel spacing of rfConfig[], so the channel plan
+//  and the stored hop calibrations hold in every profile.
+//
+//  Airtime of a few packets (preamble, sync word, packet and CRC):
+//
+//      profile           rate      pre/sync  PKT_DRIVE  fragment  240-byte
+//                                                       (55 B)    program
+//      RF_PROFILE_PLAIN  250 kbps    4/4      448 us    2080 us    10.9 ms
+//      RF_PROFILE_FEC    250 kbps    4/4     3968 us    3968 us    23.8 ms
+//      RF_PROFILE_FAST   500 kbps    4/4      224 us    1040 us     5.4 ms
+//      RF_PROFILE_SHORT  250 kbps    2/2      320 us    1952 us    10.1 ms
+//      RF_PROFILE_LONG    10 kbps    4/4     11.2 ms    52.0 ms     272 ms
+//
+//  A 240-byte program is five full fragments and one PKT_FRAG_ACK with no
+//  losses.  The PKT_DRIVE column is the radio share of the live-driving
+//  input-to-pin latency (Stream.h).  RF_PROFILE_LONG trades airtime for
+//  about 10 dB more sensitivity (datasheet: -99 dBm at 10 kbps against
+//  -89 dBm at 250 kbps); Wake-on-Radio sniff times assume 250 kbps or
+//  faster.
+//
+//  host/TestProfile.c decodes the registers built from this file, checks
+//  them against the framing above, and measures these airtimes in the host
+//  simulator.  A send takes about 0.1 ms longer for PKT_DRIVE and 0.3 ms
+//  for a fragment, to load the TXFIFO and turn the radio round.
+//----------------------------------------------------------------------------
+
+
+#define RF_XOSC_HZ             26000000    // Crystal
+#define RF_CHANSPC_E           2           // 199.95 kHz channel spacing, as
+#define RF_CHANSPC_M           0xF8        // in rfConfig[]
+
+// MDMCFG2 MOD_FORMAT
+#define RF_MOD_2FSK            0
+#define RF_MOD_MSK             7
+
+// MDMCFG2 SYNC_MODE
+#define RF_SYNC_16             1           // 15/16 sync word bits
+#define RF_SYNC_32             3           // 30/32 sync word bits
+
+
+// RF_PROFILE_PLAIN: 250 kbps MSK, variable-length packets
+#define RF_PLAIN_BPS           250000
+#define RF_PLAIN_DRATE_E       13
+#define RF_PLAIN_BW_E          0           // 541 kHz channel filter
+#define RF_PLAIN_BW_M          2
+#define RF_PLAIN_MOD           RF_MOD_MSK
+#define RF_PLAIN_SYNC          RF_SYNC_32
+#define RF_PLAIN_PREAMBLE      4
+#define RF_PLAIN_FEC           0
+#define RF_PLAIN_FSCTRL1       0x07
+#define RF_PLAIN_DEVIATN       0x00
+#define RF_PLAIN_FOCCFG        0x1D
+#define RF_PLAIN_BSCFG         0x1C
+#define RF_PLAIN_AGCCTRL2      0xC7
+#define RF_PLAIN_AGCCTRL1      0x00
+#define RF_PLAIN_AGCCTRL0      0xB2
+#define RF_PLAIN_FREND1        0xB6
+
+// RF_PROFILE_FEC: as RF_PROFILE_PLAIN, with FEC and fixed-length packets
+#define RF_FEC_BPS             250000
+#define RF_FEC_DRATE_E         13
+#define RF_FEC_BW_E            0
+#define RF_FEC_BW_M            2
+#define RF_FEC_MOD             RF_MOD_MSK
+#define RF_FEC_SYNC            RF_SYNC_32
+#define RF_FEC_PREAMBLE        4
+#define RF_FEC_FEC             1
+#define RF_FEC_FSCTRL1         0x07
+#define RF_FEC_DEVIATN         0x00
+#define RF_FEC_FOCCFG          0x1D
+#define RF_FEC_BSCFG           0x1C
+#define RF_FEC_AGCCTRL2        0xC7
+#define RF_FEC_AGCCTRL1        0x00
+#define RF_FEC_AGCCTRL0        0xB2
+#define RF_FEC_FREND1          0xB6
+
+// RF_PROFILE_FAST: 500 kbps MSK, half the airtime, about 7 dB less range
+#define RF_FAST_BPS            500000
+#define RF_FAST_DRATE_E        14
+#define RF_FAST_BW_E           0           // 812 kHz channel filter
+#define RF_FAST_BW_M           0
+#define RF_FAST_MOD            RF_MOD_MSK
+#define RF_FAST_SYNC           RF_SYNC_32
+#define RF_FAST_PREAMBLE       4
+#define RF_FAST_FEC            0
+#define RF_FAST_FSCTRL1        0x10
+#define RF_FAST_DEVIATN        0x00
+#define RF_FAST_FOCCFG         0x1D
+#define RF_FAST_BSCFG          0x1C
+#define RF_FAST_AGCCTRL2       0xC7
+#define RF_FAST_AGCCTRL1       0x40
+#define RF_FAST_AGCCTRL0       0xB0
+#define RF_FAST_FREND1         0xB6
+
+// RF_PROFILE_SHORT: 250 kbps MSK with the shortest preamble and sync word,
+// for short control packets at close range
+#define RF_SHORT_BPS           250000
+#define RF_SHORT_DRATE_E       13
+#define RF_SHORT_BW_E          0
+#define RF_SHORT_BW_M          2
+#define RF_SHORT_MOD           RF_MOD_MSK
+#define RF_SHORT_SYNC          RF_SYNC_16
+#define RF_SHORT_PREAMBLE      2
+#define RF_SHORT_FEC           0
+#define RF_SHORT_FSCTRL1       0x07
+#define RF_SHORT_DEVIATN       0x00
+#define RF_SHORT_FOCCFG        0x1D
+#define RF_SHORT_BSCFG         0x1C
+#define RF_SHORT_AGCCTRL2      0xC7
+#define RF_SHORT_AGCCTRL1      0x00
+#define RF_SHORT_AGCCTRL0      0xB2
+#define RF_SHORT_FREND1        0xB6
+
+// RF_PROFILE_LONG: 10 kbps 2-FSK, long range
+#define RF_LONG_BPS            10000
+#define RF_LONG_DRATE_E        8
+#define RF_LONG_BW_E           1           // 232 kHz channel filter
+#define RF_LONG_BW_M           3
+#define RF_LONG_MOD            RF_MOD_2FSK
+#define RF_LONG_SYNC           RF_SYNC_32
+#define RF_LONG_PREAMBLE       4
+#define RF_LONG_FEC            0
+#define RF_LONG_FSCTRL1        0x06
+#define RF_LONG_DEVIATN        0x44        // 38 kHz
+#define RF_LONG_FOCCFG         0x16
+#define RF_LONG_BSCFG          0x6C
+#define RF_LONG_AGCCTRL2       0x43
+#define RF_LONG_AGCCTRL1       0x40
+#define RF_LONG_AGCCTRL0       0x91
+#define RF_LONG_FREND1         0x56
+
+
+// Register fields from the settings above (CC2500 datasheet, section 12
+// for the data rate and 13 for the channel filter)
+#define RF_DRATE_M(bps,e)      (((bps) * (1ULL << (28 - (e))) + RF_XOSC_HZ / 2) \
+                                / RF_XOSC_HZ - 256)
+#define RF_DRATE_BPS(m,e)      (((256ULL + (m)) << (e)) * RF_XOSC_HZ >> 28)
+#define RF_CHANBW_HZ(e,m)      (RF_XOSC_HZ / (8 * (4 + (m)) << (e)))
+#define RF_NUM_PREAMBLE(n)     ((n) == 2 ? 0 : (n) == 3 ? 1 : (n) == 4 ? 2 :  \
+                                (n) == 6 ? 3 : (n) == 8 ? 4 : (n) == 12 ? 5 : \
+                                (n) == 16 ? 6 : (n) == 24 ? 7 : 8)
+#define RF_SYNC_BYTES(mode)    (((mode) & 3) == 3 ? 4 : 2)
+
+#define RF_MDMCFG4(P)          ((P##_BW_E << 6) | (P##_BW_M << 4) | P##_DRATE_E)
+#define RF_MDMCFG3(P)          RF_DRATE_M(P##_BPS, P##_DRATE_E)
+#define RF_MDMCFG2(P)          ((P##_MOD << 4) | P##_SYNC)
+#define RF_MDMCFG1(P)          ((P##_FEC << 7) | (RF_NUM_PREAMBLE(P##_PREAMBLE) \
+                                << 4) | RF_CHANSPC_E)
+#define RF_PKTLEN(P)           (P##_FEC ? RF_FEC_PKTLEN : 0xFF)
+#define RF_PKTCTRL1(P)         (P##_FEC ? 0x04 : 0x07) // Address check in
+#define RF_PKTCTRL0(P)         (P##_FEC ? 0x04 : 0x05) // software when fixed
+                                                        // length
+#define RF_AGCCTRL1(P)         (P##_AGCCTRL1 | (RF_CCA_ABS_THR & 0x0F))
+#define RF_TEST2(P)            (P##_BPS < 100000 ? 0x81 : 0x88)
+#define RF_TEST1(P)            (P##_BPS < 100000 ? 0x35 : 0x31)
+
+// Registers written by each profile, in rfProfileRegs[] order
+#define RF_PROFILE_ROW(P)      { P##_FSCTRL1, RF_PKTLEN(P), RF_PKTCTRL1(P),   \
+                                 RF_PKTCTRL0(P), RF_MDMCFG4(P),               \
+                                 RF_MDMCFG3(P), RF_MDMCFG2(P), RF_MDMCFG1(P), \
+                                 P##_DEVIATN, P##_FOCCFG, P##_BSCFG,          \
+                                 P##_AGCCTRL2, RF_AGCCTRL1(P), P##_AGCCTRL0,  \
+                                 P##_FREND1, RF_TEST2(P), RF_TEST1(P) }
+
+// Framing used by RFAirtimeUs()
+#define RF_FRAMING_ROW(P)      { P##_BPS / 1000, P##_PREAMBLE,                \
+                                 RF_SYNC_BYTES(P##_SYNC), P##_FEC }
+
+
+// Consistency checks:
+//  - DRATE_M fits its register and gives the rate within 1 %
+//  - the channel filter is at least as wide as the data rate, and no
+//    wider than the CC2500's widest
+//  - MSK only from 26 to 500 kbps, and above 250 kbps only MSK
+//  - a preamble length the radio can send, and a sync word to find
+//  - a whole number of kbps, as RFAirtimeUs() keeps it
+#define RF_RATE_OK(P)          (RF_MDMCFG3(P) <= 255                          \
+      && RF_DRATE_BPS(RF_MDMCFG3(P), P##_DRATE_E) * 100 >= P##_BPS * 99ULL    \
+      && RF_DRATE_BPS(RF_MDMCFG3(P), P##_DRATE_E) * 100 <= P##_BPS * 101ULL)
+#define RF_BW_OK(P)            (RF_CHANBW_HZ(P##_BW_E, P##_BW_M) >= P##_BPS   \
+      && RF_CHANBW_HZ(P##_BW_E, P##_BW_M) <= 812500)
+#define RF_MOD_OK(P)           (P##_MOD == RF_MOD_MSK                         \
+      ? P##_BPS >= 26000 && P##_BPS <= 500000 : P##_BPS <= 250000)
+#define RF_FRAME_OK(P)         (RF_NUM_PREAMBLE(P##_PREAMBLE) < 8             \
+      && (P##_SYNC & 3) != 0 && P##_BPS % 1000 == 0)
+#define RF_PROFILE_OK(P)       (RF_RATE_OK(P) && RF_BW_OK(P) && RF_MOD_OK(P)  \
+      && RF_FRAME_OK(P))
+
+#if !RF_PROFILE_OK(RF_PLAIN)
+#error "RF_PROFILE_PLAIN settings are inconsistent"
+#endif
+#if !RF_PROFILE_OK(RF_FEC)
+#error "RF_PROFILE_FEC settings are inconsistent"
+#endif
+#if !RF_PROFILE_OK(RF_FAST)
+#error "RF_PROFILE_FAST settings are inconsistent"
+#endif
+#if !RF_PROFILE_OK(RF_SHORT)
+#error "RF_PROFILE_SHORT settings are inconsistent"
+#endif
+#if !RF_PROFILE_OK(RF_LONG)
+#error "RF_PROFILE_LONG settings are inconsistent"
+#endif
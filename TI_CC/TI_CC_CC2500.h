@@ -91,6 +91,14 @@
 #define TI_CCxxx0_TXBYTES      0x3A        // Underflow and # of bytes in TXFIFO
 #define TI_CCxxx0_RXBYTES      0x3B        // Overflow and # of bytes in RXFIFO
 #define TI_CCxxx0_NUM_RXBYTES  0x7F        // Mask "# of bytes" field in _RXBYTES
+#define TI_CCxxx0_RXFIFO_OVERFLOW 0x80     // Mask "overflow" bit in _RXBYTES
+#define TI_CCxxx0_NUM_TXBYTES  0x7F        // Mask "# of bytes" field in _TXBYTES
+#define TI_CCxxx0_MARC_STATE   0x1F        // Mask "MARC_STATE" field in _MARCSTATE
+#define TI_CCxxx0_MARC_IDLE    0x01        // MARC_STATE value for IDLE
+#define TI_CCxxx0_MARC_VCOON_MC 0x03       // MARC_STATE values bounding
+#define TI_CCxxx0_MARC_ENDCAL  0x0C        // calibration and settling
+#define TI_CCxxx0_MARC_RX      0x0D        // MARC_STATE values for RX,
+#define TI_CCxxx0_MARC_RX_RST  0x0F        // RX_END and RX_RST
 
 // Other memory locations
 #define TI_CCxxx0_PATABLE      0x3E
@@ -98,8 +106,10 @@
 #define TI_CCxxx0_RXFIFO       0x3F
 
 // Masks for appended status bytes
+#define TI_CCxxx0_RSSI_RX      0x00        // Position of RSSI byte
 #define TI_CCxxx0_LQI_RX       0x01        // Position of LQI byte
 #define TI_CCxxx0_CRC_OK       0x80        // Mask "CRC_OK" bit within LQI byte
+#define TI_CCxxx0_LQI_EST      0x7F        // Mask "LQI" field within LQI byte
 
 // Definitions to support burst/single access:
 #define TI_CCxxx0_WRITE_BURST  0x40
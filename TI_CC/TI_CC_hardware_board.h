@@ -41,3 +41,28 @@
 // Select which port will be used for interface to CCxxxx
 //----------------------------------------------------------------------------
 #define TI_CC_RF_SER_INTF       TI_CC_SER_INTF_USCIB0  // Interface to CCxxxx
+
+
+//----------------------------------------------------------------------------
+// Clock profile: MCLK/SMCLK frequency in MHz (1, 8 or 16).  The DCO, UART
+// and SPI settings are all derived from it (see Clock.h).  16 MHz needs
+// VCC >= 3.3 V, 8 MHz needs VCC >= 2.7 V.
+//----------------------------------------------------------------------------
+#ifndef TI_CC_MCLK_MHZ
+#define TI_CC_MCLK_MHZ          8
+#endif
+
+// SPI clock divider from SMCLK, keeping SCLK within the CC2500's 6.5 MHz
+// burst-access limit
+#if TI_CC_MCLK_MHZ == 1
+#define TI_CC_SPI_DIV           1      // 1 MHz
+#elif TI_CC_MCLK_MHZ == 8
+#define TI_CC_SPI_DIV           2      // 4 MHz
+#elif TI_CC_MCLK_MHZ == 16
+#define TI_CC_SPI_DIV           3      // 5.33 MHz
+#else
+#error "TI_CC_MCLK_MHZ must be 1, 8 or 16"
+#endif
+
+// Number of MCLK cycles in "us" microseconds, for TI_CC_Wait()
+#define TI_CC_US(us)            ((us)*TI_CC_MCLK_MHZ)
@@ -14,8 +14,14 @@
 //  IAR Embedded Workbench v3.41
 //----------------------------------------------------------------------------
 
+#ifndef TI_CC_DEVICE
 #include "msp430x22x4.h"                     // Adjust this according to the
                                             // MSP430 device being used.
+#else
+#include TI_CC_DEVICE                       // Another device header, e.g. the
+                                            // simulated registers of a host
+                                            // build: host/msp430sim.h
+#endif
 
 // SPI port definitions                     // Adjust the values for the chosen
 #define TI_CC_SPI_USART0_PxSEL  P3SEL       // interfaces, according to the pin
@@ -1,8 +1,8 @@
 //----------------------------------------------------------------------------
 //  Description:  This file contains functions that allow the MSP430 device to 
-//  access the SPI interface of the CC1100/CC2500.  There are multiple 
-//  instances of each function; the one to be compiled is selected by the 
-//  system variable TI_CC_RF_SER_INTF, defined in "TI_CC_hardware_board.h".
+//  access the SPI interface of the CC1100/CC2500.  Only the USCI_B0 instance
+//  of the library is kept, the interface of the eZ430-RF2500; the system
+//  variable TI_CC_RF_SER_INTF in "TI_CC_hardware_board.h" must select it.
 //
 //  MSP430/CC1100-2500 Interface Code Library v1.0
 //
@@ -15,6 +15,11 @@
 
 #include "include.h"
 #include "TI_CC_spi.h"
+#include "../Trace.h"
+
+#if TI_CC_RF_SER_INTF != TI_CC_SER_INTF_USCIB0
+#error "TI_CC_spi.c only drives the CCxxxx from USCI_B0"
+#endif
 
 
 //----------------------------------------------------------------------------
@@ -62,11 +67,40 @@
 //  Special write function for writing to command strobe registers.  Writes
 //  to the strobe at address "addr".
 //----------------------------------------------------------------------------
+//  char TI_CC_SPIStart(char header, char *txBuffer, char *rxBuffer,
+//                      char count, TI_CC_SPIDoneFn done)
+//
+//  DESCRIPTION:
+//  Starts a transaction of the header byte and "count" data bytes, and
+//  returns at once.  The USCI_B0 RX interrupt clocks the rest: bytes from
+//  "txBuffer" (zeros if 0) go out, bytes read back go to "rxBuffer"
+//  (dropped if 0).  At the end /CS is released, "done" (if not 0) is
+//  called from the interrupt and the CPU is woken.  Returns 0 without
+//  doing anything if a transaction is still running.
+//
+//  The USCI stops with SMCLK: the header is sent before returning, and the
+//  interrupt keeps SMCLK on (LPM0) in the code it returns to until the
+//  end.  Code that goes to sleep while TI_CC_SPIBusy() must use LPM0.
+//
+//  The blocking functions above run the same engine by polling, with
+//  interrupts held off, and finish a running transaction first.
+//----------------------------------------------------------------------------
+//  char TI_CC_SPIBusy(void)
+//
+//  DESCRIPTION:
+//  Returns 1 while a transaction started by TI_CC_SPIStart() is running.
+//----------------------------------------------------------------------------
+//  char TI_CC_SPIChipStatus(void)
+//
+//  DESCRIPTION:
+//  Returns the chip status byte clocked in with the header of the last
+//  transaction.
+//----------------------------------------------------------------------------
 
 
 // Delay function. # of CPU cycles delayed is similar to "cycles". Specifically,
 // it's ((cycles-15) % 6) + 15.  Not exact, but gives a sense of the real-time
-// delay.  Also, if MCLK ~1MHz, "cycles" is similar to # of useconds delayed.
+// delay.  Use TI_CC_US() to get the cycles for a delay in useconds.
 void TI_CC_Wait(unsigned int cycles)
 {
   while(cycles>15)                          // 15 cycles consumed by overhead
@@ -84,7 +118,7 @@ void TI_CC_SPISetup(void)
 
   UCB0CTL0 |= UCMST+UCCKPL+UCMSB+UCSYNC;    // 3-pin, 8-bit SPI master
   UCB0CTL1 |= UCSSEL_2;                     // SMCLK
-  UCB0BR0 |= 0x02;                          // UCLK/2
+  UCB0BR0 = TI_CC_SPI_DIV;                  // UCLK/TI_CC_SPI_DIV
   UCB0BR1 = 0;
   //UCB0MCTL = 0;
   TI_CC_SPI_USCIB0_PxSEL |= TI_CC_SPI_USCIB0_SIMO | TI_CC_SPI_USCIB0_SOMI | TI_CC_SPI_USCIB0_UCLK;
@@ -94,121 +128,157 @@ void TI_CC_SPISetup(void)
   UCB0CTL1 &= ~UCSWRST;                     // **Initialize USCI state machine**
 }
 
+
+// USCI_B0 shares its RX interrupt vector with USCI_A0.  A UART driver for
+// USCI_A0 hooks its receive handler in here.
+void (*TI_CC_USCIA0RxHandler)(void) = 0;
+
+static char *spiTx;                         // Data to send, 0 sends zeros
+static char *spiRx;                         // Data read back, 0 drops it
+static char spiCount;                       // Data bytes after the header
+static char spiPos;                         // Bytes clocked so far
+static char spiStatus;                      // Chip status from the header
+static TI_CC_SPIDoneFn spiDone;
+static volatile char spiBusy;
+
+
+// Called once per received byte: store it, then send the next one or end
+// the transaction
+static void spiStep(void)
+{
+  char x = UCB0RXBUF;                       // Read clears UCB0RXIFG
+
+  if (spiPos == 0)
+    spiStatus = x;                          // Status byte from the header
+  else if (spiRx)
+    spiRx[spiPos-1] = x;
+
+  if (spiPos++ < spiCount)
+  {
+    UCB0TXBUF = spiTx ? spiTx[spiPos-1] : 0;
+    return;
+  }
+  TI_CC_CSn_PxOUT |= TI_CC_CSn_PIN;         // /CS disable
+  IE2 &= ~UCB0RXIE;
+  spiBusy = 0;
+  TRACE(TRACE_SPI_END, spiStatus);
+  if (spiDone)
+    spiDone();
+}
+
+// Drive the running transaction (if any) to its end by polling
+static void spiFinish(void)
+{
+  IE2 &= ~UCB0RXIE;                         // ISR must not race the poll
+  while (spiBusy)
+    if (IFG2 & UCB0RXIFG)
+      spiStep();
+}
+
+// Pull /CS low and send the header byte
+static void spiBegin(char header, char *tx, char *rx, char count,
+                     TI_CC_SPIDoneFn done)
+{
+  spiTx = tx;
+  spiRx = rx;
+  spiCount = count;
+  spiPos = 0;
+  spiDone = done;
+  spiBusy = 1;
+
+  TRACE(TRACE_SPI, header);
+  TI_CC_CSn_PxOUT &= ~TI_CC_CSn_PIN;        // /CS enable
+  while (TI_CC_SPI_USCIB0_PxIN&TI_CC_SPI_USCIB0_SOMI);// Wait for CCxxxx ready
+  IFG2 &= ~UCB0RXIFG;                       // Clear flag
+  UCB0TXBUF = header;                       // Send address/strobe
+}
+
+// Blocking transaction: the engine run by polling.  Interrupts are held off
+// so an ISR that also talks to the radio cannot cut in half way.
+static char spiRun(char header, char *tx, char *rx, char count)
+{
+  __istate_t s = __get_interrupt_state();
+
+  __disable_interrupt();
+  spiFinish();
+  spiBegin(header, tx, rx, count, 0);
+  spiFinish();
+  __set_interrupt_state(s);
+  return spiStatus;
+}
+
+char TI_CC_SPIStart(char header, char *txBuffer, char *rxBuffer, char count,
+                    TI_CC_SPIDoneFn done)
+{
+  __istate_t s = __get_interrupt_state();
+
+  __disable_interrupt();
+  if (spiBusy)
+  {
+    __set_interrupt_state(s);
+    return 0;
+  }
+  spiBegin(header, txBuffer, rxBuffer, count, done);
+  while (!(IFG2 & UCB0RXIFG));              // Header out before any LPM3
+  IE2 |= UCB0RXIE;                          // Rest of it runs from the ISR
+  __set_interrupt_state(s);
+  return 1;
+}
+
+char TI_CC_SPIBusy(void)
+{
+  return spiBusy;
+}
+
+char TI_CC_SPIChipStatus(void)
+{
+  return spiStatus;
+}
+
 void TI_CC_SPIWriteReg(char addr, char value)
 {
-    TI_CC_CSn_PxOUT &= ~TI_CC_CSn_PIN;      // /CS enable
-    while (TI_CC_SPI_USCIB0_PxIN&TI_CC_SPI_USCIB0_SOMI);// Wait for CCxxxx ready
-    IFG2 &= ~UCB0RXIFG;                     // Clear flag
-    UCB0TXBUF = addr;                       // Send address
-    while (!(IFG2&UCB0RXIFG));              // Wait for TX to finish
-    IFG2 &= ~UCB0RXIFG;                     // Clear flag
-    UCB0TXBUF = value;                      // Send data
-    while (!(IFG2&UCB0RXIFG));              // Wait for TX to finish
-    TI_CC_CSn_PxOUT |= TI_CC_CSn_PIN;       // /CS disable
+  spiRun(addr, &value, 0, 1);
 }
 
 void TI_CC_SPIWriteBurstReg(char addr, char *buffer, char count)
 {
-    unsigned int i;
-
-    TI_CC_CSn_PxOUT &= ~TI_CC_CSn_PIN;      // /CS enable
-    while (TI_CC_SPI_USCIB0_PxIN&TI_CC_SPI_USCIB0_SOMI);// Wait for CCxxxx ready
-    IFG2 &= ~UCB0RXIFG;
-    UCB0TXBUF = addr | TI_CCxxx0_WRITE_BURST;// Send address
-    while (!(IFG2&UCB0RXIFG));              // Wait for TX to finish
-    for (i = 0; i < count; i++)
-    {
-      IFG2 &= ~UCB0RXIFG;
-      UCB0TXBUF = buffer[i];                // Send data
-      while (!(IFG2&UCB0RXIFG));            // Wait for TX to finish
-    }
-    //while (!(IFG2&UCB0RXIFG));
-    TI_CC_CSn_PxOUT |= TI_CC_CSn_PIN;       // /CS disable
+  spiRun(addr | TI_CCxxx0_WRITE_BURST, buffer, 0, count);
 }
 
 char TI_CC_SPIReadReg(char addr)
 {
   char x;
 
-  TI_CC_CSn_PxOUT &= ~TI_CC_CSn_PIN;        // /CS enable
-  while (!(IFG2&UCB0TXIFG));                // Wait for TX to finish
-  UCB0TXBUF = (addr | TI_CCxxx0_READ_SINGLE);// Send address
-  while (!(IFG2&UCB0TXIFG));                // Wait for TX to finish
-  UCB0TXBUF = 0;                            // Dummy write so we can read data
-  // Address is now being TX'ed, with dummy byte waiting in TXBUF...
-  while (!(IFG2&UCB0RXIFG));                // Wait for RX to finish
-  // Dummy byte RX'ed during addr TX now in RXBUF
-  IFG2 &= ~UCB0RXIFG;                       // Clear flag set during addr write
-  while (!(IFG2&UCB0RXIFG));                // Wait for end of dummy byte TX
-  // Data byte RX'ed during dummy byte write is now in RXBUF
-  x = UCB0RXBUF;                            // Read data
-  TI_CC_CSn_PxOUT |= TI_CC_CSn_PIN;         // /CS disable
-
+  spiRun(addr | TI_CCxxx0_READ_SINGLE, 0, &x, 1);
   return x;
 }
 
 void TI_CC_SPIReadBurstReg(char addr, char *buffer, char count)
 {
-  char i;
-
-  TI_CC_CSn_PxOUT &= ~TI_CC_CSn_PIN;        // /CS enable
-  while (TI_CC_SPI_USCIB0_PxIN&TI_CC_SPI_USCIB0_SOMI);// Wait for CCxxxx ready
-  IFG2 &= ~UCB0RXIFG;                       // Clear flag
-  UCB0TXBUF = (addr | TI_CCxxx0_READ_BURST);// Send address
-  while (!(IFG2&UCB0TXIFG));                // Wait for TXBUF ready
-  UCB0TXBUF = 0;                            // Dummy write to read 1st data byte
-  // Addr byte is now being TX'ed, with dummy byte to follow immediately after
-  while (!(IFG2&UCB0RXIFG));                // Wait for end of addr byte TX
-  IFG2 &= ~UCB0RXIFG;                       // Clear flag
-  while (!(IFG2&UCB0RXIFG));                // Wait for end of 1st data byte TX
-  // First data byte now in RXBUF
-  for (i = 0; i < (count-1); i++)
-  {
-    UCB0TXBUF = 0;                          //Initiate next data RX, meanwhile..
-    buffer[i] = UCB0RXBUF;                  // Store data from last data RX
-    while (!(IFG2&UCB0RXIFG));              // Wait for RX to finish
-  }
-  buffer[count-1] = UCB0RXBUF;              // Store last RX byte in buffer
-  TI_CC_CSn_PxOUT |= TI_CC_CSn_PIN;         // /CS disable
+  spiRun(addr | TI_CCxxx0_READ_BURST, 0, buffer, count);
 }
 
 char TI_CC_SPIReadStatus(char addr)
 {
   char x;
 
-  TI_CC_CSn_PxOUT &= ~TI_CC_CSn_PIN;        // /CS enable
-  while (TI_CC_SPI_USCIB0_PxIN & TI_CC_SPI_USCIB0_SOMI);// Wait for CCxxxx ready
-  IFG2 &= ~UCB0RXIFG;                       // Clear flag set during last write
-  UCB0TXBUF = (addr | TI_CCxxx0_READ_BURST);// Send address
-  while (!(IFG2&UCB0RXIFG));                // Wait for TX to finish
-  IFG2 &= ~UCB0RXIFG;                       // Clear flag set during last write
-  UCB0TXBUF = 0;                            // Dummy write so we can read data
-  while (!(IFG2&UCB0RXIFG));                // Wait for RX to finish
-  x = UCB0RXBUF;                            // Read data
-  TI_CC_CSn_PxOUT |= TI_CC_CSn_PIN;         // /CS disable
-
+  spiRun(addr | TI_CCxxx0_READ_BURST, 0, &x, 1);
   return x;
 }
 
 void TI_CC_SPIStrobe(char strobe)
 {
-  IFG2 &= ~UCB0RXIFG;                       // Clear flag
-  TI_CC_CSn_PxOUT &= ~TI_CC_CSn_PIN;        // /CS enable
-  while (TI_CC_SPI_USCIB0_PxIN&TI_CC_SPI_USCIB0_SOMI);// Wait for CCxxxx ready
-  UCB0TXBUF = strobe;                       // Send strobe
-  // Strobe addr is now being TX'ed
-  while (!(IFG2&UCB0RXIFG));                // Wait for end of addr TX
-  TI_CC_CSn_PxOUT |= TI_CC_CSn_PIN;         // /CS disable
+  spiRun(strobe, 0, 0, 0);
 }
 
 void TI_CC_PowerupResetCCxxxx(void)
 {
   TI_CC_CSn_PxOUT |= TI_CC_CSn_PIN;
-  TI_CC_Wait(30);
+  TI_CC_Wait(TI_CC_US(30));
   TI_CC_CSn_PxOUT &= ~TI_CC_CSn_PIN;
-  TI_CC_Wait(30);
+  TI_CC_Wait(TI_CC_US(30));
   TI_CC_CSn_PxOUT |= TI_CC_CSn_PIN;
-  TI_CC_Wait(45);
+  TI_CC_Wait(TI_CC_US(45));
 
   TI_CC_CSn_PxOUT &= ~TI_CC_CSn_PIN;        // /CS enable
   while (TI_CC_SPI_USCIB0_PxIN&TI_CC_SPI_USCIB0_SOMI);// Wait for CCxxxx ready
@@ -221,3 +291,22 @@ void TI_CC_PowerupResetCCxxxx(void)
 }
 
 
+// USCI_A0/B0 receive interrupt: SPI transaction bytes, and UART bytes for
+// the driver hooked into TI_CC_USCIA0RxHandler
+#pragma vector=USCIAB0RX_VECTOR
+__interrupt void USCIAB0RX_ISR(void)
+{
+  if ((IE2 & UCB0RXIE) && (IFG2 & UCB0RXIFG))
+  {
+    spiStep();
+    if (spiBusy)
+      _BIC_SR_IRQ(SCG1);                    // SMCLK on for the next byte
+    else
+      _BIC_SR_IRQ(LPM3_bits);               // Transaction done, wake main
+  }
+  if ((IFG2 & UCA0RXIFG) && TI_CC_USCIA0RxHandler)
+  {
+    TI_CC_USCIA0RxHandler();
+    _BIC_SR_IRQ(LPM3_bits);                 // Wake main to parse
+  }
+}
@@ -20,6 +20,14 @@ char TI_CC_SPIReadStatus(char);
 void TI_CC_SPIStrobe(char);
 void TI_CC_Wait(unsigned int);
 
+typedef void (*TI_CC_SPIDoneFn)(void);
+
+char TI_CC_SPIStart(char, char *, char *, char, TI_CC_SPIDoneFn);
+char TI_CC_SPIBusy(void);
+char TI_CC_SPIChipStatus(void);
+
+extern void (*TI_CC_USCIA0RxHandler)(void);
+
 
 
 
@@ -0,0 +1,97 @@
+//----------------------------------------------------------------------------
+//  Description:  TDMA uplink schedule for a fleet of cars on one channel
+//
+//  The SENDING VERSION (TdmaTx.c) coordinates.  Every frame it broadcasts
+//  a PKT_BEACON that lists the cars holding a slot, in slot order.  The
+//  slots follow the beacon back to back, then one join slot:
+//
+//      | beacon | slot 0 | slot 1 | ... | slot n-1 | join | (idle) | beacon
+//
+//  A car sends its unsolicited uplink, the PKT_DONE reports with their link
+//  statistics, only in the first half of its own slot; the sender's
+//  PKT_DONE_ACK fits in the rest.  A car with something to send and no
+//  slot sends a PKT_JOIN in the join slot, on the frames whose beacon seq
+//  has the parity of its address, so that two joining cars don't collide
+//  every frame.  It gets a slot in the next beacon.  A car the sender
+//  hasn't heard from for TDMA_IDLE_FRAMES loses its slot, and the cars
+//  after it move up.
+//
+//  Each car measures the frame in its own ACLK ticks between beacons and
+//  scales the slot times from the sender's ticks with it.  The VLOs of two
+//  boards can be far apart (4 to 20 kHz), so the slots are timed by
+//  the sender's clock.  A car that misses TDMA_LOST_FRAMES beacons, or
+//  never hears one, sends whenever the radio is free, as with
+//  TDMA_ENABLE 0.
+//
+//  Replies the sender asks for (fragment, profile, run and address acks)
+//  go out at once, since only one car is asked at a time.  The sender's
+//  own packets are not held back from the slots; CCA (MCSM1) keeps them
+//  from starting on top of a car.  The beacon alone goes out without CCA
+//  (RFSendPacketNoCca()): a backoff would put it on the air later than
+//  the frame length it carries was measured.
+//
+//  Frame time in RF_PROFILE_PLAIN: a 6.3 ms slot (a PKT_DONE and its ack
+//  are 1.2 ms on the air) and frames of at least TDMA_FRAME_MS.  Measured
+//  in the host simulator (host/TestTdma.c), every car finishing a program
+//  at the same random point of the frame, 5 times:
+//
+//      cars   frame    wait for the ack   longest   resent   lost
+//        1    100 ms        49 ms           87 ms       0       0
+//        4    100 ms        48 ms          107 ms       0       0
+//        8     99 ms        87 ms          140 ms       0       0
+//       16    109 ms       149 ms          394 ms      30       0
+//
+//  No two cars ever share a slot, so no report is lost as the fleet grows.
+//  What limits 16 cars is the line to the GUI: a HOST_DONE takes 22 ms at
+//  9600 baud, and the sender only acks the PKT_DONEs its queue has room
+//  for (TransferTx.c).  The rest repeat in their slots over the next
+//  frames.  A car without a slot waits up to two frames more, to join.
+//----------------------------------------------------------------------------
+
+
+#ifndef TDMA_ENABLE                         // Used by both ends
+#define TDMA_ENABLE            0
+#endif
+
+#define TDMA_MAX_CARS          16
+#define TDMA_FRAME_MS          100         // Shortest frame
+#define TDMA_GUARD_MS          1           // Slot start and end margin
+#define TDMA_IDLE_FRAMES       20          // Sender: frees a quiet car's slot
+#define TDMA_LOST_FRAMES       3           // Car: beacons missed before it
+                                            // sends unscheduled
+
+#define TDMA_US_TICKS(us)      ((unsigned int)((unsigned long)(us)           \
+                                * Clock_AclkHz / 1000000) + 1)
+#define TDMA_GUARD_TICKS       CLOCK_ACLK_TICKS(TDMA_GUARD_MS)
+
+// Slot length in the profile in use, in ACLK ticks: the send window is
+// the first half, for a PKT_DONE and its ack between two guards
+#define TDMA_SLOT_TICKS()      (2 * (2*TDMA_GUARD_TICKS                       \
+                                + TDMA_US_TICKS(RFAirtimeUs(PKT_SIZE(PKT_DONE_LEN)) \
+                                                + RFAirtimeUs(PKT_SIZE(1)))))
+
+#if TDMA_ENABLE && (RF_WOR_SETTING != RF_WOR_OFF || RF_HOP_SEED)
+#error "TDMA needs the radio awake on one channel"
+#endif
+
+
+#if TDMA_ENABLE
+
+// SENDING VERSION
+void Tdma_Start(void);
+void Tdma_Join(char *, char);
+char Tdma_Heard(char);
+
+// RECEIVING VERSION
+void Tdma_Beacon(char *, char);
+char Tdma_MaySend(void);
+
+#else
+
+#define Tdma_Start()
+#define Tdma_Join(p, n)
+#define Tdma_Heard(car)
+#define Tdma_Beacon(p, n)
+#define Tdma_MaySend()         1
+
+#endif
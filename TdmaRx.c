@@ -0,0 +1,157 @@
+//----------------------------------------------------------------------------
+//  Description:  TDMA uplink schedule (RECEIVING VERSION), see Tdma.h
+//
+//  Runs from the PORT2 interrupt and the CLOCK_ALARM_FRAME alarm.  Each
+//  beacon sets the alarm for the start of our slot, or of the join slot,
+//  when there is something to send; otherwise, and after the slot, it
+//  watches for lost beacons.  Tdma_MaySend() tells main() whether the
+//  send window is open.
+//----------------------------------------------------------------------------
+
+
+#include "TI_CC/include.h"
+#include "Clock.h"
+#include "Protocol.h"
+#include "Tdma.h"
+
+#if TDMA_ENABLE
+
+static char synced = 0;                     // Clock ratio known, beacons heard
+static char haveLast = 0;
+static char lastSeq;
+static unsigned int lastRx;                 // Clock_Now() at the last beacon
+static unsigned int frameTicks;             // One frame in our ticks
+static unsigned int ratio = 256;            // Our ticks per 256 of the sender's
+static unsigned int slotStart;              // Our send window, in our ticks
+static unsigned int window;
+static volatile char mine = 0;              // The window is this frame's
+static char joining = 0;                    // The slot is the join slot
+static volatile char need = 0;              // Something waits for a slot
+static char join[PKT_SIZE(1)];
+
+
+// Sender ticks to ours
+static unsigned int scale(unsigned int ticks)
+{
+  return ((unsigned long)ticks * ratio) >> 8;
+}
+
+
+// CLOCK_ALARM_FRAME, TDMA_LOST_FRAMES after the last beacon: send freely
+static char lost(void)
+{
+  synced = 0;
+  haveLast = 0;
+  mine = 0;
+  return 1;                                 // main() may send now
+}
+
+// Watch for lost beacons from now on
+static void watch(void)
+{
+  Clock_Alarm(CLOCK_ALARM_FRAME,
+              lastRx + TDMA_LOST_FRAMES * frameTicks - Clock_Now(), lost);
+}
+
+
+// CLOCK_ALARM_FRAME at the start of our slot: open the window, or ask for
+// a slot
+static char slotOpen(void)
+{
+  watch();
+  if (joining)
+  {
+    join[0] = PKT_LEN(1);
+    join[1] = PKT_ADDR_SENDER;
+    join[2] = PKT_JOIN;
+    join[3] = RFAddress();
+    RFSendPacketAsync(join, PKT_SIZE(1));   // If busy, the next frame
+    return 0;
+  }
+  mine = 1;
+  return 1;                                 // main() sends now
+}
+
+
+//-----------------------------------------------------------------------------
+//  void Tdma_Beacon(char *payload, char length)
+//
+//  DESCRIPTION:
+//  Handles a PKT_BEACON from the PORT2 interrupt: learns how fast the
+//  sender's clock runs against ours, and sets the alarm for our slot, or
+//  for the join slot on the frames whose seq has the parity of our
+//  address, if something waits to be sent.
+//
+//  ARGUMENTS:
+//      char *payload
+//          [seq] [frame lo] [frame hi] [slot lo] [slot hi] [n] [car ...]
+//-----------------------------------------------------------------------------
+void Tdma_Beacon(char *payload, char length)
+{
+  unsigned int now = Clock_Now();
+  unsigned int frame, slot;
+  char n, k;
+
+  if (length < PKT_BEACON_HDR)
+    return;
+  n = payload[5];
+  if (length < PKT_BEACON_HDR + n)
+    return;
+  frame = (unsigned char)payload[1]
+        | ((unsigned int)(unsigned char)payload[2] << 8);
+  slot = (unsigned char)payload[3]
+       | ((unsigned int)(unsigned char)payload[4] << 8);
+
+  if (haveLast && payload[0] == (char)(lastSeq + 1) && frame)
+  {
+    frameTicks = now - lastRx;
+    ratio = ((unsigned long)frameTicks << 8) / frame;
+    synced = 1;
+  }
+  haveLast = 1;
+  lastSeq = payload[0];
+  lastRx = now;
+  mine = 0;
+  if (!synced)
+    return;
+
+  for (k = 0; k < n && payload[PKT_BEACON_HDR+k] != RFAddress(); k++);
+  joining = k == n;
+  if (!need || (joining && ((lastSeq ^ RFAddress()) & 1)))
+  {                                         // Nothing to send, or not this
+                                            // frame
+    watch();
+    return;
+  }
+  slotStart = now + scale(k * slot + TDMA_GUARD_TICKS);
+  window = scale(slot / 2 - TDMA_GUARD_TICKS);
+  Clock_Alarm(CLOCK_ALARM_FRAME, slotStart - now, slotOpen);
+}
+
+
+//-----------------------------------------------------------------------------
+//  char Tdma_MaySend(void)
+//
+//  DESCRIPTION:
+//  Tells main() whether an uplink packet may go out now: in the send window
+//  of our slot, or at any time without beacons.  A "no" asks for the slot.
+//
+//  RETURN VALUE:
+//      char
+//          1:  Send now
+//          0:  Wait; the CLOCK_ALARM_FRAME alarm wakes main() for the slot
+//-----------------------------------------------------------------------------
+char Tdma_MaySend(void)
+{
+  if (!synced)
+    return 1;
+  if (mine && Clock_Now() - slotStart < window)
+  {
+    need = 0;
+    return 1;
+  }
+  need = 1;
+  return 0;
+}
+
+#endif
@@ -0,0 +1,115 @@
+//----------------------------------------------------------------------------
+//  Description:  TDMA uplink schedule (SENDING VERSION), see Tdma.h
+//
+//  The beacon goes out from the CLOCK_ALARM_FRAME alarm.  Before each one
+//  the slot table is re-planned: cars gone quiet drop out and the rest move
+//  up, and cars that joined in the last frame are already at the end.
+//----------------------------------------------------------------------------
+
+
+#include "TI_CC/include.h"
+#include "Clock.h"
+#include "Protocol.h"
+#include "Tdma.h"
+
+#if TDMA_ENABLE
+
+static char cars[TDMA_MAX_CARS];            // Slot owners, in slot order
+static unsigned char idle[TDMA_MAX_CARS];   // Frames since each was heard
+static char numCars = 0;
+static char seq = 0;
+static unsigned int lastBeacon;             // Clock_Now() at the last beacon
+static char beacon[PKT_SIZE(PKT_BEACON_HDR + TDMA_MAX_CARS)];
+
+
+// Drop the cars not heard from for TDMA_IDLE_FRAMES, keeping the order
+static void replan(void)
+{
+  char i, n = 0;
+
+  for (i = 0; i < numCars; i++)
+    if (++idle[i] <= TDMA_IDLE_FRAMES)
+    {
+      cars[n] = cars[i];
+      idle[n] = idle[i];
+      n++;
+    }
+  numCars = n;
+}
+
+
+// CLOCK_ALARM_FRAME: put the beacon on the air and time the next one.  A
+// busy radio puts it off by a guard time.
+static char sendBeacon(void)
+{
+  unsigned int now, slot, frame, need;
+  char size, i;
+
+  if (RFTxBusy())
+  {
+    Clock_Alarm(CLOCK_ALARM_FRAME, TDMA_GUARD_TICKS, sendBeacon);
+    return 0;
+  }
+  replan();
+  size = PKT_SIZE(PKT_BEACON_HDR + numCars);
+  slot = TDMA_SLOT_TICKS();
+  now = Clock_Now();
+
+  beacon[0] = PKT_LEN(PKT_BEACON_HDR + numCars);
+  beacon[1] = PKT_ADDR_ALL;
+  beacon[2] = PKT_BEACON;
+  beacon[3] = ++seq;
+  beacon[4] = (now - lastBeacon) & 0xFF;    // The frame just ended, in our
+  beacon[5] = (now - lastBeacon) >> 8;      // ticks
+  beacon[6] = slot & 0xFF;
+  beacon[7] = slot >> 8;
+  beacon[8] = numCars;
+  for (i = 0; i < numCars; i++)
+    beacon[9+i] = cars[i];
+  RFSendPacketNoCca(beacon, size);          // On the air now, as timed
+  lastBeacon = now;
+
+  frame = CLOCK_ACLK_TICKS(TDMA_FRAME_MS);
+  need = TDMA_US_TICKS(RFAirtimeUs(size)) + (numCars + 1) * slot
+       + TDMA_GUARD_TICKS;
+  Clock_Alarm(CLOCK_ALARM_FRAME, frame > need ? frame : need, sendBeacon);
+  return 0;
+}
+
+
+// Start beaconing; the radio must be set up
+void Tdma_Start(void)
+{
+  lastBeacon = Clock_Now();
+  Clock_Alarm(CLOCK_ALARM_FRAME, CLOCK_ACLK_TICKS(TDMA_FRAME_MS), sendBeacon);
+}
+
+
+// PKT_JOIN payload from the PORT2 interrupt: [car].  The car gets the next
+// free slot from the next beacon on, unless it holds one or all are taken.
+void Tdma_Join(char *payload, char length)
+{
+  if (length < 1 || !PKT_ADDR_UNIT(payload[0]) || Tdma_Heard(payload[0])
+      || numCars == TDMA_MAX_CARS)
+    return;
+  cars[numCars] = payload[0];
+  idle[numCars] = 0;
+  numCars++;
+}
+
+
+// A car was heard from: it keeps its slot.  Returns 0 if it has none.
+char Tdma_Heard(char car)
+{
+  char i;
+
+  for (i = 0; i < numCars; i++)
+    if (cars[i] == car)
+    {
+      idle[i] = 0;
+      return 1;
+    }
+  return 0;
+}
+
+#endif
@@ -0,0 +1,64 @@
+//----------------------------------------------------------------------------
+//  Description:  Hot-path tracing into a RAM ring buffer
+//----------------------------------------------------------------------------
+
+
+#include "TI_CC/include.h"
+#include "Trace.h"
+
+#if TRACE_ENABLE
+
+Trace_Entry Trace_Ring[TRACE_SIZE];
+unsigned char Trace_Head = 0;
+
+
+// Timer_B continuous from SMCLK: the trace timestamp
+void Trace_Init(void)
+{
+  TBCTL = TBSSEL_2 + MC_2 + TBCLR;          // SMCLK, continuous mode
+}
+
+
+//-----------------------------------------------------------------------------
+//  char Trace_Dump(char *buffer)
+//
+//  DESCRIPTION:
+//  Copies the ring, oldest entry first, into "buffer" in the HOST_TRACE
+//  payload layout and empties it:
+//
+//      [TI_CC_MCLK_MHZ] then per entry [event] [arg] [time lo] [time hi]
+//
+//  Unused entries are left out.  Tracing goes on while the dump is sent.
+//
+//  ARGUMENTS:
+//      char *buffer
+//          At least TRACE_DUMP_LEN bytes
+//
+//  RETURN VALUE:
+//      char
+//          Bytes written
+//-----------------------------------------------------------------------------
+char Trace_Dump(char *buffer)
+{
+  __istate_t s = __get_interrupt_state();
+  unsigned char i, k;
+  char n = 1;
+
+  buffer[0] = TI_CC_MCLK_MHZ;
+  __disable_interrupt();
+  for (i = 0; i < TRACE_SIZE; i++)
+  {
+    k = (Trace_Head + i) & (TRACE_SIZE - 1);
+    if (Trace_Ring[k].event == TRACE_NONE)
+      continue;
+    buffer[n++] = Trace_Ring[k].event;
+    buffer[n++] = Trace_Ring[k].arg;
+    buffer[n++] = Trace_Ring[k].time & 0xFF;
+    buffer[n++] = Trace_Ring[k].time >> 8;
+    Trace_Ring[k].event = TRACE_NONE;
+  }
+  __set_interrupt_state(s);
+  return n;
+}
+
+#endif
@@ -0,0 +1,89 @@
+//----------------------------------------------------------------------------
+//  Description:  Hot-path tracing into a RAM ring buffer
+//
+//  TRACE(event, arg) stores the event, an argument byte and a timestamp in
+//  a ring of TRACE_SIZE entries, overwriting the oldest.  The trace points
+//  are:
+//
+//      event               arg                     where
+//      TRACE_ALARM         ACLK ticks late         Timer_A1 ISR entry
+//      TRACE_TIMER0        ACLK ticks late         Timer_A0 ISR entry
+//      TRACE_TIMER0_END    0                       Timer_A0 ISR exit (one
+//                                                  motion step or PKT_DRIVE)
+//      TRACE_GDO0          0                       PORT2 ISR entry
+//      TRACE_GDO0_END      RFGDO0Event() result    PORT2 ISR exit
+//      TRACE_SPI           header byte             SPI transaction start
+//      TRACE_SPI_END       chip status             SPI transaction end
+//      TRACE_TX_WAIT       packet size             RFSendPacket() waits on
+//      TRACE_TX_WAIT_END   0                       GDO0
+//
+//  Timer_A runs from the 12 kHz VLO (Clock.h), too coarse for an SPI burst
+//  of a few tens of us, so the timestamp is Timer_B counting SMCLK: one tick
+//  per MCLK cycle at TI_CC_MCLK_MHZ, wrapping every 65536 cycles.  ISR entry
+//  latency is in the arg of the Timer_A events, as the alarm's lateness in
+//  ACLK ticks.  SMCLK stops in LPM3, so with TRACE_ENABLE the car sleeps in
+//  LPM0 instead to keep Timer_B and its UART running.
+//
+//  TRACE() takes about 15 cycles with TRACE_ENABLE set and compiles to
+//  nothing otherwise.  The HOST_TRACE frame (HostLink.h) dumps the ring to
+//  the GUI, which turns it into per-event latency histograms (CarGui.m).
+//----------------------------------------------------------------------------
+
+
+#ifndef TRACE_ENABLE
+#define TRACE_ENABLE           0
+#endif
+
+#define TRACE_SIZE             32          // Entries, must be a power of 2
+#define TRACE_DUMP_LEN         (1 + 4*TRACE_SIZE) // HOST_TRACE payload
+
+// Events; a _END event closes the interval its begin event opened
+#define TRACE_NONE             0           // Unused ring entry
+#define TRACE_ALARM            1
+#define TRACE_TIMER0           2
+#define TRACE_TIMER0_END       3
+#define TRACE_GDO0             4
+#define TRACE_GDO0_END         5
+#define TRACE_SPI              6
+#define TRACE_SPI_END          7
+#define TRACE_TX_WAIT          8
+#define TRACE_TX_WAIT_END      9
+
+
+#if TRACE_ENABLE
+
+typedef struct
+{
+  char event;
+  char arg;
+  unsigned int time;                        // Timer_B, MCLK cycles
+} Trace_Entry;
+
+extern Trace_Entry Trace_Ring[TRACE_SIZE];
+extern unsigned char Trace_Head;
+
+// Inline so a trace point costs a few cycles and no call
+#define TRACE(ev, a)                                                          \
+  do {                                                                        \
+    __istate_t trace_s = __get_interrupt_state();                             \
+    __disable_interrupt();                                                    \
+    Trace_Ring[Trace_Head].time = TBR;                                        \
+    Trace_Ring[Trace_Head].event = (ev);                                      \
+    Trace_Ring[Trace_Head].arg = (a);                                         \
+    Trace_Head = (Trace_Head + 1) & (TRACE_SIZE - 1);                         \
+    __set_interrupt_state(trace_s);                                           \
+  } while (0)
+
+// ACLK ticks since Timer_A compare register "ccr" matched, up to 255
+#define TRACE_LATE(ccr)        (TAR - (ccr) > 255 ? 255 : (char)(TAR - (ccr)))
+
+void Trace_Init(void);
+char Trace_Dump(char *);
+
+#else
+
+#define TRACE(ev, a)
+#define TRACE_LATE(ccr)        0
+#define Trace_Init()
+
+#endif
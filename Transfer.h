@@ -0,0 +1,62 @@
+//----------------------------------------------------------------------------
+//  Description:  Fragmented program transfer over the radio
+//
+//  The SENDING VERSION (TransferTx.c) sends a whole program as a burst of
+//  PKT_FRAG packets and resends whatever the car's PKT_FRAG_ACK bitmap says
+//  is missing.  The RECEIVING VERSION (TransferRx.c) reassembles the
+//  fragments straight into an idle Motion slot and commits the program once
+//  every fragment is in.  The car reports each finished program with a
+//  PKT_DONE that it repeats until acknowledged.  A modem profile change is
+//  agreed on the same way as a program, with PKT_PROFILE in place of the
+//  fragments, and so are a run of a cached program, with PKT_RUN, and a new
+//  car address, with PKT_ADDRESS.  The packet layout is in Protocol.h.
+//----------------------------------------------------------------------------
+
+
+#define TRANSFER_ACK_MS        20          // Wait for an ack, beyond the
+                                            // airtime of the packet and ack
+
+// Ack timeout in ACLK ticks after starting a packet of "sent" bytes that
+// is answered with one of "reply" bytes, in the modem profile in use
+#define TRANSFER_ACK_TICKS(sent, reply) \
+        CLOCK_ACLK_TICKS(TRANSFER_ACK_MS + (RFAirtimeUs(sent)                 \
+                                            + RFAirtimeUs(reply)) / 1000)
+#define TRANSFER_MAX_ROUNDS    8           // Bursts (or PKT_DONE repeats)
+                                            // before giving up
+
+// Transfer_Poll() results
+#define TRANSFER_IDLE          0
+#define TRANSFER_BUSY          1
+#define TRANSFER_DONE          2           // The car holds the whole program
+#define TRANSFER_FAILED        3
+#define TRANSFER_MISS          4           // The car has no such program
+
+
+// SENDING VERSION
+char Transfer_Start(char *, unsigned int);
+char Transfer_Poll(void);
+char Transfer_Ready(void);
+void Transfer_Acked(char *, char);
+char Transfer_Report(char *, char);
+char Transfer_Reported(void);
+char Transfer_CarLink(char *);
+char Transfer_SetProfile(char);
+void Transfer_ProfileAcked(char *, char);
+char Transfer_Run(unsigned int, char);
+void Transfer_RunAcked(char *, char);
+char Transfer_SetTarget(char, char);
+char Transfer_Target(void);
+char Transfer_Header(char *, char, char);
+char Transfer_SetAddress(char, char);
+void Transfer_AddressAcked(char *, char);
+
+// RECEIVING VERSION
+void Transfer_Fragment(char *, char);
+void Transfer_SendReports(void);
+char Transfer_Reporting(void);
+void Transfer_ReportAcked(char *, char);
+void Transfer_Profile(char *, char);
+void Transfer_TxDone(void);
+void Transfer_RunCached(char *, char);
+void Transfer_Address(char *, char);
+char Transfer_Groups(void);
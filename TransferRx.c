@@ -0,0 +1,323 @@
+//----------------------------------------------------------------------------
+//  Description:  Fragmented program transfer (RECEIVING VERSION)
+//
+//  Runs from the PORT2 interrupt.  The first fragment of a new program id
+//  claims the idle Motion slot and the data of every fragment is copied to
+//  its place in it.  Once all fragments are in, the program is committed
+//  and acknowledged.  Fragments of the program committed last are only
+//  acknowledged again, so a lost final ack cannot run a program twice.
+//
+//  Finished programs are reported from main() with PKT_DONE, one at a
+//  time, repeated on the CLOCK_ALARM_LINK alarm until acknowledged.  With
+//  TDMA_ENABLE each goes out in the car's slot (Tdma.h).
+//
+//  A PKT_PROFILE is answered in the current modem profile, and the switch
+//  is made once the answer has gone out.
+//
+//  Every program received in full is offered to the flash cache, and a
+//  PKT_RUN runs one from there into the idle slot with no fragments.
+//
+//  A PKT_ADDRESS moves the car to its new address and groups at once; the
+//  answer goes out from there.
+//----------------------------------------------------------------------------
+
+
+#include "TI_CC/include.h"
+#include "Clock.h"
+#include "Motion.h"
+#include "Protocol.h"
+#include "Transfer.h"
+#include "Cache.h"
+#include "Tdma.h"
+
+static char *buf;                           // Claimed Motion slot
+static char open = 0;                       // A program is being reassembled
+static char curId;
+static unsigned int total;
+static char have;                           // Fragments received
+static char doneId;                         // Last program committed
+static char haveDone = 0;
+static char ack[PKT_SIZE(2)];
+
+// PKT_DONE reports
+#define RPT_IDLE               0
+#define RPT_SEND               1           // Put it on the air
+#define RPT_WAIT               2           // Waiting for PKT_DONE_ACK
+static volatile char reportState = RPT_IDLE;
+static char reportSeq = 0;
+static char reportTries;
+static char report[PKT_SIZE(PKT_DONE_LEN)];
+
+// PKT_PROFILE
+static char profileAck[PKT_SIZE(1)];
+static volatile char switchPending = 0;
+static char switchTo;
+
+// PKT_RUN
+static char runAck[PKT_SIZE(2)];
+
+// PKT_ADDRESS
+static char groups = PKT_GROUPS_CAR;
+static char addressAck[PKT_SIZE(2)];
+
+
+// Answer with the bitmap of fragments held.  If the radio is busy the ack
+// is dropped and the sender's timeout covers it.
+static void sendAck(char fid, char bitmap)
+{
+  ack[0] = PKT_LEN(2);
+  ack[1] = PKT_ADDR_SENDER;
+  ack[2] = PKT_FRAG_ACK;
+  ack[3] = fid;
+  ack[4] = bitmap;
+  RFSendPacketAsync(ack, PKT_SIZE(2));
+}
+
+
+//-----------------------------------------------------------------------------
+//  void Transfer_Fragment(char *payload, char length)
+//
+//  DESCRIPTION:
+//  Handles one PKT_FRAG packet.  Fragments that don't agree with the
+//  program being reassembled, or with their own header, are dropped.
+//
+//  ARGUMENTS:
+//      char *payload
+//          The packet after its address and type bytes
+//      char length
+//          Bytes in payload
+//-----------------------------------------------------------------------------
+void Transfer_Fragment(char *payload, char length)
+{
+  char fid, index, ackReq;
+  unsigned int size, off, n;
+  char frags, all, i;
+
+  if (length < PKT_FRAG_HDR)                // Header bytes not all there
+    return;
+  fid = payload[0];
+  index = payload[1] & ~PKT_ACK_REQ;
+  ackReq = payload[1] & PKT_ACK_REQ;
+  size = (unsigned char)payload[2]
+       | ((unsigned int)(unsigned char)payload[3] << 8);
+  if (size > MOTION_MAX_INSTR)              // Before the shift below
+    return;
+  frags = (size + PKT_FRAG_DATA - 1) / PKT_FRAG_DATA;
+  if (!frags)
+    frags = 1;
+  all = (1 << frags) - 1;
+  off = (unsigned int)index * PKT_FRAG_DATA;
+  n = size - off;
+  if (n > PKT_FRAG_DATA)
+    n = PKT_FRAG_DATA;
+  if (index >= frags || length - PKT_FRAG_HDR != n)
+    return;
+
+  if (haveDone && fid == doneId)            // Already running it
+  {
+    if (ackReq)
+      sendAck(fid, all);
+    return;
+  }
+
+  if (!open || fid != curId || size != total)
+  {
+    buf = Motion_Claim();
+    if (!buf)                               // Still busy: nothing held yet
+    {
+      if (ackReq)
+        sendAck(fid, 0);
+      return;
+    }
+    Cache_Claimed(buf);
+    open = 1;
+    curId = fid;
+    total = size;
+    have = 0;
+  }
+
+  for (i = 0; i < n; i++)
+    buf[off+i] = payload[PKT_FRAG_HDR+i];
+  have |= 1 << index;
+
+  if (have == all)
+  {
+    Motion_Commit(total);
+    Cache_Offer(buf, total);                // Stored from main()
+    open = 0;
+    doneId = fid;
+    haveDone = 1;
+    sendAck(fid, have);
+  }
+  else if (ackReq)
+    sendAck(fid, have);
+}
+
+
+// No PKT_DONE_ACK in time: send the report again, or drop it
+static char reportTimeout(void)
+{
+  if (++reportTries >= TRANSFER_MAX_ROUNDS)
+    reportState = RPT_IDLE;
+  else
+    reportState = RPT_SEND;
+  return 1;
+}
+
+
+//-----------------------------------------------------------------------------
+//  void Transfer_SendReports(void)
+//
+//  DESCRIPTION:
+//  Sends a PKT_DONE for each program Motion has finished, stop-and-wait.
+//  Call it from main() whenever Transfer_Reporting() says there is work.
+//-----------------------------------------------------------------------------
+void Transfer_SendReports(void)
+{
+  if (reportState == RPT_IDLE)
+  {
+    if (!Motion_Done())
+      return;
+    reportSeq++;
+    reportTries = 0;
+    reportState = RPT_SEND;
+  }
+  if (reportState != RPT_SEND || !Tdma_MaySend())
+    return;
+
+  report[0] = PKT_LEN(PKT_DONE_LEN);
+  report[1] = PKT_ADDR_SENDER;
+  report[2] = PKT_DONE;
+  report[3] = reportSeq;
+  RFLinkReport(&report[4]);                 // How the car hears the sender
+  report[4+RF_LINK_REPORT_LEN] = RFAddress(); // ...and who is reporting
+  _DINT();                                  // The ack can't beat RPT_WAIT
+  if (RFSendPacketAsync(report, PKT_SIZE(PKT_DONE_LEN)))
+  {
+    reportState = RPT_WAIT;
+    Clock_Alarm(CLOCK_ALARM_LINK,
+                TRANSFER_ACK_TICKS(PKT_SIZE(PKT_DONE_LEN), PKT_SIZE(1)),
+                reportTimeout);
+  }
+  _EINT();
+}
+
+
+// Non-zero if Transfer_SendReports() has something to do now
+char Transfer_Reporting(void)
+{
+  if (reportState == RPT_IDLE)
+    return Motion_Finished();
+  return reportState == RPT_SEND && !RFTxBusy() && Tdma_MaySend();
+}
+
+
+// PKT_DONE_ACK payload from the PORT2 interrupt: [seq]
+void Transfer_ReportAcked(char *payload, char length)
+{
+  if (length < 1 || reportState != RPT_WAIT || payload[0] != reportSeq)
+    return;
+  Clock_Cancel(CLOCK_ALARM_LINK);
+  reportState = RPT_IDLE;
+}
+
+
+// PKT_PROFILE payload from the PORT2 interrupt: [profile].  If the radio is
+// busy nothing is answered and the sender asks again.
+void Transfer_Profile(char *payload, char length)
+{
+  if (length < 1 || payload[0] >= RF_NUM_PROFILES)
+    return;
+  profileAck[0] = PKT_LEN(1);
+  profileAck[1] = PKT_ADDR_SENDER;
+  profileAck[2] = PKT_PROFILE_ACK;
+  profileAck[3] = payload[0];
+  if (RFSendPacketAsync(profileAck, PKT_SIZE(1)))
+  {
+    switchTo = payload[0];
+    switchPending = 1;
+  }
+}
+
+
+// A send completed (PORT2 interrupt): make a pending profile switch
+void Transfer_TxDone(void)
+{
+  if (switchPending)
+  {
+    switchPending = 0;
+    RFSetProfile(switchTo);
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+//  void Transfer_RunCached(char *payload, char length)
+//
+//  DESCRIPTION:
+//  Handles a PKT_RUN: copies the program with that hash and length from
+//  the flash cache into the idle Motion slot and commits it, and answers
+//  whether it did.  A repeat of the id run last is only answered again.
+//  With no idle slot nothing is answered and the sender asks again.
+//
+//  ARGUMENTS:
+//      char *payload
+//          [id] [hash lo] [hash hi] [length]
+//-----------------------------------------------------------------------------
+void Transfer_RunCached(char *payload, char length)
+{
+  unsigned int hash;
+  char *slot;
+  char hit = 1;
+
+  if (length < PKT_RUN_LEN)
+    return;
+  if (!haveDone || payload[0] != doneId)
+  {
+    slot = Motion_Claim();
+    if (!slot)
+      return;
+    Cache_Claimed(slot);
+    hash = (unsigned char)payload[1]
+         | ((unsigned int)(unsigned char)payload[2] << 8);
+    hit = Cache_Copy(hash, (unsigned char)payload[3], slot);
+    if (hit)
+    {
+      Motion_Commit((unsigned char)payload[3]);
+      open = 0;                             // The slot held any fragments
+      doneId = payload[0];
+      haveDone = 1;
+    }
+  }
+
+  runAck[0] = PKT_LEN(2);
+  runAck[1] = PKT_ADDR_SENDER;
+  runAck[2] = PKT_RUN_ACK;
+  runAck[3] = payload[0];
+  runAck[4] = hit;
+  RFSendPacketAsync(runAck, PKT_SIZE(2));   // If busy, the sender asks again
+}
+
+
+// PKT_ADDRESS payload from the PORT2 interrupt: [address] [groups].  Taken
+// at once; if the radio is busy nothing is answered and the sender asks
+// again, at the new address on its odd rounds.
+void Transfer_Address(char *payload, char length)
+{
+  if (length < 2 || !PKT_ADDR_UNIT(payload[0]))
+    return;
+  RFSetAddress(payload[0]);
+  groups = payload[1];
+  addressAck[0] = PKT_LEN(2);
+  addressAck[1] = PKT_ADDR_SENDER;
+  addressAck[2] = PKT_ADDRESS_ACK;
+  addressAck[3] = payload[0];
+  addressAck[4] = payload[1];
+  RFSendPacketAsync(addressAck, PKT_SIZE(2));
+}
+
+// This car's group bitmap, for PKT_ADDR_GROUP packets
+char Transfer_Groups(void)
+{
+  return groups;
+}
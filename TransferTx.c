@@ -0,0 +1,581 @@
+//----------------------------------------------------------------------------
+//  Description:  Fragmented program transfer (SENDING VERSION)
+//
+//  Transfer_Start() takes the program; Transfer_Poll(), run from main(),
+//  puts one fragment on the air each time the radio is free.  The last
+//  fragment of every burst carries PKT_ACK_REQ and arms the
+//  CLOCK_ALARM_LINK alarm.  The next burst, made of the fragments the car
+//  has not acknowledged, starts when the ack arrives or the alarm fires.
+//
+//  Transfer_SetProfile() runs a modem profile change through the same
+//  rounds: a single PKT_PROFILE stands in for the fragments, sent in the
+//  old profile on even rounds and in the new one on odd rounds.
+//  Transfer_Run() does the same with a PKT_RUN for a cached program, and
+//  Transfer_SetAddress() with a PKT_ADDRESS, sent at the old address on
+//  even rounds and at the new one on odd rounds.
+//
+//  Every packet goes to the target set by Transfer_SetTarget(), which must
+//  be a single car for anything but Stream.c's PKT_DRIVE.  Reports are
+//  answered whichever car sends them.
+//----------------------------------------------------------------------------
+
+
+#include "TI_CC/include.h"
+#include "Clock.h"
+#include "Protocol.h"
+#include "Transfer.h"
+#include "Tdma.h"
+
+#define EV_ACK                 0x01
+#define EV_TIMEOUT             0x02
+
+// What the transfer carries
+#define KIND_PROGRAM           0           // PKT_FRAG
+#define KIND_PROFILE           1           // PKT_PROFILE
+#define KIND_RUN               2           // PKT_RUN
+#define KIND_ADDRESS           3           // PKT_ADDRESS
+
+#define REPORT_CARS            4           // Cars whose last PKT_DONE is kept
+#define REPORT_QUEUE           4           // New PKT_DONEs main() has not
+                                            // forwarded yet
+
+static char *prog;
+static unsigned int total;                  // Program length in bytes
+static char id;                             // Program id, seeded at first use
+static char seeded = 0;
+static char pending;                        // Fragments not acknowledged yet
+static char toSend;                         // Fragments left in this burst
+static char rounds;
+static char state = TRANSFER_IDLE;
+static volatile char acked;                 // Bitmaps from PKT_FRAG_ACK
+static volatile char event;
+static char pkt[PKT_SIZE(PKT_FRAG_HDR + PKT_FRAG_DATA)];
+static char kind = KIND_PROGRAM;
+static char target = PKT_ADDR_CAR;          // Where packets go
+static char targetGroups = 0;               // ...with PKT_ADDR_GROUP
+static char reportCar[REPORT_CARS];         // Cars heard from last, and the
+static char reportSeq[REPORT_CARS];         // seq of each one's PKT_DONE
+static char reportCars = 0;                 // Entries used
+static char reportNext = 0;                 // Entry to replace next
+static char queueCar[REPORT_QUEUE];         // Ring of new PKT_DONEs: the car
+static char queueLink[REPORT_QUEUE][RF_LINK_REPORT_LEN]; // ...and its report
+static char queueHead = 0;                  // Oldest entry
+static volatile char queued = 0;            // Entries used
+static char reportAck[PKT_SIZE(1)];
+static char newProfile;
+static char oldProfile;
+static unsigned int runHash;
+static char runLen;
+static volatile char missed;                // PKT_RUN_ACK: not cached
+static char newAddr;                        // PKT_ADDRESS
+static char newGroups;
+
+
+// No PKT_FRAG_ACK in time after a burst
+static char ackTimeout(void)
+{
+  RFHopResult(0);
+  event |= EV_TIMEOUT;
+  return 1;
+}
+
+
+// Put fragment "index" on the air; returns 0 if the radio was busy
+static char sendFragment(char index, char last)
+{
+  unsigned int off = (unsigned int)index * PKT_FRAG_DATA;
+  unsigned int n = total - off;
+  char i;
+
+  if (n > PKT_FRAG_DATA)
+    n = PKT_FRAG_DATA;
+  Transfer_Header(pkt, PKT_FRAG, PKT_FRAG_HDR + n);
+  pkt[3] = id;
+  pkt[4] = last ? index | PKT_ACK_REQ : index;
+  pkt[5] = total & 0xFF;
+  pkt[6] = total >> 8;
+  for (i = 0; i < n; i++)
+    pkt[7+i] = prog[off+i];
+
+  if (!RFSendPacketAsync(pkt, PKT_SIZE(PKT_FRAG_HDR + n)))
+    return 0;
+  if (last)
+    Clock_Alarm(CLOCK_ALARM_LINK,
+                TRANSFER_ACK_TICKS(PKT_SIZE(PKT_FRAG_HDR + n), PKT_SIZE(2)),
+                ackTimeout);
+  return 1;
+}
+
+
+// Ask the car to run the cached program; returns 0 if the radio was busy
+static char sendRun(void)
+{
+  Transfer_Header(pkt, PKT_RUN, PKT_RUN_LEN);
+  pkt[3] = id;
+  pkt[4] = runHash & 0xFF;
+  pkt[5] = runHash >> 8;
+  pkt[6] = runLen;
+  if (!RFSendPacketAsync(pkt, PKT_SIZE(PKT_RUN_LEN)))
+    return 0;
+  Clock_Alarm(CLOCK_ALARM_LINK,
+              TRANSFER_ACK_TICKS(PKT_SIZE(PKT_RUN_LEN), PKT_SIZE(2)),
+              ackTimeout);
+  return 1;
+}
+
+
+// Next program id
+static void nextId(void)
+{
+  if (!seeded)                              // A sender reset must not reuse
+  {                                         // the id the car saw last
+    id = (char)Clock_Now();
+    seeded = 1;
+  }
+  id++;
+}
+
+
+// Ask for the new profile, in the old or the new one by turns; returns 0
+// if the radio was busy
+static char sendProfile(void)
+{
+  RFSetProfile(rounds & 1 ? newProfile : oldProfile);
+  Transfer_Header(pkt, PKT_PROFILE, 1);
+  pkt[3] = newProfile;
+  if (!RFSendPacketAsync(pkt, PKT_SIZE(1)))
+    return 0;
+  Clock_Alarm(CLOCK_ALARM_LINK, TRANSFER_ACK_TICKS(PKT_SIZE(1), PKT_SIZE(1)),
+              ackTimeout);
+  return 1;
+}
+
+
+// Give the car its new address, asking at the old or the new one by turns;
+// returns 0 if the radio was busy
+static char sendAddress(void)
+{
+  Transfer_Header(pkt, PKT_ADDRESS, 2);
+  if (rounds & 1)
+    pkt[1] = newAddr;
+  pkt[3] = newAddr;
+  pkt[4] = newGroups;
+  if (!RFSendPacketAsync(pkt, PKT_SIZE(2)))
+    return 0;
+  Clock_Alarm(CLOCK_ALARM_LINK, TRANSFER_ACK_TICKS(PKT_SIZE(2), PKT_SIZE(2)),
+              ackTimeout);
+  return 1;
+}
+
+
+// Put the next packet of a single-packet transfer on the air
+static char sendOne(void)
+{
+  switch (kind)
+  {
+  case KIND_PROFILE:
+    return sendProfile();
+  case KIND_RUN:
+    return sendRun();
+  default:
+    return sendAddress();
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+//  char Transfer_Start(char *program, unsigned int length)
+//
+//  DESCRIPTION:
+//  Starts sending a program under a new id.  The buffer must stay untouched
+//  until Transfer_Poll() reports TRANSFER_DONE or TRANSFER_FAILED.
+//
+//  RETURN VALUE:
+//      char
+//          1:  Transfer started
+//          0:  Another transfer is running, the program is longer than
+//              PKT_PROG_MAX, or the target is not a single car
+//-----------------------------------------------------------------------------
+char Transfer_Start(char *program, unsigned int length)
+{
+  char frags;
+
+  if (state == TRANSFER_BUSY || length > PKT_PROG_MAX
+      || !PKT_ADDR_UNIT(target))
+    return 0;
+  nextId();
+
+  frags = (length + PKT_FRAG_DATA - 1) / PKT_FRAG_DATA;
+  if (!frags)
+    frags = 1;                              // Empty program: one empty fragment
+  kind = KIND_PROGRAM;
+  prog = program;
+  total = length;
+  pending = toSend = (1 << frags) - 1;
+  rounds = 0;
+  acked = event = missed = 0;
+  state = TRANSFER_BUSY;
+  return 1;
+}
+
+
+//-----------------------------------------------------------------------------
+//  char Transfer_Poll(void)
+//
+//  DESCRIPTION:
+//  Moves the transfer on: sends the next fragment if the radio is free, and
+//  starts a new burst of the missing fragments after an ack or a timeout.
+//  Call it from main() whenever Transfer_Ready() says there is work.
+//
+//  RETURN VALUE:
+//      char
+//          TRANSFER_BUSY, or TRANSFER_DONE / TRANSFER_FAILED /
+//          TRANSFER_MISS once at the end of a transfer, TRANSFER_IDLE
+//          otherwise
+//-----------------------------------------------------------------------------
+char Transfer_Poll(void)
+{
+  char ev, bit, miss;
+
+  if (state != TRANSFER_BUSY)
+    return TRANSFER_IDLE;
+
+  _DINT();
+  ev = event;
+  event = 0;
+  pending &= ~acked;
+  acked = 0;
+  miss = missed;
+  _EINT();
+
+  if (miss)                                 // Not cached: the GUI uploads it
+  {
+    state = TRANSFER_IDLE;
+    return TRANSFER_MISS;
+  }
+  if (!pending)
+  {
+    Clock_Cancel(CLOCK_ALARM_LINK);
+    if (kind == KIND_PROFILE)               // The car has switched, or will
+      while (!RFSetProfile(newProfile));    // once its answer is sent
+    if (kind == KIND_ADDRESS)               // The car answers there now
+      target = newAddr;
+    state = TRANSFER_IDLE;
+    return TRANSFER_DONE;
+  }
+  if (ev)                                   // Burst over: resend the rest
+  {
+    if (++rounds >= TRANSFER_MAX_ROUNDS)
+    {
+      Clock_Cancel(CLOCK_ALARM_LINK);
+      if (kind == KIND_PROFILE)
+        while (!RFSetProfile(oldProfile));
+      state = TRANSFER_IDLE;
+      return TRANSFER_FAILED;
+    }
+    toSend = pending;
+  }
+
+  if (kind != KIND_PROGRAM)
+  {
+    if (toSend && !RFTxBusy() && sendOne())
+      toSend = 0;
+  }
+  else if (toSend && !RFTxBusy())
+  {
+    for (bit = 0; !(toSend & (1 << bit)); bit++);
+    if (sendFragment(bit, !(toSend & ~(1 << bit))))
+      toSend &= ~(1 << bit);
+  }
+  return TRANSFER_BUSY;
+}
+
+
+// Non-zero if Transfer_Poll() has something to do now
+char Transfer_Ready(void)
+{
+  return state == TRANSFER_BUSY && (event || acked || (toSend && !RFTxBusy()));
+}
+
+
+// PKT_FRAG_ACK payload from the PORT2 interrupt: [id] [bitmap]
+void Transfer_Acked(char *payload, char length)
+{
+  if (state != TRANSFER_BUSY || kind != KIND_PROGRAM || length < 2
+      || payload[0] != id)
+    return;
+  Clock_Cancel(CLOCK_ALARM_LINK);
+  RFHopResult(1);
+  acked |= payload[1];
+  event |= EV_ACK;
+}
+
+
+//-----------------------------------------------------------------------------
+//  char Transfer_Report(char *payload, char length)
+//
+//  DESCRIPTION:
+//  Handles a PKT_DONE from the PORT2 interrupt: acknowledges it to the car
+//  that sent it, and tells whether it is new.  A repeat (the car missed our
+//  PKT_DONE_ACK) is only acknowledged again; the last seq of each of the
+//  REPORT_CARS cars heard from last is kept to tell.  The car's address and
+//  link report of a new one are queued for Transfer_CarLink(); with the
+//  queue full a new one is not acknowledged, so the car repeats it.
+//
+//  RETURN VALUE:
+//      char
+//          1:  The car finished a program
+//          0:  Repeat of the last report, or malformed
+//-----------------------------------------------------------------------------
+char Transfer_Report(char *payload, char length)
+{
+  char car, i, repeat, q;
+
+  if (length < 1)
+    return 0;
+  car = length >= PKT_DONE_LEN ? payload[PKT_DONE_LEN-1] : PKT_ADDR_CAR;
+  for (i = 0; i < reportCars && reportCar[i] != car; i++);
+  repeat = i < reportCars && reportSeq[i] == payload[0];
+  if (!repeat && queued == REPORT_QUEUE)
+    return 0;
+  reportAck[0] = PKT_LEN(1);
+  reportAck[1] = car;
+  reportAck[2] = PKT_DONE_ACK;
+  reportAck[3] = payload[0];
+  RFSendPacketAsync(reportAck, PKT_SIZE(1)); // If busy, the car repeats
+  Tdma_Heard(car);                          // The car keeps its slot
+  if (repeat)
+    return 0;
+
+  if (i == reportCars)                      // New car: take a free entry, or
+  {                                         // the oldest one
+    if (reportCars < REPORT_CARS)
+      reportCars++;
+    else
+    {
+      i = reportNext;
+      reportNext = (reportNext + 1) % REPORT_CARS;
+    }
+    reportCar[i] = car;
+  }
+  reportSeq[i] = payload[0];
+  q = (queueHead + queued) % REPORT_QUEUE;
+  queueCar[q] = car;
+  for (i = 0; i < RF_LINK_REPORT_LEN; i++)  // Zeros from a car without one
+    queueLink[q][i] = i + 1 < length ? payload[i+1] : 0;
+  queued++;
+  return 1;
+}
+
+
+// Non-zero while new PKT_DONEs wait for Transfer_CarLink()
+char Transfer_Reported(void)
+{
+  return queued;
+}
+
+
+// Takes the oldest new PKT_DONE off the queue, as [link report] [car].
+// Call with interrupts off.  Returns the length, 0 if none is waiting
+char Transfer_CarLink(char *report)
+{
+  char i;
+
+  if (!queued)
+    return 0;
+  for (i = 0; i < RF_LINK_REPORT_LEN; i++)
+    report[i] = queueLink[queueHead][i];
+  report[RF_LINK_REPORT_LEN] = queueCar[queueHead];
+  queueHead = (queueHead + 1) % REPORT_QUEUE;
+  queued--;
+  return RF_LINK_REPORT_LEN + 1;
+}
+
+
+//-----------------------------------------------------------------------------
+//  char Transfer_SetProfile(char profile)
+//
+//  DESCRIPTION:
+//  Starts moving both ends to another modem profile (RF_PROFILE_PLAIN or
+//  RF_PROFILE_FEC).  Transfer_Poll() runs it and reports TRANSFER_DONE once
+//  the car has answered in either profile, and TRANSFER_FAILED, back in the
+//  old profile, if it never does.
+//
+//  RETURN VALUE:
+//      char
+//          1:  Change started
+//          0:  A transfer is running, no such profile, or the target is
+//              not a single car
+//-----------------------------------------------------------------------------
+char Transfer_SetProfile(char profile)
+{
+  if (state == TRANSFER_BUSY || profile >= RF_NUM_PROFILES
+      || !PKT_ADDR_UNIT(target))
+    return 0;
+  kind = KIND_PROFILE;
+  newProfile = profile;
+  oldProfile = RFProfile();
+  pending = toSend = 1;
+  rounds = 0;
+  acked = event = missed = 0;
+  state = TRANSFER_BUSY;
+  return 1;
+}
+
+
+// PKT_PROFILE_ACK payload from the PORT2 interrupt: [profile]
+void Transfer_ProfileAcked(char *payload, char length)
+{
+  if (state != TRANSFER_BUSY || kind != KIND_PROFILE || length < 1
+      || payload[0] != newProfile)
+    return;
+  Clock_Cancel(CLOCK_ALARM_LINK);
+  RFHopResult(1);
+  acked |= 1;
+  event |= EV_ACK;
+}
+
+
+//-----------------------------------------------------------------------------
+//  char Transfer_Run(unsigned int hash, char length)
+//
+//  DESCRIPTION:
+//  Asks the car to run a program from its flash cache by CRC-16 and
+//  length (Cache.h), under a new program id.  Transfer_Poll() reports
+//  TRANSFER_DONE once the car runs it, TRANSFER_MISS if it has no such
+//  program, and TRANSFER_FAILED if it never answers.
+//
+//  RETURN VALUE:
+//      char
+//          1:  Request started
+//          0:  A transfer is running, or the target is not a single car
+//-----------------------------------------------------------------------------
+char Transfer_Run(unsigned int hash, char length)
+{
+  if (state == TRANSFER_BUSY || !PKT_ADDR_UNIT(target))
+    return 0;
+  nextId();
+  kind = KIND_RUN;
+  runHash = hash;
+  runLen = length;
+  pending = toSend = 1;
+  rounds = 0;
+  acked = event = missed = 0;
+  state = TRANSFER_BUSY;
+  return 1;
+}
+
+
+// PKT_RUN_ACK payload from the PORT2 interrupt: [id] [ran]
+void Transfer_RunAcked(char *payload, char length)
+{
+  if (state != TRANSFER_BUSY || kind != KIND_RUN || length < 2
+      || payload[0] != id)
+    return;
+  Clock_Cancel(CLOCK_ALARM_LINK);
+  RFHopResult(1);
+  if (payload[1])
+    acked |= 1;
+  else
+    missed = 1;
+  event |= EV_ACK;
+}
+
+
+//-----------------------------------------------------------------------------
+//  char Transfer_SetTarget(char address, char groups)
+//
+//  DESCRIPTION:
+//  Picks where packets go from now on: a single car, PKT_ADDR_GROUP with
+//  a bitmap of groups, or PKT_ADDR_ALL.  Programs, profile changes, runs
+//  and address changes need a single car.
+//
+//  RETURN VALUE:
+//      char
+//          1:  Target set
+//          0:  A transfer is running, or "address" is PKT_ADDR_SENDER
+//-----------------------------------------------------------------------------
+char Transfer_SetTarget(char address, char groups)
+{
+  if (state == TRANSFER_BUSY || (unsigned char)address == PKT_ADDR_SENDER)
+    return 0;
+  target = address;
+  targetGroups = groups;
+  return 1;
+}
+
+// Where packets go, see Transfer_SetTarget()
+char Transfer_Target(void)
+{
+  return target;
+}
+
+
+//-----------------------------------------------------------------------------
+//  char Transfer_Header(char *packet, char type, char n)
+//
+//  DESCRIPTION:
+//  Writes the length, address and type of a packet of "n" payload bytes
+//  for the target, and the group bitmap after them for PKT_ADDR_GROUP.
+//  The packet must have room for the bitmap when the target may be a
+//  group.
+//
+//  RETURN VALUE:
+//      char
+//          Index of the first payload byte; the packet size is that plus n
+//-----------------------------------------------------------------------------
+char Transfer_Header(char *packet, char type, char n)
+{
+  char g = target == PKT_ADDR_GROUP;
+
+  packet[0] = PKT_LEN(n + g);
+  packet[1] = target;
+  packet[2] = type;
+  if (g)
+    packet[3] = targetGroups;
+  return PKT_HDR_LEN + 1 + g;
+}
+
+
+//-----------------------------------------------------------------------------
+//  char Transfer_SetAddress(char address, char groups)
+//
+//  DESCRIPTION:
+//  Starts giving the target car a new address and group bitmap.
+//  Transfer_Poll() reports TRANSFER_DONE once the car has answered at
+//  either address, and the new address is then the target; it reports
+//  TRANSFER_FAILED, with the target unchanged, if the car never does.
+//
+//  RETURN VALUE:
+//      char
+//          1:  Change started
+//          0:  A transfer is running, or the target or "address" is not a
+//              single car
+//-----------------------------------------------------------------------------
+char Transfer_SetAddress(char address, char groups)
+{
+  if (state == TRANSFER_BUSY || !PKT_ADDR_UNIT(target)
+      || !PKT_ADDR_UNIT(address))
+    return 0;
+  kind = KIND_ADDRESS;
+  newAddr = address;
+  newGroups = groups;
+  pending = toSend = 1;
+  rounds = 0;
+  acked = event = missed = 0;
+  state = TRANSFER_BUSY;
+  return 1;
+}
+
+
+// PKT_ADDRESS_ACK payload from the PORT2 interrupt: [address] [groups]
+void Transfer_AddressAcked(char *payload, char length)
+{
+  if (state != TRANSFER_BUSY || kind != KIND_ADDRESS || length < 2
+      || payload[0] != newAddr || payload[1] != newGroups)
+    return;
+  Clock_Cancel(CLOCK_ALARM_LINK);
+  RFHopResult(1);
+  acked |= 1;
+  event |= EV_ACK;
+}
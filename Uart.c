@@ -0,0 +1,111 @@
+//----------------------------------------------------------------------------
+//  Description:  Interrupt-driven USCI_A0 UART with RX and TX ring buffers
+//  (SENDING VERSION)
+//----------------------------------------------------------------------------
+
+
+#include "TI_CC/include.h"
+#include "Clock.h"
+#include "Uart.h"
+
+static char rxRing[UART_RX_SIZE];
+static volatile unsigned char rxHead;       // Written by USCI0RX_ISR
+static unsigned char rxTail;                // Written by main
+static volatile char rxOverruns;            // Bytes lost: ring full or UCOE
+
+static char txRing[UART_TX_SIZE];
+static unsigned char txHead;                // Written by main
+static volatile unsigned char txTail;       // Written by USCI0TX_ISR
+
+static void uartRx(void);
+
+
+//-----------------------------------------------------------------------------
+//  void Uart_Init(void)
+//
+//  DESCRIPTION:
+//  Sets USCI_A0 to CLOCK_BAUD, 8N1 from SMCLK, and enables its RX
+//  interrupt.  Clock_Init() must have been called.
+//-----------------------------------------------------------------------------
+void Uart_Init(void)
+{
+  rxHead = rxTail = 0;
+  txHead = txTail = 0;
+
+  P3SEL |= 0x30;                            // P3.4,5 = USCI_A0 TXD/RXD
+  UCA0CTL1 |= UCSWRST;
+  UCA0CTL1 |= UCSSEL_2;                     // SMCLK
+  UCA0BR0 = CLOCK_UART_BR & 0xFF;           // Divisor from the clock profile
+  UCA0BR1 = CLOCK_UART_BR >> 8;
+  UCA0MCTL = CLOCK_UART_BRS << 1;           // Modulation UCBRSx
+  UCA0CTL1 &= ~UCSWRST;                     // **Initialize USCI state machine**
+  TI_CC_USCIA0RxHandler = uartRx;           // RX vector is shared with SPI
+  IE2 |= UCA0RXIE;                          // Enable USCI_A0 RX interrupt
+}
+
+char Uart_Available(void)
+{
+  return rxHead != rxTail;
+}
+
+// Fetch one received byte; returns 0 if the RX ring is empty
+char Uart_Read(char *c)
+{
+  if (rxHead == rxTail)
+    return 0;
+  *c = rxRing[rxTail];
+  rxTail = (rxTail + 1) & (UART_RX_SIZE - 1);
+  return 1;
+}
+
+// Queue one byte for transmission; returns 0 if the TX ring is full
+char Uart_Write(char c)
+{
+  unsigned char next = (txHead + 1) & (UART_TX_SIZE - 1);
+
+  if (next == txTail)
+    return 0;
+  txRing[txHead] = c;
+  txHead = next;
+  IE2 |= UCA0TXIE;                          // TX ISR drains the ring
+  return 1;
+}
+
+char Uart_Overruns(void)
+{
+  return rxOverruns;
+}
+
+
+// Serial read, called from the shared USCI_A0/B0 RX vector in TI_CC_spi.c,
+// which also wakes main to parse
+static void uartRx(void)
+{
+  unsigned char next = (rxHead + 1) & (UART_RX_SIZE - 1);
+
+  if (UCA0STAT & UCOE)                      // Byte lost in the USCI itself
+    rxOverruns++;
+  if (next == rxTail)
+  {
+    rxOverruns++;
+    (void)UCA0RXBUF;                        // Ring full: drop, clear UCA0RXIFG
+  }
+  else
+  {
+    rxRing[rxHead] = UCA0RXBUF;
+    rxHead = next;
+  }
+}
+
+//Interrupt handler for serial write
+#pragma vector=USCIAB0TX_VECTOR
+__interrupt void USCI0TX_ISR(void)
+{
+  if (txTail == txHead)
+  {
+    IE2 &= ~UCA0TXIE;                       // Ring empty
+    return;
+  }
+  UCA0TXBUF = txRing[txTail];
+  txTail = (txTail + 1) & (UART_TX_SIZE - 1);
+}
@@ -0,0 +1,18 @@
+//----------------------------------------------------------------------------
+//  Description:  Interrupt-driven USCI_A0 UART with RX and TX ring buffers
+//
+//  The RX interrupt only stores the byte and wakes the CPU; the TX interrupt
+//  drains the TX ring.  Each ring has one producer and one consumer, so no
+//  locking is needed as long as only main() calls Uart_Read()/Uart_Write().
+//----------------------------------------------------------------------------
+
+
+#define UART_RX_SIZE           64          // Must be a power of 2
+#define UART_TX_SIZE           32          // Must be a power of 2
+
+
+void Uart_Init(void);
+char Uart_Available(void);
+char Uart_Read(char *);
+char Uart_Write(char);
+char Uart_Overruns(void);
@@ -0,0 +1,241 @@
+//----------------------------------------------------------------------------
+//  Description:  Benchmark runner: a sender and one car in the simulator
+//
+//      bench [--runs n] [--loss p] [--delay us] [--ber b] [--seed s]
+//
+//  Measures, over n runs each, on links with the given loss (0 to 1),
+//  extra delay and bit error rate in both directions:
+//
+//      drive     GUI HOST_DRIVE frame to the car's motor pin
+//      program   GUI HOST_PROGRAM frame (one instruction) to the motor pin
+//      upload    a MOTION_MAX_INSTR byte program, frame to HOST_ACK, as
+//                bytes per second of the whole frame and of the radio part
+//
+//  and for each command the CPU time both boards spent awake on it.
+//  Latencies are from the first byte of the frame on the serial line.
+//----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Gui.h"
+
+#define PIN_FWD                 0x01
+#define PIN_BACK                0x04
+#define UPLOAD_BYTES            240
+
+typedef struct
+{
+  const char *name, *unit;
+  double scale;
+  int n, failed;
+  double sum, min, max;
+} Series;
+
+typedef struct
+{
+  Sim_Board *board;
+  int from;
+  unsigned char mask, want;
+  Sim_Time when;
+} PinWait;
+
+static Sim_Board *sender, *car;
+static Gui *gui;
+static int seq;
+
+static void add(Series *s, double v)
+{
+  if (!s->n || v < s->min)
+    s->min = v;
+  if (!s->n || v > s->max)
+    s->max = v;
+  s->sum += v;
+  s->n++;
+}
+
+static void report(const Series *s)
+{
+  if (!s->n)
+    printf("%-22s %10s %10s %10s %-8s %d failed\n", s->name, "-", "-", "-",
+           s->unit, s->failed);
+  else
+    printf("%-22s %10.3f %10.3f %10.3f %-8s %d failed\n", s->name,
+           s->sum / s->n / s->scale, s->min / s->scale, s->max / s->scale,
+           s->unit, s->failed);
+}
+
+static int pinsMatch(void *arg)
+{
+  PinWait *w = arg;
+  const Sim_PinChange *p;
+  int n;
+
+  p = Sim_Pins(w->board, &n);
+  for (; w->from < n; w->from++)
+    if ((p[w->from].pins & w->mask) == w->want)
+    {
+      w->when = p[w->from].time;
+      return 1;
+    }
+  return 0;
+}
+
+// Runs until the car's pins under mask read want, 0 on timeout
+static Sim_Time waitPins(int from, unsigned char mask, unsigned char want,
+                         Sim_Time timeout)
+{
+  PinWait w = {car, from, mask, want, 0};
+
+  Sim_Run(Sim_Now() + timeout, pinsMatch, &w);
+  return w.when;
+}
+
+static int pinIndex(void)
+{
+  int n;
+
+  Sim_Pins(car, &n);
+  return n;
+}
+
+static Sim_Time busy(void)
+{
+  return Sim_BoardStats(sender)->busy + Sim_BoardStats(car)->busy;
+}
+
+static int next(void)
+{
+  seq = seq % 255 + 1;
+  return seq;
+}
+
+static void drive(Series *latency, Series *cpu)
+{
+  unsigned char fwd = PIN_FWD;
+  Sim_Time start = Sim_Now(), cpu0 = busy(), on;
+  int from = pinIndex(), s = next();
+  Gui_Frame f;
+
+  Gui_Send(gui, GUI_DRIVE, s, &fwd, 1);
+  on = waitPins(from, PIN_FWD, PIN_FWD, SIM_MS(500));
+  if (!Gui_Expect(gui, GUI_ACK, s, &f, SIM_MS(100)) || !on)
+    latency->failed++;
+  else
+    add(latency, on - start);
+  add(cpu, busy() - cpu0);
+
+  from = pinIndex();
+  Gui_Send(gui, GUI_DRIVE, next(), 0, 0);
+  waitPins(from, PIN_FWD, 0, SIM_MS(500));
+  Sim_Run(Sim_Now() + SIM_MS(100), 0, 0);   // Stream ends after the stop
+                                            // repeats, then programs go
+}
+
+static void program(Series *latency, Series *cpu)
+{
+  unsigned char instr = 0x44;               // Backward, 4 units
+  Sim_Time start = Sim_Now(), cpu0 = busy(), on;
+  int from = pinIndex(), s = next();
+  Gui_Frame f;
+
+  Gui_Send(gui, GUI_PROGRAM, s, &instr, 1);
+  on = waitPins(from, PIN_BACK, PIN_BACK, SIM_MS(1000));
+  if (!Gui_Expect(gui, GUI_ACK, s, &f, SIM_MS(1000)) || !on)
+    latency->failed++;
+  else
+    add(latency, on - start);
+  if (!Gui_Expect(gui, GUI_DONE, -1, &f, SIM_MS(2000)))
+    latency->failed++;
+  add(cpu, busy() - cpu0);
+}
+
+static void upload(Series *whole, Series *radio, Series *cpu)
+{
+  unsigned char instr[UPLOAD_BYTES];
+  Sim_Time start = Sim_Now(), cpu0 = busy(), end;
+  int s = next();
+  Gui_Frame f;
+
+  memset(instr, 0x21, sizeof(instr));       // Forward 1 unit, 240 times
+  end = Gui_Send(gui, GUI_PROGRAM, s, instr, sizeof(instr));
+  if (Gui_Expect(gui, GUI_ACK, s, &f, SIM_MS(5000)))
+  {
+    add(whole, UPLOAD_BYTES / ((f.start - start) / 1e12));
+    add(radio, UPLOAD_BYTES / ((f.start - end) / 1e12));
+  }
+  else
+  {
+    whole->failed++;
+    radio->failed++;
+  }
+  add(cpu, busy() - cpu0);
+  Gui_Expect(gui, GUI_DONE, -1, &f, SIM_MS(10000));
+}
+
+int main(int argc, char **argv)
+{
+  Series driveLat = {"drive latency", "ms", 1e9};
+  Series driveCpu = {"drive cpu", "ms", 1e9};
+  Series progLat = {"program latency", "ms", 1e9};
+  Series progCpu = {"program cpu", "ms", 1e9};
+  Series upWhole = {"upload throughput", "B/s", 1};
+  Series upRadio = {"upload radio only", "B/s", 1};
+  Series upCpu = {"upload cpu", "ms", 1e9};
+  Sim_Link link = {0, 0, 0, 0, 0, -50};
+  unsigned long seed = 1;
+  int runs = 10, i;
+
+  for (i = 1; i + 1 < argc; i += 2)
+  {
+    if (!strcmp(argv[i], "--runs"))
+      runs = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "--loss"))
+      link.loss = atof(argv[i + 1]);
+    else if (!strcmp(argv[i], "--delay"))
+      link.delay = SIM_NS(atof(argv[i + 1]) * 1000);
+    else if (!strcmp(argv[i], "--ber"))
+      link.ber = atof(argv[i + 1]);
+    else if (!strcmp(argv[i], "--seed"))
+      seed = strtoul(argv[i + 1], 0, 0);
+    else
+      break;
+  }
+  if (i < argc)
+  {
+    fprintf(stderr, "usage: bench [--runs n] [--loss p] [--delay us] "
+            "[--ber b] [--seed s]\n");
+    return 1;
+  }
+
+  Sim_Init(seed);
+  sender = Sim_AddBoard("fw_sender", 12000);
+  car = Sim_AddBoard("fw_car", 12000);
+  Sim_SetLink(sender, car, &link);
+  Sim_SetLink(car, sender, &link);
+  gui = Gui_Open(sender);
+  Sim_Run(SIM_MS(100), 0, 0);
+
+  for (i = 0; i < runs; i++)
+    drive(&driveLat, &driveCpu);
+  for (i = 0; i < runs; i++)
+    program(&progLat, &progCpu);
+  for (i = 0; i < runs; i++)
+    upload(&upWhole, &upRadio, &upCpu);
+
+  printf("%d runs, loss %g, delay %g us, ber %g, MCLK %.0f Hz\n", runs,
+         link.loss, link.delay / 1e6, link.ber, Sim_Mclk(sender));
+  printf("%-22s %10s %10s %10s\n", "", "mean", "min", "max");
+  report(&driveLat);
+  report(&driveCpu);
+  report(&progLat);
+  report(&progCpu);
+  report(&upWhole);
+  report(&upRadio);
+  report(&upCpu);
+
+  Gui_Close(gui);
+  Sim_Free();
+  return link.loss == 0 && link.ber == 0
+         && (driveLat.failed || progLat.failed || upWhole.failed);
+}
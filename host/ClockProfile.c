@@ -0,0 +1,19 @@
+//----------------------------------------------------------------------------
+//  Description:  The settings Clock.h and TI_CC_hardware_board.h derive for
+//  one clock profile, for TestClock.c.  Built once per TI_CC_MCLK_MHZ, with
+//  CLOCK_PROFILE naming the table of each build.
+//----------------------------------------------------------------------------
+
+#include "TI_CC/include.h"
+#include "Clock.h"
+#include "ClockProfile.h"
+
+const ClockProfile CLOCK_PROFILE =
+{
+  CLOCK_MHZ, TI_CC_SPI_DIV, CLOCK_FLASH_FN,
+  {{CLOCK_BAUD, CLOCK_UART_BR, CLOCK_UART_BRS,
+    CLOCK_BAUD_ERR(CLOCK_HZ, CLOCK_BAUD)},
+   {CLOCK_PROFILE_BAUD, CLOCK_UCBR(CLOCK_HZ, CLOCK_PROFILE_BAUD),
+    CLOCK_UCBRS(CLOCK_HZ, CLOCK_PROFILE_BAUD),
+    CLOCK_BAUD_ERR(CLOCK_HZ, CLOCK_PROFILE_BAUD)}}
+};
@@ -0,0 +1,25 @@
+//----------------------------------------------------------------------------
+//  Description:  The settings of a clock profile, see ClockProfile.c
+//----------------------------------------------------------------------------
+
+#ifndef CLOCK_PROFILE_H
+#define CLOCK_PROFILE_H
+
+typedef struct
+{
+  unsigned long baud;
+  unsigned int ucbr, ucbrs;
+  long errTenths;                           // CLOCK_BAUD_ERR()
+} ClockBaud;
+
+typedef struct
+{
+  unsigned int mhz;
+  unsigned int spiDiv;                      // TI_CC_SPI_DIV
+  unsigned int flashFn;                     // CLOCK_FLASH_FN
+  ClockBaud uart[2];                        // CLOCK_BAUD, CLOCK_PROFILE_BAUD
+} ClockProfile;
+
+extern const ClockProfile clockProfile1, clockProfile8, clockProfile16;
+
+#endif
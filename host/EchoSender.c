@@ -0,0 +1,57 @@
+//----------------------------------------------------------------------------
+//  Description:  The SENDING VERSION's serial side as it was before
+//  HostLink.c, for the host simulator (TestHostLink.c)
+//
+//  The GUI wrote the instruction count, then each instruction, every one
+//  followed by MATLAB's LF terminator, and waited for the echo of each
+//  before writing the next.  The USCI_A0 RX interrupt echoes every byte
+//  and keeps the instructions; echoNumber counts the programs read in.
+//  Only the serial exchange is kept: the program is not sent on to a car.
+//  The CPU sleeps in LPM0, since the USCI runs from SMCLK.
+//----------------------------------------------------------------------------
+
+
+#include "TI_CC/include.h"
+
+char echoChars[50];
+int echoCount = 0;
+unsigned int echoNumber = 0;                // Programs read in
+
+
+void main (void)
+{
+  WDTCTL = WDTPW + WDTHOLD;                 // Stop WDT
+
+  BCSCTL1 = CALBC1_1MHZ;                    // Set DCO
+  DCOCTL = CALDCO_1MHZ;
+  P3SEL = 0x30;                             // P3.4,5 = USCI_A0 TXD/RXD
+  UCA0CTL1 |= UCSSEL_2;                     // SMCLK
+  UCA0BR0 = 104;                            // 1MHz 9600
+  UCA0BR1 = 0;                              // 1MHz 9600
+  UCA0MCTL = 0x02;                          // Modulation UCBRSx = 1
+  UCA0CTL1 &= ~UCSWRST;                     // **Initialize USCI state machine**
+  IE2 |= UCA0RXIE;                          // Enable USCI_A0 RX interrupt
+
+  for (;;)
+    _BIS_SR(LPM0_bits + GIE);
+}
+
+// Serial read: echo the byte to the GUI, keep the instructions
+#pragma vector=USCIAB0RX_VECTOR
+__interrupt void USCIAB0RX_ISR(void)
+{
+  while (!(IFG2&UCA0TXIFG));                // USCI_A0 TX buffer ready?
+  if (UCA0RXBUF != 10 || !echoCount)        // skip the LF fillers unless
+  {                                         // it is the first one
+    echoChars[echoCount] = UCA0RXBUF;
+    echoCount++;
+  }
+  UCA0TXBUF = UCA0RXBUF;                    // Echo for confirmation to the GUI
+
+  if ((echoCount-1) >= echoChars[0] && UCA0RXBUF == 10)
+  {                                         // All instructions read in
+    echoChars[0] = 90;
+    echoCount = 0;
+    echoNumber++;
+  }
+}
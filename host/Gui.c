@@ -0,0 +1,161 @@
+//----------------------------------------------------------------------------
+//  Description:  The MATLAB GUI's end of the serial line, see Gui.h
+//----------------------------------------------------------------------------
+
+#include <stdlib.h>
+#include <string.h>
+#include "Gui.h"
+
+#define GUI_SOF                 0x7E
+
+struct Gui
+{
+  Sim_Board *board;
+  int state, pos;
+  Gui_Frame frame;
+  unsigned char crc[2];
+  Gui_Frame *out;
+  int got;
+};
+
+// CRC-16/CCITT, bitwise
+unsigned int Gui_Crc(const unsigned char *data, int len)
+{
+  unsigned int crc = 0xFFFF;
+  int i, bit;
+
+  for (i = 0; i < len; i++)
+  {
+    crc ^= (unsigned int)data[i] << 8;
+    for (bit = 0; bit < 8; bit++)
+      crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+    crc &= 0xFFFF;
+  }
+  return crc;
+}
+
+Gui *Gui_Open(Sim_Board *sender)
+{
+  Gui *g = calloc(1, sizeof(*g));
+
+  g->board = sender;
+  return g;
+}
+
+void Gui_Close(Gui *g)
+{
+  free(g);
+}
+
+// Returns when the last byte has reached the board
+Sim_Time Gui_Send(Gui *g, int type, int seq, const void *payload, int len)
+{
+  unsigned char buf[262];
+  unsigned int crc;
+
+  buf[0] = GUI_SOF;
+  buf[1] = type;
+  buf[2] = seq;
+  buf[3] = len;
+  memcpy(buf + 4, payload, len);
+  crc = Gui_Crc(buf + 1, len + 3);
+  buf[4 + len] = crc >> 8;
+  buf[5 + len] = crc;
+  return Sim_SerialWrite(g->board, (const char *)buf, len + 6);
+}
+
+static int feed(Gui *g, unsigned char c, Sim_Time t)
+{
+  Gui_Frame *f = &g->frame;
+  unsigned char all[258];
+  unsigned int crc;
+
+  switch (g->state)
+  {
+    case 0:
+      if (c == GUI_SOF)
+      {
+        f->start = t;
+        g->state = 1;
+      }
+      return 0;
+    case 1:
+      f->type = c;
+      g->state = 2;
+      return 0;
+    case 2:
+      f->seq = c;
+      g->state = 3;
+      return 0;
+    case 3:
+      f->len = c;
+      g->pos = 0;
+      g->state = c ? 4 : 5;
+      return 0;
+    case 4:
+      f->payload[g->pos++] = c;
+      if (g->pos == f->len)
+        g->state = 5;
+      return 0;
+    case 5:
+      g->crc[0] = c;
+      g->state = 6;
+      return 0;
+  }
+  g->state = 0;
+  f->end = t;
+  all[0] = f->type;
+  all[1] = f->seq;
+  all[2] = f->len;
+  memcpy(all + 3, f->payload, f->len);
+  crc = Gui_Crc(all, f->len + 3);
+  return crc == ((unsigned int)g->crc[0] << 8 | c);
+}
+
+// A frame from the sender, if one has finished arriving
+int Gui_Poll(Gui *g, Gui_Frame *f)
+{
+  unsigned char c;
+  Sim_Time t;
+
+  while (Sim_SerialRead(g->board, &c, &t))
+    if (feed(g, c, t))
+    {
+      *f = g->frame;
+      return 1;
+    }
+  return 0;
+}
+
+static int arrived(void *arg)
+{
+  Gui *g = arg;
+
+  if (!g->got)
+    g->got = Gui_Poll(g, g->out);
+  return g->got;
+}
+
+// Runs the simulation until a frame arrives or for timeout
+int Gui_Wait(Gui *g, Gui_Frame *f, Sim_Time timeout)
+{
+  g->out = f;
+  g->got = 0;
+  Sim_Run(Sim_Now() + timeout, arrived, g);
+  return g->got;
+}
+
+// Waits for a frame of one type and seq, dropping others
+int Gui_Expect(Gui *g, int type, int seq, Gui_Frame *f, Sim_Time timeout)
+{
+  Sim_Time end = Sim_Now() + timeout;
+
+  while (Sim_Now() < end)
+  {
+    if (!Gui_Wait(g, f, end - Sim_Now()))
+      return 0;
+    if (f->type == type && (seq < 0 || f->seq == seq))
+      return 1;
+  }
+  return 0;
+}
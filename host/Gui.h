@@ -0,0 +1,50 @@
+//----------------------------------------------------------------------------
+//  Description:  The MATLAB GUI's end of the serial line to the sender
+//
+//  Frames as in HostLink.h:  [0x7E] [type] [seq] [len] [payload] [CRC16]
+//  The frame codes are repeated here rather than taken from HostLink.h so
+//  that the harness checks the firmware against the protocol, not against
+//  itself.
+//----------------------------------------------------------------------------
+
+#ifndef GUI_H
+#define GUI_H
+
+#include "Sim.h"
+
+#define GUI_PROGRAM             0x01
+#define GUI_DRIVE               0x02
+#define GUI_PROFILE             0x03
+#define GUI_TRACE               0x04
+#define GUI_RUN                 0x05
+#define GUI_ACK                 0x06
+#define GUI_TARGET              0x07
+#define GUI_ADDRESS             0x08
+#define GUI_DONE                0x11
+#define GUI_NACK                0x15
+
+#define GUI_ERR_CRC             0x01
+#define GUI_ERR_LENGTH          0x02
+#define GUI_ERR_TYPE            0x03
+#define GUI_ERR_RADIO           0x04
+#define GUI_ERR_MISS            0x05
+#define GUI_ERR_TARGET          0x06
+
+typedef struct
+{
+  unsigned char type, seq, len;
+  unsigned char payload[255];
+  Sim_Time start, end;                      // First and last byte on the line
+} Gui_Frame;
+
+typedef struct Gui Gui;
+
+Gui *Gui_Open(Sim_Board *sender);
+void Gui_Close(Gui *g);
+Sim_Time Gui_Send(Gui *g, int type, int seq, const void *payload, int len);
+int Gui_Poll(Gui *g, Gui_Frame *f);
+int Gui_Wait(Gui *g, Gui_Frame *f, Sim_Time timeout);
+int Gui_Expect(Gui *g, int type, int seq, Gui_Frame *f, Sim_Time timeout);
+unsigned int Gui_Crc(const unsigned char *data, int len);
+
+#endif
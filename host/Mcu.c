@@ -0,0 +1,681 @@
+//----------------------------------------------------------------------------
+//  Description:  Simulated MSP430F2274 peripherals
+//
+//  Clocks: the DCO runs at 1, 8 or 16 MHz when BCSCTL1/DCOCTL hold the
+//  matching calibration constants and about 1.1 MHz out of reset; MCLK and
+//  SMCLK are the DCO undivided.  ACLK is the board's VLO once BCSCTL3
+//  selects it (there is no LFXT1 crystal on the board).
+//
+//  Timers count ACLK or SMCLK in continuous mode (up modes count the same
+//  way), to 2^32.  Compare and capture set CCIFG; CCI0B/CCI2B capture
+//  rising ACLK edges.  The UART shifts 10 bits per byte at the rate of
+//  UCA0BR/UCBRS and loses bytes that arrive while SMCLK is off in LPM3;
+//  the SPI master shifts 8 bits at SMCLK/UCB0BR into the radio, and
+//  stops half way while SMCLK is off.  The radio's chip select is P3.0
+//  and its SO/CHIP_RDYn shows on P3.2.  GDO0 is P2.6.  No watchdog: the
+//  firmware holds it.
+//----------------------------------------------------------------------------
+
+#include <stdlib.h>
+#include <string.h>
+#include "SimBoard.h"
+
+#define REG(b, a)               ((b)->reg[SIM_SLOT(a)])
+
+#define DCO_RESET_HZ            1100000.0
+
+// Calibration constants in information memory and what they select
+static const struct
+{
+  unsigned char bc1, dco;
+  double hz;
+} dcoCal[] =
+{
+  {0x86, 0xB5, 1000000.0},
+  {0x8D, 0x92, 8000000.0},
+  {0x8F, 0x95, 16000000.0}
+};
+
+// Registers whose writes have side effects or raise interrupts
+static const unsigned short watched[] =
+{
+  IE1, IE2, IFG1, IFG2, BCSCTL3, DCOCTL, BCSCTL1, BCSCTL2, WDTCTL,
+  FCTL1, FCTL2, FCTL3, P3OUT, P3DIR, P3SEL, P1OUT, P1DIR, P1IFG, P1IES,
+  P1IE, P1SEL, P1REN, P2OUT, P2DIR, P2IFG, P2IES, P2IE, P2SEL, P2REN,
+  UCA0CTL0, UCA0CTL1, UCA0BR0, UCA0BR1, UCA0MCTL, UCA0STAT, UCA0TXBUF,
+  UCB0CTL0, UCB0CTL1, UCB0BR0, UCB0BR1, UCB0MCTL, UCB0STAT, UCB0TXBUF,
+  TACTL, TACCTL0, TACCTL1, TACCTL2, TACCR0, TACCR1, TACCR2, TBCTL
+};
+
+enum
+{
+  EV_NONE,
+  EV_CCR0, EV_CCR1, EV_CCR2,
+  EV_CAPTURE,
+  EV_UARTTX,
+  EV_UARTRX,
+  EV_SPI,
+  EV_RADIO
+};
+
+void Mcu_Set(Sim_Board *b, unsigned int a, unsigned int value)
+{
+  b->reg[SIM_SLOT(a)] = b->shadow[SIM_SLOT(a)] = value;
+}
+
+static void setBits(Sim_Board *b, unsigned int a, unsigned int bits)
+{
+  Mcu_Set(b, a, REG(b, a) | bits);
+}
+
+static void clearBits(Sim_Board *b, unsigned int a, unsigned int bits)
+{
+  Mcu_Set(b, a, REG(b, a) & ~bits);
+}
+
+//----------------------------------------------------------------------------
+//  Clocks and timers
+//----------------------------------------------------------------------------
+
+static double aclkHz(Sim_Board *b)
+{
+  if ((REG(b, BCSCTL3) & 0x30) != LFXT1S_2)
+    return 0;
+  return b->vlo / (1 << ((REG(b, BCSCTL1) >> 4) & 3));
+}
+
+// ps per count of a timer with control word ctl, 0 if it does not count
+static double timerPeriod(Sim_Board *b, unsigned int ctl)
+{
+  double hz;
+
+  if (!(ctl & (MC_1 | MC_2)))
+    return 0;
+  switch (ctl & 0x0300)
+  {
+    case TASSEL_1: hz = aclkHz(b); break;
+    case TASSEL_2: hz = b->mclk; break;
+    default: hz = 0; break;
+  }
+  if (hz == 0)
+    return 0;
+  return 1e12 / hz * (1 << ((ctl >> 6) & 3));
+}
+
+static Sim_Time tickTime(const Sim_Timer *tm, unsigned long long k)
+{
+  return tm->base + (Sim_Time)((double)k * tm->period);
+}
+
+static unsigned long long ticksBy(const Sim_Timer *tm, Sim_Time t)
+{
+  unsigned long long k;
+
+  if (tm->period == 0 || t <= tm->base)
+    return 0;
+  k = (unsigned long long)((double)(t - tm->base) / tm->period);
+  while (k && tickTime(tm, k) > t)
+    k--;
+  while (tickTime(tm, k + 1) <= t)
+    k++;
+  return k;
+}
+
+static unsigned int timerValue(const Sim_Timer *tm, Sim_Time t)
+{
+  return tm->count + (unsigned int)ticksBy(tm, t);
+}
+
+// When the counter reaches v; in the past if it already has
+static Sim_Time timerWhen(const Sim_Timer *tm, unsigned int v)
+{
+  if (tm->period == 0)
+    return SIM_NEVER;
+  return tickTime(tm, (unsigned int)(v - tm->count));
+}
+
+static void rebase(Sim_Board *b, Sim_Timer *tm, double period)
+{
+  unsigned long long k;
+
+  if (tm->period != 0)
+  {
+    k = ticksBy(tm, b->now);
+    tm->base = tickTime(tm, k);
+    tm->count += (unsigned int)k;
+  }
+  else
+    tm->base = b->now;
+  tm->period = period;
+}
+
+static void retime(Sim_Board *b)
+{
+  rebase(b, &b->ta, timerPeriod(b, REG(b, TACTL)));
+  rebase(b, &b->tb, timerPeriod(b, REG(b, TBCTL)));
+}
+
+static void dco(Sim_Board *b)
+{
+  unsigned int i;
+
+  for (i = 0; i < sizeof(dcoCal) / sizeof(dcoCal[0]); i++)
+    if (REG(b, BCSCTL1) == dcoCal[i].bc1 && REG(b, DCOCTL) == dcoCal[i].dco)
+    {
+      b->mclk = dcoCal[i].hz;
+      b->cycle = 1e12 / b->mclk;
+    }
+  retime(b);
+}
+
+static int capturing(Sim_Board *b, unsigned int a)
+{
+  unsigned int ctl = REG(b, a);
+
+  return (ctl & CAP) && (ctl & 0xC000) && (ctl & 0x3000) == CCIS_1;
+}
+
+static Sim_Time aclkEdgeAfter(Sim_Board *b, Sim_Time t)
+{
+  double hz = aclkHz(b), period;
+  unsigned long long k;
+  Sim_Time edge;
+
+  if (hz == 0)
+    return SIM_NEVER;
+  period = 1e12 / hz;
+  k = (unsigned long long)((double)t / period) + 1;
+  while ((edge = (Sim_Time)((double)k * period)) <= t)
+    k++;
+  return edge;
+}
+
+//----------------------------------------------------------------------------
+//  USCIs
+//----------------------------------------------------------------------------
+
+static Sim_Time uartByteTime(Sim_Board *b)
+{
+  unsigned int br = REG(b, UCA0BR0) | REG(b, UCA0BR1) << 8;
+  double bit = (br ? br : 1) + ((REG(b, UCA0MCTL) >> 1) & 7) / 8.0;
+
+  return (Sim_Time)(10 * bit * b->cycle);
+}
+
+static Sim_Time spiByteTime(Sim_Board *b)
+{
+  unsigned int br = REG(b, UCB0BR0) | REG(b, UCB0BR1) << 8;
+
+  return (Sim_Time)(8 * (br ? br : 1) * b->cycle);
+}
+
+static void uartTx(Sim_Board *b, unsigned char c)
+{
+  if (b->uartDone == SIM_NEVER)
+  {
+    b->uartShift = c;
+    b->uartDone = b->now + uartByteTime(b);
+  }
+  else
+  {
+    b->uartNext = c;
+    b->uartFull = 1;
+    clearBits(b, IFG2, UCA0TXIFG);
+  }
+}
+
+static void spiTx(Sim_Board *b, unsigned char c)
+{
+  if (b->spiDone == SIM_NEVER && b->spiLeft == SIM_NEVER)
+  {
+    b->spiShift = c;
+    b->spiDone = b->now + spiByteTime(b);
+  }
+  else
+  {
+    b->spiNext = c;
+    b->spiFull = 1;
+    clearBits(b, IFG2, UCB0TXIFG);
+  }
+}
+
+static void usciReset(Sim_Board *b, int spi)
+{
+  if (spi)
+  {
+    b->spiDone = b->spiLeft = SIM_NEVER;
+    b->spiFull = 0;
+    setBits(b, IFG2, UCB0TXIFG);
+    clearBits(b, IFG2, UCB0RXIFG);
+    Mcu_Set(b, UCB0STAT, 0);
+  }
+  else
+  {
+    b->uartDone = SIM_NEVER;
+    b->uartFull = 0;
+    setBits(b, IFG2, UCA0TXIFG);
+    clearBits(b, IFG2, UCA0RXIFG);
+    Mcu_Set(b, UCA0STAT, 0);
+  }
+}
+
+//----------------------------------------------------------------------------
+//  Reset, writes and reads
+//----------------------------------------------------------------------------
+
+void Mcu_Reset(Sim_Board *b)
+{
+  memset(b->reg, 0, sizeof(b->reg));
+  REG(b, IFG2) = UCA0TXIFG | UCB0TXIFG;
+  REG(b, BCSCTL1) = 0x87;
+  REG(b, DCOCTL) = 0x60;
+  REG(b, BCSCTL3) = 0x05;
+  REG(b, WDTCTL) = 0x6900;
+  REG(b, FCTL1) = FRKEY;
+  REG(b, FCTL2) = FRKEY | 0x42;
+  REG(b, FCTL3) = FRKEY | LOCK | 0x08;
+  REG(b, P2SEL) = 0xC0;
+  REG(b, UCA0CTL1) = UCSWRST;
+  REG(b, UCB0CTL0) = UCSYNC;
+  REG(b, UCB0CTL1) = UCSWRST;
+  REG(b, UCA0TXBUF) = SIM_TXIDLE;
+  REG(b, UCB0TXBUF) = SIM_TXIDLE;
+  REG(b, CALBC1_1MHZ) = dcoCal[0].bc1;
+  REG(b, CALDCO_1MHZ) = dcoCal[0].dco;
+  REG(b, CALBC1_8MHZ) = dcoCal[1].bc1;
+  REG(b, CALDCO_8MHZ) = dcoCal[1].dco;
+  REG(b, CALBC1_16MHZ) = dcoCal[2].bc1;
+  REG(b, CALDCO_16MHZ) = dcoCal[2].dco;
+  memcpy(b->shadow, b->reg, sizeof(b->reg));
+
+  b->sr = 0;
+  b->depth = 0;
+  b->mclk = DCO_RESET_HZ;
+  b->cycle = 1e12 / b->mclk;
+  memset(&b->ta, 0, sizeof(b->ta));
+  memset(&b->tb, 0, sizeof(b->tb));
+  b->ta.base = b->tb.base = b->now;
+  b->ccrDone[0] = b->ccrDone[1] = b->ccrDone[2] = b->capDone = b->now;
+  b->uartDone = b->spiDone = b->spiLeft = SIM_NEVER;
+  b->uartFull = b->spiFull = 0;
+  b->gdo0 = 0;
+}
+
+// The SR changed: SMCLK (SCG1) stops or restarts the SPI byte shifting
+void Mcu_Clocks(Sim_Board *b)
+{
+  if ((b->sr & SCG1) && b->spiDone != SIM_NEVER)
+  {
+    b->spiLeft = b->spiDone - b->now;
+    b->spiDone = SIM_NEVER;
+  }
+  else if (!(b->sr & SCG1) && b->spiLeft != SIM_NEVER)
+  {
+    b->spiDone = b->now + b->spiLeft;
+    b->spiLeft = SIM_NEVER;
+  }
+}
+
+static void pinChange(Sim_Board *b, unsigned char pins)
+{
+  if (b->pinCount == b->pinSize)
+  {
+    b->pinSize = b->pinSize ? 2 * b->pinSize : 64;
+    b->pins = realloc(b->pins, b->pinSize * sizeof(*b->pins));
+  }
+  b->pins[b->pinCount].time = b->now;
+  b->pins[b->pinCount++].pins = pins;
+}
+
+static void spiByte(Sim_Board *b, unsigned char mosi, unsigned char miso,
+                    Sim_Time t)
+{
+  if (!b->spiLog)
+    return;
+  if (b->spiCount == b->spiSize)
+  {
+    b->spiSize = b->spiSize ? 2 * b->spiSize : 256;
+    b->spi = realloc(b->spi, b->spiSize * sizeof(*b->spi));
+  }
+  b->spi[b->spiCount].time = t;
+  b->spi[b->spiCount].frame = REG(b, P3OUT) & 0x01 ? 0 : b->frames;
+  b->spi[b->spiCount].mosi = mosi;
+  b->spi[b->spiCount++].miso = miso;
+}
+
+static void written(Sim_Board *b, unsigned int a, unsigned int old,
+                    unsigned int v)
+{
+  switch (a)
+  {
+    case BCSCTL1:
+    case DCOCTL:
+      dco(b);
+      break;
+    case BCSCTL3:
+      retime(b);
+      break;
+    case TACTL:
+      retime(b);
+      if (v & TACLR)
+      {
+        Mcu_Set(b, TACTL, v & ~TACLR);
+        b->ta.count = 0;
+        b->ta.base = b->now;
+      }
+      break;
+    case TBCTL:
+      retime(b);
+      if (v & TBCLR)
+      {
+        Mcu_Set(b, TBCTL, v & ~TBCLR);
+        b->tb.count = 0;
+        b->tb.base = b->now;
+      }
+      break;
+    case WDTCTL:
+      if ((v & 0xFF00) != WDTPW)
+        Sim_Fatal(b, "watchdog password violation");
+      Mcu_Set(b, WDTCTL, 0x6900 | (v & 0xFF));
+      break;
+    case FCTL1:
+    case FCTL2:
+    case FCTL3:
+      if ((v & 0xFF00) != FWKEY)
+        Sim_Fatal(b, "flash key violation");
+      Mcu_Set(b, a, FRKEY | (v & 0xFF));
+      break;
+    case UCA0CTL1:
+      if (v & UCSWRST)
+        usciReset(b, 0);
+      break;
+    case UCB0CTL1:
+      if (v & UCSWRST)
+        usciReset(b, 1);
+      break;
+    case UCA0TXBUF:
+      Mcu_Set(b, UCA0TXBUF, SIM_TXIDLE);
+      if (!(REG(b, UCA0CTL1) & UCSWRST))
+        uartTx(b, (unsigned char)v);
+      break;
+    case UCB0TXBUF:
+      Mcu_Set(b, UCB0TXBUF, SIM_TXIDLE);
+      if (!(REG(b, UCB0CTL1) & UCSWRST))
+        spiTx(b, (unsigned char)v);
+      break;
+    case P3OUT:
+      if ((old ^ v) & 0x01)
+      {
+        b->frames += !(v & 0x01);
+        Radio_Cs(b->radio, !(v & 0x01), b->now);
+      }
+      break;
+    case P2OUT:
+      if ((old ^ v) & 0x1F)
+        pinChange(b, (unsigned char)(v & 0x1F));
+      break;
+  }
+}
+
+// Applies what the firmware wrote since the last hook
+void Mcu_Sync(Sim_Board *b)
+{
+  unsigned int i, s, old;
+
+  for (i = 0; i < sizeof(watched) / sizeof(watched[0]); i++)
+  {
+    s = SIM_SLOT(watched[i]);
+    if (b->reg[s] != b->shadow[s])
+    {
+      old = b->shadow[s];
+      b->shadow[s] = b->reg[s];
+      written(b, watched[i], old, b->reg[s]);
+    }
+  }
+}
+
+// Brings a register up to date just before the firmware reads it
+void Mcu_Read(Sim_Board *b, unsigned int a)
+{
+  unsigned int ctl, iv = 0;
+
+  switch (a)
+  {
+    case TAR:
+      Mcu_Set(b, TAR, timerValue(&b->ta, b->now));
+      break;
+    case TBR:
+      Mcu_Set(b, TBR, timerValue(&b->tb, b->now));
+      break;
+    case TAIV:
+      if (((ctl = REG(b, TACCTL1)) & (CCIE | CCIFG)) == (CCIE | CCIFG))
+      {
+        iv = 2;
+        Mcu_Set(b, TACCTL1, ctl & ~CCIFG);
+      }
+      else if (((ctl = REG(b, TACCTL2)) & (CCIE | CCIFG)) == (CCIE | CCIFG))
+      {
+        iv = 4;
+        Mcu_Set(b, TACCTL2, ctl & ~CCIFG);
+      }
+      else if (((ctl = REG(b, TACTL)) & (TAIE | TAIFG)) == (TAIE | TAIFG))
+      {
+        iv = 10;
+        Mcu_Set(b, TACTL, ctl & ~TAIFG);
+      }
+      Mcu_Set(b, TAIV, iv);
+      break;
+    case UCA0RXBUF:
+      clearBits(b, IFG2, UCA0RXIFG);
+      clearBits(b, UCA0STAT, UCOE);
+      break;
+    case UCB0RXBUF:
+      clearBits(b, IFG2, UCB0RXIFG);
+      clearBits(b, UCB0STAT, UCOE);
+      break;
+    case P1IN:
+      Mcu_Set(b, P1IN, (REG(b, P1OUT) & REG(b, P1DIR))
+                       | (~REG(b, P1DIR) & 0x04));
+      break;
+    case P2IN:
+      Mcu_Set(b, P2IN, (REG(b, P2OUT) & REG(b, P2DIR))
+                       | (b->gdo0 ? 0x40 : 0));
+      break;
+    case P3IN:
+      Mcu_Set(b, P3IN, (REG(b, P3OUT) & REG(b, P3DIR) & ~0x04)
+                       | (!(REG(b, P3OUT) & 0x01)
+                          && Radio_Busy(b->radio, b->now) ? 0x04 : 0));
+      break;
+  }
+}
+
+//----------------------------------------------------------------------------
+//  Events and interrupts
+//----------------------------------------------------------------------------
+
+static Sim_Time nextEvent(Sim_Board *b, int *kind)
+{
+  Sim_Time next = SIM_NEVER, t;
+  int x;
+
+  *kind = EV_NONE;
+  for (x = 0; x < 3; x++)
+    if (!(REG(b, TACCTL0 + 2 * x) & CAP))
+    {
+      t = timerWhen(&b->ta, REG(b, TACCR0 + 2 * x));
+      if (t > b->ccrDone[x] && t < next)
+      {
+        next = t;
+        *kind = EV_CCR0 + x;
+      }
+    }
+  if (capturing(b, TACCTL0) || capturing(b, TACCTL2))
+    if ((t = aclkEdgeAfter(b, b->capDone)) < next)
+    {
+      next = t;
+      *kind = EV_CAPTURE;
+    }
+  if (b->uartDone < next)
+  {
+    next = b->uartDone;
+    *kind = EV_UARTTX;
+  }
+  if (b->toBoard.count && b->toBoard.buf[b->toBoard.head].time < next)
+  {
+    next = b->toBoard.buf[b->toBoard.head].time;
+    *kind = EV_UARTRX;
+  }
+  if (b->spiDone < next)
+  {
+    next = b->spiDone;
+    *kind = EV_SPI;
+  }
+  if ((t = Radio_Next(b->radio)) < next)
+  {
+    next = t;
+    *kind = EV_RADIO;
+  }
+  return next;
+}
+
+Sim_Time Mcu_Next(Sim_Board *b)
+{
+  int kind;
+
+  return nextEvent(b, &kind);
+}
+
+static void capture(Sim_Board *b, unsigned int ctlReg, unsigned int ccrReg,
+                    Sim_Time t)
+{
+  unsigned int ctl = REG(b, ctlReg);
+
+  if (!capturing(b, ctlReg))
+    return;
+  Mcu_Set(b, ccrReg, timerValue(&b->ta, t));
+  Mcu_Set(b, ctlReg, ctl | CCIFG | (ctl & CCIFG ? COV : 0));
+}
+
+static void fire(Sim_Board *b, int kind, Sim_Time t)
+{
+  Sim_Queue *q;
+  unsigned char c;
+  int x;
+
+  switch (kind)
+  {
+    case EV_CCR0:
+    case EV_CCR1:
+    case EV_CCR2:
+      x = kind - EV_CCR0;
+      b->ccrDone[x] = t;
+      setBits(b, TACCTL0 + 2 * x, CCIFG);
+      break;
+    case EV_CAPTURE:
+      b->capDone = t;
+      capture(b, TACCTL0, TACCR0, t);
+      capture(b, TACCTL2, TACCR2, t);
+      break;
+    case EV_UARTTX:
+      Sim_Push(&b->fromBoard, t, b->uartShift);
+      b->uartDone = SIM_NEVER;
+      if (b->uartFull)
+      {
+        b->uartShift = b->uartNext;
+        b->uartFull = 0;
+        b->uartDone = t + uartByteTime(b);
+        setBits(b, IFG2, UCA0TXIFG);
+      }
+      break;
+    case EV_UARTRX:
+      q = &b->toBoard;
+      c = q->buf[q->head].c;
+      q->head = (q->head + 1) % q->size;
+      q->count--;
+      if (REG(b, UCA0CTL1) & UCSWRST)
+        break;
+      if ((b->sr & SCG1) || (REG(b, IFG2) & UCA0RXIFG))
+      {
+        b->stats.uartOverruns++;
+        if (b->sr & SCG1)
+          break;                            // SMCLK off, byte lost
+        setBits(b, UCA0STAT, UCOE);
+      }
+      Mcu_Set(b, UCA0RXBUF, c);
+      setBits(b, IFG2, UCA0RXIFG);
+      break;
+    case EV_SPI:
+      c = REG(b, P3OUT) & 0x01 ? 0xFF : Radio_Spi(b->radio, b->spiShift, t);
+      spiByte(b, b->spiShift, (unsigned char)c, t);
+      if (REG(b, IFG2) & UCB0RXIFG)
+        setBits(b, UCB0STAT, UCOE);
+      Mcu_Set(b, UCB0RXBUF, c);
+      setBits(b, IFG2, UCB0RXIFG);
+      b->spiDone = SIM_NEVER;
+      if (b->spiFull)
+      {
+        b->spiShift = b->spiNext;
+        b->spiFull = 0;
+        b->spiDone = t + spiByteTime(b);
+        setBits(b, IFG2, UCB0TXIFG);
+      }
+      break;
+    case EV_RADIO:
+      Radio_Advance(b->radio, t);
+      break;
+  }
+}
+
+// Processes every event up to and including time t
+void Mcu_Advance(Sim_Board *b, Sim_Time t)
+{
+  Sim_Time next;
+  int kind, x;
+
+  while ((next = nextEvent(b, &kind)) <= t && kind != EV_NONE)
+    fire(b, kind, next);
+  for (x = 0; x < 3; x++)
+    if (b->ccrDone[x] < t)
+      b->ccrDone[x] = t;
+  if (b->capDone < t)
+    b->capDone = t;
+}
+
+int Mcu_Pending(Sim_Board *b)
+{
+  unsigned int ifg2 = REG(b, IE2) & REG(b, IFG2);
+
+  if ((REG(b, TACCTL0) & (CCIE | CCIFG)) == (CCIE | CCIFG))
+    return VEC_TIMERA0;
+  if ((REG(b, TACCTL1) & (CCIE | CCIFG)) == (CCIE | CCIFG)
+      || (REG(b, TACCTL2) & (CCIE | CCIFG)) == (CCIE | CCIFG)
+      || (REG(b, TACTL) & (TAIE | TAIFG)) == (TAIE | TAIFG))
+    return VEC_TIMERA1;
+  if (ifg2 & (UCA0RXIFG | UCB0RXIFG))
+    return VEC_USCIRX;
+  if (ifg2 & (UCA0TXIFG | UCB0TXIFG))
+    return VEC_USCITX;
+  if (REG(b, P2IE) & REG(b, P2IFG))
+    return VEC_PORT2;
+  if (REG(b, P1IE) & REG(b, P1IFG))
+    return VEC_PORT1;
+  return -1;
+}
+
+// Flags the hardware clears when it takes the interrupt
+void Mcu_Taken(Sim_Board *b, int vector)
+{
+  if (vector == VEC_TIMERA0)
+    clearBits(b, TACCTL0, CCIFG);
+}
+
+void Mcu_Gdo0(Sim_Board *b, int level)
+{
+  if (level == b->gdo0)
+    return;
+  b->gdo0 = level;
+  if (REG(b, P2SEL) & 0x40)
+    return;
+  if ((!(REG(b, P2IES) & 0x40)) == level)   // Rising edge unless P2IES
+    setBits(b, P2IFG, 0x40);
+}
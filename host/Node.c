@@ -0,0 +1,175 @@
+//----------------------------------------------------------------------------
+//  Description:  Traffic node for the host simulator (TestCsma.c)
+//
+//  Sends NODE_PACKET_LEN-byte packets to NODE_SINK through the CC2500
+//  driver, with RFSendPacketAsync() and so with CSMA as the build sets
+//  RF_CSMA, at random times nodeGapMs apart on average.  A node with
+//  nodeGapMs 0 only listens: run one at address NODE_SINK to count the
+//  packets that got through.  The test sets nodeAddr and nodeGapMs before
+//  the board starts, and reads the counters back with Sim_Symbol().
+//  nodeProfile and nodeLen pick the modem profile and the packet size
+//  (TestProfile.c); every node of a test must use the same profile.
+//  With nodeTwice set each send is tried again at once, and must be
+//  refused while the first is under way (TestTx.c).  nodeWor makes the
+//  sink sniff with Wake-on-Radio and the others wake it (TestWor.c).
+//
+//  CC2500.c is built into this file rather than beside it, so that the
+//  boot can draw from its static backoffTicks() and record the range of
+//  each backoff in nodeBackoff[].
+//----------------------------------------------------------------------------
+
+
+#include "TI_CC/include.h"
+#include "Clock.h"
+#include "TI_CC/CC2500.c"
+
+#define NODE_SINK              0xFE
+#define NODE_PACKET_LEN        24          // About 1 ms on the air
+#define NODE_BUFFER            64
+#define NODE_DRAWS             1000        // backoffTicks() calls per try
+
+char nodeAddr = NODE_SINK;
+unsigned int nodeGapMs = 0;
+char nodeProfile = RF_PROFILE_BOOT;
+char nodeLen = NODE_PACKET_LEN;             // 3 to RF_FEC_PKTLEN
+unsigned int nodeAirtimeUs;                 // RFAirtimeUs(nodeLen)
+char nodeTwice = 0;                         // Send each packet twice
+char nodeWor = RF_WOR_OFF;                  // The sink's RFWorListen()
+
+// Backoff ticks drawn for the n-th busy try, n = 1 up to one past the last
+unsigned int nodeBackoff[RF_CSMA_MAX_BACKOFFS + 2][2];  // min, max
+
+unsigned int nodeDone;                      // Sends that went on the air
+unsigned int nodeDropped;                   // ...and that did not
+unsigned long nodeLatency;                  // ACLK ticks from start to end
+unsigned int nodeHeard;                     // Good packets, at the sink
+unsigned int nodeRefused;                   // Second sends refused
+
+static char txBuffer[NODE_BUFFER];
+static char rxBuffer[NODE_BUFFER];
+static unsigned int sendStart;
+static unsigned int seed;
+static volatile char gapOver;
+
+
+static unsigned int nodeRandom(void)
+{
+  seed = seed * 25173 + 13849;
+  return seed >> 4;
+}
+
+// CLOCK_ALARM_LINK at the end of a gap: wake main() to send
+static char gapDone(void)
+{
+  gapOver = 1;
+  return 1;
+}
+
+// LPM3, or LPM0 while the SPI runs from its interrupt and needs SMCLK
+static void sleep(void)
+{
+  _BIS_SR((TI_CC_SPIBusy() ? LPM0_bits : LPM3_bits) + GIE);
+}
+
+static void backoffRanges(void)
+{
+  unsigned int i, t;
+  char n;
+
+  for (n = 1; n <= RF_CSMA_MAX_BACKOFFS + 1; n++)
+  {
+    nodeBackoff[n][0] = 0xFFFF;
+    for (i = 0; i < NODE_DRAWS; i++)
+    {
+      t = backoffTicks(n);
+      if (t < nodeBackoff[n][0])
+        nodeBackoff[n][0] = t;
+      if (t > nodeBackoff[n][1])
+        nodeBackoff[n][1] = t;
+    }
+  }
+}
+
+
+void main(void)
+{
+  unsigned int done;
+
+  WDTCTL = WDTPW + WDTHOLD;                 // Stop WDT
+  Clock_Init();
+  P2SEL &= 0x3F;                            // XIN, XOUT pins as I/O
+  TI_CC_SPISetup();
+  while (RFInit());
+  RFSetProfile(nodeProfile);
+  RFSetAddress(nodeAddr);
+  nodeAirtimeUs = RFAirtimeUs(nodeLen);
+  seed = Clock_Now() ^ nodeAddr;
+  backoffRanges();
+
+  TI_CC_GDO0_PxIES |= TI_CC_GDO0_PIN;       // Int on falling edge of GDO0
+  TI_CC_GDO0_PxIFG &= ~TI_CC_GDO0_PIN;
+  TI_CC_GDO0_PxIE |= TI_CC_GDO0_PIN;
+  if (nodeAddr == NODE_SINK)
+    RFWorListen(nodeWor);
+  else
+  {
+    RFWorListen(RF_WOR_OFF);
+    RFWorPeer(nodeWor);
+  }
+
+  txBuffer[0] = nodeLen - 1;
+  txBuffer[1] = NODE_SINK;
+  txBuffer[2] = nodeAddr;
+  for (;;)
+  {
+    if (!nodeGapMs)                         // The sink: listen only
+    {
+      sleep();
+      continue;
+    }
+
+    gapOver = 0;                            // 1 to 2*nodeGapMs ms
+    Clock_Alarm(CLOCK_ALARM_LINK,
+                CLOCK_ACLK_TICKS(nodeRandom() % (2*nodeGapMs) + 1), gapDone);
+    _DINT();
+    while (!gapOver)
+    {
+      sleep();
+      _DINT();
+    }
+    _EINT();
+
+    sendStart = Clock_Now();
+    done = nodeDone;
+    txBuffer[3]++;
+    RFSendPacketAsync(txBuffer, nodeLen);
+    if (nodeTwice && !RFSendPacketAsync(txBuffer, nodeLen))
+      nodeRefused++;
+    _DINT();
+    while (RFTxBusy())                      // On the air, or dropped
+    {
+      sleep();
+      _DINT();
+    }
+    _EINT();
+    if (nodeDone == done)
+      nodeDropped++;
+  }
+}
+
+
+#pragma vector=PORT2_VECTOR
+__interrupt void port2_ISR(void)
+{
+  char len = sizeof(rxBuffer);
+  char event = RFGDO0Event();
+
+  if (event == RF_EVENT_TX_DONE)
+  {
+    nodeDone++;
+    nodeLatency += (unsigned int)(Clock_Now() - sendStart);
+    _BIC_SR_IRQ(LPM3_bits);
+  }
+  else if (event == RF_EVENT_RX && RFReceivePacket(rxBuffer, &len))
+    nodeHeard++;
+}
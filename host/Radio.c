@@ -0,0 +1,890 @@
+//----------------------------------------------------------------------------
+//  Description:  Simulated CC2500 and the air between the boards
+//
+//  The radio is modelled from its registers as the firmware leaves them:
+//
+//  - SPI: header byte with R/W and burst bits, strobes, status registers,
+//    PATABLE and the 64-byte FIFOs; the chip status byte comes back on
+//    every header.  SO stays high for 40 us after SRES.
+//  - States: IDLE to RX or TX through calibration (809 us, MCSM0
+//    FS_AUTOCAL = 1) or settling only (88.4 us); RX to TX in 9.6 us, during
+//    the first 3 of which MARCSTATE still reads RX; TX to RX in 21.5 us;
+//    SCAL 809 us back to IDLE; TXOFF_MODE and RXOFF_MODE after a packet.
+//  - Wake-on-Radio: SWOR sleeps until each Event 0 (WOREVT1:0, WOR_RES),
+//    starts the crystal for EVENT1 (WORCTRL), calibrates into RX and stays
+//    there for the MCSM2 RX_TIME share of the period, 3.6058 % halved
+//    RX_TIME times and divided by 32 per WOR_RES step.  A sync word found
+//    in time ends the sniffing and the radio stays in RX; none, and it
+//    sleeps again.  /CS low wakes the chip to IDLE, SO high for 150 us.
+//  - STX in RX is ignored when CCA (MCSM1 CCA_MODE) finds the channel
+//    busy: a carrier above the world's threshold, or a packet coming in.
+//  - Packets: variable or fixed length, CRC, FEC with its rate 1/2 code
+//    in 4-byte interleaver blocks, preamble and sync word from MDMCFG1/2,
+//    airtime from the data rate.  GDO0 (IOCFG0 = 0x06 only) rises at the
+//    end of the sync word and falls at the end of the packet.  Address
+//    check with both broadcasts, length filter, APPEND_STATUS with CRC_OK;
+//    CRC_AUTOFLUSH is not modelled, so bad packets reach the RXFIFO.
+//  - Sim_RadioHang(): the next packet never ends.  The radio stays in TX
+//    with GDO0 high and nothing on the air until SIDLE or SRES.
+//
+//  On the air a packet reaches each other radio along its link (Sim.h)
+//  unless lost, later by the link delay, and maybe a second time.  The
+//  receiver must be in RX, on the same channel and modem settings, from
+//  the start of the sync word.  Another packet on the channel within 10 dB
+//  of it (the capture margin) spoils it, as do bit errors: any one of them
+//  in a plain packet, more than two in a 32-bit block with FEC.
+//
+//  Interference (Sim_SetInterference()) covers a band of frequencies at
+//  one power, in spells of a fixed length each busy at random, the same
+//  for every radio.  A busy spell raises the RSSI of a channel in the band
+//  and spoils packets on it the way another packet would.
+//----------------------------------------------------------------------------
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "SimBoard.h"
+#include "TI_CC_CC2500.h"
+
+#define RADIO_FIFO              64
+#define RADIO_REGS              (TI_CCxxx0_TEST0 + 1)
+#define RADIO_XOSC_HZ           26000000.0
+
+#define T_CAL_SETTLE            SIM_NS(809000) // IDLE to RX/TX, calibrating
+#define T_SETTLE                SIM_NS(88400)  // ...or not
+#define T_CAL                   SIM_NS(809000) // SCAL
+#define T_RXTX                  SIM_NS(9600)
+#define T_RXTX_AS_RX            SIM_NS(3000)   // MARCSTATE still RX
+#define T_TXRX                  SIM_NS(21500)
+#define T_RESET                 SIM_US(40)
+#define T_XOSC                  SIM_US(150)    // SLEEP to IDLE on /CS low
+#define T_RC                    (750e12 / RADIO_XOSC_HZ)  // WOR RC period
+#define T_KEEP                  SIM_MS(50)     // Arrivals kept for overlaps
+
+#define CAPTURE_DB              10.0
+#define NOISE_DBM               (-100.0)
+
+enum
+{
+  S_IDLE, S_CAL, S_SETTLE, S_RX, S_RXTX, S_TX, S_TXRX, S_FSTXON,
+  S_RXOVF, S_TXUNF, S_SLEEP
+};
+
+// Chip status STATE field and MARCSTATE of each state
+static const unsigned char chipState[] = {0, 4, 5, 1, 1, 2, 1, 3, 6, 7, 0};
+static const unsigned char marcState[] =
+  {0x01, 0x08, 0x09, 0x0D, 0x15, 0x13, 0x10, 0x12, 0x11, 0x16, 0x00};
+
+static const unsigned char resetRegs[RADIO_REGS] =
+{
+  0x29, 0x2E, 0x3F, 0x07, 0xD3, 0x91, 0xFF, 0x04, 0x45, 0x00, 0x00, 0x0F,
+  0x00, 0x5E, 0xC4, 0xEC, 0x8C, 0x22, 0x02, 0x22, 0xF8, 0x47, 0x07, 0x30,
+  0x04, 0x36, 0x6C, 0x03, 0x40, 0x91, 0x87, 0x6B, 0xF8, 0x56, 0x10, 0xA9,
+  0x0A, 0x20, 0x0D, 0x41, 0x00, 0x59, 0x7F, 0x3F, 0x88, 0x31, 0x0B
+};
+
+static const unsigned char preambles[] = {2, 3, 4, 6, 8, 12, 16, 24};
+static const unsigned char event1[] = {4, 6, 8, 12, 16, 24, 32, 48};
+
+typedef struct
+{
+  int refs;                                 // Arrivals, and the sender
+  Sim_Time start, sync, end;                // At the sender
+  Sim_Time syncLen;
+  Sim_Time aborted;                         // SIDLE before the end
+  double freq;
+  unsigned long long modem;
+  unsigned char data[RADIO_FIFO];           // After the sync word
+  int length;
+} Air_Tx;
+
+typedef struct Arrival
+{
+  Air_Tx *tx;
+  Sim_Time start, sync, end, drop;          // At the receiver
+  double rssi, ber;
+  int stage;                                // Before sync, locked, over
+  struct Arrival *next;
+} Arrival;
+
+struct Radio
+{
+  Sim_Board *board;
+  unsigned char reg[RADIO_REGS];
+  unsigned char pa[8];
+  unsigned char tx[RADIO_FIFO], rx[RADIO_FIFO];
+  int txn, rxn;
+  int state, next;                          // Now, and after "until"
+  Sim_Time since, until;
+  Sim_Time ready;
+  int header, addr, read, burst, paIndex;
+  Air_Tx *sending;
+  int sent;                                 // Sync word of it sent
+  int hang;                                 // Sim_RadioHang()
+  int wor;                                  // Sniffing since SWOR
+  Sim_Time event0;                          // ...and its last Event 0
+  Arrival *arrivals, *locked;
+  unsigned char lqi, crcOk;
+};
+
+//----------------------------------------------------------------------------
+//  Modem settings
+//----------------------------------------------------------------------------
+
+static double rateBps(const unsigned char *reg)
+{
+  return (256 + reg[TI_CCxxx0_MDMCFG3])
+         * pow(2, reg[TI_CCxxx0_MDMCFG4] & 0x0F) * RADIO_XOSC_HZ / (1 << 28);
+}
+
+static double freqHz(const unsigned char *reg)
+{
+  unsigned long f = (unsigned long)reg[TI_CCxxx0_FREQ2] << 16
+                    | reg[TI_CCxxx0_FREQ1] << 8 | reg[TI_CCxxx0_FREQ0];
+  double spacing = RADIO_XOSC_HZ / (1 << 18) * (256 + reg[TI_CCxxx0_MDMCFG0])
+                   * (1 << (reg[TI_CCxxx0_MDMCFG1] & 3));
+
+  return RADIO_XOSC_HZ / 65536 * f + spacing * reg[TI_CCxxx0_CHANNR];
+}
+
+// Everything both ends must agree on to hear each other, but the channel
+static unsigned long long modem(const unsigned char *reg)
+{
+  return (unsigned long long)(reg[TI_CCxxx0_MDMCFG4] & 0x0F)
+         | (unsigned long long)reg[TI_CCxxx0_MDMCFG3] << 4
+         | (unsigned long long)(reg[TI_CCxxx0_MDMCFG2] & 0x7B) << 12
+         | (unsigned long long)(reg[TI_CCxxx0_MDMCFG1] & 0x80) << 20
+         | (unsigned long long)(reg[TI_CCxxx0_PKTCTRL0] & 0x07) << 28
+         | (unsigned long long)reg[TI_CCxxx0_SYNC1] << 32
+         | (unsigned long long)reg[TI_CCxxx0_SYNC0] << 40;
+}
+
+static int syncBytes(const unsigned char *reg)
+{
+  int mode = reg[TI_CCxxx0_MDMCFG2] & 3;
+
+  return mode == 0 ? 0 : mode == 3 ? 4 : 2;
+}
+
+static int fixedLength(const unsigned char *reg)
+{
+  return (reg[TI_CCxxx0_PKTCTRL0] & 3) == 0;
+}
+
+static int crcBytes(const unsigned char *reg)
+{
+  return reg[TI_CCxxx0_PKTCTRL0] & 0x04 ? 2 : 0;
+}
+
+static int sameChannel(double a, double b)
+{
+  return fabs(a - b) < 1000;
+}
+
+static unsigned char rssiByte(double dbm)
+{
+  double v = (dbm + 72) * 2;
+
+  return (unsigned char)(signed char)(v > 127 ? 127 : v < -128 ? -128 : v);
+}
+
+//----------------------------------------------------------------------------
+//  State machine
+//----------------------------------------------------------------------------
+
+static void gdo0(Radio *r, int level)
+{
+  if ((r->reg[TI_CCxxx0_IOCFG0] & 0x3F) == 0x06)
+    Mcu_Gdo0(r->board, level);
+}
+
+static void go(Radio *r, int state, int then, Sim_Time after, Sim_Time t)
+{
+  r->state = state;
+  r->since = t;
+  r->next = then;
+  r->until = t + after;
+}
+
+static void calibrate(Radio *r)
+{
+  r->reg[TI_CCxxx0_FSCAL3] = 0xEA;
+  r->reg[TI_CCxxx0_FSCAL2] = 0x0A;
+  r->reg[TI_CCxxx0_FSCAL1] = (0x10 + r->reg[TI_CCxxx0_CHANNR] / 8) & 0x3F;
+}
+
+// From IDLE to RX or TX, calibrating first if MCSM0 says so
+static void wake(Radio *r, int then, Sim_Time t)
+{
+  if (((r->reg[TI_CCxxx0_MCSM0] >> 4) & 3) == 1)
+  {
+    calibrate(r);
+    go(r, S_CAL, then, T_CAL_SETTLE, t);
+  }
+  else
+    go(r, S_SETTLE, then, T_SETTLE, t);
+}
+
+// Wake-on-Radio Event 0 period
+static Sim_Time worPeriod(Radio *r)
+{
+  unsigned int evt0 = r->reg[TI_CCxxx0_WOREVT1] << 8
+                      | r->reg[TI_CCxxx0_WOREVT0];
+
+  return (Sim_Time)(T_RC * evt0 * (1 << 5 * (r->reg[TI_CCxxx0_WORCTRL] & 3)));
+}
+
+// Time in RX per Event 0 without a sync word, SIM_NEVER for RX_TIME 7
+static Sim_Time worTimeout(Radio *r)
+{
+  int rxTime = r->reg[TI_CCxxx0_MCSM2] & 7;
+
+  if (rxTime == 7)
+    return SIM_NEVER;
+  return (Sim_Time)(worPeriod(r) * 0.036058 / (1 << rxTime)
+                    / (1 << 5 * (r->reg[TI_CCxxx0_WORCTRL] & 3)));
+}
+
+// Asleep until the next Event 0, then EVENT1 for the crystal to start
+static void worSleep(Radio *r, Sim_Time t)
+{
+  Sim_Time period = worPeriod(r);
+
+  while (period && r->event0 <= t)
+    r->event0 += period;
+  go(r, S_SLEEP, S_RX, r->event0 - t
+     + (Sim_Time)(T_RC * event1[(r->reg[TI_CCxxx0_WORCTRL] >> 4) & 7]), t);
+}
+
+static void unlock(Radio *r)
+{
+  if (!r->locked)
+    return;
+  r->locked->stage = 2;
+  r->locked = 0;
+  gdo0(r, 0);
+}
+
+static void release(Air_Tx *a)
+{
+  if (--a->refs == 0)
+    free(a);
+}
+
+// Interference spell "s" busy, from a hash of its number and the seed
+static int spellBusy(unsigned long long s)
+{
+  unsigned long long h = (s ^ sim.seed) * 0x9E3779B97F4A7C15ULL;
+
+  h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;  // splitmix64
+  h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+  h ^= h >> 31;
+  return (h >> 11) * (1.0 / 9007199254740992.0) < sim.interference.busy;
+}
+
+// Interference on frequency f at any time in [from, to]
+static int jammed(double f, Sim_Time from, Sim_Time to)
+{
+  const Sim_Interference *j = &sim.interference;
+  unsigned long long s;
+
+  if (j->busy <= 0 || !j->spell || f < j->lowHz || f > j->highHz)
+    return 0;
+  for (s = from / j->spell; s <= to / j->spell; s++)
+    if (spellBusy(s))
+      return 1;
+  return 0;
+}
+
+// Strongest signal on our channel at time t, dBm
+static double rssiAt(Radio *r, Sim_Time t)
+{
+  double f = freqHz(r->reg), best = NOISE_DBM;
+  Arrival *v;
+
+  for (v = r->arrivals; v; v = v->next)
+    if (v->start <= t && t < v->end && sameChannel(v->tx->freq, f)
+        && v->rssi > best)
+      best = v->rssi;
+  if (sim.interference.dbm > best && jammed(f, t, t))
+    best = sim.interference.dbm;
+  return best;
+}
+
+static int clearChannel(Radio *r, Sim_Time t)
+{
+  int carrier = rssiAt(r, t) >= sim.ccaDbm;
+
+  switch ((r->reg[TI_CCxxx0_MCSM1] >> 4) & 3)
+  {
+    case 1: return !carrier;
+    case 2: return !r->locked;
+    case 3: return !carrier && !r->locked;
+  }
+  return 1;
+}
+
+static void startTx(Radio *r, Sim_Time t)
+{
+  Sim_Board *to;
+  Sim_Link *link;
+  Air_Tx *a;
+  int n, coded, i;
+  double byte;
+
+  n = fixedLength(r->reg) ? r->reg[TI_CCxxx0_PKTLEN]
+                          : (r->txn ? r->tx[0] + 1 : 1);
+  if (!r->txn || n > r->txn)
+  {
+    r->state = S_TXUNF;
+    return;
+  }
+  a = calloc(1, sizeof(*a));
+  memcpy(a->data, r->tx, n);
+  a->length = n;
+  a->freq = freqHz(r->reg);
+  a->modem = modem(r->reg);
+  coded = n + crcBytes(r->reg);
+  if (r->reg[TI_CCxxx0_MDMCFG1] & 0x80)
+    coded = (2 * coded + 4) / 4 * 4;
+  byte = 8e12 / rateBps(r->reg);
+  a->start = t;
+  a->syncLen = (Sim_Time)(syncBytes(r->reg) * byte);
+  a->sync = t + (Sim_Time)(preambles[(r->reg[TI_CCxxx0_MDMCFG1] >> 4) & 7]
+                           * byte) + a->syncLen;
+  a->end = a->sync + (Sim_Time)(coded * byte);
+  a->aborted = SIM_NEVER;
+  a->refs = 1;
+  r->sending = a;
+  r->sent = 0;
+  r->board->stats.packetsSent++;
+  if (r->hang)
+  {
+    r->hang = 0;
+    a->end = SIM_NEVER;
+    return;
+  }
+
+  for (i = 0; i < sim.boards; i++)
+  {
+    to = sim.board[i];
+    link = &sim.link[r->board->index][i];
+    if (to == r->board || !to->radio)
+      continue;
+    if (Sim_Random() >= link->loss)
+    {
+      Arrival *v = calloc(1, sizeof(*v));
+
+      v->tx = a;
+      a->refs++;
+      v->start = a->start + link->delay;
+      v->sync = a->sync + link->delay;
+      v->end = a->end + link->delay;
+      v->drop = SIM_NEVER;
+      v->rssi = link->rssi;
+      v->ber = link->ber;
+      v->next = to->radio->arrivals;
+      to->radio->arrivals = v;
+      if (Sim_Random() < link->duplicate)
+      {
+        Arrival *d = malloc(sizeof(*d));
+
+        *d = *v;
+        a->refs++;
+        d->start += link->dupDelay;
+        d->sync += link->dupDelay;
+        d->end += link->dupDelay;
+        d->next = to->radio->arrivals;
+        to->radio->arrivals = d;
+      }
+    }
+  }
+}
+
+static void enter(Radio *r, int state, Sim_Time t)
+{
+  r->state = state;
+  r->since = t;
+  r->until = SIM_NEVER;
+  if (state == S_TX)
+    startTx(r, t);
+  else if (state == S_SLEEP)
+    worSleep(r, t);
+  else if (state == S_RX && r->wor && worTimeout(r) != SIM_NEVER)
+  {
+    r->next = S_SLEEP;                      // No sync word in time
+    r->until = t + worTimeout(r);
+  }
+}
+
+// After a packet, per TXOFF_MODE or RXOFF_MODE
+static void after(Radio *r, int mode, Sim_Time t)
+{
+  switch (mode)
+  {
+    case 0: enter(r, S_IDLE, t); break;
+    case 1: enter(r, S_FSTXON, t); break;
+    case 2: go(r, S_RXTX, S_TX, T_RXTX, t); break;
+    case 3:
+      if (r->state != S_RX)
+        go(r, S_TXRX, S_RX, T_TXRX, t);
+      break;
+  }
+}
+
+static void abortTx(Radio *r, Sim_Time t)
+{
+  if (!r->sending)
+    return;
+  r->sending->aborted = t;
+  release(r->sending);
+  r->sending = 0;
+  gdo0(r, 0);
+}
+
+static void strobe(Radio *r, int s, Sim_Time t)
+{
+  switch (s)
+  {
+    case TI_CCxxx0_SRES:
+      Radio_Reset(r);
+      r->ready = t + T_RESET;
+      break;
+    case TI_CCxxx0_SFSTXON:
+      if (r->state == S_IDLE)
+        wake(r, S_FSTXON, t);
+      break;
+    case TI_CCxxx0_SCAL:
+      if (r->state == S_IDLE)
+      {
+        calibrate(r);
+        go(r, S_CAL, S_IDLE, T_CAL, t);
+      }
+      break;
+    case TI_CCxxx0_SWOR:
+      if (r->state == S_IDLE)
+      {
+        r->wor = 1;
+        r->event0 = t;
+        worSleep(r, t);
+      }
+      break;
+    case TI_CCxxx0_SRX:
+      if (r->state == S_IDLE)
+        wake(r, S_RX, t);
+      else if (r->state == S_FSTXON)
+        go(r, S_SETTLE, S_RX, T_RXTX, t);
+      break;
+    case TI_CCxxx0_STX:
+      if (r->state == S_IDLE)
+        wake(r, S_TX, t);
+      else if (r->state == S_FSTXON)
+        go(r, S_SETTLE, S_TX, T_RXTX, t);
+      else if (r->state == S_RX && clearChannel(r, t))
+      {
+        unlock(r);
+        go(r, S_RXTX, S_TX, T_RXTX, t);
+      }
+      break;
+    case TI_CCxxx0_SIDLE:
+    case TI_CCxxx0_SXOFF:
+    case TI_CCxxx0_SPWD:
+      r->wor = 0;
+      abortTx(r, t);
+      unlock(r);
+      enter(r, S_IDLE, t);
+      break;
+    case TI_CCxxx0_SFRX:
+      r->rxn = 0;
+      if (r->state == S_RXOVF)
+        enter(r, S_IDLE, t);
+      break;
+    case TI_CCxxx0_SFTX:
+      r->txn = 0;
+      if (r->state == S_TXUNF)
+        enter(r, S_IDLE, t);
+      break;
+  }
+}
+
+//----------------------------------------------------------------------------
+//  SPI
+//----------------------------------------------------------------------------
+
+static unsigned char chipStatus(Radio *r, int read, Sim_Time t)
+{
+  int fifo = read ? r->rxn : RADIO_FIFO - r->txn;
+
+  return (t < r->ready ? 0x80 : 0) | chipState[r->state] << 4
+         | (fifo > 15 ? 15 : fifo);
+}
+
+static unsigned char status(Radio *r, int a, Sim_Time t)
+{
+  switch (a)
+  {
+    case TI_CCxxx0_PARTNUM:
+      return 0x80;
+    case TI_CCxxx0_VERSION:
+      return 0x03;
+    case TI_CCxxx0_LQI:
+      return r->lqi | (r->crcOk ? 0x80 : 0);
+    case TI_CCxxx0_RSSI:
+      return rssiByte(rssiAt(r, t));
+    case TI_CCxxx0_MARCSTATE:
+      if (r->state == S_RXTX && t - r->since < T_RXTX_AS_RX)
+        return 0x0D;
+      return marcState[r->state];
+    case TI_CCxxx0_PKTSTATUS:
+      return (r->crcOk ? 0x80 : 0) | (rssiAt(r, t) >= sim.ccaDbm ? 0x40 : 0)
+             | (clearChannel(r, t) ? 0x10 : 0) | (r->locked ? 0x08 : 0)
+             | r->board->gdo0;
+    case TI_CCxxx0_TXBYTES:
+      return r->txn | (r->state == S_TXUNF ? 0x80 : 0);
+    case TI_CCxxx0_RXBYTES:
+      return r->rxn | (r->state == S_RXOVF ? 0x80 : 0);
+  }
+  return 0;
+}
+
+static unsigned char access(Radio *r, unsigned char mosi, Sim_Time t)
+{
+  unsigned char v = 0;
+
+  if (r->addr < RADIO_REGS)
+  {
+    if (r->read)
+      v = r->reg[r->addr];
+    else
+      r->reg[r->addr] = mosi;
+    if (r->burst && r->addr < RADIO_REGS - 1)
+      r->addr++;
+  }
+  else if (r->addr < TI_CCxxx0_PATABLE)
+  {
+    v = status(r, r->addr, t);
+    r->burst = 0;
+  }
+  else if (r->addr == TI_CCxxx0_PATABLE)
+  {
+    if (r->read)
+      v = r->pa[r->paIndex];
+    else
+      r->pa[r->paIndex] = mosi;
+    r->paIndex = (r->paIndex + 1) & 7;
+  }
+  else if (r->read)
+  {
+    if (r->rxn)
+    {
+      v = r->rx[0];
+      memmove(r->rx, r->rx + 1, --r->rxn);
+    }
+  }
+  else if (r->txn < RADIO_FIFO)
+    r->tx[r->txn++] = mosi;
+  if (!r->burst)
+    r->header = 1;
+  return r->read ? v : chipStatus(r, 0, t);
+}
+
+// One byte each way, at the end of the byte; the SPI master only calls
+// this while chip select is low
+unsigned char Radio_Spi(Radio *r, unsigned char mosi, Sim_Time t)
+{
+  unsigned char s;
+
+  Radio_Advance(r, t);
+  if (!r->header)
+    return access(r, mosi, t);
+  s = chipStatus(r, mosi & 0x80, t);
+  r->addr = mosi & 0x3F;
+  r->read = mosi & 0x80;
+  r->burst = mosi & 0x40;
+  if (r->addr >= TI_CCxxx0_SRES && r->addr <= TI_CCxxx0_SNOP && !r->burst)
+    strobe(r, r->addr, t);
+  else
+    r->header = 0;
+  return s;
+}
+
+void Radio_Cs(Radio *r, int low, Sim_Time t)
+{
+  r->header = 1;
+  if (!low)
+    r->paIndex = 0;
+  Radio_Advance(r, t);
+  if (low && r->state == S_SLEEP)
+  {
+    r->wor = 0;
+    enter(r, S_IDLE, t);
+    r->ready = t + T_XOSC;
+  }
+}
+
+// SO high: the crystal is not running yet after a reset or a sleep
+int Radio_Busy(Radio *r, Sim_Time t)
+{
+  return t < r->ready;
+}
+
+//----------------------------------------------------------------------------
+//  Reception
+//----------------------------------------------------------------------------
+
+// Another packet on the channel within the capture margin of v, or
+// interference
+static int interfered(Radio *r, Arrival *v, Sim_Time from, Sim_Time to)
+{
+  Arrival *w;
+
+  if (sim.interference.dbm > v->rssi - CAPTURE_DB
+      && jammed(v->tx->freq, from, to))
+    return 1;
+  for (w = r->arrivals; w; w = w->next)
+    if (w != v && w->tx != v->tx && w->start < to && w->end > from
+        && sameChannel(w->tx->freq, v->tx->freq)
+        && w->rssi > v->rssi - CAPTURE_DB)
+      return 1;
+  return 0;
+}
+
+static int bitErrors(Radio *r, Arrival *v)
+{
+  int bits, blocks, e, i;
+
+  if (v->ber <= 0)
+    return 0;
+  bits = 8 * (v->tx->length + crcBytes(r->reg));
+  if (!(r->reg[TI_CCxxx0_MDMCFG1] & 0x80))
+    return Sim_Random() < 1 - pow(1 - v->ber, bits);
+  blocks = (2 * bits / 8 + 4) / 4;
+  while (blocks--)
+  {
+    for (e = 0, i = 0; i < 32; i++)
+      if (Sim_Random() < v->ber)
+        e++;
+    if (e > 2)
+      return 1;
+  }
+  return 0;
+}
+
+static int addressed(Radio *r, unsigned char a)
+{
+  switch (r->reg[TI_CCxxx0_PKTCTRL1] & 3)
+  {
+    case 0: return 1;
+    case 1: return a == r->reg[TI_CCxxx0_ADDR];
+    case 2: return a == r->reg[TI_CCxxx0_ADDR] || a == 0x00;
+  }
+  return a == r->reg[TI_CCxxx0_ADDR] || a == 0x00 || a == 0xFF;
+}
+
+// End of the sync word at the receiver
+static void heard(Radio *r, Arrival *v)
+{
+  Sim_Time byte = (Sim_Time)(8e12 / rateBps(r->reg));
+  Air_Tx *a = v->tx;
+
+  v->stage = 2;
+  if (!sameChannel(a->freq, freqHz(r->reg)) || a->modem != modem(r->reg))
+    return;
+  if (r->state != S_RX || r->since > v->sync - a->syncLen || r->locked
+      || interfered(r, v, v->start, v->sync))
+  {
+    r->board->stats.packetsMissed++;
+    return;
+  }
+  v->stage = 1;
+  r->locked = v;
+  gdo0(r, 1);
+  if (r->wor)                               // Sniff over: stay in RX
+  {
+    r->wor = 0;
+    r->until = SIM_NEVER;
+  }
+  if (fixedLength(r->reg))
+    return;
+  if (a->data[0] > r->reg[TI_CCxxx0_PKTLEN])
+    v->drop = v->sync + byte;
+  else if ((r->reg[TI_CCxxx0_PKTCTRL1] & 3) && !addressed(r, a->data[1]))
+    v->drop = v->sync + 2 * byte;
+}
+
+// End of the packet at the receiver
+static void received(Radio *r, Arrival *v)
+{
+  Air_Tx *a = v->tx;
+  int n = fixedLength(r->reg) ? r->reg[TI_CCxxx0_PKTLEN] : a->length;
+  int append = r->reg[TI_CCxxx0_PKTCTRL1] & 0x04 ? 2 : 0;
+  int bad;
+
+  bad = a->aborted < a->end || n != a->length || interfered(r, v, v->start,
+        v->end) || bitErrors(r, v);
+  unlock(r);
+  if (r->rxn + n + append > RADIO_FIFO)
+  {
+    enter(r, S_RXOVF, v->end);
+    return;
+  }
+  memcpy(r->rx + r->rxn, a->data, n);
+  r->rxn += n;
+  r->lqi = bad ? 60 : 10;
+  r->crcOk = !bad;
+  if (append)
+  {
+    r->rx[r->rxn++] = rssiByte(v->rssi);
+    r->rx[r->rxn++] = r->lqi | (bad ? 0 : 0x80);
+  }
+  if (bad)
+    r->board->stats.packetsCorrupt++;
+  else
+    r->board->stats.packetsHeard++;
+  after(r, (r->reg[TI_CCxxx0_MCSM1] >> 2) & 3, v->end);
+}
+
+//----------------------------------------------------------------------------
+//  Events
+//----------------------------------------------------------------------------
+
+static Sim_Time arrivalTime(Arrival *v)
+{
+  if (v->stage == 0)
+    return v->sync;
+  if (v->stage == 1)
+    return v->drop < v->end ? v->drop : v->end;
+  return SIM_NEVER;
+}
+
+Sim_Time Radio_Next(Radio *r)
+{
+  Sim_Time next = r->until, t;
+  Arrival *v;
+
+  if (r->sending)
+  {
+    t = r->sent ? r->sending->end : r->sending->sync;
+    if (t < next)
+      next = t;
+  }
+  for (v = r->arrivals; v; v = v->next)
+    if ((t = arrivalTime(v)) < next)
+      next = t;
+  return next;
+}
+
+static void sweep(Radio *r, Sim_Time t)
+{
+  Arrival **p = &r->arrivals, *v;
+
+  while ((v = *p))
+    if (v->stage == 2 && v->end + T_KEEP < t)
+    {
+      *p = v->next;
+      release(v->tx);
+      free(v);
+    }
+    else
+      p = &v->next;
+}
+
+// Processes every radio event up to and including time t
+void Radio_Advance(Radio *r, Sim_Time t)
+{
+  Sim_Time next, e;
+  Arrival *v, *first;
+  Air_Tx *a;
+  int n;
+
+  while ((next = Radio_Next(r)) <= t)
+  {
+    if (next == r->until)
+    {
+      if (r->state == S_SLEEP)
+        wake(r, S_RX, next);                // Event 1: calibrate and sniff
+      else
+        enter(r, r->next, next);
+      continue;
+    }
+    if ((a = r->sending) && next == (r->sent ? a->end : a->sync))
+    {
+      if (!r->sent)
+      {
+        r->sent = 1;
+        gdo0(r, 1);
+        continue;
+      }
+      n = a->length < r->txn ? a->length : r->txn;
+      memmove(r->tx, r->tx + n, r->txn - n);
+      r->txn -= n;
+      release(a);
+      r->sending = 0;
+      gdo0(r, 0);
+      after(r, r->reg[TI_CCxxx0_MCSM1] & 3, next);
+      continue;
+    }
+    first = 0;
+    for (v = r->arrivals; v; v = v->next)
+      if ((e = arrivalTime(v)) == next && (!first || v->sync < first->sync))
+        first = v;
+    if (!first)
+      break;
+    if (first->stage == 0)
+      heard(r, first);
+    else if (first->drop <= first->end)
+    {
+      first->stage = 2;
+      unlock(r);
+    }
+    else
+      received(r, first);
+  }
+  sweep(r, t);
+}
+
+//----------------------------------------------------------------------------
+
+void Radio_Reset(Radio *r)
+{
+  memcpy(r->reg, resetRegs, sizeof(r->reg));
+  memset(r->pa, 0, sizeof(r->pa));
+  r->pa[0] = 0xC6;
+  r->txn = r->rxn = 0;
+  abortTx(r, r->board->now);
+  unlock(r);
+  r->state = S_IDLE;
+  r->until = SIM_NEVER;
+  r->wor = 0;
+  r->header = 1;
+  r->paIndex = 0;
+  r->lqi = r->crcOk = 0;
+}
+
+void Radio_Hang(Radio *r)
+{
+  r->hang = 1;
+}
+
+Radio *Radio_New(Sim_Board *b)
+{
+  Radio *r = calloc(1, sizeof(*r));
+
+  r->board = b;
+  Radio_Reset(r);
+  return r;
+}
+
+void Radio_Free(Radio *r)
+{
+  Arrival *v;
+
+  abortTx(r, r->board->now);
+  while ((v = r->arrivals))
+  {
+    r->arrivals = v->next;
+    release(v->tx);
+    free(v);
+  }
+  free(r);
+}
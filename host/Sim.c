@@ -0,0 +1,722 @@
+//----------------------------------------------------------------------------
+//  Description:  Host simulator core: boards, scheduling, CPU hooks
+//
+//  Each board's firmware runs on its own stack (ucontext).  The firmware
+//  enters the simulator through Sim_Reg(), the intrinsics and the
+//  -finstrument-functions entry hook; each of these
+//
+//    1. applies the registers written since the last hook (Mcu_Sync),
+//    2. charges the CPU an estimate of the MCLK cycles spent,
+//    3. processes the board's peripheral events up to its time,
+//    4. hands over to the scheduler if the board got more than SIM_QUANTUM
+//       ahead of the others, and
+//    5. takes pending interrupts if GIE is set.
+//
+//  A sleeping board (CPUOFF) is resumed at its next event.  SIM_QUANTUM is
+//  shorter than any radio turnaround, so a packet or a busy channel never
+//  reaches a board later than it should.
+//
+//  The flash segments of the firmware's cache (the "flash" object in
+//  Cache.c) stay write-protected.  A write traps: with the controller
+//  unlocked and in ERASE or WRT mode, the write is single-stepped and the
+//  segment erased, or the written bits ANDed into the old contents, and
+//  the CPU stalls for the flash timing generator as the MSP430 would.  A
+//  write to locked flash stops the simulation.
+//----------------------------------------------------------------------------
+
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <elf.h>
+#include <fcntl.h>
+#include <link.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "SimBoard.h"
+
+#define SIM_QUANTUM             SIM_US(4)
+#define SIM_STACK               (256 * 1024)
+#define SIM_SCRIPTS             256
+
+// Estimated MCLK cycles
+#define CYCLES_REG              4           // Absolute-mode operand
+#define CYCLES_CALL             10          // CALL, RET, PUSH/POP
+#define CYCLES_INTRINSIC        2
+#define CYCLES_INTERRUPT        6
+#define CYCLES_RETI             5
+
+// Flash timing generator cycles (MSP430x2xx family guide)
+#define FLASH_ERASE_TFTG        4819
+#define FLASH_BYTE_TFTG         30
+
+#define TRAP_FLAG               0x100       // EFLAGS TF
+
+// Interrupt service routines by vector, the names the firmware uses
+static const char *isrNames[VEC_COUNT][2] =
+{
+  {"motion_ISR", "stream_ISR"},
+  {"clock_ISR", 0},
+  {"USCIAB0RX_ISR", 0},
+  {"USCI0TX_ISR", 0},
+  {"port2_ISR", 0},
+  {"port1_ISR", 0}
+};
+
+typedef struct
+{
+  Sim_Time when;
+  void (*action)(void *);
+  void *arg;
+} Sim_Script;
+
+Sim_World sim;
+Sim_Board *sim_cur;
+
+static Sim_Script scripts[SIM_SCRIPTS];
+static int scriptCount;
+static char firmwareDir[512] = SIM_FIRMWARE_DIR;
+
+void Sim_Fatal(Sim_Board *b, const char *what)
+{
+  fprintf(stderr, "sim: %s at %.3f ms: %s\n", b ? b->name : "-",
+          (b ? b->now : sim.now) / 1e9, what);
+  exit(2);
+}
+
+void Sim_Push(Sim_Queue *q, Sim_Time time, unsigned char c)
+{
+  Sim_Byte *buf;
+  int i;
+
+  if (q->count == q->size)
+  {
+    buf = malloc((q->size ? 2 * q->size : 256) * sizeof(*buf));
+    for (i = 0; i < q->count; i++)
+      buf[i] = q->buf[(q->head + i) % q->size];
+    free(q->buf);
+    q->buf = buf;
+    q->head = 0;
+    q->size = q->size ? 2 * q->size : 256;
+  }
+  q->buf[(q->head + q->count) % q->size].time = time;
+  q->buf[(q->head + q->count++) % q->size].c = c;
+}
+
+double Sim_Random(void)
+{
+  sim.rng ^= sim.rng << 13;                 // xorshift64
+  sim.rng ^= sim.rng >> 7;
+  sim.rng ^= sim.rng << 17;
+  return (sim.rng >> 11) * (1.0 / 9007199254740992.0);
+}
+
+//----------------------------------------------------------------------------
+//  CPU
+//----------------------------------------------------------------------------
+
+static void spend(Sim_Board *b, unsigned int cycles)
+{
+  Sim_Time dt = (Sim_Time)(cycles * b->cycle + 0.5) + b->stall;
+
+  b->stall = 0;
+  b->now += dt;
+  b->stats.busy += dt;
+}
+
+static void yield(Sim_Board *b)
+{
+  swapcontext(&b->ctx, &sim.main);
+}
+
+static int dispatch(Sim_Board *b)
+{
+  int v;
+
+  Mcu_Sync(b);                              // What the last ISR wrote
+  if (!(b->sr & GIE) || (v = Mcu_Pending(b)) < 0)
+    return 0;
+  if (!b->isr[v])
+    Sim_Fatal(b, "interrupt without a handler");
+  if (b->depth == (int)(sizeof(b->saved) / sizeof(b->saved[0])))
+    Sim_Fatal(b, "interrupts nested too deep");
+  b->saved[b->depth++] = b->sr;
+  b->sr &= SCG0;
+  Mcu_Clocks(b);
+  Mcu_Taken(b, v);
+  spend(b, CYCLES_INTERRUPT);
+  b->stats.interrupts++;
+  b->isr[v]();
+  spend(b, CYCLES_RETI);
+  b->sr = b->saved[--b->depth];
+  Mcu_Clocks(b);
+  return 1;
+}
+
+static void hook(unsigned int cycles)
+{
+  Sim_Board *b = sim_cur;
+
+  Mcu_Sync(b);
+  spend(b, cycles);
+  Mcu_Advance(b, b->now);
+  if (b->now > sim.limit)
+    yield(b);
+  while (dispatch(b))
+    ;
+}
+
+static void lowPower(Sim_Board *b)
+{
+  while (b->sr & CPUOFF)
+  {
+    if (dispatch(b))
+      continue;
+    if (!(b->sr & GIE))
+      Sim_Fatal(b, "sleeps with interrupts disabled");
+    b->sleeping = 1;
+    yield(b);
+    b->sleeping = 0;
+    Mcu_Advance(b, b->now);
+  }
+}
+
+void *Sim_Reg(unsigned int address)
+{
+  hook(CYCLES_REG);
+  Mcu_Read(sim_cur, address);
+  return &sim_cur->reg[SIM_SLOT(address)];
+}
+
+void __cyg_profile_func_enter(void *fn, void *site)
+{
+  (void)fn;
+  (void)site;
+  hook(CYCLES_CALL);
+}
+
+void __cyg_profile_func_exit(void *fn, void *site)
+{
+  (void)fn;
+  (void)site;
+}
+
+void _BIS_SR(unsigned int bits)
+{
+  hook(CYCLES_INTRINSIC);
+  sim_cur->sr |= bits;
+  Mcu_Clocks(sim_cur);
+  if (bits & GIE)
+    while (dispatch(sim_cur))
+      ;
+  lowPower(sim_cur);
+}
+
+void _BIC_SR_IRQ(unsigned int bits)
+{
+  hook(CYCLES_INTRINSIC);
+  if (!sim_cur->depth)
+    Sim_Fatal(sim_cur, "_BIC_SR_IRQ outside an interrupt");
+  sim_cur->saved[sim_cur->depth - 1] &= ~bits;
+}
+
+void _DINT(void)
+{
+  hook(CYCLES_INTRINSIC);
+  sim_cur->sr &= ~GIE;
+}
+
+void _EINT(void)
+{
+  sim_cur->sr |= GIE;
+  hook(CYCLES_INTRINSIC);
+}
+
+void __disable_interrupt(void)
+{
+  _DINT();
+}
+
+void __enable_interrupt(void)
+{
+  _EINT();
+}
+
+__istate_t __get_interrupt_state(void)
+{
+  hook(CYCLES_INTRINSIC);
+  return sim_cur->sr;
+}
+
+void __set_interrupt_state(__istate_t state)
+{
+  sim_cur->sr = (sim_cur->sr & ~GIE) | (state & GIE);
+  hook(CYCLES_INTRINSIC);
+}
+
+static void boardMain(void)
+{
+  sim_cur->entry();
+  Sim_Fatal(sim_cur, "main() returned");
+}
+
+//----------------------------------------------------------------------------
+//  Flash
+//----------------------------------------------------------------------------
+
+static void flashProtect(Sim_Board *b, int prot)
+{
+  long page = sysconf(_SC_PAGESIZE);
+  unsigned long start = (unsigned long)b->flash & ~(page - 1);
+  unsigned long end = ((unsigned long)b->flash + b->flashSize + page - 1)
+                      & ~(page - 1);
+
+  if (mprotect((void *)start, end - start, prot))
+    Sim_Fatal(b, "cannot protect the flash image");
+}
+
+// The single-stepped write is done: make it what the flash would have done
+static void flashWritten(Sim_Board *b)
+{
+  unsigned int mode = b->reg[SIM_SLOT(FCTL1)] & (ERASE | WRT);
+  unsigned int fctl2 = b->reg[SIM_SLOT(FCTL2)];
+  double tftg = b->cycle * ((fctl2 & 0x3F) + 1);
+  unsigned int i, seg;
+
+  if (mode == ERASE)
+  {
+    seg = b->flashAt / 512 * 512;
+    memcpy(b->flash, b->flashPre, b->flashSize);
+    memset(b->flash + seg, 0xFF, 512);
+    b->stall += (Sim_Time)(FLASH_ERASE_TFTG * tftg);
+    b->stats.flashErases++;
+  }
+  else if (mode == WRT)
+  {
+    for (i = 0; i < b->flashSize; i++)
+      b->flash[i] &= b->flashPre[i];
+    b->stall += (Sim_Time)(FLASH_BYTE_TFTG * tftg);
+    b->stats.flashBytes++;
+  }
+  else
+    memcpy(b->flash, b->flashPre, b->flashSize);
+}
+
+static void flashTrap(int sig, siginfo_t *si, void *context)
+{
+  ucontext_t *uc = context;
+  Sim_Board *b = sim_cur;
+  unsigned char *a = si->si_addr;
+
+  if (sig == SIGSEGV)
+  {
+    if (!b || !b->flash || a < b->flash || a >= b->flash + b->flashSize)
+    {
+      signal(SIGSEGV, SIG_DFL);
+      return;
+    }
+    if (b->reg[SIM_SLOT(FCTL3)] & LOCK)
+      Sim_Fatal(b, "writes locked flash");
+    memcpy(b->flashPre, b->flash, b->flashSize);
+    b->flashAt = a - b->flash;
+    b->flashStep = 1;
+    flashProtect(b, PROT_READ | PROT_WRITE);
+    uc->uc_mcontext.gregs[REG_EFL] |= TRAP_FLAG;
+    return;
+  }
+  if (!b || !b->flashStep)
+  {
+    signal(SIGTRAP, SIG_DFL);
+    return;
+  }
+  uc->uc_mcontext.gregs[REG_EFL] &= ~TRAP_FLAG;
+  b->flashStep = 0;
+  flashWritten(b);
+  flashProtect(b, PROT_READ);
+}
+
+// Finds a data object in the firmware's symbol table, statics included
+static unsigned long elfObject(const char *path, const char *name,
+                               unsigned long *size)
+{
+  int fd = open(path, O_RDONLY);
+  struct stat st;
+  unsigned char *map;
+  Elf64_Ehdr *eh;
+  Elf64_Shdr *sh;
+  Elf64_Sym *sym;
+  const char *str;
+  unsigned long value = 0, n, i, j;
+
+  if (fd < 0 || fstat(fd, &st))
+    return 0;
+  map = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+    return 0;
+  eh = (Elf64_Ehdr *)map;
+  sh = (Elf64_Shdr *)(map + eh->e_shoff);
+  for (i = 0; i < eh->e_shnum && !value; i++)
+    if (sh[i].sh_type == SHT_SYMTAB)
+    {
+      sym = (Elf64_Sym *)(map + sh[i].sh_offset);
+      str = (const char *)(map + sh[sh[i].sh_link].sh_offset);
+      n = sh[i].sh_size / sizeof(*sym);
+      for (j = 0; j < n; j++)
+        if (ELF64_ST_TYPE(sym[j].st_info) == STT_OBJECT
+            && !strcmp(str + sym[j].st_name, name))
+        {
+          value = sym[j].st_value;
+          *size = sym[j].st_size;
+          break;
+        }
+    }
+  munmap(map, st.st_size);
+  return value;
+}
+
+//----------------------------------------------------------------------------
+//  Boards
+//----------------------------------------------------------------------------
+
+// A private copy of the firmware, so that every board has its own globals
+static void load(Sim_Board *b)
+{
+  char tmp[] = "/tmp/simfw-XXXXXX";
+  char buf[65536];
+  struct link_map *lm;
+  unsigned long offset, size = 0;
+  int in, out, n, v, i;
+
+  in = open(b->path, O_RDONLY);
+  out = mkstemp(tmp);
+  if (in < 0 || out < 0)
+    Sim_Fatal(b, "cannot copy the firmware");
+  while ((n = read(in, buf, sizeof(buf))) > 0)
+    if (write(out, buf, n) != n)
+      Sim_Fatal(b, "cannot copy the firmware");
+  close(in);
+  close(out);
+  b->lib = dlopen(tmp, RTLD_NOW | RTLD_LOCAL);
+  unlink(tmp);
+  if (!b->lib)
+    Sim_Fatal(b, dlerror());
+  b->entry = (void (*)(void))dlsym(b->lib, "sim_firmware_main");
+  if (!b->entry)
+    Sim_Fatal(b, "no main()");
+  for (v = 0; v < VEC_COUNT; v++)
+  {
+    b->isr[v] = 0;
+    for (i = 0; i < 2 && isrNames[v][i] && !b->isr[v]; i++)
+      b->isr[v] = (void (*)(void))dlsym(b->lib, isrNames[v][i]);
+  }
+
+  b->flash = 0;
+  if ((offset = elfObject(b->path, "flash", &size)))
+  {
+    dlinfo(b->lib, RTLD_DI_LINKMAP, &lm);
+    b->flash = (unsigned char *)(lm->l_addr + offset);
+    b->flashSize = size;
+    free(b->flashPre);
+    b->flashPre = malloc(size);
+    flashProtect(b, PROT_READ);
+  }
+
+  if (!b->stack)
+    b->stack = malloc(SIM_STACK);
+  getcontext(&b->ctx);
+  b->ctx.uc_stack.ss_sp = b->stack;
+  b->ctx.uc_stack.ss_size = SIM_STACK;
+  b->ctx.uc_link = 0;
+  makecontext(&b->ctx, boardMain, 0);
+  b->sleeping = 0;
+  b->stall = 0;
+  Mcu_Reset(b);
+  Radio_Reset(b->radio);
+}
+
+void Sim_Init(unsigned long seed)
+{
+  struct sigaction sa;
+  const char *dir = getenv("SIM_FIRMWARE_DIR");
+
+  Sim_Free();
+  memset(&sim, 0, sizeof(sim));
+  sim.rng = 0x9E3779B97F4A7C15ULL ^ seed;
+  sim.seed = seed;
+  sim.ccaDbm = -85;
+  if (dir)
+    snprintf(firmwareDir, sizeof(firmwareDir), "%s", dir);
+
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_sigaction = flashTrap;
+  sa.sa_flags = SA_SIGINFO | SA_NODEFER;
+  sigaction(SIGSEGV, &sa, 0);
+  sigaction(SIGTRAP, &sa, 0);
+}
+
+void Sim_Free(void)
+{
+  Sim_Board *b;
+  int i;
+
+  for (i = 0; i < sim.boards; i++)
+  {
+    b = sim.board[i];
+    Radio_Free(b->radio);
+    dlclose(b->lib);
+    free(b->stack);
+    free(b->flashPre);
+    free(b->pins);
+    free(b->spi);
+    free(b->toBoard.buf);
+    free(b->fromBoard.buf);
+    free(b);
+  }
+  sim.boards = 0;
+  scriptCount = 0;
+}
+
+Sim_Board *Sim_AddBoard(const char *firmware, double vloHz)
+{
+  Sim_Link link = {0, 0, 0, 0, 0, -50};
+  Sim_Board *b;
+  int i;
+
+  if (sim.boards == SIM_MAX_BOARDS)
+    Sim_Fatal(0, "too many boards");
+  b = calloc(1, sizeof(*b));
+  snprintf(b->name, sizeof(b->name), "%s#%d", firmware, sim.boards);
+  snprintf(b->path, sizeof(b->path), "%s/%s.so", firmwareDir, firmware);
+  b->index = sim.boards;
+  b->vlo = vloHz;
+  b->now = sim.now;
+  b->baud = 9600;
+  b->radio = Radio_New(b);
+  sim.board[sim.boards++] = b;
+  for (i = 0; i < sim.boards; i++)
+  {
+    sim.link[i][b->index] = link;
+    sim.link[b->index][i] = link;
+  }
+  load(b);
+  return b;
+}
+
+void Sim_SetLink(Sim_Board *from, Sim_Board *to, const Sim_Link *link)
+{
+  sim.link[from->index][to->index] = *link;
+}
+
+// Interference on every radio, in place of any before; busy 0 for none
+void Sim_SetInterference(const Sim_Interference *interference)
+{
+  sim.interference = *interference;
+}
+
+// The board's next packet never ends, see Radio.c
+void Sim_RadioHang(Sim_Board *b)
+{
+  Radio_Hang(b->radio);
+}
+
+// Power off and on again: a fresh copy of the firmware, the flash kept
+void Sim_PowerCycle(Sim_Board *b)
+{
+  unsigned char *keep = 0;
+
+  if (b->flash)
+  {
+    keep = malloc(b->flashSize);
+    memcpy(keep, b->flash, b->flashSize);
+  }
+  Radio_Free(b->radio);
+  b->radio = Radio_New(b);
+  dlclose(b->lib);
+  if (b->now < sim.now)
+    b->now = sim.now;
+  load(b);
+  if (keep)
+  {
+    flashProtect(b, PROT_READ | PROT_WRITE);
+    memcpy(b->flash, keep, b->flashSize);
+    flashProtect(b, PROT_READ);
+    free(keep);
+  }
+}
+
+//----------------------------------------------------------------------------
+//  Scheduling
+//----------------------------------------------------------------------------
+
+void Sim_At(Sim_Time when, void (*action)(void *), void *arg)
+{
+  int i;
+
+  if (scriptCount == SIM_SCRIPTS)
+    Sim_Fatal(0, "too many scripted actions");
+  for (i = scriptCount++; i > 0 && scripts[i - 1].when > when; i--)
+    scripts[i] = scripts[i - 1];
+  scripts[i].when = when;
+  scripts[i].action = action;
+  scripts[i].arg = arg;
+}
+
+static Sim_Time horizon(Sim_Board *b)
+{
+  return b->sleeping ? Mcu_Next(b) : b->now;
+}
+
+void Sim_Run(Sim_Time until, int (*stop)(void *), void *arg)
+{
+  Sim_Board *best;
+  Sim_Script s;
+  Sim_Time first, second, next, h;
+  int i;
+
+  for (;;)
+  {
+    if (stop && stop(arg))
+      return;
+    best = 0;
+    first = second = SIM_NEVER;
+    for (i = 0; i < sim.boards; i++)
+    {
+      h = horizon(sim.board[i]);
+      if (h < first)
+      {
+        second = first;
+        first = h;
+        best = sim.board[i];
+      }
+      else if (h < second)
+        second = h;
+    }
+    next = scriptCount ? scripts[0].when : SIM_NEVER;
+    if (next < until && next <= first)
+    {
+      if (sim.now < next)
+        sim.now = next;
+      s = scripts[0];
+      memmove(scripts, scripts + 1, --scriptCount * sizeof(*scripts));
+      s.action(s.arg);
+      continue;
+    }
+    if (first >= until)
+    {
+      if (sim.now < until)
+        sim.now = until;
+      return;
+    }
+    if (sim.now < first)
+      sim.now = first;
+    if (best->now < first)
+      best->now = first;
+    if (second > next)
+      second = next;
+    if (second > until)
+      second = until;
+    sim.limit = second + SIM_QUANTUM;
+    sim_cur = best;
+    swapcontext(&sim.main, &best->ctx);
+    sim_cur = 0;
+  }
+}
+
+Sim_Time Sim_Now(void)
+{
+  return sim.now;
+}
+
+//----------------------------------------------------------------------------
+//  Inspection and the serial line
+//----------------------------------------------------------------------------
+
+const Sim_Stats *Sim_BoardStats(Sim_Board *b)
+{
+  return &b->stats;
+}
+
+const Sim_PinChange *Sim_Pins(Sim_Board *b, int *count)
+{
+  *count = b->pinCount;
+  return b->pins;
+}
+
+// Start logging the SPI bytes afresh, or stop
+void Sim_SpiLog(Sim_Board *b, int on)
+{
+  b->spiLog = on;
+  if (on)
+    b->spiCount = 0;
+}
+
+const Sim_SpiByte *Sim_Spi(Sim_Board *b, int *count)
+{
+  *count = b->spiCount;
+  return b->spi;
+}
+
+void *Sim_Symbol(Sim_Board *b, const char *name)
+{
+  void *p = dlsym(b->lib, name);
+  struct link_map *lm;
+  unsigned long offset, size;
+
+  if (!p && (offset = elfObject(b->path, name, &size)))
+  {
+    dlinfo(b->lib, RTLD_DI_LINKMAP, &lm);
+    p = (void *)(lm->l_addr + offset);
+  }
+  return p;
+}
+
+unsigned char *Sim_Flash(Sim_Board *b, unsigned int *size)
+{
+  *size = b->flashSize;
+  return b->flash;
+}
+
+double Sim_Mclk(Sim_Board *b)
+{
+  return b->mclk;
+}
+
+void Sim_SerialBaud(Sim_Board *b, unsigned long baud)
+{
+  b->baud = baud;
+}
+
+// Bytes from the host, each arriving at the end of its stop bit
+Sim_Time Sim_SerialWrite(Sim_Board *b, const char *data, int length)
+{
+  double byte = 10e12 / b->baud;
+  Sim_Time start = b->lineFree;
+  int i;
+
+  if (start < sim.now)
+    start = sim.now;
+  if (start < b->now)
+    start = b->now;
+  for (i = 0; i < length; i++)
+    Sim_Push(&b->toBoard, start + (Sim_Time)((i + 1) * byte), data[i]);
+  b->lineFree = start + (Sim_Time)(length * byte);
+  return b->lineFree;
+}
+
+int Sim_SerialRead(Sim_Board *b, unsigned char *c, Sim_Time *when)
+{
+  Sim_Queue *q = &b->fromBoard;
+
+  if (!q->count)
+    return 0;
+  *c = q->buf[q->head].c;
+  if (when)
+    *when = q->buf[q->head].time;
+  q->head = (q->head + 1) % q->size;
+  q->count--;
+  return 1;
+}
@@ -0,0 +1,113 @@
+//----------------------------------------------------------------------------
+//  Description:  Host simulator of eZ430-RF2500 boards and the air between
+//
+//  Each board runs one firmware build, a shared object compiled from the
+//  firmware sources against msp430sim.h (see CMakeLists.txt), with its own
+//  copy of every global.  Sim_Run() interleaves the boards in simulated
+//  time: a board runs until it sleeps or gets a few microseconds ahead of
+//  the others, so nothing one board does can reach another before it
+//  happened.  The CPU is charged an estimate of MCLK cycles per register
+//  access, function call and interrupt, so busy times are comparative
+//  rather than exact.
+//
+//  Around the CPU: the DCO at the calibrated frequencies, the VLO, Timer_A
+//  (compare and ACLK capture), Timer_B, the UART and SPI USCIs, ports 1-3
+//  and the flash controller.  The CC2500 behind the SPI port is modelled
+//  from its registers (Radio.c): states and their timings, FIFOs, GDO0,
+//  CCA, address filtering and packet airtime.  Packets cross the air along
+//  one-way links with loss, bit errors, duplicates and extra delay, and
+//  may meet interference in a band of frequencies.
+//----------------------------------------------------------------------------
+
+#ifndef SIM_H
+#define SIM_H
+
+typedef unsigned long long Sim_Time;        // Picoseconds
+
+#define SIM_NS(n)               ((Sim_Time)(n) * 1000)
+#define SIM_US(n)               ((Sim_Time)(n) * 1000000)
+#define SIM_MS(n)               ((Sim_Time)(n) * 1000000000)
+#define SIM_NEVER               (~(Sim_Time)0)
+
+#define SIM_MAX_BOARDS          24
+
+typedef struct Sim_Board Sim_Board;
+
+// One direction of a radio link, see Sim_SetLink()
+typedef struct
+{
+  double loss;                              // Packets never heard, 0 to 1
+  double ber;                               // Bit error rate
+  double duplicate;                         // Packets heard a second time,
+  Sim_Time dupDelay;                        // ...this much later
+  Sim_Time delay;                           // Added to every packet
+  double rssi;                              // Received power, dBm
+} Sim_Link;
+
+// A band busy part of the time, such as a Wi-Fi channel, see
+// Sim_SetInterference()
+typedef struct
+{
+  double lowHz, highHz;
+  double busy;                              // Share of the time, 0 to 1
+  Sim_Time spell;                           // Busy or quiet this long a time
+  double dbm;                               // At every receiver
+} Sim_Interference;
+
+// A change of the motor pins, P2OUT bits 0-4
+typedef struct
+{
+  Sim_Time time;
+  unsigned char pins;
+} Sim_PinChange;
+
+// A byte exchanged with the radio, see Sim_SpiLog()
+typedef struct
+{
+  Sim_Time time;                            // End of the byte
+  unsigned int frame;                       // /CS low period, from 1; 0 if
+                                            // /CS was high
+  unsigned char mosi, miso;
+} Sim_SpiByte;
+
+typedef struct
+{
+  Sim_Time busy;                            // CPU awake, flash stalls too
+  unsigned long interrupts;
+  unsigned long packetsSent;
+  unsigned long packetsHeard;               // In the RX FIFO, CRC good
+  unsigned long packetsCorrupt;             // In the RX FIFO, CRC bad
+  unsigned long packetsMissed;              // Reached the antenna in vain
+  unsigned long flashErases;
+  unsigned long flashBytes;
+  unsigned long uartOverruns;
+} Sim_Stats;
+
+void Sim_Init(unsigned long seed);
+void Sim_Free(void);
+
+Sim_Board *Sim_AddBoard(const char *firmware, double vloHz);
+void Sim_SetLink(Sim_Board *from, Sim_Board *to, const Sim_Link *link);
+void Sim_SetInterference(const Sim_Interference *interference);
+void Sim_PowerCycle(Sim_Board *board);
+void Sim_RadioHang(Sim_Board *board);
+
+void Sim_At(Sim_Time when, void (*action)(void *), void *arg);
+void Sim_Run(Sim_Time until, int (*stop)(void *), void *arg);
+Sim_Time Sim_Now(void);
+double Sim_Random(void);
+
+const Sim_Stats *Sim_BoardStats(Sim_Board *board);
+const Sim_PinChange *Sim_Pins(Sim_Board *board, int *count);
+void Sim_SpiLog(Sim_Board *board, int on);
+const Sim_SpiByte *Sim_Spi(Sim_Board *board, int *count);
+void *Sim_Symbol(Sim_Board *board, const char *name);
+unsigned char *Sim_Flash(Sim_Board *board, unsigned int *size);
+double Sim_Mclk(Sim_Board *board);
+
+// The board's UART, seen from the host end of the cable
+void Sim_SerialBaud(Sim_Board *board, unsigned long baud);
+Sim_Time Sim_SerialWrite(Sim_Board *board, const char *data, int length);
+int Sim_SerialRead(Sim_Board *board, unsigned char *c, Sim_Time *when);
+
+#endif
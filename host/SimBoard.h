@@ -0,0 +1,143 @@
+//----------------------------------------------------------------------------
+//  Description:  Simulator internals shared by Sim.c, Mcu.c and Radio.c
+//
+//  The register file holds one word per MSP430 address of the peripheral
+//  space, plus the calibration constants of information memory.  A shadow
+//  copy tells the simulator what the firmware wrote since the last hook;
+//  the simulator's own changes go through Mcu_Set(), which keeps the two
+//  in step.
+//----------------------------------------------------------------------------
+
+#ifndef SIM_BOARD_H
+#define SIM_BOARD_H
+
+#define SIM_HOST
+#include <ucontext.h>
+#include "msp430sim.h"
+#include "Sim.h"
+
+#define SIM_REGS                0x208
+#define SIM_SLOT(a)             ((a) < 0x200 ? (a) : 0x200 + ((a) - 0x10F8))
+#define SIM_TXIDLE              0x100       // In a TX buffer nobody wrote
+
+// Interrupt vectors, highest priority first
+enum
+{
+  VEC_TIMERA0,
+  VEC_TIMERA1,
+  VEC_USCIRX,
+  VEC_USCITX,
+  VEC_PORT2,
+  VEC_PORT1,
+  VEC_COUNT
+};
+
+typedef struct Radio Radio;
+
+typedef struct
+{
+  unsigned int count;                       // Counter value at...
+  Sim_Time base;                            // ...this tick
+  double period;                            // ps per count, 0 when stopped
+} Sim_Timer;
+
+typedef struct
+{
+  Sim_Time time;
+  unsigned char c;
+} Sim_Byte;
+
+typedef struct
+{
+  Sim_Byte *buf;
+  int head, count, size;
+} Sim_Queue;
+
+struct Sim_Board
+{
+  char name[64];
+  char path[512];
+  int index;
+  void *lib;
+  void (*entry)(void);
+  void (*isr[VEC_COUNT])(void);
+  ucontext_t ctx;
+  char *stack;
+  int sleeping;
+
+  unsigned int reg[SIM_REGS];
+  unsigned int shadow[SIM_REGS];
+  unsigned int sr;
+  unsigned int saved[8];                    // SR pushed by each interrupt
+  int depth;
+  Sim_Time now;
+  Sim_Time stall;                           // Flash time not yet charged
+  double mclk, cycle;                       // Hz, ps
+  double vlo;
+
+  Sim_Timer ta, tb;
+  Sim_Time ccrDone[3], capDone;
+  Sim_Time uartDone, spiDone;
+  Sim_Time spiLeft;                         // Of a byte stopped by LPM3
+  unsigned char uartShift, uartNext, spiShift, spiNext;
+  int uartFull, spiFull;
+  int gdo0;
+  Radio *radio;
+
+  unsigned long baud;                       // Host end of the serial line
+  Sim_Time lineFree;
+  Sim_Queue toBoard, fromBoard;
+
+  unsigned char *flash, *flashPre;
+  unsigned int flashSize;
+  long flashAt;
+  int flashStep;
+
+  Sim_PinChange *pins;
+  int pinCount, pinSize;
+  Sim_SpiByte *spi;                         // Logged while spiLog
+  int spiLog, spiCount, spiSize;
+  unsigned int frames;                      // /CS falling edges
+  Sim_Stats stats;
+};
+
+typedef struct
+{
+  Sim_Board *board[SIM_MAX_BOARDS];
+  int boards;
+  Sim_Link link[SIM_MAX_BOARDS][SIM_MAX_BOARDS];
+  Sim_Time now, limit;
+  ucontext_t main;
+  unsigned long long rng, seed;
+  double ccaDbm;                            // Carrier sense threshold
+  Sim_Interference interference;
+} Sim_World;
+
+extern Sim_World sim;
+extern Sim_Board *sim_cur;
+
+void Sim_Fatal(Sim_Board *b, const char *what);
+void Sim_Push(Sim_Queue *q, Sim_Time time, unsigned char c);
+
+void Mcu_Reset(Sim_Board *b);
+void Mcu_Set(Sim_Board *b, unsigned int address, unsigned int value);
+void Mcu_Sync(Sim_Board *b);
+void Mcu_Clocks(Sim_Board *b);
+void Mcu_Read(Sim_Board *b, unsigned int address);
+void Mcu_Advance(Sim_Board *b, Sim_Time t);
+Sim_Time Mcu_Next(Sim_Board *b);
+int Mcu_Pending(Sim_Board *b);
+void Mcu_Taken(Sim_Board *b, int vector);
+void Mcu_Gdo0(Sim_Board *b, int level);
+
+Radio *Radio_New(Sim_Board *b);
+void Radio_Free(Radio *r);
+void Radio_Reset(Radio *r);
+void Radio_Hang(Radio *r);
+void Radio_Cs(Radio *r, int low, Sim_Time t);
+unsigned char Radio_Spi(Radio *r, unsigned char mosi, Sim_Time t);
+int Radio_Busy(Radio *r, Sim_Time t);
+Sim_Time Radio_Next(Radio *r);
+void Radio_Advance(Radio *r, Sim_Time t);
+
+#endif
@@ -0,0 +1,25 @@
+//----------------------------------------------------------------------------
+//  Description:  Checks for the host tests
+//----------------------------------------------------------------------------
+
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdio.h>
+
+static int test_failures;
+
+#define CHECK(cond)                                                         \
+  do                                                                        \
+  {                                                                         \
+    if (!(cond))                                                            \
+    {                                                                       \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__,      \
+              #cond);                                                       \
+      test_failures++;                                                      \
+    }                                                                       \
+  } while (0)
+
+#define TEST_RESULT()           (test_failures ? 1 : 0)
+
+#endif
@@ -0,0 +1,72 @@
+//----------------------------------------------------------------------------
+//  Description:  ARQ: over links that lose and duplicate packets every
+//  program is acked within milliseconds, runs once and is reported once
+//----------------------------------------------------------------------------
+
+#include "Gui.h"
+#include "Test.h"
+
+#define PROGRAMS                20
+#define PIN_FWD                 0x01
+
+// Run PROGRAMS one-unit programs over links losing "loss" of the packets
+// each way and repeating "duplicate" of them 0-5 ms later
+static void run(double loss, double duplicate)
+{
+  Sim_Link link = {0, 0, 0, 0, 0, -50};
+  unsigned char program[] = {0x21};         // Forward, 1 unit
+  const Sim_PinChange *pins;
+  Sim_Board *sender, *car;
+  Sim_Time sent, ack, worst = 0;
+  int done = 0, runs = 0, acked = 0, n, i;
+  Gui_Frame f;
+  Gui *gui;
+
+  Sim_Init(12);
+  sender = Sim_AddBoard("fw_sender", 12000);
+  car = Sim_AddBoard("fw_car", 12000);
+  link.loss = loss;
+  link.duplicate = duplicate;
+  gui = Gui_Open(sender);
+  Sim_Run(SIM_MS(100), 0, 0);
+
+  for (i = 0; i < PROGRAMS; i++)
+  {
+    link.dupDelay = SIM_US(250 * (i % 21));  // 0 to 5 ms
+    Sim_SetLink(sender, car, &link);
+    Sim_SetLink(car, sender, &link);
+    sent = Gui_Send(gui, GUI_PROGRAM, i + 1, program, sizeof(program));
+    while (Gui_Wait(gui, &f, SIM_MS(400)))  // Its ack and report, in either
+    {                                       // order (a lost fragment ack),
+      done += f.type == GUI_DONE;           // and any repeat
+      if (f.type != GUI_ACK || f.seq != i + 1)
+        continue;
+      acked++;
+      ack = f.start - sent;
+      if (ack > worst)
+        worst = ack;
+    }
+  }
+
+  pins = Sim_Pins(car, &n);
+  for (i = 0; i < n; i++)
+    if ((pins[i].pins & PIN_FWD) && (!i || !(pins[i - 1].pins & PIN_FWD)))
+      runs++;
+  printf("loss %2.0f %%, duplicates %3.0f %%: %d acked, %d runs, %d reports,"
+         " slowest ack %.1f ms\n", 100 * loss, 100 * duplicate, acked, runs,
+         done, worst / 1e9);
+  CHECK(acked == PROGRAMS);
+  CHECK(runs == PROGRAMS);
+  CHECK(done == PROGRAMS);
+  CHECK(worst < SIM_MS(250));
+  Gui_Close(gui);
+}
+
+int main(void)
+{
+  run(0, 1);                                // Every packet twice
+  run(0.2, 0);
+  run(0.2, 0.3);
+  Sim_Free();
+  return TEST_RESULT();
+}
@@ -0,0 +1,182 @@
+//----------------------------------------------------------------------------
+//  Description:  The car's flash program cache: programs found by their
+//  hash, LRU eviction over the four segments, and stores cut short by a
+//  power loss after each of their steps
+//----------------------------------------------------------------------------
+
+#include "Gui.h"
+#include "Test.h"
+
+#define SEGMENTS                4           // CACHE_SEGMENTS
+#define SHORT_BYTES             3
+#define LONG_BYTES              240
+#define STORE_HDR               (3 * sizeof(unsigned int))  // hash, length,
+#define STORE_MARKER            sizeof(unsigned int)        // stamp; marker
+
+static Sim_Board *car;
+static Gui *gui;
+static int seq;
+
+// Program "k": short ones run in a few steps, the long one fills a segment
+static int program(int k, unsigned char *p)
+{
+  int i;
+
+  if (k < 100)
+  {
+    p[0] = 0x21;                            // Forward 1
+    p[1] = 0x40 | k;                        // Backward k
+    p[2] = 0x21;
+    return SHORT_BYTES;
+  }
+  for (i = 0; i < LONG_BYTES; i++)
+    p[i] = 0x20 | (1 + (k + i) % 2);
+  return LONG_BYTES;
+}
+
+static void boot(void)
+{
+  Sim_Board *sender;
+
+  Sim_Init(3);
+  sender = Sim_AddBoard("fw_sender", 12000);
+  car = Sim_AddBoard("fw_car", 12000);
+  gui = Gui_Open(sender);
+  Sim_Run(SIM_MS(100), 0, 0);
+}
+
+static void shutdown(void)
+{
+  Gui_Close(gui);
+}
+
+// Upload program "k"; with "wait" until the car has run it
+static void upload(int k, int wait)
+{
+  unsigned char p[LONG_BYTES];
+  int n = program(k, p);
+  Gui_Frame f;
+
+  Gui_Send(gui, GUI_PROGRAM, ++seq, p, n);
+  CHECK(Gui_Expect(gui, GUI_ACK, seq, &f, SIM_MS(1000)));
+  if (wait)
+    CHECK(Gui_Expect(gui, GUI_DONE, -1, &f, SIM_MS(10000)));
+}
+
+// Ask the car to run program "k" from its cache: 1 on a hit, run to the
+// end, 0 on a miss
+static int run(int k)
+{
+  unsigned char p[LONG_BYTES], req[3];
+  int n = program(k, p);
+  unsigned int hash = Gui_Crc(p, n);
+  Gui_Frame f;
+
+  req[0] = hash;
+  req[1] = hash >> 8;
+  req[2] = n;
+  Gui_Send(gui, GUI_RUN, ++seq, req, sizeof(req));
+  CHECK(Gui_Wait(gui, &f, SIM_MS(1000)));
+  if (f.type == GUI_ACK && f.seq == seq)
+  {
+    CHECK(Gui_Expect(gui, GUI_DONE, -1, &f, SIM_MS(10000)));
+    return 1;
+  }
+  CHECK(f.type == GUI_NACK && f.seq == seq && f.payload[0] == GUI_ERR_MISS);
+  return 0;
+}
+
+// Found by hash; the same program with another hash, or another length, is
+// not
+static void lookup(void)
+{
+  unsigned char req[3] = {0x12, 0x34, SHORT_BYTES};
+  unsigned long erases;
+  Gui_Frame f;
+
+  boot();
+  CHECK(!run(1));
+  upload(1, 1);
+  CHECK(run(1));
+  Gui_Send(gui, GUI_RUN, ++seq, req, sizeof(req));
+  CHECK(Gui_Expect(gui, GUI_NACK, seq, &f, SIM_MS(1000)));
+  CHECK(f.payload[0] == GUI_ERR_MISS);
+
+  erases = Sim_BoardStats(car)->flashErases;
+  upload(1, 1);                             // Already there: not stored again
+  CHECK(Sim_BoardStats(car)->flashErases == erases);
+  shutdown();
+}
+
+// With all segments in use the least recently used program goes, where a
+// run from the cache and an upload of a cached program both count as uses
+static void eviction(void)
+{
+  int k;
+
+  boot();
+  for (k = 1; k <= SEGMENTS; k++)
+    upload(k, 1);
+  CHECK(run(1));                            // 2 is now the oldest
+  upload(5, 1);
+  CHECK(!run(2));                           // Evicted: 3 is now the oldest
+  upload(3, 1);                             // A use, not a new store
+  upload(6, 1);
+  CHECK(!run(4));
+  CHECK(run(1) && run(3) && run(5) && run(6));
+  shutdown();
+}
+
+// Cut the power once the car has written "bytes" bytes of the next store,
+// or once it erased the segment if "bytes" is 0.  Only the store with all
+// its bytes written may count.
+static void powerLoss(unsigned long bytes)
+{
+  const Sim_Stats *s;
+  unsigned long erases, written;
+  Sim_Time end;
+  int k;
+
+  boot();
+  for (k = 1; k < SEGMENTS; k++)
+    upload(k, 1);
+  s = Sim_BoardStats(car);
+  erases = s->flashErases;
+  written = s->flashBytes;
+  upload(100, 0);
+  end = Sim_Now() + SIM_MS(1000);
+  while (Sim_Now() < end && (s->flashErases == erases
+                             || s->flashBytes < written + bytes))
+    Sim_Run(Sim_Now() + SIM_US(20), 0, 0);
+  CHECK(s->flashErases == erases + 1);
+  written = s->flashBytes - written;
+  Sim_PowerCycle(car);
+  Sim_Run(Sim_Now() + SIM_MS(100), 0, 0);
+
+  printf("power lost after %3lu bytes of the store: ", written);
+  k = run(100);
+  printf("%s\n", k ? "program whole" : "segment free");
+  CHECK(k == (written == STORE_HDR + LONG_BYTES + STORE_MARKER));
+  for (k = 1; k < SEGMENTS; k++)            // The others are untouched
+    CHECK(run(k));
+  upload(100, 1);                           // The segment can be used again
+  CHECK(run(100));
+  shutdown();
+}
+
+int main(void)
+{
+  static const unsigned long cut[] =       // After each step of the store;
+  {                                         // a flashWrite() loop has no
+    0, STORE_HDR, STORE_HDR + LONG_BYTES,   // hook to stop it part way
+    STORE_HDR + LONG_BYTES + STORE_MARKER
+  };
+  unsigned int i;
+
+  lookup();
+  eviction();
+  for (i = 0; i < sizeof(cut) / sizeof(cut[0]); i++)
+    powerLoss(cut[i]);
+  Sim_Free();
+  return TEST_RESULT();
+}
@@ -0,0 +1,129 @@
+//----------------------------------------------------------------------------
+//  Description:  Motion timing stays right across the VLO's 4-20 kHz range,
+//  since Clock_Init() measures it against the DCO; and the UART, SPI and
+//  flash settings Clock.h derives are right in each of the 1, 8 and 16 MHz
+//  profiles, not only the one the firmware is built with
+//----------------------------------------------------------------------------
+
+#include <math.h>
+#include "ClockProfile.h"
+#include "Gui.h"
+#include "Test.h"
+
+#define PIN_FWD                 0x01
+
+#define SPI_MAX_MHZ             6.5         // CC2500 burst access
+#define FLASH_MIN_HZ            257000
+#define FLASH_MAX_HZ            476000
+#define BAUD_MAX_ERR            2.0         // %, as Clock.c builds
+
+// USCI_A0 settings (UCOS16 = 0) for the least mean error, as in Clock.h
+typedef struct
+{
+  unsigned int mhz;
+  unsigned long baud;
+  unsigned int ucbr, ucbrs;
+} Uart;
+
+static const Uart uarts[] =
+{
+  { 1,   9600,  104, 1},
+  { 8,   9600,  833, 3},
+  { 8, 115200,   69, 4},
+  {16,   9600, 1666, 5},
+  {16, 230400,   69, 4},
+};
+
+// Mean baud rate error in percent of UCBRx and UCBRSx at "mhz"
+static double baudErr(unsigned int mhz, unsigned long baud,
+                      unsigned int ucbr, unsigned int ucbrs)
+{
+  return (mhz * 1e6 / (ucbr + ucbrs / 8.0) / baud - 1) * 100;
+}
+
+static void uart(const ClockProfile *p, const ClockBaud *b)
+{
+  unsigned int i, s;
+  double err;
+
+  for (i = 0; i < sizeof(uarts) / sizeof(uarts[0]); i++)
+    if (uarts[i].mhz == p->mhz && uarts[i].baud == b->baud)
+      break;
+  CHECK(i < sizeof(uarts) / sizeof(uarts[0]));
+  if (i == sizeof(uarts) / sizeof(uarts[0]))
+    return;
+  err = baudErr(p->mhz, b->baud, b->ucbr, b->ucbrs);
+  printf("%3u MHz  %6lu baud  UCBRx %4u  UCBRSx %u  error %+.3f %%\n",
+         p->mhz, b->baud, b->ucbr, b->ucbrs, err);
+  CHECK(b->ucbr == uarts[i].ucbr && b->ucbrs == uarts[i].ucbrs);
+  CHECK(fabs(err) < BAUD_MAX_ERR);
+  CHECK(fabs(b->errTenths - err * 10) <= 1);  // CLOCK_BAUD_ERR() truncates
+  for (s = 0; s < 8; s++)                   // No better modulation
+    CHECK(fabs(baudErr(p->mhz, b->baud, b->ucbr, s)) >= fabs(err));
+}
+
+static void profile(const ClockProfile *p)
+{
+  double spi = (double)p->mhz / p->spiDiv;
+  double flash = p->mhz * 1e6 / (p->flashFn + 1);
+
+  uart(p, &p->uart[0]);
+  if (p->uart[1].baud != p->uart[0].baud)
+    uart(p, &p->uart[1]);
+  printf("%3u MHz  SPI / %u = %.2f MHz  flash / %u = %.0f kHz\n", p->mhz,
+         p->spiDiv, spi, p->flashFn + 1, flash / 1000);
+  CHECK(spi <= SPI_MAX_MHZ);
+  CHECK(p->spiDiv == 1 || (double)p->mhz / (p->spiDiv - 1) > SPI_MAX_MHZ);
+  CHECK(flash >= FLASH_MIN_HZ && flash <= FLASH_MAX_HZ);
+}
+
+// Time the forward pin is on for a 2-unit (50 ms) program, 0 if never
+static Sim_Time forward(double vloHz)
+{
+  unsigned char program[] = {0x22};         // Forward, 2 units
+  const Sim_PinChange *pins;
+  Sim_Board *sender, *car;
+  Sim_Time on = 0;
+  Gui_Frame f;
+  Gui *gui;
+  int n, i;
+
+  Sim_Init(1);
+  sender = Sim_AddBoard("fw_sender", 12000);
+  car = Sim_AddBoard("fw_car", vloHz);
+  gui = Gui_Open(sender);
+  Sim_Run(SIM_MS(100), 0, 0);
+  Gui_Send(gui, GUI_PROGRAM, 1, program, sizeof(program));
+  Gui_Expect(gui, GUI_DONE, -1, &f, SIM_MS(1000));
+  Gui_Close(gui);
+
+  pins = Sim_Pins(car, &n);
+  for (i = 0; i < n; i++)
+    if (pins[i].pins & PIN_FWD)
+      on = pins[i].time;
+    else if (on)
+      return pins[i].time - on;
+  return 0;
+}
+
+int main(void)
+{
+  double vlo[] = {4500, 9400, 12000, 19000};
+  Sim_Time t;
+  int i;
+
+  profile(&clockProfile1);
+  profile(&clockProfile8);
+  profile(&clockProfile16);
+  CHECK(clockProfile1.mhz == 1 && clockProfile8.mhz == 8
+        && clockProfile16.mhz == 16);
+
+  for (i = 0; i < 4; i++)
+  {
+    t = forward(vlo[i]);
+    printf("VLO %5.0f Hz: forward for %.3f ms\n", vlo[i], t / 1e9);
+    CHECK(t > SIM_US(49000) && t < SIM_US(51000));
+  }
+  Sim_Free();
+  return TEST_RESULT();
+}
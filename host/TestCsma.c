@@ -0,0 +1,119 @@
+//----------------------------------------------------------------------------
+//  Description:  CSMA: the range of each backoff, and the collision rate
+//  and latency of 2-10 traffic nodes (Node.c) with and without it
+//----------------------------------------------------------------------------
+
+#include "Gui.h"
+#include "Test.h"
+
+// As in CC2500.h
+#define UNIT_TICKS              6
+#define MIN_BE                  2
+#define MAX_BE                  4
+#define MAX_BACKOFFS            4
+
+#define NODE_SINK               0xFE
+#define GAP_MS                  20          // 1 ms packets: 5 % of the air
+#define RUN_MS                  4000
+#define DRAIN_MS                100         // Past the longest gap and send
+
+typedef struct
+{
+  double collided;                          // Of the packets on the air
+  double dropped;                           // Of the packets sent
+  double latencyMs;
+} Result;
+
+// Every busy try backs off 1 to 2^BE units, BE growing from MIN_BE by one
+// per try up to MAX_BE
+static void ranges(void)
+{
+  unsigned int (*drawn)[2];
+  Sim_Board *node;
+  int n, be;
+
+  Sim_Init(1);
+  node = Sim_AddBoard("fw_node", 12000);
+  Sim_Run(SIM_MS(200), 0, 0);
+  drawn = Sim_Symbol(node, "nodeBackoff");
+  CHECK(drawn != 0);
+  if (!drawn)
+    return;
+  for (n = 1; n <= MAX_BACKOFFS + 1; n++)
+  {
+    be = MIN_BE + n - 1 < MAX_BE ? MIN_BE + n - 1 : MAX_BE;
+    printf("backoff %d: %2u to %3u ticks\n", n, drawn[n][0], drawn[n][1]);
+    CHECK(drawn[n][0] == UNIT_TICKS);
+    CHECK(drawn[n][1] == (1u << be) * UNIT_TICKS);
+  }
+}
+
+// "nodes" nodes sending to a sink for RUN_MS
+static Result traffic(const char *firmware, int nodes)
+{
+  Sim_Board *sink, *node[10];
+  unsigned long dropped = 0, done = 0, ticks;
+  double hz;
+  Result r;
+  int i;
+
+  Sim_Init(nodes);
+  sink = Sim_AddBoard(firmware, 12000);
+  for (i = 0; i < nodes; i++)
+  {
+    node[i] = Sim_AddBoard(firmware, 9000 + 600 * i);
+    *(char *)Sim_Symbol(node[i], "nodeAddr") = (char)(i + 1);
+    *(unsigned int *)Sim_Symbol(node[i], "nodeGapMs") = GAP_MS;
+  }
+  Sim_Run(SIM_MS(RUN_MS), 0, 0);
+
+  // Stop each node after the send under way, so that the sink has read
+  // every packet it holds before the counters are compared
+  for (i = 0; i < nodes; i++)
+    *(unsigned int *)Sim_Symbol(node[i], "nodeGapMs") = 0;
+  Sim_Run(SIM_MS(RUN_MS + DRAIN_MS), 0, 0);
+
+  r.latencyMs = 0;
+  for (i = 0; i < nodes; i++)
+  {
+    dropped += *(unsigned int *)Sim_Symbol(node[i], "nodeDropped");
+    done += *(unsigned int *)Sim_Symbol(node[i], "nodeDone");
+    ticks = *(unsigned long *)Sim_Symbol(node[i], "nodeLatency");
+    hz = *(unsigned int *)Sim_Symbol(node[i], "Clock_AclkHz");
+    r.latencyMs += 1000.0 * ticks / hz;
+  }
+  r.latencyMs /= done;
+  r.collided = 1 - (double)*(unsigned int *)Sim_Symbol(sink, "nodeHeard")
+                   / done;
+  r.dropped = (double)dropped / (done + dropped);
+  CHECK(Sim_BoardStats(sink)->packetsHeard
+        == *(unsigned int *)Sim_Symbol(sink, "nodeHeard"));
+  return r;
+}
+
+int main(void)
+{
+  Result aloha, csma;
+  int n;
+
+  ranges();
+
+  printf("nodes     collisions        dropped    mean latency\n");
+  printf("       RF_CSMA 0     1           1     RF_CSMA 0     1\n");
+  for (n = 2; n <= 10; n += 2)
+  {
+    aloha = traffic("fw_node_aloha", n);
+    csma = traffic("fw_node", n);
+    printf("  %2d     %5.1f %%  %5.1f %%    %5.1f %%     %5.2f ms  %5.2f ms\n",
+           n, 100 * aloha.collided, 100 * csma.collided, 100 * csma.dropped,
+           aloha.latencyMs, csma.latencyMs);
+    CHECK(aloha.dropped == 0);
+    CHECK(csma.collided <= aloha.collided);
+    CHECK(csma.dropped < 0.05);
+    CHECK(csma.latencyMs < 5 * aloha.latencyMs);
+    if (n >= 6)
+      CHECK(csma.collided < 0.6 * aloha.collided);
+  }
+  Sim_Free();
+  return TEST_RESULT();
+}
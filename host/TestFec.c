@@ -0,0 +1,97 @@
+//----------------------------------------------------------------------------
+//  Description:  Upload goodput and latency in RF_PROFILE_PLAIN and
+//  RF_PROFILE_FEC as the bit error rate grows
+//----------------------------------------------------------------------------
+
+#include <string.h>
+#include "Gui.h"
+#include "Test.h"
+
+// As in CC2500.h
+#define PROFILE_PLAIN           0
+#define PROFILE_FEC             1
+
+#define PROGRAM_BYTES           240
+#define UPLOADS                 10
+#define RATES                   6
+#define NOISY                   4           // ber[] 1e-3: FEC should win
+
+typedef struct
+{
+  double goodput;                           // B/s over the uploads acked
+  double latencyMs;                         // Mean, frame end to ack
+  int failed;
+} Result;
+
+static Result uploads(int profile, double ber)
+{
+  Sim_Link link = {0, 0, 0, 0, 0, -50};
+  unsigned char program[PROGRAM_BYTES], p = profile;
+  Sim_Board *sender, *car;
+  Sim_Time end, total = 0;
+  Result r = {0, 0, 0};
+  int i, acked = 0;
+  Gui_Frame f;
+  Gui *gui;
+
+  memset(program, 0x20, sizeof(program));   // Forward 0 units: runs at once
+  Sim_Init(16);
+  sender = Sim_AddBoard("fw_sender", 12000);
+  car = Sim_AddBoard("fw_car", 12000);
+  gui = Gui_Open(sender);
+  Sim_Run(SIM_MS(100), 0, 0);
+  Gui_Send(gui, GUI_PROFILE, 1, &p, 1);     // On a clean channel
+  CHECK(Gui_Expect(gui, GUI_ACK, 1, &f, SIM_MS(1000)));
+
+  link.ber = ber;
+  Sim_SetLink(sender, car, &link);
+  Sim_SetLink(car, sender, &link);
+  for (i = 0; i < UPLOADS; i++)
+  {
+    end = Gui_Send(gui, GUI_PROGRAM, 2 + i, program, sizeof(program));
+    while (Gui_Wait(gui, &f, SIM_MS(3000)) && f.type == GUI_DONE)
+      ;
+    if (f.type == GUI_ACK && f.seq == 2 + i)
+    {
+      acked++;
+      total += f.start - end;
+    }
+    else
+      r.failed++;
+    while (Gui_Wait(gui, &f, SIM_MS(300)))  // Its report
+      ;
+  }
+  if (acked)
+  {
+    r.goodput = acked * PROGRAM_BYTES / (total / 1e12);
+    r.latencyMs = total / 1e9 / acked;
+  }
+  Gui_Close(gui);
+  return r;
+}
+
+int main(void)
+{
+  static const double ber[RATES] = {0, 1e-5, 1e-4, 3e-4, 1e-3, 3e-3};
+  Result plain[RATES], fec[RATES];
+  int i;
+
+  printf("   ber      goodput B/s        latency ms        failed\n");
+  printf("          plain      FEC     plain      FEC    plain  FEC\n");
+  for (i = 0; i < RATES; i++)
+  {
+    plain[i] = uploads(PROFILE_PLAIN, ber[i]);
+    fec[i] = uploads(PROFILE_FEC, ber[i]);
+    printf("%8.0e %8.0f %8.0f  %8.1f %8.1f   %3d %4d\n", ber[i],
+           plain[i].goodput, fec[i].goodput, plain[i].latencyMs,
+           fec[i].latencyMs, plain[i].failed, fec[i].failed);
+  }
+  // FEC costs airtime on a clean channel and pays off on a noisy one
+  CHECK(!plain[0].failed && !fec[0].failed);
+  CHECK(plain[0].goodput > fec[0].goodput);
+  CHECK(fec[NOISY].goodput > plain[NOISY].goodput);
+  for (i = 0; i < RATES; i++)
+    CHECK(fec[i].failed <= plain[i].failed);
+  Sim_Free();
+  return TEST_RESULT();
+}
@@ -0,0 +1,114 @@
+//----------------------------------------------------------------------------
+//  Description:  Channel hopping under Wi-Fi interference: uploads with the
+//  radio on the fixed channel, hopping over every channel alike
+//  (RF_HOP_BLACKLIST 0), and hopping with the lead's blacklist, while
+//  Wi-Fi channel 6 keeps its part of the band busy and every channel
+//  loses some packets besides
+//----------------------------------------------------------------------------
+
+#include <string.h>
+#include "Gui.h"
+#include "Test.h"
+
+#define PROGRAM_BYTES           240         // Five fragments
+#define UPLOADS                 200
+#define LOSS                    0.15        // On every channel
+#define MODES                   3
+
+// Wi-Fi channel 6, 2426 to 2448 MHz: 6 of the 16 hop channels (2433 MHz
+// up, 3 MHz apart), the fixed channel among them
+static const Sim_Interference wifi =
+  {2426e6, 2448e6, 0.3, SIM_MS(1), -55};
+
+typedef struct
+{
+  const char *name, *sender, *car;
+} Mode;
+
+static const Mode modes[MODES] =
+{
+  {"fixed CHANNR 0 (2433 MHz)",        "fw_sender",        "fw_car"},
+  {"hopping, no blacklist",            "fw_sender_hop_any", "fw_car_hop"},
+  {"hopping with blacklist",           "fw_sender_hop",    "fw_car_hop"},
+};
+
+typedef struct
+{
+  double per;                               // Packets lost on the channel
+  double uploadMs;                          // Mean, frame end to ack
+  int failed;
+} Result;
+
+// Packets that reached the board's channel, and those lost on it
+static void count(Sim_Board *b, unsigned long *all, unsigned long *lost)
+{
+  const Sim_Stats *s = Sim_BoardStats(b);
+
+  *lost += s->packetsMissed + s->packetsCorrupt;
+  *all += s->packetsHeard + s->packetsMissed + s->packetsCorrupt;
+}
+
+static Result uploads(const Mode *m)
+{
+  Sim_Link link = {LOSS, 0, 0, 0, 0, -50};
+  unsigned long all = 0, lost = 0;
+  unsigned char program[PROGRAM_BYTES];
+  Sim_Board *sender, *car;
+  Sim_Time end, total = 0;
+  Result r = {0, 0, 0};
+  int i, acked = 0;
+  Gui_Frame f;
+  Gui *gui;
+
+  memset(program, 0x20, sizeof(program));   // Forward 0 units: runs at once
+  Sim_Init(15);
+  sender = Sim_AddBoard(m->sender, 12000);
+  car = Sim_AddBoard(m->car, 12000);
+  Sim_SetLink(sender, car, &link);
+  Sim_SetLink(car, sender, &link);
+  Sim_SetInterference(&wifi);
+  gui = Gui_Open(sender);
+  Sim_Run(SIM_MS(100), 0, 0);
+
+  for (i = 0; i < UPLOADS; i++)
+  {
+    end = Gui_Send(gui, GUI_PROGRAM, 1 + i, program, sizeof(program));
+    while (Gui_Wait(gui, &f, SIM_MS(3000)) && f.type == GUI_DONE)
+      ;
+    if (f.type == GUI_ACK && f.seq == 1 + i)
+    {
+      acked++;
+      total += f.start - end;
+    }
+    else
+      r.failed++;
+    while (Gui_Wait(gui, &f, SIM_MS(300)))  // Its report
+      ;
+  }
+  count(sender, &all, &lost);
+  count(car, &all, &lost);
+  r.per = all ? 100.0 * lost / all : 100;
+  r.uploadMs = acked ? total / 1e9 / acked : 0;
+  Gui_Close(gui);
+  return r;
+}
+
+int main(void)
+{
+  Result r[MODES];
+  int i;
+
+  printf("mode                          packet errors  upload   failed\n");
+  for (i = 0; i < MODES; i++)
+  {
+    r[i] = uploads(&modes[i]);
+    printf("%-30s %6.1f %%  %7.1f ms  %3d\n", modes[i].name, r[i].per,
+           r[i].uploadMs, r[i].failed);
+  }
+  CHECK(r[0].per > 2 * r[1].per);          // Off the busy channels
+  CHECK(r[2].per <= r[1].per);              // And off them for good
+  CHECK(r[2].failed == 0);
+  CHECK(r[0].failed > r[1].failed);
+  Sim_Free();
+  return TEST_RESULT();
+}
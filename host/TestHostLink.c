@@ -0,0 +1,228 @@
+//----------------------------------------------------------------------------
+//  Description:  Crc16.c against the GUI's bitwise CRC, and the sender's
+//  framing of byte streams cut up, run together, noisy or corrupted; an
+//  upload timed against the per-byte echo it replaced (EchoSender.c)
+//----------------------------------------------------------------------------
+
+#include <string.h>
+#include "Gui.h"
+#include "Test.h"
+#include "Crc16.h"
+
+#define BURST                   24          // Frames in one write
+#define FRAME_MAX               (4 + 255 + 2)
+#define INSTRUCTIONS            49          // The old GUI's largest program
+#define LF                      10          // MATLAB's fprintf() terminator
+
+static Sim_Board *sender;
+static Gui *gui;
+
+// Table-driven Crc16() and Crc16_Update() agree with the bitwise CRC
+static void crc(void)
+{
+  char data[256];
+  unsigned int c;
+  int i, n;
+
+  CHECK(Crc16("123456789", 9) == 0x29B1);   // CRC-16/CCITT-FALSE check
+  CHECK(Gui_Crc((const unsigned char *)"123456789", 9) == 0x29B1);
+  for (n = 0; n <= 256; n += 17)
+  {
+    for (i = 0; i < n; i++)
+      data[i] = (char)(Sim_Random() * 256);
+    c = CRC16_INIT;
+    for (i = 0; i < n; i++)
+      c = Crc16_Update(c, data[i]);
+    CHECK(c == Crc16(data, n));
+    CHECK(c == Gui_Crc((const unsigned char *)data, n));
+  }
+}
+
+// A whole frame in "buf"; returns its length
+static int frame(unsigned char *buf, int type, int seq, const void *payload,
+                 int len)
+{
+  unsigned int c;
+
+  buf[0] = 0x7E;
+  buf[1] = type;
+  buf[2] = seq;
+  buf[3] = len;
+  memcpy(buf + 4, payload, len);
+  c = Gui_Crc(buf + 1, len + 3);
+  buf[4 + len] = c >> 8;
+  buf[5 + len] = c;
+  return len + 6;
+}
+
+// A TARGET frame for car 1, which the sender acks at once
+static int target(unsigned char *buf, int seq)
+{
+  static const unsigned char car[2] = {1, 0};
+
+  return frame(buf, GUI_TARGET, seq, car, sizeof(car));
+}
+
+// The next frame answers "seq" with "type" (and "reason" for a NACK)
+static void answer(int type, int seq, int reason)
+{
+  Gui_Frame f;
+
+  CHECK(Gui_Wait(gui, &f, SIM_MS(200)));
+  CHECK(f.type == type && f.seq == seq);
+  if (type == GUI_NACK)
+    CHECK(f.len == 1 && f.payload[0] == reason);
+}
+
+// One frame dribbled in a few bytes at a time, with gaps
+static void fragmented(void)
+{
+  unsigned char buf[FRAME_MAX];
+  int n = target(buf, 1), i, k;
+
+  for (i = 0; i < n; i += k)
+  {
+    k = 1 + (int)(Sim_Random() * 3);
+    if (k > n - i)
+      k = n - i;
+    Sim_SerialWrite(sender, (const char *)buf + i, k);
+    Sim_Run(Sim_Now() + SIM_MS(2 + (int)(Sim_Random() * 10)), 0, 0);
+  }
+  answer(GUI_ACK, 1, 0);
+}
+
+// Frames back to back in one write, more than the RX ring holds: every one
+// is answered, in order
+static void backToBack(void)
+{
+  unsigned char buf[BURST * FRAME_MAX];
+  int n = 0, i;
+
+  for (i = 0; i < BURST; i++)
+    n += target(buf + n, 10 + i);
+  Sim_SerialWrite(sender, (const char *)buf, n);
+  for (i = 0; i < BURST; i++)
+    answer(GUI_ACK, 10 + i, 0);
+}
+
+// Noise before a frame is skipped; a bad CRC, a length past the largest
+// payload and an unknown type are nacked, and the frames after them still
+// get through; a repeated seq is acked again without being run twice
+static void damaged(void)
+{
+  static const unsigned char noise[] = {0x00, 0x55, 0xFF, 0x13};
+  unsigned char buf[4 * FRAME_MAX], big[4] = {0x7E, GUI_TARGET, 41, 241};
+  int n = 0;
+
+  memcpy(buf, noise, sizeof(noise));
+  n = sizeof(noise);
+  n += target(buf + n, 40);
+  Sim_SerialWrite(sender, (const char *)buf, n);
+  answer(GUI_ACK, 40, 0);
+
+  n = target(buf, 41);
+  buf[n - 1] ^= 0x01;                       // CRC off by one bit
+  n += target(buf + n, 42);
+  Sim_SerialWrite(sender, (const char *)buf, n);
+  answer(GUI_NACK, 41, GUI_ERR_CRC);
+  answer(GUI_ACK, 42, 0);
+
+  Sim_SerialWrite(sender, (const char *)big, sizeof(big));
+  answer(GUI_NACK, 41, GUI_ERR_LENGTH);
+  n = target(buf, 43);
+  Sim_SerialWrite(sender, (const char *)buf, n);
+  answer(GUI_ACK, 43, 0);
+
+  n = frame(buf, 0x7F, 44, 0, 0);
+  n += target(buf + n, 44);
+  n += target(buf + n, 44);                 // Its ack was lost
+  Sim_SerialWrite(sender, (const char *)buf, n);
+  answer(GUI_NACK, 44, GUI_ERR_TYPE);
+  answer(GUI_ACK, 44, 0);
+  answer(GUI_ACK, 44, 0);
+}
+
+// Sim_Run() stop: the GUI has read the echo of a LF
+static int echoed(void *arg)
+{
+  unsigned char c;
+
+  while (Sim_SerialRead(arg, &c, 0))
+    if (c == LF)
+      return 1;
+  return 0;
+}
+
+// One program of INSTRUCTIONS bytes, from the GUI's first byte until it
+// may go on: the old GUI wrote the count and each instruction with a LF
+// and waited for the echo of each, 1 + INSTRUCTIONS round trips; the new
+// one writes one frame and waits for the HOST_ACK, sent once the car has
+// the program.  The serial latency of the host adds to each round trip.
+static void timing(void)
+{
+  char program[INSTRUCTIONS], line[2];
+  Sim_Time start, frameEnd, acked;
+  Sim_Board *echo;
+  double oldMs, newMs;
+  Gui_Frame f;
+  int i;
+
+  memset(program, 0x21, sizeof(program));   // Forward, 1 unit
+
+  Sim_Init(5);
+  echo = Sim_AddBoard("fw_sender_echo", 12000);
+  Sim_Run(SIM_MS(10), 0, 0);
+  start = Sim_Now();
+  for (i = 0; i <= INSTRUCTIONS; i++)
+  {
+    line[0] = i ? program[i - 1] : INSTRUCTIONS;
+    line[1] = LF;
+    Sim_SerialWrite(echo, line, 2);
+    Sim_Run(Sim_Now() + SIM_MS(100), echoed, echo);
+  }
+  oldMs = (Sim_Now() - start) / 1e9;
+  CHECK(*(unsigned int *)Sim_Symbol(echo, "echoNumber") == 1);
+
+  Sim_Init(5);
+  sender = Sim_AddBoard("fw_sender", 12000);
+  Sim_AddBoard("fw_car", 12000);
+  gui = Gui_Open(sender);
+  Sim_Run(SIM_MS(100), 0, 0);
+  start = Sim_Now();
+  frameEnd = Gui_Send(gui, GUI_PROGRAM, 1, program, sizeof(program));
+  CHECK(Gui_Expect(gui, GUI_ACK, 1, &f, SIM_MS(500)));
+  acked = f.end;
+  newMs = (acked - start) / 1e9;
+  Gui_Close(gui);
+
+  printf("%d instructions:  per-byte echo %5.1f ms, %d round trips\n"
+         "                  frame %5.1f ms on the line, acked at %5.1f ms, "
+         "1 round trip\n", INSTRUCTIONS, oldMs, 1 + INSTRUCTIONS,
+         (frameEnd - start) / 1e9, newMs);
+  CHECK(newMs < oldMs);
+}
+
+int main(void)
+{
+  Gui_Frame f;
+
+  Sim_Init(4);
+  crc();
+
+  sender = Sim_AddBoard("fw_sender", 12000);
+  Sim_AddBoard("fw_car", 12000);
+  gui = Gui_Open(sender);
+  Sim_Run(SIM_MS(100), 0, 0);
+
+  fragmented();
+  backToBack();
+  damaged();
+  CHECK(!Gui_Wait(gui, &f, SIM_MS(100)));   // Nothing more
+  CHECK(Sim_BoardStats(sender)->uartOverruns == 0);
+
+  Gui_Close(gui);
+
+  timing();
+  Sim_Free();
+  return TEST_RESULT();
+}
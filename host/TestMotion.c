@@ -0,0 +1,265 @@
+//----------------------------------------------------------------------------
+//  Description:  The instruction encoding (Encoding.c, built for the host)
+//  and the car's ENC_CONTROL loops and subroutines; repeat counts on
+//  zero-length steps refused; the CPU time of a step with pinTable[] and
+//  with the switch it replaced (MOTION_PIN_TABLE 0)
+//----------------------------------------------------------------------------
+
+#include "Gui.h"
+#include "Test.h"
+#include "Encoding.h"
+
+#define UNIT_MS                 25          // MOTION_UNIT_MS
+#define MAX_STEPS               16
+#define CYCLE_STEPS             240         // MOTION_MAX_INSTR one-byte steps
+
+// A timed step of the car: the pins it held and for how long
+typedef struct
+{
+  unsigned char pins;
+  int units;
+} Step;
+
+static Sim_Board *car;
+static Gui *gui;
+static int seq;
+
+// Encode "n" instructions into "buf"; returns the bytes used
+static int encode(char *buf, const Encoding_Instr *in, int n)
+{
+  int len = 0, i, k;
+
+  for (i = 0; i < n; i++)
+  {
+    k = Encoding_Encode(buf + len, ENC_MAX_BYTES, &in[i]);
+    CHECK(k > 0);
+    len += k;
+  }
+  return len;
+}
+
+// Every one-byte instruction decodes as it always meant, and the canonical
+// ones encode back to themselves
+static void legacy(void)
+{
+  Encoding_Instr in;
+  char b, out[ENC_MAX_BYTES];
+  int c, op;
+
+  for (c = 0; c < 0x80; c++)
+  {
+    b = (char)c;
+    CHECK(Encoding_Decode(&b, 1, &in) == 1);
+    CHECK(in.repeat == 1);
+    switch (c & 0x60)
+    {
+      case 0x00:
+        op = (c & 0x1F) ? ENC_DETONATE : ENC_STOP;
+        CHECK(in.op == op && in.arg == 0);
+        break;
+      case 0x20:
+        CHECK(in.op == ENC_FORWARD && in.arg == (unsigned int)(c & 0x1F));
+        break;
+      case 0x40:
+        CHECK(in.op == ENC_BACKWARD && in.arg == (unsigned int)(c & 0x1F));
+        break;
+      default:
+        op = (c & 0x1F) ? ENC_RIGHT : ENC_LEFT;
+        CHECK(in.op == op && in.arg == 90);
+        break;
+    }
+    if (c == 0x00 || c == 0x1F || c == 0x60 || c == 0x7F
+        || (c & 0x60) == 0x20 || (c & 0x60) == 0x40)
+      CHECK(Encoding_Encode(out, sizeof(out), &in) == 1 && out[0] == b);
+  }
+}
+
+// Bytes of the varint for "v"
+static int varintBytes(unsigned int v)
+{
+  return v < 0x80 ? 1 : v < 0x4000 ? 2 : 3;
+}
+
+// Arguments and repeat counts survive the trip through their varints, in
+// the fewest bytes, and malformed varints are refused
+static void varints(void)
+{
+  static const unsigned int value[] =
+    {0, 6, 7, 127, 128, 16383, 16384, 65535};
+  static const char tooBig[] = {(char)0xF7, (char)0xFF, (char)0xFF, 0x7F};
+  static const char zeroRepeat[] = {(char)0x99, 0x00};
+  static const char stopRepeat[] = {(char)0x88, 0x02};      // Stop 0 twice
+  static const char detonateRepeat[] = {(char)0xD8, (char)0xFF, (char)0xFF,
+                                        0x03};              // 65535 times
+  Encoding_Instr in, out;
+  char buf[ENC_MAX_BYTES];
+  int i, j, n, expect;
+
+  in.op = ENC_STOP;
+  for (i = 0; i < 8; i++)
+    for (j = 0; j < 8; j++)
+    {
+      in.arg = value[i];
+      in.repeat = value[j] ? value[j] : 1;
+      if (!in.arg && in.repeat > 1)         // Takes no time: no repeats
+      {
+        CHECK(Encoding_Encode(buf, sizeof(buf), &in) == 0);
+        continue;
+      }
+      expect = 1 + (in.arg >= ENC_ARG_VARINT ? varintBytes(in.arg) : 0)
+               + (in.repeat > 1 ? varintBytes(in.repeat) : 0);
+      n = Encoding_Encode(buf, sizeof(buf), &in);
+      CHECK(n == expect);                   // Stop 0 once: legacy, 1 byte
+      CHECK(Encoding_Decode(buf, (char)n, &out) == n);
+      CHECK(out.op == ENC_STOP && out.arg == in.arg
+            && out.repeat == in.repeat);
+      if (n > 1)
+        CHECK(Encoding_Decode(buf, (char)(n - 1), &out) == 0);
+    }
+  CHECK(Encoding_Encode(buf, 2, &in) == 0);
+  CHECK(Encoding_Decode(tooBig, sizeof(tooBig), &out) == 0);
+  CHECK(Encoding_Decode(zeroRepeat, sizeof(zeroRepeat), &out) == 0);
+  CHECK(Encoding_Decode(stopRepeat, sizeof(stopRepeat), &out) == 0);
+  CHECK(Encoding_Decode(detonateRepeat, sizeof(detonateRepeat), &out) == 0);
+  in.op = ENC_DETONATE;
+  in.arg = 0;
+  in.repeat = 2;
+  CHECK(Encoding_Encode(buf, sizeof(buf), &in) == 0);
+  in.repeat = 1;
+  CHECK(Encoding_Encode(buf, sizeof(buf), &in) == 1);
+}
+
+// Run a program on the car and compare its timed steps with "expect"
+static void run(const char *name, const char *program, int len,
+                const Step *expect, int steps)
+{
+  const Sim_PinChange *pins;
+  Sim_Time start = Sim_Now(), t;
+  Step got[MAX_STEPS];
+  Gui_Frame f;
+  int n, i, k = 0, same = 1;
+
+  Gui_Send(gui, GUI_PROGRAM, ++seq, program, len);
+  CHECK(Gui_Expect(gui, GUI_DONE, -1, &f, SIM_MS(2000)));
+
+  pins = Sim_Pins(car, &n);
+  for (i = 0; i + 1 < n; i++)
+  {
+    t = pins[i + 1].time - pins[i].time;
+    if (pins[i].time < start || !pins[i].pins || !t || k == MAX_STEPS)
+      continue;
+    got[k].pins = pins[i].pins;
+    got[k++].units = (int)((t / 1e9 + UNIT_MS / 2) / UNIT_MS);
+  }
+  for (i = 0; i < k && i < steps; i++)
+    same &= got[i].pins == expect[i].pins && got[i].units == expect[i].units;
+  printf("%s: %d steps\n", name, k);
+  CHECK(k == steps && same);
+}
+
+static void control(void)
+{
+  Encoding_Instr in[8] =
+  {
+    {ENC_VERSION, 2, 1},
+    {ENC_CONTROL, ENC_CTL(ENC_CTL_REPEAT, 2), 1},
+    {ENC_FORWARD, 1, 1},
+    {ENC_CONTROL, ENC_CTL(ENC_CTL_CALL, 31), 1}, // Offset set below
+    {ENC_CONTROL, ENC_CTL(ENC_CTL_LOOP, 0), 1},
+    {ENC_CONTROL, ENC_CTL(ENC_CTL_RETURN, 0), 1},
+    {ENC_BACKWARD, 2, 1},                   // The subroutine
+    {ENC_CONTROL, ENC_CTL(ENC_CTL_RETURN, 0), 1}
+  };
+  static const Step loops[] = {{0x01, 1}, {0x04, 2}, {0x01, 1}, {0x04, 2}};
+  Encoding_Instr stray[3] =
+  {
+    {ENC_FORWARD, 1, 1},
+    {ENC_CONTROL, ENC_CTL(ENC_CTL_LOOP, 0), 1},
+    {ENC_BACKWARD, 1, 1}
+  };
+  static const Step stops[] = {{0x01, 1}};
+  char program[64];
+  int len;
+
+  in[3].arg = ENC_CTL(ENC_CTL_CALL, encode(program, in, 6));
+  len = encode(program, in, 8);
+  run("repeat 2 { forward 1, call backward 2 }", program, len, loops, 4);
+
+  len = encode(program, stray, 3);
+  run("loop without a repeat", program, len, stops, 1);
+
+  len = encode(program, stray, 1);          // Detonate 65535 times
+  program[len++] = (char)0xD8;
+  program[len++] = (char)0xFF;
+  program[len++] = (char)0xFF;
+  program[len++] = 0x03;
+  len += encode(program + len, &stray[2], 1);
+  run("detonate repeated 65535 times", program, len, stops, 1);
+}
+
+// MCLK cycles the car spends on each step of a program of CYCLE_STEPS
+// one-byte moves and pauses, over what it spends idle for as long
+static double cyclesPerStep(const char *firmware)
+{
+  char program[CYCLE_STEPS];
+  Sim_Time busy, idle, start;
+  Sim_Board *sender, *board;
+  Gui_Frame f;
+  Gui *g;
+  int i;
+
+  for (i = 0; i < CYCLE_STEPS; i++)
+    program[i] = i % 3 == 0 ? 0x21 : i % 3 == 1 ? 0x41 : (char)0x81;
+  Sim_Init(2);                              // Forward, backward, pause 1
+  sender = Sim_AddBoard("fw_sender", 12000);
+  board = Sim_AddBoard(firmware, 12000);
+  g = Gui_Open(sender);
+  Sim_Run(SIM_MS(100), 0, 0);
+
+  // Run once so that the car has it cached: the run timed below stores
+  // nothing in flash
+  Gui_Send(g, GUI_PROGRAM, 1, program, sizeof(program));
+  CHECK(Gui_Expect(g, GUI_DONE, -1, &f,
+                   SIM_MS(CYCLE_STEPS * UNIT_MS + 1000)));
+
+  start = Sim_Now();
+  idle = Sim_BoardStats(board)->busy;
+  Sim_Run(start + SIM_MS(CYCLE_STEPS * UNIT_MS), 0, 0);
+  idle = Sim_BoardStats(board)->busy - idle;
+
+  Gui_Send(g, GUI_PROGRAM, 2, program, sizeof(program));
+  CHECK(Gui_Expect(g, GUI_ACK, 2, &f, SIM_MS(2000)));
+  start = Sim_Now();
+  busy = Sim_BoardStats(board)->busy;
+  CHECK(Gui_Expect(g, GUI_DONE, -1, &f, SIM_MS(CYCLE_STEPS * UNIT_MS + 500)));
+  busy = Sim_BoardStats(board)->busy - busy;
+  busy -= idle * (Sim_Now() - start) / SIM_MS(CYCLE_STEPS * UNIT_MS);
+  Gui_Close(g);
+  return busy / 1e12 * Sim_Mclk(board) / CYCLE_STEPS;
+}
+
+int main(void)
+{
+  Sim_Board *sender;
+  double table, other;
+
+  legacy();
+  varints();
+
+  Sim_Init(1);
+  sender = Sim_AddBoard("fw_sender", 12000);
+  car = Sim_AddBoard("fw_car", 12000);
+  gui = Gui_Open(sender);
+  Sim_Run(SIM_MS(100), 0, 0);
+  control();
+
+  Gui_Close(gui);
+
+  table = cyclesPerStep("fw_car");
+  other = cyclesPerStep("fw_car_switch");
+  printf("MCLK cycles per step: pinTable[] %.0f, switch %.0f\n", table,
+         other);
+  CHECK(table > 0 && table <= 1.05 * other);
+  Sim_Free();
+  return TEST_RESULT();
+}
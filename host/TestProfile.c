@@ -0,0 +1,193 @@
+//----------------------------------------------------------------------------
+//  Description:  Modem profiles: the register values CC2500Profiles.h built
+//  into rfProfiles[], decoded as the datasheet reads them, agree with the
+//  framing RFAirtimeUs() assumes; both ends hear each other in every
+//  profile, and packets take the airtime RFAirtimeUs() says
+//----------------------------------------------------------------------------
+
+#include <math.h>
+#include "TI_CC/TI_CC_CC2500.h"
+#include "Gui.h"
+#include "Test.h"
+
+// As in CC2500.h and CC2500.c
+#define NUM_PROFILES            5
+#define PROFILE_REGS            17
+#define PROFILE_PLAIN           0
+#define PROFILE_FEC             1
+#define FEC_PKTLEN              55
+#define XOSC_HZ                 26e6
+#define CHANNEL_SPACING_HZ      199950
+
+#define GAP_MS                  100
+#define RUN_MS                  3000
+#define DRAIN_MS                300         // Past the longest gap and send
+
+typedef struct                              // rfFraming[]
+{
+  unsigned int kbps;
+  char preamble;
+  char sync;
+  char fec;
+} Framing;
+
+static const char *name[NUM_PROFILES] =
+  {"PLAIN", "FEC", "FAST", "SHORT", "LONG"};
+
+// One register of profile "p" from the table
+static unsigned char reg(const unsigned char (*profiles)[PROFILE_REGS],
+                         const unsigned char *regs, int p, int addr)
+{
+  int r;
+
+  for (r = 0; r < PROFILE_REGS && regs[r] != addr; r++);
+  CHECK(r < PROFILE_REGS);
+  return r < PROFILE_REGS ? profiles[p][r] : 0;
+}
+
+// Data rate, channel spacing and filter, sync word, preamble and packet
+// format of each profile, from its registers
+static void registers(void)
+{
+  static const int preambles[8] = {2, 3, 4, 6, 8, 12, 16, 24};
+  const unsigned char (*profiles)[PROFILE_REGS];
+  const unsigned char *regs, *config;
+  const Framing *framing;
+  unsigned char m4, m2, m1, pktctrl0;
+  double bps, spacing, filter;
+  Sim_Board *board;
+  int p, mod, fec;
+
+  Sim_Init(1);
+  board = Sim_AddBoard("fw_node", 12000);
+  profiles = Sim_Symbol(board, "rfProfiles");
+  regs = Sim_Symbol(board, "rfProfileRegs");
+  config = Sim_Symbol(board, "rfConfig");
+  framing = Sim_Symbol(board, "rfFraming");
+  CHECK(profiles && regs && config && framing);
+  if (!profiles || !regs || !config || !framing)
+    return;
+
+  printf("profile   rate       spacing     filter    sync  preamble  FEC\n");
+  for (p = 0; p < NUM_PROFILES; p++)
+  {
+    m4 = reg(profiles, regs, p, TI_CCxxx0_MDMCFG4);
+    m2 = reg(profiles, regs, p, TI_CCxxx0_MDMCFG2);
+    m1 = reg(profiles, regs, p, TI_CCxxx0_MDMCFG1);
+    pktctrl0 = reg(profiles, regs, p, TI_CCxxx0_PKTCTRL0);
+    bps = (256 + reg(profiles, regs, p, TI_CCxxx0_MDMCFG3))
+          * pow(2, m4 & 0x0F) * XOSC_HZ / pow(2, 28);
+    spacing = XOSC_HZ / pow(2, 18) * (256 + config[TI_CCxxx0_MDMCFG0])
+              * pow(2, m1 & 3);
+    filter = XOSC_HZ / (8 * (4 + ((m4 >> 4) & 3)) * pow(2, m4 >> 6));
+    mod = (m2 >> 4) & 7;
+    fec = m1 >> 7;
+    printf("%-6s %6.1f kbps %7.2f kHz %5.0f kHz   %d/%d    %2d/%d     %d\n",
+           name[p], bps / 1000, spacing / 1000, filter / 1000,
+           (m2 & 3) == 3 ? 4 : 2, framing[p].sync, preambles[(m1 >> 4) & 7],
+           framing[p].preamble, fec);
+
+    CHECK(fabs(bps - 1000.0 * framing[p].kbps) < 10.0 * framing[p].kbps);
+    CHECK(fabs(spacing - CHANNEL_SPACING_HZ) < 100);
+    CHECK(filter >= bps && filter <= 812500);
+    CHECK(mod != 7 || (bps >= 26000 && bps <= 500000));
+    CHECK(mod == 7 || bps <= 250000);
+    CHECK((m2 & 3) != 0);                   // A sync word to find
+    CHECK(((m2 & 3) == 3 ? 4 : 2) == framing[p].sync);
+    CHECK(preambles[(m1 >> 4) & 7] == framing[p].preamble);
+    CHECK(fec == framing[p].fec);
+    CHECK(((pktctrl0 & 3) == 0) == fec);    // FEC codes fixed lengths only
+    if (fec)
+      CHECK(reg(profiles, regs, p, TI_CCxxx0_PKTLEN) == FEC_PKTLEN);
+    CHECK(pktctrl0 & 0x04);                 // CRC
+  }
+}
+
+// The node's sends, timed from the simulator: RFSendPacketAsync() raises
+// txPending and the end of the packet clears it
+typedef struct
+{
+  volatile char *pending;
+  char was;
+  Sim_Time start, total;
+  unsigned int sends;
+} Watch;
+
+static int watch(void *arg)
+{
+  Watch *w = arg;
+
+  if (*w->pending && !w->was)
+    w->start = Sim_Now();
+  else if (!*w->pending && w->was)
+  {
+    w->total += Sim_Now() - w->start;
+    w->sends++;
+  }
+  w->was = *w->pending;
+  return 0;
+}
+
+// A node sending "length"-byte packets to a sink, both in profile "p";
+// returns the mean time from the send to the end of the packet, in us
+static double airtime(int p, int length, unsigned int *computed)
+{
+  Sim_Board *sink, *node;
+  Watch w = {0, 0, 0, 0, 0};
+  unsigned int done, heard;
+
+  Sim_Init(p + 1);
+  sink = Sim_AddBoard("fw_node", 12000);
+  node = Sim_AddBoard("fw_node", 12000);
+  *(char *)Sim_Symbol(sink, "nodeProfile") = (char)p;
+  *(char *)Sim_Symbol(node, "nodeProfile") = (char)p;
+  *(char *)Sim_Symbol(node, "nodeAddr") = 1;
+  *(char *)Sim_Symbol(node, "nodeLen") = (char)length;
+  *(unsigned int *)Sim_Symbol(node, "nodeGapMs") = GAP_MS;
+  w.pending = Sim_Symbol(node, "txPending");
+  Sim_Run(SIM_MS(RUN_MS), watch, &w);
+  *(unsigned int *)Sim_Symbol(node, "nodeGapMs") = 0;
+  Sim_Run(SIM_MS(RUN_MS + DRAIN_MS), watch, &w);
+
+  done = *(unsigned int *)Sim_Symbol(node, "nodeDone");
+  heard = *(unsigned int *)Sim_Symbol(sink, "nodeHeard");
+  *computed = *(unsigned int *)Sim_Symbol(node, "nodeAirtimeUs");
+  CHECK(done > 5);
+  CHECK(w.sends == done);
+  CHECK(heard == done);                     // Both ends agree on the modem
+  CHECK(*(unsigned int *)Sim_Symbol(node, "nodeDropped") == 0);
+  return w.sends ? w.total / 1e6 / w.sends : 0;
+}
+
+
+// The time from the send to the end of the packet is its airtime, plus
+// the TXFIFO load and the RX to TX turnaround, which do not depend on the
+// profile: they are taken from RF_PROFILE_PLAIN and checked to hold in the
+// other profiles.  RF_PROFILE_FEC always loads RF_FEC_PKTLEN bytes.
+int main(void)
+{
+  static const int length[2] = {4, FEC_PKTLEN};  // PKT_DRIVE, a fragment
+  unsigned int computed[NUM_PROFILES][2];
+  double measured[NUM_PROFILES][2], overhead;
+  int p, n;
+
+  registers();
+
+  for (p = 0; p < NUM_PROFILES; p++)
+    for (n = 0; n < 2; n++)
+      measured[p][n] = airtime(p, length[n], &computed[p][n]);
+
+  printf("\nprofile   size  RFAirtimeUs  send to end  overhead\n");
+  for (p = 0; p < NUM_PROFILES; p++)
+    for (n = 0; n < 2; n++)
+    {
+      overhead = measured[PROFILE_PLAIN][p == PROFILE_FEC ? 1 : n]
+                 - computed[PROFILE_PLAIN][p == PROFILE_FEC ? 1 : n];
+      printf("%-6s    %4d  %8u us  %8.0f us  %5.0f us\n", name[p], length[n],
+             computed[p][n], measured[p][n], measured[p][n] - computed[p][n]);
+      CHECK(fabs(measured[p][n] - computed[p][n] - overhead)
+            <= 0.01 * computed[p][n] + 20);
+    }
+  Sim_Free();
+  return TEST_RESULT();
+}
@@ -0,0 +1,76 @@
+//----------------------------------------------------------------------------
+//  Description:  Program queue: programs sent back to back while the car
+//  drives are staged and run one after the other with no gap
+//----------------------------------------------------------------------------
+
+#include "Gui.h"
+#include "Test.h"
+
+#define PROGRAMS                4
+#define PIN_FWD                 0x01
+#define PIN_BACK                0x04
+
+int main(void)
+{
+  static const unsigned char program[PROGRAMS] =
+    {0x24, 0x44, 0x24, 0x44};               // 4 units each, 100 ms
+  const Sim_PinChange *pins;
+  Sim_Time start[PROGRAMS], end[PROGRAMS], gap, worst = 0;
+  Sim_Board *sender, *car;
+  Gui_Frame f;
+  Gui *gui;
+  int n, i, k, tries, done = 0;
+
+  Sim_Init(2);
+  sender = Sim_AddBoard("fw_sender", 12000);
+  car = Sim_AddBoard("fw_car", 12000);
+  gui = Gui_Open(sender);
+  Sim_Run(SIM_MS(100), 0, 0);
+
+  // Each one goes as soon as the last is acked.  While one is staged the
+  // car has no slot for the next, and the sender nacks it: it is sent
+  // again, as the GUI does
+  for (i = 0; i < PROGRAMS; i++)
+  {
+    for (tries = 0; tries < 50; tries++)
+    {
+      Gui_Send(gui, GUI_PROGRAM, i + 1, &program[i], 1);
+      while (Gui_Wait(gui, &f, SIM_MS(1000)) && f.type == GUI_DONE)
+        done++;
+      if (f.type != GUI_NACK || f.payload[0] != GUI_ERR_RADIO)
+        break;
+      Sim_Run(Sim_Now() + SIM_MS(10), 0, 0);
+    }
+    CHECK(f.type == GUI_ACK && f.seq == i + 1);
+  }
+  while (done < PROGRAMS && Gui_Expect(gui, GUI_DONE, -1, &f, SIM_MS(1000)))
+    done++;
+  CHECK(done == PROGRAMS);
+
+  // One forward or backward run per program, each starting as the last ends
+  pins = Sim_Pins(car, &n);
+  for (i = k = 0; i < n && k < PROGRAMS; i++)
+    if (pins[i].pins & (PIN_FWD | PIN_BACK))
+    {
+      start[k] = pins[i].time;
+      end[k] = i + 1 < n ? pins[i + 1].time : 0;
+      CHECK(pins[i].pins == (program[k] & 0x20 ? PIN_FWD : PIN_BACK));
+      k++;
+    }
+  CHECK(k == PROGRAMS);
+  for (i = 0; i < k; i++)
+  {
+    CHECK(end[i] - start[i] > SIM_MS(99) && end[i] - start[i] < SIM_MS(101));
+    if (!i)
+      continue;
+    gap = start[i] - end[i - 1];
+    if (gap > worst)
+      worst = gap;
+  }
+  printf("%d programs back to back, longest gap %.3f ms\n", k, worst / 1e9);
+  CHECK(worst < SIM_US(500));
+
+  Gui_Close(gui);
+  Sim_Free();
+  return TEST_RESULT();
+}
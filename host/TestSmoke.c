@@ -0,0 +1,123 @@
+//----------------------------------------------------------------------------
+//  Description:  End to end: a program from the GUI drives the car's pins.
+//  And the radio configuration at boot, in bursts (RF_CONFIG_BURST) and
+//  one register at a time: SPI transactions, bytes and time.
+//----------------------------------------------------------------------------
+
+#include "TI_CC/TI_CC_CC2500.h"
+#include "Gui.h"
+#include "Test.h"
+
+#define PIN_FWD                 0x01
+
+// Registers in rfConfig[] written and verified: IOCFG2-RCCTRL0, FSTEST,
+// TEST2-TEST0
+#define CONFIG_REGS             (TI_CCxxx0_RCCTRL0 + 1 + 1 + 3)
+
+typedef struct
+{
+  int frames, bytes;                        // Header bytes included
+} Count;
+
+// The boot of "firmware": the configuration written after SRES up to the
+// PATABLE, and read back up to the next write.  Returns the time from the
+// first write to the last read.
+static Sim_Time boot(const char *firmware, Count *write, Count *verify)
+{
+  const Sim_SpiByte *log;
+  Sim_Board *car;
+  Sim_Time first = 0, last = 0;
+  int count, i, n, stage = 0;
+  unsigned char h;
+
+  Sim_Init(1);
+  car = Sim_AddBoard(firmware, 12000);
+  Sim_SpiLog(car, 1);
+  Sim_Run(SIM_MS(50), 0, 0);
+  log = Sim_Spi(car, &count);
+
+  write->frames = write->bytes = verify->frames = verify->bytes = 0;
+  for (i = 0; i < count && stage < 3; i += n)
+  {
+    for (n = 1; i + n < count && log[i + n].frame == log[i].frame; n++);
+    h = log[i].mosi;
+    if (stage == 0 && h == TI_CCxxx0_SRES)
+      stage = 1;
+    else if (stage == 1 && (h & 0x3F) == TI_CCxxx0_PATABLE)
+      stage = 2;
+    else if (stage == 2 && !(h & TI_CCxxx0_READ_SINGLE))
+      stage = 3;
+    else if (stage == 1)
+    {
+      if (!write->frames++)
+        first = log[i].time;
+      write->bytes += n;
+    }
+    else if (stage == 2)
+    {
+      verify->frames++;
+      verify->bytes += n;
+      last = log[i + n - 1].time;
+    }
+  }
+  CHECK(stage == 3);
+  return last - first;
+}
+
+int main(void)
+{
+  unsigned char program[] = {0x22};         // Forward, 2 units
+  Sim_Board *sender, *car;
+  const Sim_PinChange *pins;
+  Gui_Frame f;
+  Gui *gui;
+  Sim_Time on = 0, off = 0;
+  Count burstWrite, burstVerify, singleWrite, singleVerify;
+  Sim_Time burstTime, singleTime;
+  int n, i;
+
+  Sim_Init(1);
+  sender = Sim_AddBoard("fw_sender", 12000);
+  car = Sim_AddBoard("fw_car", 12000);
+  gui = Gui_Open(sender);
+  Sim_Run(SIM_MS(100), 0, 0);
+
+  Gui_Send(gui, GUI_PROGRAM, 1, program, sizeof(program));
+  CHECK(Gui_Expect(gui, GUI_ACK, 1, &f, SIM_MS(500)));
+  CHECK(Gui_Expect(gui, GUI_DONE, -1, &f, SIM_MS(1000)));
+
+  pins = Sim_Pins(car, &n);
+  for (i = 0; i < n; i++)
+  {
+    if (!on && pins[i].pins & PIN_FWD)
+      on = pins[i].time;
+    else if (on && !off && !(pins[i].pins & PIN_FWD))
+      off = pins[i].time;
+  }
+  CHECK(on && off);
+  CHECK(off - on > SIM_MS(45) && off - on < SIM_MS(55));
+  printf("forward %.3f ms after the frame, for %.3f ms\n",
+         (on - SIM_MS(100)) / 1e9, (off - on) / 1e9);
+
+  Gui_Close(gui);
+
+  burstTime = boot("fw_car", &burstWrite, &burstVerify);
+  singleTime = boot("fw_car_single", &singleWrite, &singleVerify);
+  printf("configuration   write          verify         time\n");
+  printf("burst          %2d /CS %3d B   %2d /CS %3d B   %4.0f us\n",
+         burstWrite.frames, burstWrite.bytes, burstVerify.frames,
+         burstVerify.bytes, burstTime / 1e6);
+  printf("per register   %2d /CS %3d B   %2d /CS %3d B   %4.0f us\n",
+         singleWrite.frames, singleWrite.bytes, singleVerify.frames,
+         singleVerify.bytes, singleTime / 1e6);
+  CHECK(burstWrite.frames == 3 && burstWrite.bytes == 3 + CONFIG_REGS);
+  CHECK(burstVerify.frames == 3 && burstVerify.bytes == 3 + CONFIG_REGS);
+  CHECK(singleWrite.frames == CONFIG_REGS);
+  CHECK(singleWrite.bytes == 2 * CONFIG_REGS);
+  CHECK(singleVerify.frames == CONFIG_REGS);
+  CHECK(singleVerify.bytes == 2 * CONFIG_REGS);
+  CHECK(burstTime < singleTime / 2);
+
+  Sim_Free();
+  return TEST_RESULT();
+}
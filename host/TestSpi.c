@@ -0,0 +1,176 @@
+//----------------------------------------------------------------------------
+//  Description:  The SPI bytes between the MSP430 and the radio, as the
+//  UCB0 model logs them: the TXFIFO load of RFSendPacketAsync() and the
+//  RXFIFO drain of RFReceivePacket(), both run from the USCI interrupt,
+//  send and read the packet bytes in order, one header byte per /CS low
+//  period, and nothing is clocked with /CS high
+//----------------------------------------------------------------------------
+
+#include "TI_CC/TI_CC_CC2500.h"
+#include "Gui.h"
+#include "Test.h"
+
+// As in CC2500.h and host/Node.c
+#define PROFILE_PLAIN           0
+#define PROFILE_FEC             1
+#define FEC_PKTLEN              55
+#define NODE_SINK               0xFE
+#define NODE_ADDR               1
+#define LENGTH                  24
+
+#define GAP_MS                  20
+#define RUN_MS                  500
+#define DRAIN_MS                100
+
+#define TX_LOAD   (TI_CCxxx0_TXFIFO | TI_CCxxx0_WRITE_BURST)
+#define RX_LENGTH (TI_CCxxx0_RXFIFO | TI_CCxxx0_READ_SINGLE)
+#define RX_DRAIN  (TI_CCxxx0_RXFIFO | TI_CCxxx0_READ_BURST)
+
+// One /CS low period of the log
+typedef struct
+{
+  const Sim_SpiByte *byte;
+  int count;                                // Header included
+} Frame;
+
+// The frame starting at log[*at], advancing *at past it
+static int nextFrame(const Sim_SpiByte *log, int count, int *at, Frame *f)
+{
+  int i = *at;
+
+  if (i >= count)
+    return 0;
+  CHECK(log[i].frame != 0);                 // No byte with /CS high
+  f->byte = &log[i];
+  for (f->count = 0; i < count && log[i].frame == f->byte->frame; i++)
+    f->count++;
+  if (i < count)
+    CHECK(log[i].frame > f->byte->frame);   // /CS went high in between
+  *at = i;
+  return 1;
+}
+
+// The data bytes of frame "f" starting at "offset", as sent or as read
+static int same(const Frame *f, int offset, const unsigned char *data,
+                int n, int mosi)
+{
+  int i;
+
+  for (i = 0; i < n; i++)
+    if ((mosi ? f->byte[offset + i].mosi : f->byte[offset + i].miso)
+        != data[i])
+      return 0;
+  return 1;
+}
+
+// The node's TXFIFO loads: the packet, in order, then in RF_PROFILE_FEC
+// the padding to FEC_PKTLEN in a frame of its own; the sequence number
+// counts up.  Returns the number of loads.
+static int loads(Sim_Board *node, int profile, unsigned char *firstSeq)
+{
+  unsigned char head[4] = {LENGTH - 1, NODE_SINK, NODE_ADDR, 0};
+  static const unsigned char zero[FEC_PKTLEN];
+  const Sim_SpiByte *log;
+  int count, at = 0, n = 0;
+  Frame f;
+
+  log = Sim_Spi(node, &count);
+  while (nextFrame(log, count, &at, &f))
+  {
+    if (f.byte[0].mosi != TX_LOAD)
+      continue;
+    CHECK(f.count == 1 + LENGTH);
+    head[3] = n ? head[3] + 1 : f.byte[4].mosi;
+    if (!n)
+      *firstSeq = head[3];
+    CHECK(same(&f, 1, head, sizeof(head), 1));
+    CHECK(same(&f, 1 + sizeof(head), zero, LENGTH - sizeof(head), 1));
+    if (profile == PROFILE_FEC)
+    {
+      CHECK(nextFrame(log, count, &at, &f));
+      CHECK(f.byte[0].mosi == TX_LOAD);
+      CHECK(f.count == 1 + FEC_PKTLEN - LENGTH);
+      CHECK(same(&f, 1, zero, FEC_PKTLEN - LENGTH, 1));
+    }
+    n++;
+  }
+  return n;
+}
+
+// The sink's drains: the length byte alone, then the packet, then in
+// RF_PROFILE_FEC the padding, then the two status bytes, each frame with
+// its own header.  Returns the number of packets read.
+static int drains(Sim_Board *sink, int profile, unsigned char seq)
+{
+  unsigned char head[3] = {NODE_SINK, NODE_ADDR, 0};
+  static const unsigned char zero[FEC_PKTLEN];
+  const Sim_SpiByte *log;
+  int count, at = 0, n = 0;
+  Frame f;
+
+  log = Sim_Spi(sink, &count);
+  while (nextFrame(log, count, &at, &f))
+  {
+    if (f.byte[0].mosi != RX_LENGTH)
+      continue;
+    CHECK(f.count == 2 && f.byte[1].miso == LENGTH - 1);
+    CHECK(nextFrame(log, count, &at, &f));
+    CHECK(f.byte[0].mosi == RX_DRAIN && f.count == LENGTH);
+    head[2] = seq + n;
+    CHECK(same(&f, 1, head, sizeof(head), 0));
+    CHECK(same(&f, 1 + sizeof(head), zero, LENGTH - 1 - sizeof(head), 0));
+    if (profile == PROFILE_FEC)
+    {
+      CHECK(nextFrame(log, count, &at, &f));
+      CHECK(f.byte[0].mosi == RX_DRAIN);
+      CHECK(f.count == 1 + FEC_PKTLEN - LENGTH);
+      CHECK(same(&f, 1, zero, FEC_PKTLEN - LENGTH, 0));
+    }
+    CHECK(nextFrame(log, count, &at, &f));
+    CHECK(f.byte[0].mosi == RX_DRAIN && f.count == 3);
+    CHECK(f.byte[2].miso & TI_CCxxx0_CRC_OK);
+    n++;
+  }
+  return n;
+}
+
+static void run(int profile)
+{
+  Sim_Board *sink, *node;
+  unsigned long interrupts;
+  unsigned char seq = 0;
+  int sent, read;
+
+  Sim_Init(profile + 1);
+  sink = Sim_AddBoard("fw_node", 12000);
+  node = Sim_AddBoard("fw_node", 12000);
+  *(char *)Sim_Symbol(sink, "nodeProfile") = (char)profile;
+  *(char *)Sim_Symbol(node, "nodeProfile") = (char)profile;
+  *(char *)Sim_Symbol(node, "nodeAddr") = NODE_ADDR;
+  *(char *)Sim_Symbol(node, "nodeLen") = LENGTH;
+  *(unsigned int *)Sim_Symbol(node, "nodeGapMs") = GAP_MS;
+  Sim_Run(SIM_MS(GAP_MS), 0, 0);            // Past the boot
+  Sim_SpiLog(sink, 1);
+  Sim_SpiLog(node, 1);
+  interrupts = Sim_BoardStats(node)->interrupts;
+  Sim_Run(SIM_MS(RUN_MS), 0, 0);
+  *(unsigned int *)Sim_Symbol(node, "nodeGapMs") = 0;
+  Sim_Run(SIM_MS(RUN_MS + DRAIN_MS), 0, 0);
+  interrupts = Sim_BoardStats(node)->interrupts - interrupts;
+
+  sent = loads(node, profile, &seq);
+  read = drains(sink, profile, seq);
+  printf("%-5s  %3d loads  %3d drains  %6lu node interrupts\n",
+         profile == PROFILE_FEC ? "FEC" : "PLAIN", sent, read, interrupts);
+  CHECK(sent > RUN_MS / GAP_MS / 4);
+  CHECK(read == sent);                      // Every packet heard
+  CHECK(interrupts >= (unsigned long)sent * LENGTH);  // One per byte
+}
+
+int main(void)
+{
+  run(PROFILE_PLAIN);
+  run(PROFILE_FEC);
+  Sim_Free();
+  return TEST_RESULT();
+}
@@ -0,0 +1,232 @@
+//----------------------------------------------------------------------------
+//  Description:  TDMA: cars without a slot join, then every car's PKT_DONE
+//  gets through in its own slot.  Fleets of 1, 4, 8 and 16 cars finish
+//  their programs together, so that every car reports in the same frame;
+//  once the cars hold their slots no report collides.  Up to LINE_CARS
+//  each is acked the first time, within a frame and its place in it; the
+//  sender acks no more than its report queue and the 9600 baud line to the
+//  GUI take, and the rest repeat in their slots of the next frames.
+//----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include "Gui.h"
+#include "Test.h"
+
+#define CARS                    3
+#define MAX_CARS                16          // TDMA_MAX_CARS
+#define DONE_CAR                14          // HOST_DONE: car's address
+
+// As in Motion.h, Encoding.h, TransferRx.c and Tdma.h
+#define UNIT_MS                 25
+#define FORWARD_VARINT          0x97        // ENC_EXTENDED, ENC_FORWARD, varint
+#define RPT_IDLE                0
+#define FRAME_MS                100
+#define SLOT_MS                 7           // A little over the 6.3 ms slot
+#define LINE_CARS               8           // Reports acked in one frame
+
+#define UPLOAD_MS               50          // Budget per car
+#define SETTLE_MS               200
+#define ROUND_MS                3000
+#define ROUNDS                  5           // Measured, after the one to join
+
+static int reported[MAX_CARS + 1];
+
+// Gui_Expect() that counts the HOST_DONEs it passes over on the way
+static int expect(Gui *gui, int type, int seq, Sim_Time timeout)
+{
+  Sim_Time end = Sim_Now() + timeout;
+  Gui_Frame f;
+
+  while (Sim_Now() < end && Gui_Wait(gui, &f, end - Sim_Now()))
+  {
+    if (f.type == GUI_DONE && f.len > DONE_CAR
+        && f.payload[DONE_CAR] >= 1 && f.payload[DONE_CAR] <= MAX_CARS)
+      reported[f.payload[DONE_CAR]]++;
+    if (f.type == type && (seq < 0 || f.seq == seq))
+      return 1;
+  }
+  return 0;
+}
+
+static Sim_Board *addCar(int car, double vloHz)
+{
+  char firmware[32];
+
+  snprintf(firmware, sizeof(firmware), "fw_car%d_tdma", car);
+  return Sim_AddBoard(firmware, vloHz);
+}
+
+// Each car's reports, timed from the simulator: reportState leaving
+// RPT_IDLE starts one, its return ends it; reportTries counts its resends.
+// The sender's beacon seq times the frames.
+typedef struct
+{
+  int cars;
+  volatile char *state[MAX_CARS], *tries[MAX_CARS], *beaconSeq;
+  char was[MAX_CARS], wasSeq;
+  Sim_Time start[MAX_CARS], total, longest, lastBeacon, frameTotal;
+  int reports, resent, frames;
+} Watch;
+
+static int watch(void *arg)
+{
+  Watch *w = arg;
+  int c;
+
+  for (c = 0; c < w->cars; c++)
+  {
+    if (*w->state[c] != RPT_IDLE && w->was[c] == RPT_IDLE)
+      w->start[c] = Sim_Now();
+    else if (*w->state[c] == RPT_IDLE && w->was[c] != RPT_IDLE)
+    {
+      w->total += Sim_Now() - w->start[c];
+      if (Sim_Now() - w->start[c] > w->longest)
+        w->longest = Sim_Now() - w->start[c];
+      w->reports++;
+      w->resent += *w->tries[c] != 0;
+    }
+    w->was[c] = *w->state[c];
+  }
+  if (*w->beaconSeq != w->wasSeq)
+  {
+    if (*w->beaconSeq == (char)(w->wasSeq + 1) && w->lastBeacon)
+    {                                       // Watched since the last one
+      w->frameTotal += Sim_Now() - w->lastBeacon;
+      w->frames++;
+    }
+    w->lastBeacon = Sim_Now();
+    w->wasSeq = *w->beaconSeq;
+  }
+  return 0;
+}
+
+// Every car gets a program that ends at the same time, at a random point
+// of the frame, uploaded one after the other; the round lasts until they
+// have all reported, well inside TDMA_IDLE_FRAMES so that they keep their
+// slots
+static void programs(Gui *gui, Watch *w, int *seq)
+{
+  unsigned char program[3] = {FORWARD_VARINT};
+  unsigned char target[2];
+  Sim_Time end = Sim_Now() + SIM_MS(w->cars * UPLOAD_MS + SETTLE_MS)
+                 + (Sim_Time)(Sim_Random() * SIM_MS(FRAME_MS));
+  int c, goal = w->reports + w->cars;
+  unsigned int units;
+  Gui_Frame f;
+
+  for (c = 1; c <= w->cars; c++)
+  {
+    units = (unsigned int)((end - Sim_Now()) / SIM_MS(UNIT_MS));
+    program[1] = 0x80 | (units & 0x7F);
+    program[2] = units >> 7;
+    target[0] = c;
+    target[1] = 0;
+    Gui_Send(gui, GUI_TARGET, ++*seq, target, 2);
+    CHECK(expect(gui, GUI_ACK, *seq, SIM_MS(1000)));
+    Gui_Send(gui, GUI_PROGRAM, ++*seq, program, sizeof(program));
+    CHECK(expect(gui, GUI_ACK, *seq, SIM_MS(1000)));
+  }
+  CHECK(Sim_Now() < end);
+  w->wasSeq = *w->beaconSeq;                // Frames from the next beacon
+  w->lastBeacon = 0;
+  while (w->reports < goal && Sim_Now() < end + SIM_MS(ROUND_MS))
+  {
+    Sim_Run(Sim_Now() + SIM_MS(UNIT_MS), watch, w);
+    while (Gui_Poll(gui, &f))               // Keep the GUI reading
+      ;
+  }
+}
+
+// A fleet of "cars": a round to join, then ROUNDS measured
+static void fleet(int cars)
+{
+  Sim_Board *sender, *board;
+  unsigned long lost;
+  Watch w = {0};
+  int c, r, seq = 0;
+  Gui *gui;
+
+  Sim_Init(100 + cars);
+  sender = Sim_AddBoard("fw_sender_tdma", 11000);
+  w.cars = cars;
+  for (c = 0; c < cars; c++)
+  {
+    board = addCar(c + 1, 6000 + 12000.0 * c / cars);
+    w.state[c] = Sim_Symbol(board, "reportState");
+    w.tries[c] = Sim_Symbol(board, "reportTries");
+  }
+  w.beaconSeq = (char *)Sim_Symbol(sender, "beacon") + 3;
+  gui = Gui_Open(sender);
+  Sim_Run(SIM_MS(500), 0, 0);               // A few beacons to sync on
+
+  programs(gui, &w, &seq);                  // Every car joins
+  Sim_Run(Sim_Now() + SIM_MS(FRAME_MS + cars * SLOT_MS), watch, &w);
+  CHECK(w.reports == cars);
+  CHECK(((char *)Sim_Symbol(sender, "beacon"))[8] == cars);
+
+  w.total = w.longest = 0;
+  w.reports = w.resent = w.frames = 0;
+  w.frameTotal = 0;
+  lost = Sim_BoardStats(sender)->packetsMissed
+         + Sim_BoardStats(sender)->packetsCorrupt;
+  for (r = 0; r < ROUNDS; r++)
+    programs(gui, &w, &seq);
+  lost = Sim_BoardStats(sender)->packetsMissed
+         + Sim_BoardStats(sender)->packetsCorrupt - lost;
+
+  printf("%3d cars  frame %5.1f ms  report wait mean %5.1f ms  longest "
+         "%5.1f ms  %d resent  %lu lost\n", cars,
+         w.frames ? w.frameTotal / 1e9 / w.frames : 0,
+         w.reports ? w.total / 1e9 / w.reports : 0, w.longest / 1e9,
+         w.resent, lost);
+  CHECK(w.reports == ROUNDS * cars);
+  CHECK(lost == 0);                         // No two in one slot
+  if (cars <= LINE_CARS)
+    CHECK(w.resent == 0
+          && w.longest < SIM_MS(FRAME_MS + (cars + 1) * SLOT_MS));
+  else
+    CHECK(w.frames && w.longest < 4 * w.frameTotal / w.frames);
+  Gui_Close(gui);
+}
+
+int main(void)
+{
+  static const int fleets[] = {1, 4, 8, 16};
+  unsigned char program[] = {0x21};         // Forward, 1 unit
+  unsigned char target[2];
+  Sim_Board *sender;
+  Gui *gui;
+  int c, seq = 0, round;
+
+  Sim_Init(7);
+  sender = Sim_AddBoard("fw_sender_tdma", 11000);
+  for (c = 0; c < CARS; c++)
+    addCar(c + 1, 8000 + 3000 * c);
+  gui = Gui_Open(sender);
+  Sim_Run(SIM_MS(500), 0, 0);               // A few beacons to sync on
+
+  for (round = 0; round < 3; round++)
+    for (c = 1; c <= CARS; c++)
+    {
+      target[0] = c;
+      target[1] = 0;
+      Gui_Send(gui, GUI_TARGET, ++seq, target, 2);
+      CHECK(expect(gui, GUI_ACK, seq, SIM_MS(200)));
+      Gui_Send(gui, GUI_PROGRAM, ++seq, program, sizeof(program));
+      CHECK(expect(gui, GUI_ACK, seq, SIM_MS(1000)));
+    }
+  while (expect(gui, GUI_DONE, -1, SIM_MS(2000)))
+    ;
+
+  for (c = 1; c <= CARS; c++)
+  {
+    printf("car %d: %d of 3 programs reported\n", c, reported[c]);
+    CHECK(reported[c] == 3);
+  }
+  Gui_Close(gui);
+
+  for (c = 0; c < (int)(sizeof(fleets) / sizeof(fleets[0])); c++)
+    fleet(fleets[c]);
+  Sim_Free();
+  return TEST_RESULT();
+}
@@ -0,0 +1,86 @@
+//----------------------------------------------------------------------------
+//  Description:  Fragmented program transfer: the car reassembles the whole
+//  program from the fragment bitmap, and the time to do so at 0-30 % loss
+//----------------------------------------------------------------------------
+
+#include <string.h>
+#include "Gui.h"
+#include "Test.h"
+
+#define PROGRAM_BYTES           240         // PKT_PROG_MAX
+#define FRAGMENTS               5           // Of PKT_FRAG_DATA bytes
+#define UPLOADS                 8           // Per loss rate
+
+// Upload one program over links losing "loss" of the packets each way.
+// Returns the time from the end of the frame to its ack, 0 if it failed.
+static Sim_Time upload(double loss, unsigned long seed, unsigned long *sent)
+{
+  Sim_Link link = {0, 0, 0, 0, 0, -50};
+  unsigned char program[PROGRAM_BYTES];
+  Sim_Board *sender, *car;
+  Sim_Time end, t = 0;
+  const char *slot;
+  Gui_Frame f;
+  Gui *gui;
+  int i;
+
+  for (i = 0; i < PROGRAM_BYTES; i++)       // Forward and backward 1-7
+    program[i] = (i & 1 ? 0x40 : 0x20) | (1 + i % 7);
+
+  Sim_Init(seed);
+  sender = Sim_AddBoard("fw_sender", 12000);
+  car = Sim_AddBoard("fw_car", 12000);
+  link.loss = loss;
+  Sim_SetLink(sender, car, &link);
+  Sim_SetLink(car, sender, &link);
+  gui = Gui_Open(sender);
+  Sim_Run(SIM_MS(100), 0, 0);
+
+  *sent = Sim_BoardStats(sender)->packetsSent;
+  end = Gui_Send(gui, GUI_PROGRAM, 1, program, sizeof(program));
+  if (Gui_Expect(gui, GUI_ACK, 1, &f, SIM_MS(5000)))
+  {
+    t = f.start - end;
+    slot = Sim_Symbol(car, "slot");         // Motion.c: slot[2][240]
+    CHECK(slot && (!memcmp(slot, program, PROGRAM_BYTES)
+                   || !memcmp(slot + PROGRAM_BYTES, program, PROGRAM_BYTES)));
+  }
+  *sent = Sim_BoardStats(sender)->packetsSent - *sent;
+  Gui_Close(gui);
+  return t;
+}
+
+int main(void)
+{
+  static const double loss[] = {0, 0.1, 0.2, 0.3};
+  unsigned long sent, packets;
+  Sim_Time t, sum, max;
+  int i, j, done;
+
+  printf("loss   done   mean ms    max ms   packets sent\n");
+  for (i = 0; i < 4; i++)
+  {
+    sum = max = 0;
+    done = 0;
+    packets = 0;
+    for (j = 0; j < UPLOADS; j++)
+    {
+      t = upload(loss[i], 1 + j, &sent);
+      packets += sent;
+      if (!t)
+        continue;
+      done++;
+      sum += t;
+      if (t > max)
+        max = t;
+      if (loss[i] == 0)                     // One burst, nothing resent
+        CHECK(sent == FRAGMENTS);
+    }
+    printf("%3.0f %%  %d/%d  %8.3f  %8.3f   %6.1f\n", 100 * loss[i], done,
+           UPLOADS, done ? sum / 1e9 / done : 0, max / 1e9,
+           (double)packets / UPLOADS);
+    CHECK(done == UPLOADS);
+  }
+  Sim_Free();
+  return TEST_RESULT();
+}
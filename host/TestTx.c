@@ -0,0 +1,155 @@
+//----------------------------------------------------------------------------
+//  Description:  RFSendPacketAsync() and its TX timeout: a normal send ends
+//  with the packet; a send whose GDO0 never falls is ended by the alarm,
+//  which flushes the FIFOs, resets the radio and goes back to RX with the
+//  send no longer pending; a second send while one is under way is
+//  refused, and only the first goes on the air
+//----------------------------------------------------------------------------
+
+#include "TI_CC/TI_CC_CC2500.h"
+#include "Gui.h"
+#include "Test.h"
+
+// As in CC2500.h, CC2500.c and host/Node.c
+#define PROFILE_PLAIN           0
+#define PROFILE_FEC             1
+#define TX_MARGIN_MS            10
+#define NODE_ADDR               1
+#define LENGTH                  24
+
+#define GAP_MS                  20
+#define RUN_MS                  500
+
+// The node's sends, timed from the simulator: RFSendPacketAsync() raises
+// txPending and the end of the packet (or the timeout) clears it
+typedef struct
+{
+  volatile char *pending;
+  char was;
+  Sim_Time start, total, longest;
+  unsigned int sends;
+} Watch;
+
+static int watch(void *arg)
+{
+  Watch *w = arg;
+
+  if (*w->pending && !w->was)
+    w->start = Sim_Now();
+  else if (!*w->pending && w->was)
+  {
+    w->total += Sim_Now() - w->start;
+    if (Sim_Now() - w->start > w->longest)
+      w->longest = Sim_Now() - w->start;
+    w->sends++;
+  }
+  w->was = *w->pending;
+  return 0;
+}
+
+static unsigned int counter(Sim_Board *board, const char *name)
+{
+  return *(unsigned int *)Sim_Symbol(board, name);
+}
+
+// The strobes of the timeout in the node's SPI log, in order, each one
+// header byte in a /CS low period of its own, then SRX to listen again
+static int timeoutStrobes(Sim_Board *node)
+{
+  static const unsigned char strobe[] =
+    {TI_CCxxx0_SIDLE, TI_CCxxx0_SFTX, TI_CCxxx0_SFRX, TI_CCxxx0_SRES,
+     TI_CCxxx0_SRX};
+  const Sim_SpiByte *log;
+  unsigned int frame = 0;
+  int count, i, s = 0;
+
+  log = Sim_Spi(node, &count);
+  for (i = 0; i < count && s < (int)sizeof(strobe); i++)
+  {
+    if (log[i].frame == frame)
+      continue;                             // Not a header byte
+    frame = log[i].frame;
+    if (log[i].mosi == strobe[s]
+        && (i + 1 == count || log[i + 1].frame != frame))
+      s++;
+    else if (s < 4)                         // Not back to back: over
+      s = log[i].mosi == strobe[0] && (i + 1 == count
+                                       || log[i + 1].frame != frame);
+  }
+  return s == sizeof(strobe);
+}
+
+static void run(int profile)
+{
+  Watch w = {0, 0, 0, 0, 0, 0};
+  unsigned int done, heard, airtimeUs, refused;
+  unsigned long sent;
+  Sim_Board *sink, *node;
+  double mean, hung;
+
+  Sim_Init(profile + 1);
+  sink = Sim_AddBoard("fw_node", 12000);
+  node = Sim_AddBoard("fw_node", 12000);
+  *(char *)Sim_Symbol(sink, "nodeProfile") = (char)profile;
+  *(char *)Sim_Symbol(node, "nodeProfile") = (char)profile;
+  *(char *)Sim_Symbol(node, "nodeAddr") = NODE_ADDR;
+  *(char *)Sim_Symbol(node, "nodeLen") = LENGTH;
+  *(unsigned int *)Sim_Symbol(node, "nodeGapMs") = GAP_MS;
+  w.pending = Sim_Symbol(node, "txPending");
+
+  // Normal sends: each ends with its packet
+  Sim_Run(SIM_MS(RUN_MS), watch, &w);
+  done = counter(node, "nodeDone");
+  airtimeUs = counter(node, "nodeAirtimeUs");
+  mean = w.sends ? w.total / 1e6 / w.sends : 0;
+  CHECK(done > RUN_MS / GAP_MS / 4);
+  CHECK(w.sends == done);
+  CHECK(counter(sink, "nodeHeard") == done);
+  CHECK(counter(node, "nodeDropped") == 0);
+  CHECK(*(char *)Sim_Symbol(node, "txTimeouts") == 0);
+  CHECK(mean > airtimeUs && mean < airtimeUs + 1000);
+
+  // The next packet never ends: the alarm takes the radio back
+  w.longest = 0;
+  Sim_SpiLog(node, 1);
+  Sim_RadioHang(node);
+  Sim_Run(SIM_MS(2 * RUN_MS), watch, &w);
+  Sim_SpiLog(node, 0);
+  hung = w.longest / 1e6;
+  CHECK(*(char *)Sim_Symbol(node, "txTimeouts") == 1);
+  CHECK(counter(node, "nodeDropped") == 1);
+  CHECK(hung >= airtimeUs / 1000 * 1000 + TX_MARGIN_MS * 1000);
+  CHECK(hung <= airtimeUs / 1000 * 1000 + (TX_MARGIN_MS + 3) * 1000);
+  CHECK(timeoutStrobes(node));
+  CHECK(counter(node, "nodeDone") > done + RUN_MS / GAP_MS / 4);
+  CHECK(counter(sink, "nodeHeard") == counter(node, "nodeDone"));
+
+  // Back to back: the second send is refused while the first is pending
+  done = counter(node, "nodeDone");
+  heard = counter(sink, "nodeHeard");
+  sent = Sim_BoardStats(node)->packetsSent;
+  *(char *)Sim_Symbol(node, "nodeTwice") = 1;
+  Sim_Run(SIM_MS(3 * RUN_MS), watch, &w);
+  *(unsigned int *)Sim_Symbol(node, "nodeGapMs") = 0;
+  Sim_Run(SIM_MS(3 * RUN_MS + 100), watch, &w);
+  refused = counter(node, "nodeRefused");
+  done = counter(node, "nodeDone") - done;
+  heard = counter(sink, "nodeHeard") - heard;
+  sent = Sim_BoardStats(node)->packetsSent - sent;
+  CHECK(done > RUN_MS / GAP_MS / 4);
+  CHECK(refused == done);
+  CHECK(sent == done && heard == done);     // Each packet once
+  CHECK(*w.pending == 0);
+
+  printf("%-5s  airtime %4u us  send to end %6.0f us  hung send %6.0f us"
+         "  refused %u of %u\n", profile == PROFILE_FEC ? "FEC" : "PLAIN",
+         airtimeUs, mean, hung, refused, done);
+}
+
+int main(void)
+{
+  run(PROFILE_PLAIN);
+  run(PROFILE_FEC);
+  Sim_Free();
+  return TEST_RESULT();
+}
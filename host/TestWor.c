@@ -0,0 +1,111 @@
+//----------------------------------------------------------------------------
+//  Description:  Wake-on-Radio: a node wakes a sniffing sink with the
+//  repeated burst of RFSendPacketAsync(), in each RFWorListen() setting and
+//  in RF_PROFILE_PLAIN and RF_PROFILE_FEC, at random phases of the sink's
+//  sniff cycle.  Every wake must land within the burst, so within one
+//  period and RF_WOR_MARGIN_MS of the send.
+//----------------------------------------------------------------------------
+
+#include "Gui.h"
+#include "Test.h"
+
+// As in CC2500.h and CC2500.c
+#define PROFILE_PLAIN           0
+#define PROFILE_FEC             1
+#define WOR_FAST                1
+#define WOR_SLOW                3
+#define WOR_MARGIN_MS           5
+#define FEC_PKTLEN              55
+#define NODE_ADDR               1
+
+#define GAP_MS                  2500        // Half the gaps outlast the
+#define WAKES                   25          // sink's RF_WOR_AWAKE_MS
+#define RUN_MS                  600000
+
+static const char *setting[] = {"", "FAST", "MEDIUM", "SLOW"};
+static const unsigned int periodMs[] = {0, 150, 300, 1200};
+
+// Sends seen from the simulator: the node's txPending rising starts one,
+// the sink's nodeHeard counting ends its wait, txPending falling ends it
+typedef struct
+{
+  volatile char *pending, *sinkAwake;
+  volatile unsigned int *heard;
+  char was, wake, woken;
+  unsigned int lastHeard;
+  Sim_Time start, total, longest;
+  int wakes, missed;
+} Watch;
+
+static int watch(void *arg)
+{
+  Watch *w = arg;
+
+  if (*w->pending && !w->was)
+  {
+    w->start = Sim_Now();
+    w->wake = !*w->sinkAwake;               // The sink is sniffing
+    w->woken = 0;
+    w->lastHeard = *w->heard;
+  }
+  else if (*w->pending && w->wake && !w->woken && *w->heard != w->lastHeard)
+  {
+    w->woken = 1;
+    w->total += Sim_Now() - w->start;
+    if (Sim_Now() - w->start > w->longest)
+      w->longest = Sim_Now() - w->start;
+  }
+  else if (!*w->pending && w->was && w->wake)
+  {
+    w->wakes++;
+    w->missed += !w->woken;
+  }
+  w->was = *w->pending;
+  return w->wakes >= WAKES;
+}
+
+static void run(int profile, int wor)
+{
+  Watch w = {0};
+  Sim_Board *sink, *node;
+
+  Sim_Init(10 * profile + wor);
+  sink = Sim_AddBoard("fw_node", 12000);
+  node = Sim_AddBoard("fw_node", 12000);
+  *(char *)Sim_Symbol(sink, "nodeProfile") = (char)profile;
+  *(char *)Sim_Symbol(node, "nodeProfile") = (char)profile;
+  *(char *)Sim_Symbol(sink, "nodeWor") = (char)wor;
+  *(char *)Sim_Symbol(node, "nodeWor") = (char)wor;
+  *(char *)Sim_Symbol(node, "nodeAddr") = NODE_ADDR;
+  *(char *)Sim_Symbol(node, "nodeLen") = FEC_PKTLEN;  // A full fragment
+  *(unsigned int *)Sim_Symbol(node, "nodeGapMs") = GAP_MS;
+  w.pending = Sim_Symbol(node, "txPending");
+  w.sinkAwake = Sim_Symbol(sink, "awake");
+  w.heard = Sim_Symbol(sink, "nodeHeard");
+  Sim_Run(SIM_MS(RUN_MS), watch, &w);
+
+  printf("%-5s  %-6s  %4u ms  %3d wakes  %d missed  mean %6.1f ms"
+         "  longest %6.1f ms\n", profile == PROFILE_FEC ? "FEC" : "PLAIN",
+         setting[wor], periodMs[wor], w.wakes, w.missed,
+         w.wakes > w.missed ? w.total / 1e9 / (w.wakes - w.missed) : 0,
+         w.longest / 1e9);
+  CHECK(w.wakes == WAKES);
+  CHECK(w.missed == 0);
+  CHECK(w.longest <= SIM_MS(periodMs[wor] + WOR_MARGIN_MS));
+  CHECK(w.wakes > w.missed                  // Random phases
+        && w.total / (w.wakes - w.missed) > SIM_MS(periodMs[wor]) / 4);
+}
+
+int main(void)
+{
+  int wor;
+
+  printf("profile setting  period   wakes     missed  wake latency\n");
+  for (wor = WOR_FAST; wor <= WOR_SLOW; wor++)
+  {
+    run(PROFILE_PLAIN, wor);
+    run(PROFILE_FEC, wor);
+  }
+  Sim_Free();
+  return TEST_RESULT();
+}
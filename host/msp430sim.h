@@ -0,0 +1,172 @@
+//----------------------------------------------------------------------------
+//  Description:  Simulated MSP430F2274 registers for the host build
+//
+//  Stands in for msp430x22x4.h when the firmware is built for the host
+//  simulator (TI_CC_DEVICE="msp430sim.h", see TI_CC_msp430.h).  Every
+//  register access goes through Sim_Reg(), which lets the simulated clocks,
+//  timers, USCIs and radio catch up with the CPU first, and returns the
+//  register's word in the board's register file.  The intrinsics are host
+//  functions in Sim.c for the same reason.
+//
+//  Registers the MSP430 has as 16 bits are unsigned int, 32 bits on the
+//  host: TAR and TBR count to 2^32 instead of wrapping at 2^16.  The TX
+//  buffers are accessed as 16 bits, so that writing any byte is told apart
+//  from the 0x100 the simulator leaves there.  The simulator itself includes
+//  this file with SIM_HOST defined, where each register name is its address.
+//----------------------------------------------------------------------------
+
+#ifndef SIM_HOST
+#define SIM_R8(a)               (*(volatile unsigned char *)Sim_Reg(a))
+#define SIM_R16(a)              (*(volatile unsigned int *)Sim_Reg(a))
+#define SIM_TX(a)               (*(volatile unsigned short *)Sim_Reg(a))
+void *Sim_Reg(unsigned int address);
+#else
+#define SIM_R8(a)               (a)
+#define SIM_R16(a)              (a)
+#define SIM_TX(a)               (a)
+#endif
+
+// Special function, clock and flash registers
+#define IE1                     SIM_R8(0x0000)
+#define IE2                     SIM_R8(0x0001)
+#define IFG1                    SIM_R8(0x0002)
+#define IFG2                    SIM_R8(0x0003)
+#define BCSCTL3                 SIM_R8(0x0053)
+#define DCOCTL                  SIM_R8(0x0056)
+#define BCSCTL1                 SIM_R8(0x0057)
+#define BCSCTL2                 SIM_R8(0x0058)
+#define WDTCTL                  SIM_R16(0x0120)
+#define FCTL1                   SIM_R16(0x0128)
+#define FCTL2                   SIM_R16(0x012A)
+#define FCTL3                   SIM_R16(0x012C)
+#define CALDCO_16MHZ            SIM_R8(0x10F8)
+#define CALBC1_16MHZ            SIM_R8(0x10F9)
+#define CALDCO_8MHZ             SIM_R8(0x10FC)
+#define CALBC1_8MHZ             SIM_R8(0x10FD)
+#define CALDCO_1MHZ             SIM_R8(0x10FE)
+#define CALBC1_1MHZ             SIM_R8(0x10FF)
+
+// Ports
+#define P3IN                    SIM_R8(0x0018)
+#define P3OUT                   SIM_R8(0x0019)
+#define P3DIR                   SIM_R8(0x001A)
+#define P3SEL                   SIM_R8(0x001B)
+#define P1IN                    SIM_R8(0x0020)
+#define P1OUT                   SIM_R8(0x0021)
+#define P1DIR                   SIM_R8(0x0022)
+#define P1IFG                   SIM_R8(0x0023)
+#define P1IES                   SIM_R8(0x0024)
+#define P1IE                    SIM_R8(0x0025)
+#define P1SEL                   SIM_R8(0x0026)
+#define P1REN                   SIM_R8(0x0027)
+#define P2IN                    SIM_R8(0x0028)
+#define P2OUT                   SIM_R8(0x0029)
+#define P2DIR                   SIM_R8(0x002A)
+#define P2IFG                   SIM_R8(0x002B)
+#define P2IES                   SIM_R8(0x002C)
+#define P2IE                    SIM_R8(0x002D)
+#define P2SEL                   SIM_R8(0x002E)
+#define P2REN                   SIM_R8(0x002F)
+
+// USCI_A0 (UART) and USCI_B0 (SPI to the CC2500)
+#define UCA0CTL0                SIM_R8(0x0060)
+#define UCA0CTL1                SIM_R8(0x0061)
+#define UCA0BR0                 SIM_R8(0x0062)
+#define UCA0BR1                 SIM_R8(0x0063)
+#define UCA0MCTL                SIM_R8(0x0064)
+#define UCA0STAT                SIM_R8(0x0065)
+#define UCA0RXBUF               SIM_R8(0x0066)
+#define UCA0TXBUF               SIM_TX(0x0067)
+#define UCB0CTL0                SIM_R8(0x0068)
+#define UCB0CTL1                SIM_R8(0x0069)
+#define UCB0BR0                 SIM_R8(0x006A)
+#define UCB0BR1                 SIM_R8(0x006B)
+#define UCB0MCTL                SIM_R8(0x006C)
+#define UCB0STAT                SIM_R8(0x006D)
+#define UCB0RXBUF               SIM_R8(0x006E)
+#define UCB0TXBUF               SIM_TX(0x006F)
+
+// Timer_A3 and Timer_B3
+#define TAIV                    SIM_R16(0x012E)
+#define TACTL                   SIM_R16(0x0160)
+#define TACCTL0                 SIM_R16(0x0162)
+#define TACCTL1                 SIM_R16(0x0164)
+#define TACCTL2                 SIM_R16(0x0166)
+#define TAR                     SIM_R16(0x0170)
+#define TACCR0                  SIM_R16(0x0172)
+#define TACCR1                  SIM_R16(0x0174)
+#define TACCR2                  SIM_R16(0x0176)
+#define TBCTL                   SIM_R16(0x0180)
+#define TBR                     SIM_R16(0x0190)
+
+// Register bits
+#define WDTPW                   0x5A00
+#define WDTHOLD                 0x0080
+#define UCA0RXIE                0x01
+#define UCA0TXIE                0x02
+#define UCB0RXIE                0x04
+#define UCB0TXIE                0x08
+#define UCA0RXIFG               0x01
+#define UCA0TXIFG               0x02
+#define UCB0RXIFG               0x04
+#define UCB0TXIFG               0x08
+#define LFXT1S_2                0x20
+#define UCSYNC                  0x01
+#define UCMST                   0x08
+#define UCMSB                   0x20
+#define UCCKPL                  0x40
+#define UCSWRST                 0x01
+#define UCSSEL_2                0x80
+#define UCOS16                  0x01
+#define UCOE                    0x20
+#define TACLR                   0x0004
+#define TBCLR                   0x0004
+#define TAIFG                   0x0001
+#define TAIE                    0x0002
+#define MC_0                    0x0000
+#define MC_1                    0x0010
+#define MC_2                    0x0020
+#define ID_0                    0x0000
+#define ID_3                    0x00C0
+#define TASSEL_1                0x0100
+#define TASSEL_2                0x0200
+#define TBSSEL_1                0x0100
+#define TBSSEL_2                0x0200
+#define CCIFG                   0x0001
+#define COV                     0x0002
+#define CCIE                    0x0010
+#define CAP                     0x0100
+#define SCS                     0x0800
+#define CCIS_1                  0x1000
+#define CM_1                    0x4000
+#define FWKEY                   0xA500
+#define FRKEY                   0x9600
+#define ERASE                   0x0002
+#define WRT                     0x0040
+#define FSSEL_1                 0x0040
+#define BUSY                    0x0001
+#define LOCK                    0x0010
+#define GIE                     0x0008
+#define CPUOFF                  0x0010
+#define OSCOFF                  0x0020
+#define SCG0                    0x0040
+#define SCG1                    0x0080
+#define LPM0_bits               (CPUOFF)
+#define LPM3_bits               (SCG1+SCG0+CPUOFF)
+
+// Intrinsics; "#pragma vector" is ignored and ISRs are found by name
+#define __interrupt
+typedef unsigned int __istate_t;
+void _BIS_SR(unsigned int bits);
+void _BIC_SR_IRQ(unsigned int bits);
+void _DINT(void);
+void _EINT(void);
+void __disable_interrupt(void);
+void __enable_interrupt(void);
+__istate_t __get_interrupt_state(void);
+void __set_interrupt_state(__istate_t state);
+
+// Flash the firmware writes through the flash controller (Cache.c).  GCC
+// puts const volatile data with the other globals; the relocation read-only
+// area keeps it on pages of its own, which the simulator write-protects.
+#define CACHE_FLASH_PLACEMENT   __attribute__((section(".data.rel.ro.flash")))